@@ -25,6 +25,7 @@
 
 #include "vulkan/vk_layer.h"
 #include "vk_layer_table.h"
+#include "api_dump_json.h"
 #include <vulkan/utility/vk_dispatch_table.h>
 
 #include <vulkan/layer/vk_layer_settings.hpp>
@@ -41,8 +42,11 @@
 #include "vk_video/vulkan_video_codec_av1std_decode.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <fstream>
 #include <mutex>
 #include <iomanip>
@@ -51,15 +55,21 @@
 #include <sstream>
 #include <string.h>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <map>
 #include <set>
+#include <shared_mutex>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 #include <unordered_set>
 #include <utility>
 
+#if !defined(_WIN32)
+#include <signal.h>
+#endif
+
 #ifdef ANDROID
 #include <memory>
 #include <string_view>
@@ -85,7 +95,12 @@
 #define kSettingsKeyDetailedOutput "detailed"
 #define kSettingsKeyNoAddr "no_addr"
 #define kSettingsKeyFlush "flush"
+#define kSettingsKeyFlushPolicy "flush_policy"
+#define kSettingsKeyFlushInterval "flush_interval"
+#define kSettingsKeyFlushSize "flush_size"
 #define kSettingsKeyOutputRange "output_range"
+#define kSettingsKeyCallRange "call_range"
+#define kSettingsKeyCommandRange "command_range"
 #define kSettingsKeyTimestamp "timestamp"
 #define kSettingsKeyIndentSize "indent_size"
 #define kSettingsKeyShowTypes "show_types"
@@ -94,6 +109,15 @@
 #define kSettingsKeyUseSpaces "use_spaces"
 #define kSettingsKeyShowShader "show_shader"
 #define kSettingsKeyShowThreadAndFrame "show_thread_and_frame"
+#define kSettingsKeyControlFile "control_file"
+#define kSettingsKeyOutputSocket "output_socket"
+#define kSettingsKeySocketBufferSize "socket_buffer_size"
+#define kSettingsKeySocketBackpressure "socket_backpressure"
+#define kSettingsKeySocketReconnectInterval "socket_reconnect_interval"
+#define kSettingsKeyFilePerThread "file_per_thread"
+#define kSettingsKeyHtmlFramesPerPage "html_frames_per_page"
+#define kSettingsKeyCsvParams "csv_params"
+#define kSettingsKeyCsvDepth "csv_depth"
 
 // We want to dump all extensions even beta extensions.
 #ifndef VK_ENABLE_BETA_EXTENSIONS
@@ -128,44 +152,189 @@
 
 #endif  // __APPLE__
 
+// The output formats compiled into the layer are selected with APIDUMP_OUTPUT_FORMATS in layersvt/CMakeLists.txt.
+#if !defined(API_DUMP_FORMAT_TEXT) && !defined(API_DUMP_FORMAT_HTML) && !defined(API_DUMP_FORMAT_JSON) && \
+    !defined(API_DUMP_FORMAT_BINARY) && !defined(API_DUMP_FORMAT_NDJSON) && !defined(API_DUMP_FORMAT_CSV)
+#error "At least one of the API_DUMP_FORMAT_TEXT, HTML, JSON, BINARY, NDJSON or CSV definitions must be set!"
+#endif
+
+// Number of calls to a command during a frame, dumped in place of the calls in statistics mode
+struct ApiDumpCallCount {
+    const char *name;
+    uint64_t count;
+};
+
+// The json, binary, ndjson and csv formats are written by the table driven walker of api_dump_reflection.cpp
+#if defined(API_DUMP_FORMAT_JSON) || defined(API_DUMP_FORMAT_BINARY) || defined(API_DUMP_FORMAT_NDJSON) || \
+    defined(API_DUMP_FORMAT_CSV)
+#define API_DUMP_REFLECTION
+#include "api_dump_reflection.h"
+#include "api_dump_socket.h"
+#endif
+
 enum class ApiDumpFormat {
     Text,
     Html,
     Json,
+    Binary,
+    Ndjson,
+    Csv,
+};
+
+// Extension appended to the output file name, and the default file name when only the file setting is used
+inline const char *outputFileExtension(ApiDumpFormat format) {
+    switch (format) {
+        case ApiDumpFormat::Html:
+            return ".html";
+        case ApiDumpFormat::Json:
+            return ".json";
+        case ApiDumpFormat::Binary:
+            return ".bin";
+        case ApiDumpFormat::Ndjson:
+            return ".ndjson";
+        case ApiDumpFormat::Csv:
+            return ".csv";
+        default:
+            return ".txt";
+    }
+}
+
+inline bool isFormatEnabled(ApiDumpFormat format) {
+    switch (format) {
+#if defined(API_DUMP_FORMAT_TEXT)
+        case ApiDumpFormat::Text:
+            return true;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
+        case ApiDumpFormat::Html:
+            return true;
+#endif
+#if defined(API_DUMP_FORMAT_JSON)
+        case ApiDumpFormat::Json:
+            return true;
+#endif
+#if defined(API_DUMP_FORMAT_BINARY)
+        case ApiDumpFormat::Binary:
+            return true;
+#endif
+#if defined(API_DUMP_FORMAT_NDJSON)
+        case ApiDumpFormat::Ndjson:
+            return true;
+#endif
+#if defined(API_DUMP_FORMAT_CSV)
+        case ApiDumpFormat::Csv:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+// When the output is written to the file or stdout. Every flush is a system call, so flushing less often makes file output
+// much faster at the cost of losing the buffered calls if the process is killed. Crashes still flush, see installCrashHandler().
+enum class ApiDumpFlushPolicy {
+    Never,          // The flush setting is false, only the stream decides when to write
+    EveryCall,      // Flush after the head and at the end of each call
+    EveryFrame,     // Flush at vkQueuePresentKHR
+    EveryInterval,  // Flush after a call when flush_interval milliseconds have passed since the last flush
+    OnSize,         // Flush when flush_size bytes are buffered
+};
+
+// What is done with the calls, changed at run time by the control file
+enum class ApiDumpCaptureMode : uint8_t {
+    Off,         // Calls are not dumped
+    Full,        // Calls are dumped in the output format
+    Statistics,  // Calls are only counted, the counts are dumped at the end of each frame
 };
 
 static const uint64_t OUTPUT_RANGE_UNLIMITED = 0;
 static const uint64_t OUTPUT_RANGE_INTERVAL_DEFAULT = 1;
 
-struct FrameRange {
-    uint64_t start_frame;  // The range begins on this frame, inclusive.
-    uint64_t frame_count;  // If value is OUTPUT_RANGE_UNLIMITED, dump continues without limit.
-    uint64_t interval;     // Rate at which frames are dumped. A value of 3 will dump every third frame.
-};
+// A set of indices, frames or calls, given as a list of ranges. The ranges are compiled into sorted, disjoint segments, so
+// finding an index is a binary search however many ranges there are.
+class ConditionalOutputRange {
+    struct Progression {
+        uint64_t start;     // The range begins on this index, inclusive.
+        uint64_t end;       // The range ends before this index, UINT64_MAX if the range is unlimited.
+        uint64_t interval;  // Rate at which indices are selected. A value of 3 selects every third index.
+    };
+
+    // Indices in [begin, end) covered by the same ranges. When a range of every index covers the segment, all its indices
+    // are selected, otherwise the progressions [first, first + count) of segment_progressions are checked.
+    struct Segment {
+        uint64_t begin;
+        uint64_t end;
+        bool every;
+        uint32_t first;
+        uint32_t count;
+    };
 
-class ConditionalFrameOutput {
     bool use_conditional_output = false;
-    std::set<uint64_t> frames;
-    std::vector<FrameRange> ranges;
+    std::vector<Progression> progressions;
+    std::vector<Segment> segments;
+    std::vector<Progression> segment_progressions;
 
     struct NumberToken {
         uint64_t value;
         uint32_t length;
     };
 
-    NumberToken parseNumber(std::string str, uint32_t current_char) {
+    NumberToken parseNumber(const std::string &str, uint32_t current_char) {
         uint32_t length = 0;
         while (current_char + length < str.size() && str[current_char + length] >= '0' && str[current_char + length] <= '9') {
             length++;
         }
         if (length > 0) {
-            uint64_t value = std::atol(&str[current_char]);
+            uint64_t value = std::strtoull(&str[current_char], nullptr, 10);
             return NumberToken{value, length};
         } else {
             return NumberToken{0, 0};
         }
     }
 
+    void addRange(uint64_t start, uint64_t count, uint64_t interval) {
+        const uint64_t end = (count == OUTPUT_RANGE_UNLIMITED || start > UINT64_MAX - count) ? UINT64_MAX : start + count;
+        progressions.push_back(Progression{start, end, interval == 0 ? OUTPUT_RANGE_INTERVAL_DEFAULT : interval});
+    }
+
+    // Splits the ranges at each of their bounds. Adjacent segments of every index are merged, so a list of single frames
+    // and contiguous ranges compiles to a few segments.
+    void compile() {
+        std::vector<uint64_t> bounds;
+        for (const Progression &progression : progressions) {
+            bounds.push_back(progression.start);
+            bounds.push_back(progression.end);
+        }
+        std::sort(bounds.begin(), bounds.end());
+        bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+        segments.clear();
+        segment_progressions.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i++) {
+            Segment segment{bounds[i], bounds[i + 1], false, static_cast<uint32_t>(segment_progressions.size()), 0};
+            for (const Progression &progression : progressions) {
+                if (progression.start > segment.begin || progression.end < segment.end) continue;
+                if (progression.interval == OUTPUT_RANGE_INTERVAL_DEFAULT) {
+                    segment.every = true;
+                    break;
+                }
+                segment_progressions.push_back(progression);
+                segment.count++;
+            }
+            if (segment.every) {
+                segment_progressions.resize(segment.first);
+                segment.count = 0;
+                if (!segments.empty() && segments.back().every && segments.back().end == segment.begin) {
+                    segments.back().end = segment.end;
+                    continue;
+                }
+            } else if (segment.count == 0) {
+                continue;
+            }
+            segments.push_back(segment);
+        }
+    }
+
     void printErrorMsg(const char *msg) {
 #ifdef ANDROID
         __android_log_print(ANDROID_LOG_DEBUG, "api_dump", "%s", msg);
@@ -175,13 +344,13 @@ class ConditionalFrameOutput {
     }
 
    public:
-    /* Parses a string for a comma seperated list of frames & frame ranges
-     * where frames are singular integers and frame ranges are of the following
-     * format: "S-C-I" with S is the start frame, C is the count of frames to dump,
-     * and I the interval between dumped frames.
+    /* Parses a string for a comma seperated list of indices & index ranges
+     * where indices are singular integers and ranges are of the following
+     * format: "S-C-I" with S is the start index, C is the count of indices to dump,
+     * and I the interval between dumped indices.
      * Valid range strings: "2,3,5", "4-4-2", "3-6, 10-2"
      */
-    bool parseConditionalFrameRange(std::string range_str) {
+    bool parseConditionalRange(const std::string &range_str) {
         uint32_t current_char = 0;
 
         if (range_str.empty()) {
@@ -190,95 +359,68 @@ class ConditionalFrameOutput {
         }
 
         while (current_char < range_str.size()) {
-            NumberToken frame_number = parseNumber(range_str, current_char);
-            if (frame_number.length <= 0) {
-                printErrorMsg("Conditional range error: Invalid frame number\n");
+            while (current_char < range_str.size() && range_str[current_char] == ' ') current_char++;
+            NumberToken start = parseNumber(range_str, current_char);
+            if (start.length <= 0) {
+                printErrorMsg("Conditional range error: Invalid start number\n");
                 return false;
             }
-            current_char += frame_number.length;
+            current_char += start.length;
 
-            // Range of frames
-            if (range_str[current_char] == '-') {
+            if (current_char < range_str.size() && range_str[current_char] == '-') {
                 current_char++;
-                if (current_char >= range_str.size()) {
-                    printErrorMsg("Conditional range error: Must have number for frame count\n");
+                NumberToken count = parseNumber(range_str, current_char);
+                if (count.length <= 0) {
+                    printErrorMsg("Conditional range error: Invalid count\n");
                     return false;
                 }
-                NumberToken frame_count = parseNumber(range_str, current_char);
-                if (frame_count.length <= 0) {
-                    printErrorMsg("Conditional range error: Invalid frame count\n");
-                    return false;
-                }
-                current_char += frame_count.length;
-
-                if (current_char >= range_str.size()) {
-                    // Frame Range w/o interval
-                    ranges.push_back(FrameRange{frame_number.value, frame_count.value, 1l});
-                    use_conditional_output = true;
-                    return true;
-                }
+                current_char += count.length;
 
-                else if (range_str[current_char] == '-') {
+                NumberToken interval{OUTPUT_RANGE_INTERVAL_DEFAULT, 0};
+                if (current_char < range_str.size() && range_str[current_char] == '-') {
                     current_char++;
-                    if (current_char >= range_str.size()) {
-                        printErrorMsg("Conditional range error: Must have number for frame interval \n");
-                        return false;
-                    }
-
-                    NumberToken frame_interval = parseNumber(range_str, current_char);
-                    if (frame_interval.length <= 0) {
+                    interval = parseNumber(range_str, current_char);
+                    if (interval.length <= 0 || interval.value == 0) {
                         printErrorMsg("Conditional range error: Invalid interval\n");
                         return false;
                     }
-
-                    // Frame Range w/ interval
-                    ranges.push_back(FrameRange{frame_number.value, frame_count.value, frame_interval.value});
-
-                    current_char += frame_interval.length;
-                    if (current_char >= range_str.size()) {
-                        use_conditional_output = true;
-                        return true;
-                    }
-                } else {
-                    // Frame Range w/o interval
-                    ranges.push_back(FrameRange{frame_number.value, frame_count.value, 1l});
+                    current_char += interval.length;
                 }
+                addRange(start.value, count.value, interval.value);
             } else {
-                // Single frame capture
-                frames.insert(frame_number.value);
+                // Single index
+                addRange(start.value, 1, OUTPUT_RANGE_INTERVAL_DEFAULT);
             }
-            if (range_str[current_char] == ',') {
+
+            while (current_char < range_str.size() && range_str[current_char] == ' ') current_char++;
+            if (current_char < range_str.size()) {
+                if (range_str[current_char] != ',') {
+                    printErrorMsg("Conditional range error: Expected a comma between ranges\n");
+                    return false;
+                }
                 current_char++;
             }
         }
+        compile();
         use_conditional_output = true;
         return true;
     }
 
-    // Return true if either use_conditional_output is false or if frame_count is within
-    // the provided frame ranges
-    bool isFrameInRange(uint64_t frame_number) const {
-        if (!use_conditional_output) return true;
-        for (auto &range : ranges) {
-            if (range.start_frame <= frame_number) {
-                if (range.frame_count == OUTPUT_RANGE_UNLIMITED) {
-                    if (range.interval == OUTPUT_RANGE_INTERVAL_DEFAULT) {
-                        return true;
-                    } else {
-                        return (frame_number - range.start_frame) % range.interval == 0;
-                    }
+    bool empty() const { return !use_conditional_output; }
 
-                } else if (range.start_frame + range.frame_count > frame_number) {
-                    if (range.interval == OUTPUT_RANGE_INTERVAL_DEFAULT) {
-                        return true;
-                    } else {
-                        return (frame_number - range.start_frame) % range.interval == 0;
-                    }
-                }
-            }
-        }
-        if (frames.count(frame_number) > 0) {
-            return true;
+    // Return true if either use_conditional_output is false or if index is within
+    // the provided ranges
+    bool isInRange(uint64_t index) const {
+        if (!use_conditional_output) return true;
+        auto segment = std::upper_bound(segments.begin(), segments.end(), index,
+                                        [](uint64_t value, const Segment &entry) { return value < entry.begin; });
+        if (segment == segments.begin()) return false;
+        --segment;
+        if (index >= segment->end) return false;
+        if (segment->every) return true;
+        for (uint32_t i = segment->first; i < segment->first + segment->count; i++) {
+            const Progression &progression = segment_progressions[i];
+            if ((index - progression.start) % progression.interval == 0) return true;
         }
         return false;
     }
@@ -375,6 +517,14 @@ static const char *GetDefaultPrefix() {
 #endif
 }
 
+// Output file of a single thread, with the file_per_thread setting
+struct ApiDumpThreadOutput {
+    std::vector<char> buffer;  // Declared before file so that it outlives the final flush
+    std::ofstream file;
+    std::chrono::steady_clock::time_point last_flush_time = std::chrono::steady_clock::now();
+    ApiDumpThreadOutput *next = nullptr;  // Output of the thread created before, see ApiDumpSettings::thread_output_list
+};
+
 class ApiDumpSettings {
    public:
     ApiDumpSettings() : output_stream(std::cout.rdbuf()) {
@@ -385,50 +535,56 @@ class ApiDumpSettings {
     }
 
     ~ApiDumpSettings() {
-        if (output_format == ApiDumpFormat::Html) {
-            // Close off html
-            output_stream << "</div></body></html>";
-        } else if (output_format == ApiDumpFormat::Json) {
-            // Close off json
-            output_stream << "\n]" << std::endl;
+        uninstallCrashHandler();
+        if (html_frames_per_page > 0) {
+            finishHtmlIndex();
+        } else {
+            writeOutputFooter();
+        }
+#if defined(API_DUMP_REFLECTION)
+        if (output_socket && output_socket->droppedRecords() > 0) {
+            printErrorMsg(("api_dump dropped " + std::to_string(output_socket->droppedRecords()) +
+                           " records that could not be sent to " + output_socket_path + "\n")
+                              .c_str());
         }
+#endif
     }
 
-    void setupInterFrameOutputFormatting(uint64_t frame_count) const /*name change? */
-    {
-        static bool hasPrintedAFrame = false;
+    // Closes the output of the previous frame and starts the output of frame_count if it is in the output range
+    void setupInterFrameOutputFormatting(uint64_t frame_count) {
+        closeFrameOutput();
+        if (rotation_requested) {
+            rotation_requested = false;
+            rotateOutputFile();
+        }
+        if (html_frames_per_page > 0) {
+            updateHtmlPage(frame_count);
+        }
+        if (!condFrameOutput.isInRange(frame_count)) return;
+
+        frame_output_open = true;
         switch (format()) {
             case (ApiDumpFormat::Html):
-                if (frame_count > 0) {
-                    if (condFrameOutput.isFrameInRange(frame_count - 1)) output_stream << "</details>";
-                }
-                if (condFrameOutput.isFrameInRange(frame_count)) {
-                    output_stream << "<details class='frm'><summary>Frame ";
-                    if (show_thread_and_frame) {
-                        output_stream << frame_count;
-                    }
-                    output_stream << "</summary>";
+                page_last_frame = frame_count;
+                output_stream << "<details class='frm'><summary>Frame ";
+                if (show_thread_and_frame) {
+                    output_stream << frame_count;
                 }
+                output_stream << "</summary>";
                 break;
 
             case (ApiDumpFormat::Json):
-
-                if (frame_count > 0) {
-                    if (condFrameOutput.isFrameInRange(frame_count - 1)) output_stream << "\n" << indentation(1) << "]\n}";
+                if (!has_printed_a_frame) {
+                    has_printed_a_frame = true;
+                } else {
+                    output_stream << ",\n";
                 }
-                if (condFrameOutput.isFrameInRange(frame_count)) {
-                    if (!hasPrintedAFrame) {
-                        hasPrintedAFrame = true;
-                    } else {
-                        output_stream << ",\n";
-                    }
-                    output_stream << "{\n";
-                    if (show_thread_and_frame) {
-                        output_stream << indentation(1) << "\"frameNumber\" : \"" << frame_count << "\",\n";
-                    }
-                    output_stream << indentation(1) << "\"apiCalls\" :\n";
-                    output_stream << indentation(1) << "[\n";
+                output_stream << "{\n";
+                if (show_thread_and_frame) {
+                    output_stream << indentation(1) << "\"frameNumber\" : \"" << frame_count << "\",\n";
                 }
+                output_stream << indentation(1) << "\"apiCalls\" :\n";
+                output_stream << indentation(1) << "[\n";
                 break;
             case (ApiDumpFormat::Text):
                 break;
@@ -437,7 +593,9 @@ class ApiDumpSettings {
         }
     }
 
-    void closeFrameOutput() const {
+    void closeFrameOutput() {
+        if (!frame_output_open) return;
+        frame_output_open = false;
         switch (format()) {
             case (ApiDumpFormat::Html):
                 output_stream << "</details>";
@@ -452,6 +610,26 @@ class ApiDumpSettings {
         }
     }
 
+    // Replaces the frames set by the output_range setting. Returns false, and keeps the current frames, if range can't be parsed.
+    bool setOutputRange(const std::string &range) {
+        ConditionalOutputRange frames;
+        if (range != "0-0" && !frames.parseConditionalRange(range)) return false;
+        condFrameOutput = frames;
+        return true;
+    }
+
+    // Continues the output in a new file when the next frame starts. Returns false if the output isn't written to a file.
+    bool requestOutputRotation() {
+        if (!output_file_stream.is_open() || html_frames_per_page > 0) return false;
+        rotation_requested = true;
+        return true;
+    }
+
+    const std::string &controlFile() const { return control_file; }
+
+    // Counted for the index of the html pages
+    void countHtmlPageCall() { page_calls++; }
+
     ApiDumpFormat format() const { return output_format; }
 
     void formatNameType(int indents, const char *name, const char *type) const {
@@ -479,7 +657,31 @@ class ApiDumpSettings {
         return "";
     }
 
-    bool shouldFlush() const { return should_flush; }
+    // Called after the head of a call and at the end of each call
+    void flushCallOutput() const {
+        switch (flush_policy) {
+            case ApiDumpFlushPolicy::EveryCall:
+                stream().flush();
+                break;
+            case ApiDumpFlushPolicy::EveryInterval: {
+                // Each thread output has its own interval
+                const auto now = std::chrono::steady_clock::now();
+                auto &last_flush = thread_output ? thread_output->last_flush_time : last_flush_time;
+                if (now - last_flush >= flush_interval) {
+                    stream().flush();
+                    last_flush = now;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Called when a frame ends. With file_per_thread, only the output of the thread presenting is flushed.
+    void flushFrameOutput() const {
+        if (flush_policy == ApiDumpFlushPolicy::EveryFrame) stream().flush();
+    }
 
     bool showAddress() const { return show_address; }
 
@@ -493,11 +695,65 @@ class ApiDumpSettings {
 
     bool showThreadAndFrame() const { return show_thread_and_frame; }
 
+    // Parameters given their own column in the csv output, as paths such as pCreateInfo.size
+    const std::vector<std::string> &csvParams() const { return csv_params; }
+
+    // Number of struct and array levels flattened into the args column of the csv output, 0 for the parameters only
+    uint32_t csvDepth() const { return csv_depth; }
+
     // The const cast is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
     // Since basically every function in this struct is const, we have to work around that.
-    std::ostream &stream() const { return output_stream; }
+    std::ostream &stream() const {
+        if (thread_output) return thread_output->file;
+        return output_stream;
+    }
+
+    // Each thread writes its own <log_filename>.<thread>, without sharing the output mutex, see beginOutputRecord()
+    bool filePerThread() const { return file_per_thread; }
+
+    bool isFrameInRange(uint64_t frame) const { return condFrameOutput.isInRange(frame); }
+
+    // The calls are only numbered for call_range and for the sequence numbers of the ndjson, binary and csv records, and
+    // only counted per command for command_range
+    bool numbersCalls() const {
+        return !callRange.empty() || output_format == ApiDumpFormat::Ndjson || output_format == ApiDumpFormat::Binary ||
+               output_format == ApiDumpFormat::Csv;
+    }
+    bool hasCommandRanges() const { return !commandRanges.empty(); }
 
-    bool isFrameInRange(uint64_t frame) const { return condFrameOutput.isFrameInRange(frame); }
+    // True if the call is selected by call_range, by its index among all the calls, and by command_range, by its index
+    // among the calls of the same command. Called before the output mutex is locked.
+    bool isCallInRange(uint64_t call_index, std::string_view command, uint64_t command_index) const {
+        if (!callRange.isInRange(call_index)) return false;
+        if (commandRanges.empty()) return true;
+        auto found = commandRanges.find(command);
+        return found != commandRanges.end() && found->second.isInRange(command_index);
+    }
+
+    // Called before writing each ndjson or binary record. Returns true when the output restarts, and the record must be
+    // preceded by the stream header: each time a reader connects to the output socket, and when the file of a thread is
+    // created with file_per_thread.
+    bool beginOutputRecord(uint64_t thread_id) const {
+#if defined(API_DUMP_REFLECTION)
+        if (output_socket) return output_socket->beginRecord();
+#endif
+        if (file_per_thread && !thread_output) {
+            auto output = std::make_unique<ApiDumpThreadOutput>();
+            if (isBuffered()) {
+                output->buffer.resize(flush_size);
+                output->file.rdbuf()->pubsetbuf(output->buffer.data(), output->buffer.size());
+            }
+            output->file.open(output_filename + "." + std::to_string(thread_id), outputFileMode());
+
+            std::lock_guard<std::mutex> lock(thread_outputs_mutex);
+            thread_output = output.get();
+            output->next = thread_output_list.load(std::memory_order_relaxed);
+            thread_output_list.store(output.get(), std::memory_order_release);
+            thread_outputs.push_back(std::move(output));
+            return true;
+        }
+        return false;
+    }
 
     void init(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator) {
         VkuLayerSettingSet layerSettingSet = VK_NULL_HANDLE;
@@ -516,11 +772,29 @@ class ApiDumpSettings {
                 output_format = ApiDumpFormat::Html;
             } else if (value == "json") {
                 output_format = ApiDumpFormat::Json;
+            } else if (value == "binary") {
+                output_format = ApiDumpFormat::Binary;
+            } else if (value == "ndjson") {
+                output_format = ApiDumpFormat::Ndjson;
+            } else if (value == "csv") {
+                output_format = ApiDumpFormat::Csv;
             } else {
                 output_format = ApiDumpFormat::Text;
             }
         }
 
+        // Fall back to a format that was compiled into the layer
+        if (!isFormatEnabled(output_format)) {
+            printErrorMsg("Requested output format was not built into this api_dump layer, using another format instead\n");
+            for (ApiDumpFormat fallback : {ApiDumpFormat::Text, ApiDumpFormat::Json, ApiDumpFormat::Html, ApiDumpFormat::Ndjson,
+                                           ApiDumpFormat::Binary, ApiDumpFormat::Csv}) {
+                if (isFormatEnabled(fallback)) {
+                    output_format = fallback;
+                    break;
+                }
+            }
+        }
+
         // If the layer settings file has a flag indicating to output to a file,
         // do so, to the appropriate default filename.
         std::string filename_string = "";
@@ -529,13 +803,7 @@ class ApiDumpSettings {
             vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFile, file);
 
             if (file) {
-                if (output_format == ApiDumpFormat::Html) {
-                    filename_string = "vk_apidump.html";
-                } else if (output_format == ApiDumpFormat::Json) {
-                    filename_string = "vk_apidump.json";
-                } else {
-                    filename_string = "vk_apidump.txt";
-                }
+                filename_string = std::string("vk_apidump") + outputFileExtension(output_format);
             }
         }
 
@@ -546,29 +814,150 @@ class ApiDumpSettings {
 
         // Append file extension if one doesn't exist or is the wrong extension. Make sure the found extension is at the end
         if (!filename_string.empty()) {
-            size_t txt_pos = filename_string.find(".txt", filename_string.size() - 4);
-            size_t html_pos = filename_string.find(".html", filename_string.size() - 5);
-            size_t json_pos = filename_string.find(".json", filename_string.size() - 5);
-
-            if (output_format == ApiDumpFormat::Html) {
-                if (json_pos != std::string::npos) filename_string.erase(json_pos);
-                if (txt_pos != std::string::npos) filename_string.erase(txt_pos);
-                if (html_pos == std::string::npos) filename_string.append(".html");
-            } else if (output_format == ApiDumpFormat::Json) {
-                if (html_pos != std::string::npos) filename_string.erase(html_pos);
-                if (txt_pos != std::string::npos) filename_string.erase(txt_pos);
-                if (json_pos == std::string::npos) filename_string.append(".json");
-            } else {
-                if (html_pos != std::string::npos) filename_string.erase(html_pos);
-                if (json_pos != std::string::npos) filename_string.erase(json_pos);
-                if (txt_pos == std::string::npos) filename_string.append(".txt");
+            const std::string extension = outputFileExtension(output_format);
+            for (ApiDumpFormat format : {ApiDumpFormat::Text, ApiDumpFormat::Html, ApiDumpFormat::Json, ApiDumpFormat::Binary,
+                                         ApiDumpFormat::Ndjson, ApiDumpFormat::Csv}) {
+                const std::string other = outputFileExtension(format);
+                if (other != extension && filename_string.size() >= other.size() &&
+                    filename_string.compare(filename_string.size() - other.size(), other.size(), other) == 0) {
+                    filename_string.erase(filename_string.size() - other.size());
+                }
+            }
+            if (filename_string.size() < extension.size() ||
+                filename_string.compare(filename_string.size() - extension.size(), extension.size(), extension) != 0) {
+                filename_string.append(extension);
             }
         }
 
+        bool should_flush = true;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFlush)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFlush, should_flush);
+        }
+
+        flush_policy = ApiDumpFlushPolicy::EveryCall;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFlushPolicy)) {
+            std::string value;
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFlushPolicy, value);
+            value = ToLowerString(value);
+            if (value == "every_frame") {
+                flush_policy = ApiDumpFlushPolicy::EveryFrame;
+            } else if (value == "every_n_ms") {
+                flush_policy = ApiDumpFlushPolicy::EveryInterval;
+            } else if (value == "on_size") {
+                flush_policy = ApiDumpFlushPolicy::OnSize;
+            } else if (value != "every_call") {
+                printErrorMsg("Unknown flush_policy, flushing after every call instead\n");
+            }
+        }
+        if (!should_flush) {
+            flush_policy = ApiDumpFlushPolicy::Never;
+        }
+
+        uint32_t flush_interval_ms = 100;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFlushInterval)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFlushInterval, flush_interval_ms);
+        }
+        flush_interval = std::chrono::milliseconds(flush_interval_ms);
+        last_flush_time = std::chrono::steady_clock::now();
+
+        flush_size = 1024 * 1024;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFlushSize)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFlushSize, flush_size);
+        }
+        flush_size = std::max(flush_size, 1u);
+
+        // The output socket replaces the output file
+        std::string socket_path;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyOutputSocket)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyOutputSocket, socket_path);
+        }
+        if (!socket_path.empty() && output_format != ApiDumpFormat::Ndjson && output_format != ApiDumpFormat::Binary) {
+            printErrorMsg("output_socket requires the ndjson or binary output format, ignoring it\n");
+            socket_path.clear();
+        }
+#if defined(API_DUMP_REFLECTION)
+        if (!socket_path.empty() && !output_socket) {
+            uint32_t socket_buffer_size = 4 * 1024 * 1024;
+            if (vkuHasLayerSetting(layerSettingSet, kSettingsKeySocketBufferSize)) {
+                vkuGetLayerSettingValue(layerSettingSet, kSettingsKeySocketBufferSize, socket_buffer_size);
+            }
+
+            ApiDumpBackpressure backpressure = ApiDumpBackpressure::Drop;
+            if (vkuHasLayerSetting(layerSettingSet, kSettingsKeySocketBackpressure)) {
+                std::string value;
+                vkuGetLayerSettingValue(layerSettingSet, kSettingsKeySocketBackpressure, value);
+                value = ToLowerString(value);
+                if (value == "block") {
+                    backpressure = ApiDumpBackpressure::Block;
+                } else if (value != "drop") {
+                    printErrorMsg("Unknown socket_backpressure, dropping records instead\n");
+                }
+            }
+
+            uint32_t reconnect_interval_ms = 500;
+            if (vkuHasLayerSetting(layerSettingSet, kSettingsKeySocketReconnectInterval)) {
+                vkuGetLayerSettingValue(layerSettingSet, kSettingsKeySocketReconnectInterval, reconnect_interval_ms);
+            }
+
+            output_socket = std::make_unique<ApiDumpSocketBuf>(socket_path, socket_buffer_size, backpressure,
+                                                               std::chrono::milliseconds(reconnect_interval_ms));
+            output_socket_path = socket_path;
+            output_stream.rdbuf(output_socket.get());
+            filename_string.clear();
+        }
+#endif
+
+        // The files of each thread are created by the threads, the record sequence numbers and timestamps give the order
+        // of the calls across files
+        bool per_thread = false;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFilePerThread)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFilePerThread, per_thread);
+        }
+        if (per_thread && (output_format != ApiDumpFormat::Ndjson && output_format != ApiDumpFormat::Binary)) {
+            printErrorMsg("file_per_thread requires the ndjson or binary output format, ignoring it\n");
+            per_thread = false;
+        } else if (per_thread && filename_string.empty()) {
+            printErrorMsg("file_per_thread requires an output file, ignoring it\n");
+            per_thread = false;
+        }
+        if (per_thread) {
+            file_per_thread = true;
+            output_filename = filename_string;
+            filename_string.clear();
+        }
+
+        // The html pages are opened by setupInterFrameOutputFormatting(), log_filename becomes the index of the pages
+        uint32_t frames_per_page = 0;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyHtmlFramesPerPage)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyHtmlFramesPerPage, frames_per_page);
+        }
+        if (frames_per_page > 0 && (output_format != ApiDumpFormat::Html || filename_string.empty())) {
+            printErrorMsg("html_frames_per_page requires the html output format and an output file, ignoring it\n");
+            frames_per_page = 0;
+        }
+        if (frames_per_page > 0 && html_frames_per_page == 0) {
+            html_frames_per_page = frames_per_page;
+            output_filename = filename_string;
+            filename_string.clear();
+            if (isBuffered()) {
+                output_file_buffer.resize(flush_size);
+                output_file_stream.rdbuf()->pubsetbuf(output_file_buffer.data(), output_file_buffer.size());
+            }
+            output_stream.rdbuf(output_file_stream.rdbuf());
+            startHtmlIndex();
+        }
+
         // If one of the above has set a filename, open the file as an output stream.
         if (!filename_string.empty()) {
-            output_file_stream.open(filename_string, std::ofstream::out | std::ostream::trunc);
+            // The policies that don't flush every call write the file in flush_size chunks. The buffer has to be set before
+            // the file is opened.
+            if (isBuffered() && !output_file_stream.is_open()) {
+                output_file_buffer.resize(flush_size);
+                output_file_stream.rdbuf()->pubsetbuf(output_file_buffer.data(), output_file_buffer.size());
+            }
+            output_file_stream.open(filename_string, outputFileMode());
             output_stream.rdbuf(output_file_stream.rdbuf());
+            output_filename = filename_string;
         }
 
         show_params = true;
@@ -584,15 +973,11 @@ class ApiDumpSettings {
             show_address = !show_address;
         }
 
-        should_flush = true;
-        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyFlush)) {
-            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyFlush, should_flush);
-        }
-
         show_timestamp = false;
         if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyTimestamp)) {
             vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyTimestamp, show_timestamp);
         }
+        show_timestamp = show_timestamp || file_per_thread;
 
         indent_size = 4;
         if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyIndentSize)) {
@@ -638,10 +1023,64 @@ class ApiDumpSettings {
             vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyOutputRange, cond_range_string);
         }
 
+        callRange = ConditionalOutputRange();
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyCallRange)) {
+            std::string call_range_string;
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyCallRange, call_range_string);
+            if (!call_range_string.empty() && call_range_string != "0-0") callRange.parseConditionalRange(call_range_string);
+        }
+
+        // "vkQueueSubmit:2-8; vkCmdDraw:0-0-10" selects the 3rd to 10th vkQueueSubmit and every 10th vkCmdDraw
+        commandRanges.clear();
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyCommandRange)) {
+            std::string command_range_string;
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyCommandRange, command_range_string);
+            std::stringstream stream(command_range_string);
+            std::string entry;
+            while (std::getline(stream, entry, ';')) {
+                entry.erase(0, entry.find_first_not_of(' '));
+                entry.erase(entry.find_last_not_of(' ') + 1);
+                if (entry.empty()) continue;
+                const size_t colon = entry.find(':');
+                ConditionalOutputRange range;
+                if (colon == 0 || colon == std::string::npos || !range.parseConditionalRange(entry.substr(colon + 1))) {
+                    printErrorMsg(("Ignoring api_dump command range: " + entry + "\n").c_str());
+                    continue;
+                }
+                std::string command = entry.substr(0, colon);
+                command.erase(command.find_last_not_of(' ') + 1);
+                commandRanges[command] = range;
+            }
+        }
+
+        control_file.clear();
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyControlFile)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyControlFile, control_file);
+        }
+
+        // The csv columns are fixed by the header row, written when the output starts
+        csv_params.clear();
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyCsvParams)) {
+            std::string params;
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyCsvParams, params);
+            std::stringstream stream(params);
+            std::string param;
+            while (std::getline(stream, param, ',')) {
+                param.erase(0, param.find_first_not_of(' '));
+                param.erase(param.find_last_not_of(' ') + 1);
+                if (!param.empty()) csv_params.push_back(param);
+            }
+        }
+
+        csv_depth = 0;
+        if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyCsvDepth)) {
+            vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyCsvDepth, csv_depth);
+        }
+
         if (cond_range_string == "" || cond_range_string == "0-0") {  //"0-0" is every frame, no need to check
             use_conditional_output = false;
         } else {
-            bool parsingStatus = condFrameOutput.parseConditionalFrameRange(cond_range_string);
+            bool parsingStatus = condFrameOutput.parseConditionalRange(cond_range_string);
             if (!parsingStatus) {
                 use_conditional_output = false;
             }
@@ -655,6 +1094,120 @@ class ApiDumpSettings {
             indent_size = 1;  // setting this allows indentation to not need a branch on use_spaces
         }
 
+        if (html_frames_per_page == 0) {
+            writeOutputHeader();
+        }
+        setupInterFrameOutputFormatting(0);
+
+        if (flush_policy != ApiDumpFlushPolicy::EveryCall) {
+            installCrashHandler();
+        }
+
+        vkuDestroyLayerSettingSet(layerSettingSet, pAllocator);
+    }
+
+    static void printErrorMsg(const char *msg) {
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_DEBUG, "api_dump", "%s", msg);
+#else
+        fprintf(stderr, "%s", msg);
+#endif
+    }
+
+   private:
+    static const char *htmlStyleSheet() {
+        // clang-format off
+        return
+            "html {"
+                "background-color: #0b1e48;"
+                "background-image: url('https://vulkan.lunarg.com/img/bg-starfield.jpg');"
+                "background-position: center;"
+                "-webkit-background-size: cover;"
+                "-moz-background-size: cover;"
+                "-o-background-size: cover;"
+                "background-size: cover;"
+                "background-attachment: fixed;"
+                "background-repeat: no-repeat;"
+                "height: 100%;"
+            "}"
+            "#header {"
+                "z-index: -1;"
+            "}"
+            "#header>img {"
+                "position: absolute;"
+                "width: 160px;"
+                "margin-left: -280px;"
+                "top: -10px;"
+                "left: 50%;"
+            "}"
+            "#header>h1 {"
+                "font-family: Arial, 'Helvetica Neue', Helvetica, sans-serif;"
+                "font-size: 44px;"
+                "font-weight: 200;"
+                "text-shadow: 4px 4px 5px #000;"
+                "color: #eee;"
+                "position: absolute;"
+                "width: 400px;"
+                "margin-left: -80px;"
+                "top: 8px;"
+                "left: 50%;"
+            "}"
+            "body {"
+                "font-family: Consolas, monaco, monospace;"
+                "font-size: 14px;"
+                "line-height: 20px;"
+                "color: #eee;"
+                "height: 100%;"
+                "margin: 0;"
+                "overflow: hidden;"
+            "}"
+            "#wrapper {"
+                "background-color: rgba(0, 0, 0, 0.7);"
+                "border: 1px solid #446;"
+                "box-shadow: 0px 0px 10px #000;"
+                "padding: 8px 12px;"
+                "display: inline-block;"
+                "position: absolute;"
+                "top: 80px;"
+                "bottom: 25px;"
+                "left: 50px;"
+                "right: 50px;"
+                "overflow: auto;"
+            "}"
+            "details>*:not(summary) {"
+                "margin-left: 22px;"
+            "}"
+            "summary:only-child {"
+              "display: block;"
+              "padding-left: 15px;"
+            "}"
+            "details>summary:only-child::-webkit-details-marker {"
+                "display: none;"
+                "padding-left: 15px;"
+            "}"
+            ".var, .type, .val {"
+                "display: inline;"
+                "margin: 0 6px;"
+            "}"
+            ".type {"
+                "color: #acf;"
+            "}"
+            ".val {"
+                "color: #afa;"
+                "text-align: right;"
+            "}"
+            ".thd {"
+                "color: #888;"
+            "}"
+            ".time {"
+                "color: #888;"
+            "}";
+        // clang-format on
+    }
+
+    void writeOutputHeader() {
+        has_printed_a_frame = false;
+
         // Generate HTML heading if specified
         if (output_format == ApiDumpFormat::Html) {
             // clang-format off
@@ -663,93 +1216,13 @@ class ApiDumpSettings {
                 "<!doctype html>"
                 "<html>"
                     "<head>"
-                        "<title>Vulkan API Dump</title>"
-                        "<style type='text/css'>"
-                        "html {"
-                            "background-color: #0b1e48;"
-                            "background-image: url('https://vulkan.lunarg.com/img/bg-starfield.jpg');"
-                            "background-position: center;"
-                            "-webkit-background-size: cover;"
-                            "-moz-background-size: cover;"
-                            "-o-background-size: cover;"
-                            "background-size: cover;"
-                            "background-attachment: fixed;"
-                            "background-repeat: no-repeat;"
-                            "height: 100%;"
-                        "}"
-                        "#header {"
-                            "z-index: -1;"
-                        "}"
-                        "#header>img {"
-                            "position: absolute;"
-                            "width: 160px;"
-                            "margin-left: -280px;"
-                            "top: -10px;"
-                            "left: 50%;"
-                        "}"
-                        "#header>h1 {"
-                            "font-family: Arial, 'Helvetica Neue', Helvetica, sans-serif;"
-                            "font-size: 44px;"
-                            "font-weight: 200;"
-                            "text-shadow: 4px 4px 5px #000;"
-                            "color: #eee;"
-                            "position: absolute;"
-                            "width: 400px;"
-                            "margin-left: -80px;"
-                            "top: 8px;"
-                            "left: 50%;"
-                        "}"
-                        "body {"
-                            "font-family: Consolas, monaco, monospace;"
-                            "font-size: 14px;"
-                            "line-height: 20px;"
-                            "color: #eee;"
-                            "height: 100%;"
-                            "margin: 0;"
-                            "overflow: hidden;"
-                        "}"
-                        "#wrapper {"
-                            "background-color: rgba(0, 0, 0, 0.7);"
-                            "border: 1px solid #446;"
-                            "box-shadow: 0px 0px 10px #000;"
-                            "padding: 8px 12px;"
-                            "display: inline-block;"
-                            "position: absolute;"
-                            "top: 80px;"
-                            "bottom: 25px;"
-                            "left: 50px;"
-                            "right: 50px;"
-                            "overflow: auto;"
-                        "}"
-                        "details>*:not(summary) {"
-                            "margin-left: 22px;"
-                        "}"
-                        "summary:only-child {"
-                          "display: block;"
-                          "padding-left: 15px;"
-                        "}"
-                        "details>summary:only-child::-webkit-details-marker {"
-                            "display: none;"
-                            "padding-left: 15px;"
-                        "}"
-                        ".var, .type, .val {"
-                            "display: inline;"
-                            "margin: 0 6px;"
-                        "}"
-                        ".type {"
-                            "color: #acf;"
-                        "}"
-                        ".val {"
-                            "color: #afa;"
-                            "text-align: right;"
-                        "}"
-                        ".thd {"
-                            "color: #888;"
-                        "}"
-                        ".time {"
-                            "color: #888;"
-                        "}"
-                        "</style>"
+                        "<title>Vulkan API Dump</title>";
+            if (html_frames_per_page > 0) {
+                output_stream << "<link rel='stylesheet' href='" << htmlLinkTarget(htmlStyleSheetFilename()) << "'>";
+            } else {
+                output_stream << "<style type='text/css'>" << htmlStyleSheet() << "</style>";
+            }
+            output_stream <<
                     "</head>"
                     "<body>"
                         "<div id='header'>"
@@ -761,15 +1234,217 @@ class ApiDumpSettings {
         } else if (output_format == ApiDumpFormat::Json) {
             output_stream << "[\n";
         }
+#if defined(API_DUMP_REFLECTION)
+        // The output socket and the thread files start their streams with their first record, see beginOutputRecord()
+        else if ((output_format == ApiDumpFormat::Binary || output_format == ApiDumpFormat::Ndjson ||
+                  output_format == ApiDumpFormat::Csv) &&
+                 !output_socket && !file_per_thread) {
+            api_dump_start_reflected_output(*this);
+        }
+#endif
+    }
 
-        if (isFrameInRange(0)) {
-            setupInterFrameOutputFormatting(0);
+    void writeOutputFooter() {
+        closeFrameOutput();
+        if (output_format == ApiDumpFormat::Html) {
+            // Close off html
+            output_stream << "</div></body></html>";
+        } else if (output_format == ApiDumpFormat::Json) {
+            // Close off json
+            output_stream << "\n]" << std::endl;
         }
+    }
 
-        vkuDestroyLayerSettingSet(layerSettingSet, pAllocator);
+    // Closes the current file and continues in <log_filename>.<n>, keeping the extension last
+    void rotateOutputFile() {
+        writeOutputFooter();
+        output_stream.flush();
+        output_file_stream.close();
+
+        rotation_count++;
+        std::string filename = output_filename;
+        const std::string extension = outputFileExtension(output_format);
+        filename.insert(filename.size() - extension.size(), "." + std::to_string(rotation_count));
+
+        output_file_stream.open(filename, outputFileMode());
+        output_stream.clear();
+        writeOutputHeader();
     }
 
-   private:
+    // The policies that don't flush every call write the files in flush_size chunks
+    bool isBuffered() const {
+        return flush_policy == ApiDumpFlushPolicy::EveryFrame || flush_policy == ApiDumpFlushPolicy::EveryInterval ||
+               flush_policy == ApiDumpFlushPolicy::OnSize;
+    }
+
+    std::ios_base::openmode outputFileMode() const {
+        std::ios_base::openmode mode = std::ofstream::out | std::ostream::trunc;
+        if (output_format == ApiDumpFormat::Binary) mode |= std::ios_base::binary;
+        return mode;
+    }
+
+    //============================ Paginated HTML ============================//
+    //
+    // With html_frames_per_page, log_filename is an index linking to pages of html_frames_per_page frames each, named
+    // <log_filename>.frame<first frame>.html, which share the <log_filename>.css style sheet. The index gets a row each time
+    // a page is completed, so the pages written so far can be browsed while the application runs.
+
+    std::string htmlFilenameBase() const {
+        const std::string extension = outputFileExtension(ApiDumpFormat::Html);
+        return output_filename.substr(0, output_filename.size() - extension.size());
+    }
+    std::string htmlStyleSheetFilename() const { return htmlFilenameBase() + ".css"; }
+    std::string htmlPageFilename(uint64_t frame) const {
+        return htmlFilenameBase() + ".frame" + std::to_string(frame) + outputFileExtension(ApiDumpFormat::Html);
+    }
+
+    // Pages and index are in the same directory, so they link to each other by file name
+    static std::string htmlLinkTarget(const std::string &path) {
+        const size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? path : path.substr(separator + 1);
+    }
+
+    void startHtmlIndex() {
+        std::ofstream(htmlStyleSheetFilename(), std::ofstream::out | std::ostream::trunc) << htmlStyleSheet();
+
+        html_index_stream.open(output_filename, std::ofstream::out | std::ostream::trunc);
+        // clang-format off
+        html_index_stream <<
+            "<!doctype html>"
+            "<html>"
+                "<head>"
+                    "<title>Vulkan API Dump</title>"
+                    "<style type='text/css'>"
+                    "body { font-family: Consolas, monaco, monospace; font-size: 14px; }"
+                    "th, td { padding: 2px 12px; text-align: right; }"
+                    "th:first-child, td:first-child { text-align: left; }"
+                    "</style>"
+                "</head>"
+                "<body>"
+                    "<h1>Vulkan API Dump</h1>"
+                    "<table>"
+                        "<tr><th>Frames</th><th>Calls</th><th>Bytes</th></tr>\n";
+        // clang-format on
+        html_index_stream.flush();
+    }
+
+    void finishHtmlIndex() {
+        closeHtmlPage();
+        html_index_stream << "</table></body></html>\n";
+        html_index_stream.close();
+    }
+
+    // Completes the page once it spans html_frames_per_page frames, and starts the next page when a frame of the output range
+    // begins
+    void updateHtmlPage(uint64_t frame) {
+        if (output_file_stream.is_open() && frame - page_first_frame >= html_frames_per_page) {
+            closeHtmlPage();
+        }
+        if (!output_file_stream.is_open() && condFrameOutput.isInRange(frame)) {
+            page_first_frame = frame;
+            page_last_frame = frame;
+            page_calls = 0;
+            output_file_stream.open(htmlPageFilename(frame), outputFileMode());
+            output_stream.clear();
+            writeOutputHeader();
+        }
+    }
+
+    void closeHtmlPage() {
+        if (!output_file_stream.is_open()) return;
+        writeOutputFooter();
+        output_stream.flush();
+        const std::streamoff size = output_file_stream.tellp();
+        output_file_stream.close();
+
+        html_index_stream << "<tr><td><a href='" << htmlLinkTarget(htmlPageFilename(page_first_frame)) << "'>"
+                          << page_first_frame;
+        if (page_last_frame != page_first_frame) {
+            html_index_stream << " - " << page_last_frame;
+        }
+        html_index_stream << "</a></td><td>" << page_calls << "</td><td>" << size << "</td></tr>\n";
+        html_index_stream.flush();
+    }
+
+    // Without a flush after every call, the calls leading to a crash would be lost in the buffers, and they are usually the
+    // ones that matter. Flushing a stream isn't async-signal-safe, but the process is going down anyway and the handler is only
+    // entered once.
+#if defined(_WIN32)
+    void installCrashHandler() {
+        if (crash_settings != nullptr) return;
+        crash_settings = this;
+        previous_sigsegv_handler = std::signal(SIGSEGV, crashHandler);
+        previous_sigabrt_handler = std::signal(SIGABRT, crashHandler);
+    }
+
+    void uninstallCrashHandler() {
+        if (crash_settings != this) return;
+        std::signal(SIGSEGV, previous_sigsegv_handler == SIG_ERR ? SIG_DFL : previous_sigsegv_handler);
+        std::signal(SIGABRT, previous_sigabrt_handler == SIG_ERR ? SIG_DFL : previous_sigabrt_handler);
+        crash_settings = nullptr;
+    }
+
+    static void crashHandler(int signal_number) {
+        flushOnCrash();
+
+        // Let the application handler or the default action terminate the process
+        void (*previous)(int) = signal_number == SIGSEGV ? previous_sigsegv_handler : previous_sigabrt_handler;
+        std::signal(signal_number, previous == SIG_ERR ? SIG_DFL : previous);
+        std::raise(signal_number);
+    }
+
+    static inline void (*previous_sigsegv_handler)(int) = SIG_DFL;
+    static inline void (*previous_sigabrt_handler)(int) = SIG_DFL;
+#else
+    // The previous actions are saved whole, so handlers installed with SA_SIGINFO, such as crash reporters, get the signal
+    // back with their flags and the original siginfo.
+    void installCrashHandler() {
+        if (crash_settings != nullptr) return;
+        crash_settings = this;
+        struct sigaction action = {};
+        action.sa_sigaction = crashHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigaction(SIGSEGV, &action, &previous_sigsegv_action);
+        sigaction(SIGABRT, &action, &previous_sigabrt_action);
+    }
+
+    void uninstallCrashHandler() {
+        if (crash_settings != this) return;
+        sigaction(SIGSEGV, &previous_sigsegv_action, nullptr);
+        sigaction(SIGABRT, &previous_sigabrt_action, nullptr);
+        crash_settings = nullptr;
+    }
+
+    static void crashHandler(int signal_number, siginfo_t *info, void *context) {
+        flushOnCrash();
+
+        // Restore the previous action before passing the signal on. A fault happens again when the handler returns, and is
+        // then delivered to the previous handler with its own siginfo. Signals sent by abort(), raise() or kill() are sent
+        // again, they stay blocked until the handler returns.
+        sigaction(signal_number, signal_number == SIGSEGV ? &previous_sigsegv_action : &previous_sigabrt_action, nullptr);
+        if (info == nullptr || info->si_code <= 0) raise(signal_number);
+    }
+
+    static inline struct sigaction previous_sigsegv_action = {};
+    static inline struct sigaction previous_sigabrt_action = {};
+#endif
+
+    static void flushOnCrash() {
+        static volatile std::sig_atomic_t handling = 0;
+        if (handling != 0 || crash_settings == nullptr) return;
+        handling = 1;
+        crash_settings->output_stream.flush();
+        crash_settings->html_index_stream.flush();
+        // The crashing thread may hold thread_outputs_mutex, so the files are walked through the lock-free list
+        for (ApiDumpThreadOutput *output = crash_settings->thread_output_list.load(std::memory_order_acquire); output != nullptr;
+             output = output->next) {
+            output->file.flush();
+        }
+    }
+
+    static inline ApiDumpSettings *crash_settings = nullptr;
+
     // Utility member to enable easier comparison by forcing a string to all lower-case
     static std::string ToLowerString(const std::string &value) {
         std::string lower_value = value;
@@ -780,16 +1455,31 @@ class ApiDumpSettings {
     // The mutable is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
     // Since basically every function in this struct is const, we have to work around that.
     mutable std::ostream output_stream;
+    std::vector<char> output_file_buffer;  // Declared before output_file_stream so that it outlives the final flush
     std::ofstream output_file_stream;
+#if defined(API_DUMP_REFLECTION)
+    std::unique_ptr<ApiDumpSocketBuf> output_socket;
+    std::string output_socket_path;
+#endif
+    bool file_per_thread = false;
+    mutable std::mutex thread_outputs_mutex;
+    mutable std::vector<std::unique_ptr<ApiDumpThreadOutput>> thread_outputs;
+    // The same outputs linked newest first, each one published whole, for the crash handler which can't take the mutex
+    mutable std::atomic<ApiDumpThreadOutput *> thread_output_list{nullptr};
+    static inline thread_local ApiDumpThreadOutput *thread_output = nullptr;  // Output of the calling thread
 #ifdef __ANDROID__
     std::unique_ptr<AndroidLogcatBuf<>> android_logcat_buf = nullptr;
 #endif
     ApiDumpFormat output_format;
     bool show_params;
     bool show_address;
-    bool should_flush;
     bool show_timestamp;
 
+    ApiDumpFlushPolicy flush_policy = ApiDumpFlushPolicy::EveryCall;
+    std::chrono::milliseconds flush_interval;
+    mutable std::chrono::steady_clock::time_point last_flush_time;
+    uint32_t flush_size = 1024 * 1024;
+
     bool show_type;
     int indent_size;  // how many indent levels to use - also sets the tab_size
     int name_size;
@@ -799,50 +1489,120 @@ class ApiDumpSettings {
     bool show_thread_and_frame;
 
     bool use_conditional_output = false;
-    ConditionalFrameOutput condFrameOutput;
+    ConditionalOutputRange condFrameOutput;
+    ConditionalOutputRange callRange;
+    std::map<std::string, ConditionalOutputRange, std::less<>> commandRanges;
+
+    std::string control_file;
+    std::string output_filename;
+
+    std::vector<std::string> csv_params;
+    uint32_t csv_depth = 0;
+
+    uint32_t html_frames_per_page = 0;  // 0 writes a single html document
+    std::ofstream html_index_stream;
+    uint64_t page_first_frame = 0;
+    uint64_t page_last_frame = 0;
+    uint64_t page_calls = 0;
+
+    uint32_t rotation_count = 0;
+    bool rotation_requested = false;
+    bool frame_output_open = false;
+    bool has_printed_a_frame = false;
 
     int tab_size;  // equal to the indent size if using spaces, otherwise is equal to 1
 };
 
 class ApiDumpInstance {
    public:
-    ApiDumpInstance() noexcept : frame_count(0) { program_start = std::chrono::system_clock::now(); }
+    ApiDumpInstance() noexcept { program_start = std::chrono::system_clock::now(); }
     // Can't copy or move this type
     ApiDumpInstance(const ApiDumpInstance &) = delete;
     ApiDumpInstance &operator=(const ApiDumpInstance &) = delete;
     ApiDumpInstance(ApiDumpInstance &&) = delete;
     ApiDumpInstance &operator=(ApiDumpInstance &&) = delete;
 
-    ~ApiDumpInstance() {
-        if (!first_func_call_on_frame) settings().closeFrameOutput();
-    }
-
     void initLayerSettings(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator) {
         this->dump_settings.init(pCreateInfo, pAllocator);
+        // Commands already in the control file apply from the start, so the application can start with capture off
+        pollControlFile(true);
     }
 
-    uint64_t frameCount() {
-        std::lock_guard<std::recursive_mutex> lg(frame_mutex);
-        uint64_t count = frame_count;
-        return count;
-    }
+    uint64_t frameCount() const { return frame_count.load(std::memory_order_acquire); }
 
+    // Called at the end of vkQueuePresentKHR, with the output mutex locked
     void nextFrame() {
         std::lock_guard<std::recursive_mutex> lg(frame_mutex);
-        ++frame_count;
+        if (!call_counts.empty()) {
+            dumpCallCounts();
+        }
+        pollControlFile();
+        const uint64_t frame = frame_count.load(std::memory_order_relaxed) + 1;
+        frame_count.store(frame, std::memory_order_release);
 
-        should_dump_output = settings().isFrameInRange(frame_count);
-        settings().setupInterFrameOutputFormatting(frame_count);
+        should_dump_output.store(settings().isFrameInRange(frame), std::memory_order_relaxed);
+        settings().setupInterFrameOutputFormatting(frame);
+        settings().flushFrameOutput();
         first_func_call_on_frame = true;
     }
 
+    // Checked by every call, when capture is off it costs a single relaxed atomic load
+    ApiDumpCaptureMode captureMode() const { return capture_mode.load(std::memory_order_relaxed); }
+
     bool shouldDumpOutput() {
-        if (!conditional_initialized) {
-            should_dump_output = settings().isFrameInRange(frame_count);
-            conditional_initialized = true;
+        if (captureMode() != ApiDumpCaptureMode::Full || !call_selected) return false;
+        return isFrameInOutputRange();
+    }
+
+    bool isFrameInOutputRange() {
+        if (!conditional_initialized.load(std::memory_order_acquire)) {
+            should_dump_output.store(settings().isFrameInRange(frameCount()), std::memory_order_relaxed);
+            conditional_initialized.store(true, std::memory_order_release);
         }
-        return should_dump_output;
+        return should_dump_output.load(std::memory_order_relaxed);
+    }
+
+    // Statistics mode: counts the call in place of dumping it. The lock is only contended with file_per_thread, otherwise
+    // the output mutex is already held.
+    void countCall(const char *funcName) {
+        if (!call_selected || !isFrameInOutputRange()) return;
+        std::lock_guard<std::recursive_mutex> lg(frame_mutex);
+        call_counts[funcName]++;
+    }
+
+    // Called by every entry point before the output mutex is locked. Numbers the call, counts it among the calls of the
+    // command, and checks both against call_range and command_range, when they or the record sequence numbers need it.
+    // Returns the output mutex to lock, or nullptr if the call isn't dumped and doesn't need to be serialized, so calls
+    // outside of the ranges don't wait on the output.
+    // When capture is off, the calls are neither numbered nor locked, only the serialized ones still take the mutex since
+    // the end of the frame polls the control file.
+    std::recursive_mutex *beginCall(std::string_view funcName, std::atomic<uint64_t> &command_calls, bool serialize) {
+        if (captureMode() == ApiDumpCaptureMode::Off) {
+            call_selected = false;
+            return serialize ? outputMutex() : nullptr;
+        }
+        const ApiDumpSettings &call_settings = settings();
+        call_index = call_settings.numbersCalls() ? call_sequence.fetch_add(1, std::memory_order_relaxed) : 0;
+        const uint64_t command_index = call_settings.hasCommandRanges() ? command_calls.fetch_add(1, std::memory_order_relaxed) : 0;
+        call_selected = call_settings.isCallInRange(call_index, funcName, command_index);
+        return (call_selected || serialize) ? outputMutex() : nullptr;
+    }
+
+    // Index of the current call among all the calls, the sequence number of the ndjson and binary records. It orders the
+    // records across the thread files of file_per_thread, and matches the indices of call_range.
+    uint64_t callIndex() const { return call_index; }
+
+    // Called by the entry points just before calling down the chain, for the duration column of the csv output. Only the
+    // csv output reads the clock.
+    void startCallTimer() {
+        if (settings().format() == ApiDumpFormat::Csv) call_start = std::chrono::steady_clock::now();
     }
+    uint64_t callDurationNs() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - call_start).count();
+    }
+
+    // Dumps and clears the calls counted during the frame
+    void dumpCallCounts();
 
     bool firstFunctionCallOnFrame() {
         if (first_func_call_on_frame) {
@@ -852,21 +1612,35 @@ class ApiDumpInstance {
         return false;
     }
 
-    std::recursive_mutex *outputMutex() { return &output_mutex; }
+    // Serializes the calls and their output. With file_per_thread, each thread writes its own file and the mutex is the
+    // uncontended mutex of the thread. The callers keep the returned mutex to unlock it, as vkCreateInstance can change
+    // the setting while it is locked.
+    std::recursive_mutex *outputMutex() {
+        if (settings().filePerThread()) {
+            static thread_local std::recursive_mutex thread_output_mutex;
+            return &thread_output_mutex;
+        }
+        return &output_mutex;
+    }
 
     ApiDumpSettings &settings() { return dump_settings; }
 
     uint64_t threadID() {
+        // Threads are numbered in the order of their first call, each thread looks its number up once
+        static thread_local uint64_t thread_id = UINT64_MAX;
+        if (thread_id != UINT64_MAX) return thread_id;
+
         std::thread::id this_id = std::this_thread::get_id();
         std::lock_guard<std::recursive_mutex> lg(thread_mutex);
 
         auto it = thread_map.find(this_id);
         if (it != thread_map.end()) {
-            return it->second;
+            thread_id = it->second;
+        } else {
+            thread_id = thread_map.size();
+            thread_map.insert({this_id, thread_id});
         }
-
-        thread_map.insert({this_id, thread_map.size()});
-        return thread_map.size() - 1;
+        return thread_id;
     }
 
     void setCmdBuffer(VkCommandBuffer cmd_buffer) { this->cmd_buffer = cmd_buffer; }
@@ -934,6 +1708,75 @@ class ApiDumpInstance {
     void setIsGPLPreRasterOrFragmentShader(bool in) { this->GPLPreRasterOrFragmentShader = in; }
     bool getIsGPLPreRasterOrFragmentShader() { return this->GPLPreRasterOrFragmentShader; }
 
+    // The control file holds one command per line, applied at the end of the frame:
+    //   capture on|off|toggle        Start or stop dumping calls
+    //   mode full|statistics         Dump the calls, or only count them
+    //   output_range <range>         Replace the output_range setting, frame numbers count from the start of the application
+    //   rotate                       Continue the output in <log_filename>.<n>
+    // The file is renamed before it's read, so each command is applied once and the lines written while the commands are
+    // applied go to a new file. It is looked for at most every kControlFilePollInterval, not on every present.
+    void pollControlFile(bool force = false) {
+        const std::string &path = settings().controlFile();
+        if (path.empty()) return;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!force && now - control_file_polled < kControlFilePollInterval) return;
+        control_file_polled = now;
+
+        const std::string consumed_path = path + ".applying";
+        if (std::rename(path.c_str(), consumed_path.c_str()) != 0) return;
+
+        std::ifstream file(consumed_path);
+        std::string line;
+        while (std::getline(file, line)) {
+            applyControlCommand(line);
+        }
+        file.close();
+        std::remove(consumed_path.c_str());
+    }
+
+    void applyControlCommand(const std::string &line) {
+        std::istringstream words(line);
+        std::string command, argument;
+        words >> command >> argument;
+
+        const ApiDumpCaptureMode mode = captureMode();
+        bool valid = true;
+        if (command.empty() || command[0] == '#') {
+            return;
+        } else if (command == "capture") {
+            if (argument == "on" || (argument == "toggle" && mode == ApiDumpCaptureMode::Off)) {
+                capture_mode.store(capture_mode_when_on.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            } else if (argument == "off" || argument == "toggle") {
+                capture_mode.store(ApiDumpCaptureMode::Off, std::memory_order_relaxed);
+            } else {
+                valid = false;
+            }
+        } else if (command == "mode") {
+            if (argument == "full") {
+                capture_mode_when_on.store(ApiDumpCaptureMode::Full, std::memory_order_relaxed);
+            } else if (argument == "statistics") {
+                capture_mode_when_on.store(ApiDumpCaptureMode::Statistics, std::memory_order_relaxed);
+            } else {
+                valid = false;
+            }
+            if (valid && mode != ApiDumpCaptureMode::Off) {
+                capture_mode.store(capture_mode_when_on.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        } else if (command == "output_range") {
+            valid = settings().setOutputRange(argument);
+            if (valid) conditional_initialized.store(false, std::memory_order_release);
+        } else if (command == "rotate") {
+            valid = settings().requestOutputRotation();
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            ApiDumpSettings::printErrorMsg(("Ignoring api_dump control command: " + line + "\n").c_str());
+        }
+    }
+
     std::chrono::microseconds current_time_since_start() {
         std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
         return std::chrono::duration_cast<std::chrono::microseconds>(now - program_start);
@@ -946,21 +1789,36 @@ class ApiDumpInstance {
         return current_instance;
     }
 
-    std::unordered_map<uint64_t, std::string> object_name_map;
+    // Returns the name given to the object with vkSetDebugUtilsObjectNameEXT or vkDebugMarkerSetObjectNameEXT, or an empty
+    // string. Handles are dumped by every thread, with file_per_thread without the output mutex, so the names are read
+    // under a shared lock.
+    std::string objectName(uint64_t object) {
+        std::shared_lock<std::shared_mutex> lock(object_name_mutex);
+        auto it = object_name_map.find(object);
+        return it != object_name_map.end() ? it->second : std::string();
+    }
 
-    void set_vk_instance(VkPhysicalDevice phys_dev, VkInstance instance) { vk_instance_map.insert({phys_dev, instance}); }
-    VkInstance get_vk_instance(VkPhysicalDevice phys_dev) const {
+    // The physical device map is also locked by shared_state_mutex and the object names by object_name_mutex, for the
+    // threads that don't share the output mutex with file_per_thread
+    void set_vk_instance(VkPhysicalDevice phys_dev, VkInstance instance) {
+        std::lock_guard<std::recursive_mutex> lg(shared_state_mutex);
+        vk_instance_map.insert({phys_dev, instance});
+    }
+    VkInstance get_vk_instance(VkPhysicalDevice phys_dev) {
+        std::lock_guard<std::recursive_mutex> lg(shared_state_mutex);
         if (vk_instance_map.count(phys_dev) == 0) return VK_NULL_HANDLE;
         return vk_instance_map.at(phys_dev);
     }
 
     void update_object_name_map(const VkDebugMarkerObjectNameInfoEXT *pNameInfo) {
+        std::unique_lock<std::shared_mutex> lock(object_name_mutex);
         if (pNameInfo->pObjectName)
             object_name_map[pNameInfo->object] = pNameInfo->pObjectName;
         else
             object_name_map.erase(pNameInfo->object);
     }
     void update_object_name_map(const VkDebugUtilsObjectNameInfoEXT *pNameInfo) {
+        std::unique_lock<std::shared_mutex> lock(object_name_mutex);
         if (pNameInfo->pObjectName)
             object_name_map[pNameInfo->objectHandle] = pNameInfo->pObjectName;
         else
@@ -971,7 +1829,12 @@ class ApiDumpInstance {
     ApiDumpSettings dump_settings;
     std::recursive_mutex output_mutex;
     std::recursive_mutex frame_mutex;
-    uint64_t frame_count;
+    std::atomic<uint64_t> frame_count{0};
+    std::atomic<uint64_t> call_sequence{0};
+    std::recursive_mutex shared_state_mutex;
+
+    std::shared_mutex object_name_mutex;
+    std::unordered_map<uint64_t, std::string> object_name_map;
 
     std::recursive_mutex thread_mutex;
     std::unordered_map<std::thread::id, uint64_t> thread_map;
@@ -980,38 +1843,54 @@ class ApiDumpInstance {
     std::map<std::pair<VkDevice, VkCommandPool>, std::unordered_set<VkCommandBuffer>> cmd_buffer_pools;
     std::unordered_map<VkCommandBuffer, VkCommandBufferLevel> cmd_buffer_level;
 
-    bool conditional_initialized = false;
-    bool should_dump_output = true;
+    std::atomic<bool> conditional_initialized{false};
+    std::atomic<bool> should_dump_output{true};
     bool first_func_call_on_frame = true;
 
+    std::atomic<ApiDumpCaptureMode> capture_mode{ApiDumpCaptureMode::Full};
+    std::atomic<ApiDumpCaptureMode> capture_mode_when_on{ApiDumpCaptureMode::Full};  // Restored by "capture on"
+    std::unordered_map<std::string_view, uint64_t> call_counts;  // Calls of the current frame in statistics mode
+
+    static constexpr std::chrono::milliseconds kControlFilePollInterval{100};
+    std::chrono::steady_clock::time_point control_file_polled;
+
     std::chrono::system_clock::time_point program_start;
 
     // Store the VkInstance handle so we don't use null in the call to
     // vkGetInstanceProcAddr(instance_handle, "vkCreateDevice");
     std::unordered_map<VkPhysicalDevice, VkInstance> vk_instance_map;
 
+    // The storage below only lives for the duration of a call, so it is per thread.
+
     // Storage for getCmdBufferLevel() which is called in a place where it needs access to the cmd_buffer but it isn't present in
     // the current structure.
-    VkCommandBuffer cmd_buffer;
+    static inline thread_local VkCommandBuffer cmd_buffer;
+
+    // Set by beginCall()
+    static inline thread_local uint64_t call_index = 0;
+    static inline thread_local bool call_selected = true;
 
     // Storage for VkPipelineViewportStateCreateInfo which needs to ignore the scissor and viewport pipeline state if their
     // respective dynamic state is set.
-    bool is_dynamic_scissor;
-    bool is_dynamic_viewport;
+    static inline thread_local bool is_dynamic_scissor;
+    static inline thread_local bool is_dynamic_viewport;
 
     // Storage for VkPhysicalDeviceMemoryBudgetPropertiesEXT which needs the number of heaps from VkPhysicalDeviceMemoryProperties
-    uint32_t memory_heap_count;
+    static inline thread_local uint32_t memory_heap_count;
 
     // Storage for the VkDescriptorDataEXT union to know what is the active element
-    VkDescriptorType descriptor_type;
+    static inline thread_local VkDescriptorType descriptor_type;
 
     // True when creating a graphics pipeline library with VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT or
     // VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT set in the VkGraphicsPipelineLibraryCreateInfoEXT struct.
-    bool GPLPreRasterOrFragmentShader;
+    static inline thread_local bool GPLPreRasterOrFragmentShader;
+
+    // Time the current call was passed down the chain, see startCallTimer()
+    static inline thread_local std::chrono::steady_clock::time_point call_start;
 };
 
 // Helper function to determine the value of GPLPreRasterOrFragmentShader;
-bool checkForGPLPreRasterOrFragmentShader(const VkGraphicsPipelineCreateInfo &object) {
+inline bool checkForGPLPreRasterOrFragmentShader(const VkGraphicsPipelineCreateInfo &object) {
     VkGraphicsPipelineLibraryFlagsEXT flags{};
     const VkBaseInStructure *pNext_chain = reinterpret_cast<const VkBaseInStructure *>(object.pNext);
     while (pNext_chain) {
@@ -1028,7 +1907,7 @@ bool checkForGPLPreRasterOrFragmentShader(const VkGraphicsPipelineCreateInfo &ob
 // Utility to output an address.
 // If the quotes arg is true, the address is encloded in quotes.
 // Used for text, html, and json output.
-void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
+inline void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
     if (settings.showAddress())
         if (addr == NULL)
             settings.stream() << "NULL";
@@ -1038,16 +1917,99 @@ void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
         settings.stream() << "address";
 }
 
-void OutputAddressJSON(const ApiDumpSettings &settings, const void *addr) {
+inline void OutputAddressJSON(const ApiDumpSettings &settings, const void *addr) {
     settings.stream() << "\"";
     OutputAddress(settings, addr);
     settings.stream() << "\"";
 }
 
+//================================== Enum and Bitmask Names =====================================//
+
+// Name of a value, or of a bit, terminated by an entry with a nullptr name. order is the position of the name in vk.xml.
+struct ApiDumpFlagName {
+    uint64_t value;
+    const char *name;
+    uint32_t order;
+};
+
+// Range of enum values [first, first + count) whose names are stored from ApiDumpEnumNames::names[offset]
+struct ApiDumpEnumBlock {
+    int64_t first;
+    uint32_t count;
+    uint32_t offset;
+};
+
+// Generated for each enum. The values are split in dense blocks sorted by their first value, usually one for the core values
+// and one for each extension, which gives its values from 1000000000 + 1000 * (extension number - 1).
+struct ApiDumpEnumNames {
+    const char *const *names;  // nullptr for the holes in a block
+    const ApiDumpEnumBlock *blocks;
+    uint32_t block_count;
+};
+
+// Generated for each bitmask.
+struct ApiDumpBitmaskNames {
+    const char *const *bit_names;  // Indexed by bit position, nullptr for bits without a name
+    const uint32_t *bit_order;     // Indexed by bit position, the position of the name of the bit in vk.xml
+    uint32_t bit_count;
+    const ApiDumpFlagName *exact_values;  // Names that only match when the value is equal, such as 0 or a combination of bits,
+                                          // in vk.xml order
+};
+
+// Returns nullptr if value has no name
+inline const char *api_dump_enum_name(const ApiDumpEnumNames &names, int64_t value) {
+    const ApiDumpEnumBlock *end = names.blocks + names.block_count;
+    const ApiDumpEnumBlock *block =
+        std::upper_bound(names.blocks, end, value, [](int64_t v, const ApiDumpEnumBlock &b) { return v < b.first; });
+    if (block == names.blocks) return nullptr;
+    --block;
+    const uint64_t index = static_cast<uint64_t>(value - block->first);
+    return index < block->count ? names.names[block->offset + index] : nullptr;
+}
+
+// Calls write(name) for each bit set in value that has a name and for each exact value that matches, in vk.xml order.
+// Only visits the set bits, so a value with few bits costs a few iterations whatever the width of the bitmask.
+template <typename Write>
+inline void api_dump_for_each_flag_name(const ApiDumpBitmaskNames &names, uint64_t value, Write write) {
+    // The bits set are few, so they are sorted by order with an insertion sort
+    uint32_t bits_set[64];
+    uint32_t bit_count = 0;
+    for (uint64_t bits = value; bits != 0; bits &= bits - 1) {
+        const uint32_t bit = api_dump_count_trailing_zeros(bits);
+        if (bit >= names.bit_count) break;
+        if (names.bit_names[bit] == nullptr) continue;
+        uint32_t i = bit_count++;
+        for (; i > 0 && names.bit_order[bits_set[i - 1]] > names.bit_order[bit]; i--) bits_set[i] = bits_set[i - 1];
+        bits_set[i] = bit;
+    }
+
+    // Merges the bits with the exact values, which are already in order
+    uint32_t next_bit = 0;
+    for (const ApiDumpFlagName *exact = names.exact_values; exact->name != nullptr; exact++) {
+        if (exact->value != value) continue;
+        for (; next_bit < bit_count && names.bit_order[bits_set[next_bit]] < exact->order; next_bit++) {
+            write(names.bit_names[bits_set[next_bit]]);
+        }
+        write(exact->name);
+    }
+    for (; next_bit < bit_count; next_bit++) write(names.bit_names[bits_set[next_bit]]);
+}
+
+// Writes " (NAME_A | NAME_B)" after a bitmask value in the text, html and json formats
+inline void dump_bitmask_names(const ApiDumpBitmaskNames &names, uint64_t value, const ApiDumpSettings &settings) {
+    std::ostream &stream = settings.stream();
+    bool is_first = true;
+    api_dump_for_each_flag_name(names, value, [&](const char *name) {
+        stream << (is_first ? " (" : " | ") << name;
+        is_first = false;
+    });
+    if (!is_first) stream << ")";
+}
+
 //==================================== Text Backend Helpers ======================================//
 
-void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
-                             const char *funcReturn) {
+inline void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                                    const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
     if (settings.showThreadAndFrame()) {
         settings.stream() << "Thread " << dump_inst.threadID() << ", Frame " << dump_inst.frameCount();
@@ -1063,7 +2025,20 @@ void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, c
     }
     settings.stream() << funcName << "(" << funcNamedParams << ") returns " << funcReturn;
 
-    settings.shouldFlush() ? settings.stream() << std::flush : settings.stream();
+    settings.flushCallOutput();
+}
+
+inline void dump_text_call_counts(ApiDumpInstance &dump_inst, const std::vector<ApiDumpCallCount> &counts) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    uint64_t total = 0;
+    for (const ApiDumpCallCount &count : counts) total += count.count;
+
+    settings.stream() << "Frame " << dump_inst.frameCount() << " statistics: " << total << " calls\n";
+    for (const ApiDumpCallCount &count : counts) {
+        settings.stream() << settings.indentation(1) << count.name << ": " << count.count << "\n";
+    }
+    settings.stream() << "\n";
+    settings.flushCallOutput();
 }
 
 template <typename T>
@@ -1139,19 +2114,20 @@ void dump_text_value(const T &object, const ApiDumpSettings &settings, const cha
     dump(object, settings, indents);
 }
 
-void dump_text_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_text_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name,
+                              int indents) {
     settings.formatNameType(indents, name, type_string);
     settings.stream() << text << "\n";
 }
 
-void dump_text_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_text_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
     if (object == NULL)
         settings.stream() << "NULL";
     else
         settings.stream() << "\"" << object << "\"";
 }
 
-void dump_text_void(const void *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_text_void(const void *object, const ApiDumpSettings &settings, int indents) {
     if (object == NULL) {
         settings.stream() << "NULL";
         return;
@@ -1159,7 +2135,7 @@ void dump_text_void(const void *object, const ApiDumpSettings &settings, int ind
     OutputAddress(settings, object);
 }
 
-void dump_text_int(int object, const ApiDumpSettings &settings, int indents) { settings.stream() << object; }
+inline void dump_text_int(int object, const ApiDumpSettings &settings, int indents) { settings.stream() << object; }
 
 template <typename T>
 void dump_text_pNext(const T *object, const ApiDumpSettings &settings, const char *type_string, int indents,
@@ -1174,15 +2150,15 @@ void dump_text_pNext(const T *object, const ApiDumpSettings &settings, const cha
 
 //==================================== Html Backend Helpers ======================================//
 
-void dump_html_nametype(std::ostream &stream, bool showType, const char *name, const char *type) {
+inline void dump_html_nametype(std::ostream &stream, bool showType, const char *name, const char *type) {
     stream << "<div class='var'>" << name << "</div>";
     if (showType) {
         stream << "<div class='type'>" << type << "</div>";
     }
 }
 
-void dump_html_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
-                             const char *funcReturn) {
+inline void dump_html_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                                    const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
     if (settings.showThreadAndFrame()) {
         settings.stream() << "<div class='thd'>Thread: " << dump_inst.threadID() << "</div>";
@@ -1194,7 +2170,22 @@ void dump_html_function_head(ApiDumpInstance &dump_inst, const char *funcName, c
     if (settings.showType()) {
         settings.stream() << "<div class='type'>" << funcReturn << "</div>";
     }
-    settings.shouldFlush() ? settings.stream() << std::flush : settings.stream();
+    settings.flushCallOutput();
+}
+
+inline void dump_html_call_counts(ApiDumpInstance &dump_inst, const std::vector<ApiDumpCallCount> &counts) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    uint64_t total = 0;
+    for (const ApiDumpCallCount &count : counts) total += count.count;
+
+    settings.stream() << "<details class='fn'><summary><div class='var'>Frame statistics</div><div class='val'>" << total
+                      << " calls</div></summary>";
+    for (const ApiDumpCallCount &count : counts) {
+        settings.stream() << "<details class='data'><summary><div class='var'>" << count.name << "</div><div class='val'>"
+                          << count.count << "</div></summary></details>";
+    }
+    settings.stream() << "</details>";
+    settings.flushCallOutput();
 }
 
 template <typename T>
@@ -1287,13 +2278,14 @@ void dump_html_value(const T &object, const ApiDumpSettings &settings, const cha
     settings.stream() << "</details>";
 }
 
-void dump_html_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_html_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name,
+                              int indents) {
     settings.stream() << "<details class='data'><summary>";
     dump_html_nametype(settings.stream(), settings.showType(), name, type_string);
     settings.stream() << "<div class='val'>" << text << "</div></summary></details>";
 }
 
-void dump_html_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     if (object == NULL)
         settings.stream() << "NULL";
@@ -1302,13 +2294,13 @@ void dump_html_cstring(const char *object, const ApiDumpSettings &settings, int
     settings.stream() << "</div>";
 }
 
-void dump_html_void(const void *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_void(const void *object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     OutputAddress(settings, object);
     settings.stream() << "</div>";
 }
 
-void dump_html_int(int object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_int(int object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     settings.stream() << object;
     settings.stream() << "</div>";
@@ -1328,7 +2320,7 @@ void dump_html_pNext(const T *object, const ApiDumpSettings &settings, const cha
 
 //==================================== Json Backend Helpers ======================================//
 
-void dump_json_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcReturn) {
+inline void dump_json_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
 
     if (!dump_inst.firstFunctionCallOnFrame()) settings.stream() << ",\n";
@@ -1356,250 +2348,89 @@ void dump_json_function_head(ApiDumpInstance &dump_inst, const char *funcName, c
     }
     settings.stream() << "\n";
 
-    settings.shouldFlush() ? settings.stream() << std::flush : settings.stream();
-}
-
-template <typename T>
-void dump_json_array(const T *array, size_t len, const ApiDumpSettings &settings, const char *type_string, const char *child_type,
-                     const char *name, bool is_struct, bool is_union, int indents,
-                     void (*dump)(const T, const ApiDumpSettings &, int)) {
-    if (len == 0 || array == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, array);
-        settings.stream() << "\n";
-        settings.stream() << settings.indentation(indents) << "}";
-        return;
-    }
-    settings.stream() << settings.indentation(indents) << "{\n";
-
-    if (len > 0 && array != NULL) {
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, array);
-        settings.stream() << ",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"elements\" :\n";
-        settings.stream() << settings.indentation(indents + 1) << "[\n";
-        for (size_t i = 0; i < len && array != NULL; ++i) {
-            std::stringstream stream;
-            stream << "[" << i << "]";
-            std::string indexName = stream.str();
-            dump_json_value(array[i], &array[i], settings, child_type, indexName.c_str(), is_struct, is_union, indents + 2, dump);
-            if (i < len - 1) settings.stream() << ',';
-            settings.stream() << "\n";
-        }
-        settings.stream() << settings.indentation(indents + 1) << "]";
-    }
-    settings.stream() << "\n" << settings.indentation(indents) << "}";
-}
-
-template <typename T>
-void dump_json_array(const T *array, size_t len, const ApiDumpSettings &settings, const char *type_string, const char *child_type,
-                     const char *name, bool is_struct, bool is_union, int indents,
-                     void (*dump)(const T &, const ApiDumpSettings &, int)) {
-    if (len == 0 || array == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, array);
-        settings.stream() << "\n";
-        settings.stream() << settings.indentation(indents) << "}";
-        return;
-    }
-    settings.stream() << settings.indentation(indents) << "{\n";
-    if (len > 0 && array != NULL) {
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, array);
-        settings.stream() << ",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"elements\" :\n";
-        settings.stream() << settings.indentation(indents + 1) << "[\n";
-        for (size_t i = 0; i < len && array != NULL; ++i) {
-            std::stringstream stream;
-            stream << "[" << i << "]";
-            std::string indexName = stream.str();
-            dump_json_value(array[i], &array[i], settings, child_type, indexName.c_str(), is_struct, is_union, indents + 2, dump);
-            if (i < len - 1) settings.stream() << ',';
-            settings.stream() << "\n";
-        }
-        settings.stream() << settings.indentation(indents + 1) << "]";
-    }
-    settings.stream() << "\n" << settings.indentation(indents) << "}";
-}
-
-template <typename T>
-void dump_json_pointer(const T *pointer, const ApiDumpSettings &settings, const char *type_string, const char *name, bool is_struct,
-                       bool is_union, int indents, void (*dump)(const T, const ApiDumpSettings &, int)) {
-    if (pointer == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        settings.stream() << (settings.showAddress() ? "\"NULL\"" : "\"address\"") << "\n";
-        settings.stream() << settings.indentation(indents) << "}";
-    } else {
-        dump_json_value(*pointer, pointer, settings, type_string, name, is_struct, is_union, indents, dump);
-    }
-}
-
-template <typename T>
-void dump_json_pointer(const T *pointer, const ApiDumpSettings &settings, const char *type_string, const char *name, bool is_struct,
-                       bool is_union, int indents, void (*dump)(const T &, const ApiDumpSettings &, int)) {
-    if (pointer == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-        settings.stream() << (settings.showAddress() ? "\"NULL\"" : "\"address\"") << "\n";
-        settings.stream() << settings.indentation(indents) << "}";
-    } else {
-        dump_json_value(*pointer, pointer, settings, type_string, name, is_struct, is_union, indents, dump);
-    }
-}
-
-template <typename T>
-void dump_json_value(const T object, const void *pObject, const ApiDumpSettings &settings, const char *type_string,
-                     const char *name, bool is_struct, bool is_union, int indents,
-                     void (*dump)(const T, const ApiDumpSettings &, int)) {
-    bool isPnext = !strcmp(name, "pNext") || !strcmp(name, "pUserData");
-    const char *star = (isPnext && !strstr(type_string, "void")) ? "*" : "";
-    settings.stream() << settings.indentation(indents) << "{\n";
-    if (is_union)
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << star << " (Union)\",\n";
-    else
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << star << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\"";
-    if (isPnext || (strchr(type_string, '*') && strcmp(type_string, "const char*") && strcmp(type_string, "const char* const"))) {
-        // Print pointers, except for char string pointers
-        settings.stream() << ",\n" << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, pObject);
-    }
-    if (!isPnext || (isPnext && pObject != nullptr)) {
-        settings.stream() << ",\n";
-        if (is_struct || is_union)
-            settings.stream() << settings.indentation(indents + 1) << "\"members\" :\n";
-        else
-            settings.stream() << settings.indentation(indents + 1) << "\"value\" : ";
-        dump(object, settings, indents + 1);
-    }
-    settings.stream() << "\n";
-    settings.stream() << settings.indentation(indents) << "}";
-}
-
-template <typename T>
-void dump_json_value(const T &object, const void *pObject, const ApiDumpSettings &settings, const char *type_string,
-                     const char *name, bool is_struct, bool is_union, int indents,
-                     void (*dump)(const T &, const ApiDumpSettings &, int)) {
-    bool isPnext = !strcmp(name, "pNext") || !strcmp(name, "pUserData");
-    const char *star = (isPnext && !strstr(type_string, "void")) ? "*" : "";
-    settings.stream() << settings.indentation(indents) << "{\n";
-    if (is_union)
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << star << " (Union)\",\n";
-    else
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << star << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\"";
-    if (isPnext || (strchr(type_string, '*') && strcmp(type_string, "const char*") && strcmp(type_string, "const char* const"))) {
-        // Print pointers, except for char string pointers
-        settings.stream() << ",\n" << settings.indentation(indents + 1) << "\"address\" : ";
-        OutputAddressJSON(settings, pObject);
-    }
-    if (!isPnext || (isPnext && pObject != nullptr)) {
-        settings.stream() << ",\n";
-        if (is_struct || is_union)
-            settings.stream() << settings.indentation(indents + 1) << "\"members\" :\n";
-        else
-            settings.stream() << settings.indentation(indents + 1) << "\"value\" : ";
-        dump(object, settings, indents + 1);
-    }
-    settings.stream() << "\n";
-    settings.stream() << settings.indentation(indents) << "}";
-}
-
-void dump_json_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
-    settings.stream() << settings.indentation(indents) << "{\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
-    OutputAddressJSON(settings, text);
-    settings.stream() << ",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"value\" : ";
-    settings.stream() << "\"" << text << "\"\n";
-    settings.stream() << settings.indentation(indents) << "}";
-}
-
-void dump_json_UNUSED(const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
-    settings.stream() << settings.indentation(indents) << "{\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"address\" : \"UNUSED\",\n";
-    settings.stream() << settings.indentation(indents + 1) << "\"value\" : \"UNUSED\"\n";
-    settings.stream() << settings.indentation(indents) << "}";
-}
-
-void dump_json_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
-    if (object == NULL)
-        settings.stream() << "\"\"";
-    else
-        settings.stream() << "\"" << object << "\"";
-}
-
-void dump_json_void(const void *object, const ApiDumpSettings &settings, int indents) {
-    OutputAddressJSON(settings, object);
-    settings.stream() << "\n";
-}
-
-void dump_json_int(int object, const ApiDumpSettings &settings, int indents) {
-    settings.stream() << settings.indentation(indents) << "\"value\" : " << '"' << object << "\"";
-    settings.stream() << '"' << object << "\"";
-}
-
-template <typename T>
-void dump_json_pNext(const T *object, const ApiDumpSettings &settings, const char *type_string, int indents,
-                     void (*dump)(const T, const ApiDumpSettings &, int)) {
-    if (object == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "*\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"pNext\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : \"NULL\",\n";
-        settings.stream() << settings.indentation(indents) << "}";
-    } else {
-        dump_json_value(*object, object, settings, type_string, "pNext", true, false, indents, dump);
-    }
+    settings.flushCallOutput();
 }
 
-template <typename T>
-void dump_json_pNext(const T *object, const ApiDumpSettings &settings, const char *type_string, int indents,
-                     void (*dump)(const T &, const ApiDumpSettings &, int)) {
-    if (object == NULL) {
-        settings.stream() << settings.indentation(indents) << "{\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "*\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"pNext\",\n";
-        settings.stream() << settings.indentation(indents + 1) << "\"address\" : \"NULL\",\n";
-        settings.stream() << settings.indentation(indents) << "}";
-    } else {
-        dump_json_value(*object, object, settings, type_string, "pNext", true, false, indents, dump);
-    }
+// Written as an element of the apiCalls array of the frame
+inline void dump_json_call_counts(ApiDumpInstance &dump_inst, const std::vector<ApiDumpCallCount> &counts) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    if (!dump_inst.firstFunctionCallOnFrame()) settings.stream() << ",\n";
+    settings.stream() << settings.indentation(2) << "{\n";
+    settings.stream() << settings.indentation(3) << "\"callCounts\" :\n";
+    settings.stream() << settings.indentation(3) << "{";
+    for (size_t i = 0; i < counts.size(); i++) {
+        settings.stream() << (i == 0 ? "\n" : ",\n");
+        settings.stream() << settings.indentation(4) << "\"" << counts[i].name << "\" : " << counts[i].count;
+    }
+    settings.stream() << "\n" << settings.indentation(3) << "}\n";
+    settings.stream() << settings.indentation(2) << "}";
+    settings.flushCallOutput();
 }
 
 //==================================== Common Helpers ======================================//
 
-void dump_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams, const char *funcReturn) {
-    if (dump_inst.shouldDumpOutput()) {
+inline void dump_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                               const char *funcReturn) {
+    if (dump_inst.captureMode() == ApiDumpCaptureMode::Statistics) {
+        dump_inst.countCall(funcName);
+    } else if (dump_inst.shouldDumpOutput()) {
         switch (dump_inst.settings().format()) {
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
+                dump_inst.settings().countHtmlPageCall();
                 dump_html_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_JSON)
             case ApiDumpFormat::Json:
                 dump_json_function_head(dump_inst, funcName, funcReturn);
                 break;
+#endif
+            default:
+                break;
         }
     }
 }
+
+inline void ApiDumpInstance::dumpCallCounts() {
+    std::vector<ApiDumpCallCount> counts;
+    counts.reserve(call_counts.size());
+    for (const auto &entry : call_counts) {
+        counts.push_back({entry.first.data(), entry.second});
+    }
+    call_counts.clear();
+    std::sort(counts.begin(), counts.end(),
+              [](const ApiDumpCallCount &a, const ApiDumpCallCount &b) { return strcmp(a.name, b.name) < 0; });
+
+    switch (settings().format()) {
+#if defined(API_DUMP_FORMAT_TEXT)
+        case ApiDumpFormat::Text:
+            dump_text_call_counts(*this, counts);
+            break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
+        case ApiDumpFormat::Html:
+            dump_html_call_counts(*this, counts);
+            break;
+#endif
+#if defined(API_DUMP_FORMAT_JSON)
+        case ApiDumpFormat::Json:
+            dump_json_call_counts(*this, counts);
+            break;
+#endif
+#if defined(API_DUMP_REFLECTION)
+        case ApiDumpFormat::Binary:
+        case ApiDumpFormat::Ndjson:
+        case ApiDumpFormat::Csv:
+            dump_reflected_call_counts(*this, counts.data(), counts.size());
+            break;
+#endif
+        default:
+            break;
+    }
+}
@@ -0,0 +1,179 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Escaping of the strings written in the json and ndjson output. It doesn't depend on the Vulkan headers, so the tests
+// build it on its own.
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Used to scan strings 16 bytes at a time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define API_DUMP_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define API_DUMP_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// value must not be 0
+inline uint32_t api_dump_count_trailing_zeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    uint32_t count = 0;
+    for (; (value & 1) == 0; value >>= 1) count++;
+    return count;
+#endif
+}
+
+//===================================== JSON Strings ========================================//
+
+// How each byte is written in a JSON string: 0 copies it as is, 'u' writes it as \u00XX, 'U' starts a UTF-8 sequence which
+// is copied if it is valid, and any other value is the letter written after a backslash.
+struct ApiDumpJsonEscapes {
+    char action[256] = {};
+    constexpr ApiDumpJsonEscapes() {
+        for (int c = 0; c < 0x20; c++) action[c] = 'u';
+        for (int c = 0x80; c < 0x100; c++) action[c] = 'U';
+        action[static_cast<int>('"')] = '"';
+        action[static_cast<int>('\\')] = '\\';
+        action[static_cast<int>('\b')] = 'b';
+        action[static_cast<int>('\f')] = 'f';
+        action[static_cast<int>('\n')] = 'n';
+        action[static_cast<int>('\r')] = 'r';
+        action[static_cast<int>('\t')] = 't';
+    }
+};
+inline constexpr ApiDumpJsonEscapes kApiDumpJsonEscapes;
+
+// Returns the length of the prefix of value that needs no escape: no quote, backslash, control character or byte above 0x7F.
+// Strings are mostly ASCII, so they are scanned 16 bytes at a time where SIMD is available.
+inline size_t api_dump_json_clean_length(const char *value, size_t length) {
+    size_t i = 0;
+#if defined(API_DUMP_SIMD_SSE2)
+    // Bytes below 0x20 and above 0x7F are the signed bytes below 0x20
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= length; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value + i));
+        const __m128i special = _mm_or_si128(_mm_cmplt_epi8(bytes, space),
+                                             _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask != 0) return i + api_dump_count_trailing_zeros(mask);
+    }
+#elif defined(API_DUMP_SIMD_NEON)
+    const int8x16_t space = vdupq_n_s8(0x20);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    for (; i + 16 <= length; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(value + i));
+        const uint8x16_t special = vorrq_u8(vcltq_s8(vreinterpretq_s8_u8(bytes), space),
+                                            vorrq_u8(vceqq_u8(bytes, quote), vceqq_u8(bytes, backslash)));
+        // Narrows each byte of the comparison to 4 bits, so the first special byte is found with a single count
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+        if (mask != 0) return i + api_dump_count_trailing_zeros(mask) / 4;
+    }
+#endif
+    for (; i < length; i++) {
+        if (kApiDumpJsonEscapes.action[static_cast<unsigned char>(value[i])] != 0) break;
+    }
+    return i;
+}
+
+// Returns the length of the valid UTF-8 sequence at the start of value, or 0 if it is malformed: a stray continuation byte,
+// an overlong encoding, a surrogate, a code point above U+10FFFF or a truncated sequence.
+inline size_t api_dump_utf8_sequence_length(const unsigned char *value, size_t length) {
+    const unsigned char lead = value[0];
+    size_t count;
+    unsigned char low = 0x80, high = 0xBF;  // Range of the second byte
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        count = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        count = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        count = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+    if (count > length || value[1] < low || value[1] > high) return 0;
+    for (size_t i = 2; i < count; i++) {
+        if (value[i] < 0x80 || value[i] > 0xBF) return 0;
+    }
+    return count;
+}
+
+// Calls write(data, size) with the content of a JSON string holding value. The spans needing no escape are written whole,
+// and malformed UTF-8 is replaced by U+FFFD, so any string from the application gives valid JSON.
+template <typename Write>
+void api_dump_json_escape(const char *value, size_t length, Write write) {
+    static const char hex[] = "0123456789abcdef";
+    size_t i = 0;
+    while (i < length) {
+        const size_t clean = api_dump_json_clean_length(value + i, length - i);
+        if (clean > 0) {
+            write(value + i, clean);
+            i += clean;
+            if (i == length) break;
+        }
+
+        const unsigned char c = static_cast<unsigned char>(value[i]);
+        const char action = kApiDumpJsonEscapes.action[c];
+        if (action == 'U') {
+            const size_t sequence = api_dump_utf8_sequence_length(reinterpret_cast<const unsigned char *>(value + i), length - i);
+            if (sequence > 0) {
+                write(value + i, sequence);
+                i += sequence;
+            } else {
+                write("\\ufffd", 6);
+                i++;
+            }
+        } else if (action == 'u') {
+            const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            write(escaped, sizeof(escaped));
+            i++;
+        } else {
+            const char escaped[2] = {'\\', action};
+            write(escaped, sizeof(escaped));
+            i++;
+        }
+    }
+}
+
+inline void api_dump_json_escape(std::ostream &stream, const char *value, size_t length) {
+    api_dump_json_escape(value, length, [&stream](const char *data, size_t size) { stream.write(data, size); });
+}
+
+inline void api_dump_json_escape(std::string &line, const char *value, size_t length) {
+    api_dump_json_escape(value, length, [&line](const char *data, size_t size) { line.append(data, size); });
+}
@@ -0,0 +1,1139 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "api_dump.h"
+#include "api_dump_reflection.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+//================================= Walker ==================================//
+
+namespace {
+
+template <typename T>
+T readValue(const void *address) {
+    T value;
+    memcpy(&value, address, sizeof(T));
+    return value;
+}
+
+int64_t readSigned(const void *address, uint16_t size) {
+    switch (size) {
+        case 1:
+            return readValue<int8_t>(address);
+        case 2:
+            return readValue<int16_t>(address);
+        case 4:
+            return readValue<int32_t>(address);
+        default:
+            return readValue<int64_t>(address);
+    }
+}
+
+uint64_t readUnsigned(const void *address, uint16_t size) {
+    switch (size) {
+        case 1:
+            return readValue<uint8_t>(address);
+        case 2:
+            return readValue<uint16_t>(address);
+        case 4:
+            return readValue<uint32_t>(address);
+        default:
+            return readValue<uint64_t>(address);
+    }
+}
+
+// Distance between two elements of an array of the member's element type
+size_t elementStride(const ApiDumpMemberInfo &member) {
+    switch (member.tag) {
+        case ApiDumpTypeTag::Struct:
+        case ApiDumpTypeTag::Union:
+            return member.struct_info->size;
+        case ApiDumpTypeTag::Void:
+        case ApiDumpTypeTag::PNext:
+        case ApiDumpTypeTag::CString:
+            return sizeof(void *);
+        case ApiDumpTypeTag::FuncPointer:
+            return sizeof(PFN_vkVoidFunction);
+        default:
+            return member.size;
+    }
+}
+
+class Walker {
+   public:
+    Walker(ApiDumpEmitter &emitter, const ApiDumpSettings &settings) : emitter(emitter), settings(settings) {}
+
+    // Dumps the element at address, which holds a value of the member's element type.
+    void element(const ApiDumpMemberInfo &member, const char *name, const char *type, const void *address) {
+        switch (member.tag) {
+            case ApiDumpTypeTag::Void:
+                emitter.emitAddress(name, type, readValue<const void *>(address));
+                break;
+            case ApiDumpTypeTag::PNext:
+                pNext(name, type, readValue<const void *>(address));
+                break;
+            case ApiDumpTypeTag::Bool32:
+                emitter.emitBool(name, type, readValue<VkBool32>(address) != VK_FALSE);
+                break;
+            case ApiDumpTypeTag::SInt:
+                emitter.emitSigned(name, type, readSigned(address, member.size));
+                break;
+            case ApiDumpTypeTag::UInt:
+                emitter.emitUnsigned(name, type, readUnsigned(address, member.size));
+                break;
+            case ApiDumpTypeTag::Float:
+                if (member.size == sizeof(float))
+                    emitter.emitFloat(name, type, readValue<float>(address));
+                else
+                    emitter.emitFloat(name, type, readValue<double>(address));
+                break;
+            case ApiDumpTypeTag::CString: {
+                const char *string = readValue<const char *>(address);
+                if (string == nullptr)
+                    emitter.emitNull(name, type);
+                else
+                    emitter.emitString(name, type, string, strlen(string));
+                break;
+            }
+            case ApiDumpTypeTag::CharArray: {
+                const char *string = static_cast<const char *>(address);
+                emitter.emitString(name, type, string, strnlen(string, member.fixed_length));
+                break;
+            }
+            case ApiDumpTypeTag::Enum: {
+                int64_t value = readSigned(address, member.size);
+                emitter.emitEnum(name, type, value, member.enum_names ? api_dump_enum_name(*member.enum_names, value) : nullptr);
+                break;
+            }
+            case ApiDumpTypeTag::Flags:
+                emitter.emitFlags(name, type, readUnsigned(address, member.size), member.bitmask_names);
+                break;
+            case ApiDumpTypeTag::Handle:
+                emitter.emitHandle(name, type, readUnsigned(address, member.size));
+                break;
+            case ApiDumpTypeTag::Struct:
+            case ApiDumpTypeTag::Union:
+                structure(*member.struct_info, name, type ? type : member.struct_info->name, address);
+                break;
+            case ApiDumpTypeTag::FuncPointer:
+                emitter.emitAddress(name, type, reinterpret_cast<const void *>(readValue<PFN_vkVoidFunction>(address)));
+                break;
+            case ApiDumpTypeTag::Opaque:
+                if (member.size > 0 && member.size <= sizeof(uint64_t))
+                    emitter.emitOpaque(name, type, readUnsigned(address, member.size));
+                else
+                    emitter.emitAddress(name, type, address);
+                break;
+        }
+    }
+
+    // Dumps a struct member or function parameter. data is the address of the member or parameter and context is passed to
+    // the length and condition callbacks.
+    void member(const ApiDumpMemberInfo &member, const void *data, const void *context) {
+        if (member.condition && !member.condition(context)) {
+            emitter.emitUnused(member.name, member.type_name);
+            return;
+        }
+        if (member.is_shader_code && !settings.showShader()) {
+            emitter.emitShaderCode(member.name, member.type_name, readValue<const void *>(data));
+            return;
+        }
+
+        // In-place arrays
+        if (member.fixed_length > 0 && member.tag != ApiDumpTypeTag::CharArray) {
+            uint64_t count = member.length ? std::min<uint64_t>(member.length(context), member.fixed_length) : member.fixed_length;
+            array(member, data, count);
+            return;
+        }
+
+        // Follow the pointers down to the element, an element that is itself a pointer is only dumped as an address
+        uint8_t levels = member.pointer_levels;
+        if (levels == 0) {
+            element(member, member.name, member.type_name, data);
+            return;
+        }
+        const void *pointer = readValue<const void *>(data);
+        if (pointer == nullptr) {
+            emitter.emitNull(member.name, member.type_name);
+        } else if (levels > 1) {
+            emitter.emitAddress(member.name, member.type_name, pointer);
+        } else if (member.length) {
+            array(member, pointer, member.length(context));
+        } else {
+            emitter.valueAddress(pointer);
+            element(member, member.name, member.type_name, pointer);
+        }
+    }
+
+    void array(const ApiDumpMemberInfo &member, const void *data, uint64_t count) {
+        emitter.beginArray(member.name, member.type_name, data, count);
+        const size_t stride = elementStride(member);
+        const char *element_address = static_cast<const char *>(data);
+        for (uint64_t i = 0; i < count; i++, element_address += stride) {
+            emitter.valueAddress(element_address);
+            element(member, nullptr, nullptr, element_address);
+        }
+        emitter.endArray();
+    }
+
+    void structure(const ApiDumpStructInfo &info, const char *name, const char *type, const void *object) {
+        // Record the state other members depend on first, as the text backend does
+        for (uint32_t i = 0; i < info.member_count; i++) {
+            const ApiDumpMemberInfo &member = info.members[i];
+            if (member.store && (!member.condition || member.condition(object))) member.store(object);
+        }
+
+        if (info.is_union)
+            emitter.beginUnion(name, type, object);
+        else
+            emitter.beginStruct(name, type, object);
+        const char *base = static_cast<const char *>(object);
+        for (uint32_t i = 0; i < info.member_count; i++) {
+            this->member(info.members[i], base + info.members[i].offset, object);
+        }
+        emitter.endStruct();
+    }
+
+    void pNext(const char *name, const char *type, const void *chain) {
+        if (chain == nullptr) {
+            emitter.emitNull(name, type);
+            return;
+        }
+        // Skip the structs the loader inserts in the chain of vkCreateInstance and vkCreateDevice
+        const VkBaseInStructure *next = static_cast<const VkBaseInStructure *>(chain);
+        while ((next->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO ||
+                next->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO) &&
+               next->pNext != nullptr) {
+            next = next->pNext;
+        }
+        const ApiDumpStructInfo *info = api_dump_struct_info_from_stype(next->sType);
+        if (info == nullptr) {
+            // Unknown structs, and the loader structs ending a chain
+            emitter.emitAddress(name, type, next);
+            return;
+        }
+        structure(*info, name, info->name, next);
+    }
+
+   private:
+    ApiDumpEmitter &emitter;
+    const ApiDumpSettings &settings;
+};
+
+// "3 (NAME_A | NAME_B)", the way the json format writes a bitmask
+std::string flagsText(uint64_t value, const ApiDumpBitmaskNames *bitmask_names) {
+    std::string names;
+    if (bitmask_names) api_dump_flags_to_string(value, *bitmask_names, names);
+    std::string text = std::to_string(value);
+    if (!names.empty()) {
+        text += " (";
+        text += names;
+        text += ')';
+    }
+    return text;
+}
+
+//=============================== JSON Emitter ==============================//
+
+// Writes each call as an element of the apiCalls array of its frame. The head of the call, up to its return type, is written
+// by dump_json_function_head() before the call is made. Each argument is an object with its type, name, address when it is
+// a pointer, and its value, struct members or array elements:
+// {
+//     "type" : "const VkInstanceCreateInfo*",
+//     "name" : "pCreateInfo",
+//     "address" : "0x7ffd1c3e8f30",
+//     "members" :
+//     [
+//         ...
+//     ]
+// }
+class ApiDumpJsonEmitter final : public ApiDumpEmitter {
+   public:
+    explicit ApiDumpJsonEmitter(const ApiDumpSettings &settings) : settings(settings) {}
+
+    void beginCall(const ApiDumpCallInfo &call) override {
+        scopes.clear();
+        value_address = nullptr;
+    }
+    void endCall() override { settings.stream() << settings.indentation(2) << "}"; }
+    void beginParams() override {
+        settings.stream() << settings.indentation(3) << "\"args\" :\n";
+        settings.stream() << settings.indentation(3) << "[\n";
+        scopes.push_back({2, 4, false, false, true, 0, 0, std::string()});
+    }
+    void endParams() override {
+        settings.stream() << "\n" << settings.indentation(3) << "]\n";
+        scopes.pop_back();
+    }
+
+    void beginStruct(const char *name, const char *type, const void *address) override { beginMembers(name, type, address, false); }
+    void beginUnion(const char *name, const char *type, const void *address) override { beginMembers(name, type, address, true); }
+    void endStruct() override {
+        const int indent = scopes.back().indent;
+        scopes.pop_back();
+        settings.stream() << "\n" << settings.indentation(indent + 1) << "]";
+        settings.stream() << "\n" << settings.indentation(indent) << "}";
+    }
+    void beginArray(const char *name, const char *type, const void *address, uint64_t count) override {
+        type = open(name, type);
+        const int indent = scopes.back().value_indent;
+        addressLine(indent, address);
+        if (count > 0) {
+            settings.stream() << ",\n" << settings.indentation(indent + 1) << "\"elements\" :\n";
+            settings.stream() << settings.indentation(indent + 1) << "[\n";
+        }
+        // "const VkFoo*" and "float[4]" hold "const VkFoo" and "float" elements
+        const char *end = type[0] != '\0' && type[strlen(type) - 1] == ']' ? strrchr(type, '[') : strrchr(type, '*');
+        scopes.push_back({indent, indent + 2, true, false, true, count, 0, std::string(type, end ? end - type : strlen(type))});
+    }
+    void endArray() override {
+        const Scope &scope = scopes.back();
+        if (scope.count > 0) settings.stream() << "\n" << settings.indentation(scope.indent + 1) << "]";
+        settings.stream() << "\n" << settings.indentation(scope.indent) << "}";
+        scopes.pop_back();
+    }
+
+    void emitNull(const char *name, const char *type) override {
+        if (isString(elementType(type))) {
+            value(name, type, [](std::ostream &stream) { stream << "\"\""; });
+            return;
+        }
+        open(name, type);
+        const int indent = scopes.back().value_indent;
+        addressLine(indent, nullptr);
+        settings.stream() << "\n" << settings.indentation(indent) << "}";
+    }
+    void emitSigned(const char *name, const char *type, int64_t value) override {
+        this->value(name, type, [value](std::ostream &stream) { stream << '"' << value << '"'; });
+    }
+    void emitUnsigned(const char *name, const char *type, uint64_t value) override {
+        this->value(name, type, [value](std::ostream &stream) { stream << '"' << value << '"'; });
+    }
+    void emitFloat(const char *name, const char *type, double value) override {
+        this->value(name, type, [value](std::ostream &stream) { stream << '"' << value << '"'; });
+    }
+    // VkBool32 is written as its number
+    void emitBool(const char *name, const char *type, bool value) override {
+        this->value(name, type, [value](std::ostream &stream) { stream << (value ? "\"1\"" : "\"0\""); });
+    }
+    void emitString(const char *name, const char *type, const char *value, size_t length) override {
+        this->value(name, type, [value, length](std::ostream &stream) {
+            stream << '"';
+            api_dump_json_escape(stream, value, length);
+            stream << '"';
+        });
+    }
+    void emitEnum(const char *name, const char *type, int64_t value, const char *enumerant) override {
+        this->value(name, type, [value, enumerant](std::ostream &stream) {
+            if (enumerant)
+                stream << '"' << enumerant << '"';
+            else
+                stream << "\"UNKNOWN (" << value << ")\"";
+        });
+    }
+    void emitFlags(const char *name, const char *type, uint64_t value, const ApiDumpBitmaskNames *bitmask_names) override {
+        this->value(name, type, [this, value, bitmask_names](std::ostream &stream) {
+            stream << '"' << value;
+            if (bitmask_names) dump_bitmask_names(*bitmask_names, value, settings);
+            stream << '"';
+        });
+    }
+    void emitHandle(const char *name, const char *type, uint64_t value) override {
+        this->value(name, type, [this, value](std::ostream &stream) {
+            if (!settings.showAddress())
+                stream << "\"address\"";
+            else if (sizeof(void *) == sizeof(uint64_t))
+                stream << '"' << reinterpret_cast<const void *>(static_cast<uintptr_t>(value)) << '"';
+            else
+                stream << '"' << value << '"';
+        });
+    }
+    void emitAddress(const char *name, const char *type, const void *value) override {
+        if (name != nullptr && strcmp(name, "pNext") == 0) {
+            // The loader structs ending a chain are written as the end of the chain
+            const int32_t s_type = static_cast<const VkBaseInStructure *>(value)->sType;
+            const int indent = scopes.back().value_indent;
+            const bool is_loader =
+                s_type == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO || s_type == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO;
+            separate();
+            settings.stream() << settings.indentation(indent) << "{\n";
+            settings.stream() << settings.indentation(indent + 1) << "\"type\" : \"const void*\",\n";
+            settings.stream() << settings.indentation(indent + 1) << "\"name\" : \"pNext\",\n";
+            if (is_loader)
+                settings.stream() << settings.indentation(indent + 1) << "\"value\" : \"NULL\"\n";
+            else
+                settings.stream() << settings.indentation(indent + 1) << "\"value\" : \"UNKNOWN (" << s_type << ")\"\n";
+            settings.stream() << settings.indentation(indent) << "}";
+        } else if (name != nullptr && strcmp(name, "pUserData") == 0) {
+            // Only the address of the user data is written, and it is always NULL
+            open(name, type);
+            const int indent = scopes.back().value_indent;
+            addressLine(indent, nullptr);
+            settings.stream() << "\n" << settings.indentation(indent) << "}";
+        } else if (strncmp(elementType(type), "PFN_", 4) == 0) {
+            this->value(name, type, [this, value](std::ostream &stream) {
+                if (settings.showAddress())
+                    stream << '"' << (value != nullptr) << '"';
+                else
+                    stream << "\"address\"";
+            });
+        } else {
+            this->value(name, type, [this, value](std::ostream &stream) {
+                OutputAddressJSON(settings, value);
+                stream << "\n";
+            });
+        }
+    }
+    void emitOpaque(const char *name, const char *type, uint64_t value) override {
+        this->value(name, type, [this, value](std::ostream &stream) {
+            if (settings.showAddress())
+                stream << '"' << value << '"';
+            else
+                stream << "\"address\"";
+        });
+    }
+    void emitShaderCode(const char *name, const char *type, const void *code) override {
+        open(name, type);
+        const int indent = scopes.back().value_indent;
+        addressLine(indent, code);
+        settings.stream() << ",\n" << settings.indentation(indent + 1) << "\"value\" : \"SHADER DATA\"\n";
+        settings.stream() << settings.indentation(indent) << "}";
+    }
+    // Only the members of structs are marked as unused, the choices of unions that are not selected are skipped
+    void emitUnused(const char *name, const char *type) override {
+        if (scopes.back().is_union) return;
+        open(name, type);
+        const int indent = scopes.back().value_indent;
+        settings.stream() << ",\n" << settings.indentation(indent + 1) << "\"address\" : \"UNUSED\",\n";
+        settings.stream() << settings.indentation(indent + 1) << "\"value\" : \"UNUSED\"\n";
+        settings.stream() << settings.indentation(indent) << "}";
+    }
+    void valueAddress(const void *address) override { value_address = address; }
+
+    // The call counts are written with the frame by dump_json_call_counts()
+    void emitCallCounts(uint64_t frame, const ApiDumpCallCount *counts, size_t count) override {}
+
+   private:
+    struct Scope {
+        int indent;           // Indentation of the object holding the values of the scope
+        int value_indent;     // Indentation of the values
+        bool is_array;
+        bool is_union;
+        bool is_empty;        // No value was written in the scope yet
+        uint64_t count;       // Number of elements of arrays
+        uint64_t next_index;  // Index of the next element of arrays
+        std::string element_type;
+    };
+
+    // Array elements are named after their index and have the element type of their array
+    const char *elementType(const char *type) const {
+        return !scopes.empty() && scopes.back().is_array ? scopes.back().element_type.c_str() : type;
+    }
+    static bool isString(const char *type) { return strcmp(type, "const char*") == 0 || strcmp(type, "const char* const") == 0; }
+    // pNext and pUserData are written with the address they hold
+    static bool isChain(const char *name) {
+        return name != nullptr && (strcmp(name, "pNext") == 0 || strcmp(name, "pUserData") == 0);
+    }
+    // The address of pointers is written, except for strings
+    static bool hasAddress(const char *name, const char *type) {
+        return isChain(name) || (strchr(type, '*') != nullptr && !isString(type));
+    }
+
+    // Starts a value in the current scope, the address given by valueAddress() only applies to that value
+    void separate() {
+        value_address = nullptr;
+        Scope &scope = scopes.back();
+        if (!scope.is_empty) settings.stream() << ",\n";
+        scope.is_empty = false;
+    }
+
+    // Writes the type and name of a value in the current scope, and returns the type. The object of the value is left open, at
+    // the indentation of the values of the scope, which is also the indentation the value's own lines are relative to.
+    const char *open(const char *name, const char *type, bool is_union = false) {
+        separate();
+        Scope &scope = scopes.back();
+        type = elementType(type);
+        const int indent = scope.value_indent;
+        std::ostream &stream = settings.stream();
+        stream << settings.indentation(indent) << "{\n";
+        stream << settings.indentation(indent + 1) << "\"type\" : \"" << type;
+        if (isChain(name) && strstr(type, "void") == nullptr) stream << '*';
+        if (is_union) stream << " (Union)";
+        stream << "\",\n";
+        stream << settings.indentation(indent + 1) << "\"name\" : \"";
+        if (scope.is_array)
+            stream << '[' << scope.next_index++ << ']';
+        else
+            stream << name;
+        stream << '"';
+        return type;
+    }
+    void addressLine(int indent, const void *address) {
+        settings.stream() << ",\n" << settings.indentation(indent + 1) << "\"address\" : ";
+        OutputAddressJSON(settings, address);
+    }
+
+    // Writes a scalar value, write() writes the value itself. The return value of the call is written before its arguments.
+    template <typename Write>
+    void value(const char *name, const char *type, Write write) {
+        const void *address = value_address;
+        std::ostream &stream = settings.stream();
+        if (scopes.empty()) {
+            stream << settings.indentation(3) << "\"returnValue\" : ";
+            write(stream);
+            if (settings.showParams()) stream << ",";
+            stream << "\n";
+            return;
+        }
+        type = open(name, type);
+        const int indent = scopes.back().value_indent;
+        if (hasAddress(name, type)) addressLine(indent, address);
+        stream << ",\n" << settings.indentation(indent + 1) << "\"value\" : ";
+        write(stream);
+        stream << "\n" << settings.indentation(indent) << "}";
+    }
+
+    void beginMembers(const char *name, const char *type, const void *address, bool is_union) {
+        type = open(name, type, is_union);
+        const int indent = scopes.back().value_indent;
+        if (hasAddress(name, type)) addressLine(indent, address);
+        settings.stream() << ",\n" << settings.indentation(indent + 1) << "\"members\" :\n";
+        settings.stream() << settings.indentation(indent + 1) << "[\n";
+        // The choices of unions are indented one more level than the members of structs
+        scopes.push_back({indent, indent + (is_union ? 3 : 2), false, is_union, true, 0, 0, std::string()});
+    }
+
+    const ApiDumpSettings &settings;
+    std::vector<Scope> scopes;
+    const void *value_address = nullptr;
+};
+
+//============================== Binary Emitter =============================//
+
+class ApiDumpBinaryEmitter final : public ApiDumpEmitter {
+   public:
+    explicit ApiDumpBinaryEmitter(const ApiDumpSettings &settings) : settings(settings) {}
+
+    void reset() override {
+        interned_names.clear();
+        interned_flags.clear();
+        next_id = 1;
+    }
+
+    void beginCall(const ApiDumpCallInfo &call) override {
+        buffer.clear();
+        writeTag(ApiDumpBinaryTag::Call);
+        write(call.sequence);
+        write(call.thread);
+        write(call.frame);
+        write(call.timestamp_us);
+        writeName(call.name);
+        writeName(call.return_type);
+    }
+    void endCall() override {
+        writeTag(ApiDumpBinaryTag::End);
+        settings.stream().write(buffer.data(), buffer.size());
+    }
+    void beginParams() override { writeTag(ApiDumpBinaryTag::Params); }
+    void endParams() override { writeTag(ApiDumpBinaryTag::End); }
+
+    void beginStruct(const char *name, const char *type, const void *address) override {
+        writeHead(ApiDumpBinaryTag::Struct, name, type);
+        writeAddress(address);
+    }
+    void endStruct() override { writeTag(ApiDumpBinaryTag::End); }
+    void beginArray(const char *name, const char *type, const void *address, uint64_t count) override {
+        writeHead(ApiDumpBinaryTag::Array, name, type);
+        writeAddress(address);
+        write(count);
+    }
+    void endArray() override { writeTag(ApiDumpBinaryTag::End); }
+
+    void emitNull(const char *name, const char *type) override { writeHead(ApiDumpBinaryTag::Null, name, type); }
+    void emitSigned(const char *name, const char *type, int64_t value) override {
+        writeHead(ApiDumpBinaryTag::Signed, name, type);
+        write(value);
+    }
+    void emitUnsigned(const char *name, const char *type, uint64_t value) override {
+        writeHead(ApiDumpBinaryTag::Unsigned, name, type);
+        write(value);
+    }
+    void emitFloat(const char *name, const char *type, double value) override {
+        writeHead(ApiDumpBinaryTag::Float, name, type);
+        write(value);
+    }
+    void emitBool(const char *name, const char *type, bool value) override {
+        writeHead(ApiDumpBinaryTag::Bool, name, type);
+        write(static_cast<uint8_t>(value));
+    }
+    void emitString(const char *name, const char *type, const char *value, size_t length) override {
+        writeHead(ApiDumpBinaryTag::String, name, type);
+        write(static_cast<uint32_t>(length));
+        buffer.append(value, length);
+    }
+    void emitEnum(const char *name, const char *type, int64_t value, const char *enumerant) override {
+        writeHead(ApiDumpBinaryTag::Enum, name, type);
+        write(value);
+        writeName(enumerant);
+    }
+    void emitFlags(const char *name, const char *type, uint64_t value, const ApiDumpBitmaskNames *bitmask_names) override {
+        writeHead(ApiDumpBinaryTag::Flags, name, type);
+        write(value);
+        flags_string.clear();
+        if (bitmask_names) api_dump_flags_to_string(value, *bitmask_names, flags_string);
+        writeFlagsString();
+    }
+    void emitHandle(const char *name, const char *type, uint64_t value) override {
+        writeHead(ApiDumpBinaryTag::Handle, name, type);
+        write(settings.showAddress() ? value : 0);
+    }
+    void emitAddress(const char *name, const char *type, const void *value) override {
+        writeHead(ApiDumpBinaryTag::Address, name, type);
+        writeAddress(value);
+    }
+
+    void emitCallCounts(uint64_t frame, const ApiDumpCallCount *counts, size_t count) override {
+        buffer.clear();
+        writeTag(ApiDumpBinaryTag::CallCounts);
+        write(frame);
+        write(static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; i++) {
+            writeName(counts[i].name);
+            write(counts[i].count);
+        }
+        settings.stream().write(buffer.data(), buffer.size());
+    }
+
+   private:
+    template <typename T>
+    void write(T value) {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    void writeTag(ApiDumpBinaryTag tag) { buffer.push_back(static_cast<char>(tag)); }
+    void writeAddress(const void *address) { write(settings.showAddress() ? reinterpret_cast<uint64_t>(address) : 0); }
+    void writeHead(ApiDumpBinaryTag tag, const char *name, const char *type) {
+        writeTag(tag);
+        writeName(name);
+        writeName(type);
+    }
+
+    // Names and types come from the reflection tables, so their address identifies them
+    void writeName(const char *name) {
+        if (name == nullptr) {
+            write(uint32_t(0));
+            return;
+        }
+        auto inserted = interned_names.emplace(name, next_id);
+        write(inserted.first->second);
+        if (inserted.second) {
+            next_id++;
+            write(static_cast<uint32_t>(strlen(name)));
+            buffer.append(name);
+        }
+    }
+    void writeFlagsString() {
+        if (flags_string.empty()) {
+            write(uint32_t(0));
+            return;
+        }
+        auto inserted = interned_flags.emplace(flags_string, next_id);
+        write(inserted.first->second);
+        if (inserted.second) {
+            next_id++;
+            write(static_cast<uint32_t>(flags_string.size()));
+            buffer.append(flags_string);
+        }
+    }
+
+    const ApiDumpSettings &settings;
+    std::string buffer;
+    std::string flags_string;
+    std::unordered_map<const char *, uint32_t> interned_names;
+    std::unordered_map<std::string, uint32_t> interned_flags;
+    uint32_t next_id = 1;
+};
+
+//============================== NDJSON Emitter =============================//
+
+// Writes one JSON object per line for each call:
+// {"seq":0,"thread":0,"frame":0,"time":0,"name":"vkCreateDevice","returnType":"VkResult","result":"VK_SUCCESS","args":{...}}
+class ApiDumpNdjsonEmitter final : public ApiDumpEmitter {
+   public:
+    explicit ApiDumpNdjsonEmitter(const ApiDumpSettings &settings) : settings(settings) {}
+
+    void beginCall(const ApiDumpCallInfo &call) override {
+        line.clear();
+        line += "{\"seq\":";
+        line += std::to_string(call.sequence);
+        line += ",\"thread\":";
+        line += std::to_string(call.thread);
+        line += ",\"frame\":";
+        line += std::to_string(call.frame);
+        if (settings.showTimestamp()) {
+            line += ",\"time\":";
+            line += std::to_string(call.timestamp_us);
+        }
+        line += ",\"name\":\"";
+        line += call.name;
+        line += "\",\"returnType\":\"";
+        line += call.return_type;
+        line += "\"";
+        first_in_scope = false;
+    }
+    void endCall() override {
+        line += "}\n";
+        settings.stream().write(line.data(), line.size());
+    }
+    void beginParams() override {
+        key("args");
+        line += '{';
+        first_in_scope = true;
+    }
+    void endParams() override { close('}'); }
+
+    void beginStruct(const char *name, const char *type, const void *address) override {
+        key(name);
+        line += '{';
+        first_in_scope = true;
+    }
+    void endStruct() override { close('}'); }
+    void beginArray(const char *name, const char *type, const void *address, uint64_t count) override {
+        key(name);
+        line += '[';
+        first_in_scope = true;
+    }
+    void endArray() override { close(']'); }
+
+    void emitNull(const char *name, const char *type) override {
+        key(name);
+        line += "null";
+    }
+    void emitSigned(const char *name, const char *type, int64_t value) override {
+        key(name);
+        line += std::to_string(value);
+    }
+    void emitUnsigned(const char *name, const char *type, uint64_t value) override {
+        key(name);
+        line += std::to_string(value);
+    }
+    void emitFloat(const char *name, const char *type, double value) override {
+        key(name);
+        // JSON has no representation of NaN or infinity
+        if (value != value || value > std::numeric_limits<double>::max() || value < -std::numeric_limits<double>::max()) {
+            quoted(std::to_string(value));
+            return;
+        }
+        char number[32];
+        int length = snprintf(number, sizeof(number), "%.9g", value);
+        line.append(number, length);
+    }
+    void emitBool(const char *name, const char *type, bool value) override {
+        key(name);
+        line += value ? "true" : "false";
+    }
+    void emitString(const char *name, const char *type, const char *value, size_t length) override {
+        key(name);
+        line += '"';
+        api_dump_json_escape(line, value, length);
+        line += '"';
+    }
+    void emitEnum(const char *name, const char *type, int64_t value, const char *enumerant) override {
+        key(name);
+        if (enumerant)
+            quoted(enumerant);
+        else
+            line += std::to_string(value);
+    }
+    void emitFlags(const char *name, const char *type, uint64_t value, const ApiDumpBitmaskNames *bitmask_names) override {
+        key(name);
+        quoted(flagsText(value, bitmask_names));
+    }
+    void emitHandle(const char *name, const char *type, uint64_t value) override {
+        key(name);
+        address(reinterpret_cast<const void *>(static_cast<uintptr_t>(value)), value == 0);
+    }
+    void emitAddress(const char *name, const char *type, const void *value) override {
+        key(name);
+        address(value, value == nullptr);
+    }
+
+    // {"frame":0,"callCounts":{"vkCmdDraw":120,...}}
+    void emitCallCounts(uint64_t frame, const ApiDumpCallCount *counts, size_t count) override {
+        line.clear();
+        line += "{\"frame\":";
+        line += std::to_string(frame);
+        line += ",\"callCounts\":{";
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) line += ',';
+            quoted(counts[i].name);
+            line += ':';
+            line += std::to_string(counts[i].count);
+        }
+        line += "}}\n";
+        settings.stream().write(line.data(), line.size());
+    }
+
+   private:
+    // Separates values and writes the key of object members, array elements don't have a name
+    void key(const char *name) {
+        if (!first_in_scope) line += ',';
+        first_in_scope = false;
+        if (name != nullptr) {
+            line += '"';
+            line += name;
+            line += "\":";
+        }
+    }
+    void close(char bracket) {
+        line += bracket;
+        first_in_scope = false;
+    }
+    void quoted(const std::string &value) {
+        line += '"';
+        line += value;
+        line += '"';
+    }
+    void address(const void *value, bool is_null) {
+        if (is_null) {
+            line += "null";
+        } else if (!settings.showAddress()) {
+            line += "\"address\"";
+        } else {
+            char text[32];
+            const uint64_t raw_address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+            int length = snprintf(text, sizeof(text), "\"0x%" PRIx64 "\"", raw_address);
+            line.append(text, length);
+        }
+    }
+    const ApiDumpSettings &settings;
+    std::string line;
+    bool first_in_scope = true;
+};
+
+//=============================== CSV Emitter ===============================//
+
+// Writes a row per call, with a header row at the start of the output:
+// seq,thread,frame,time,command,result,duration_ns,<csv_params>,args
+// Each parameter listed in csv_params, such as pCreateInfo.size, has its own column, left empty by the calls that don't have
+// it. The other values, down to csv_depth levels of structs and arrays, go to the args column as space separated
+// path=value pairs.
+class ApiDumpCsvEmitter final : public ApiDumpEmitter {
+   public:
+    explicit ApiDumpCsvEmitter(const ApiDumpSettings &settings) : settings(settings) {
+        for (const std::string &param : settings.csvParams()) {
+            // Values deeper than the deepest column and csv_depth are skipped without building their path
+            const size_t levels = std::count_if(param.begin(), param.end(), [](char c) { return c == '.' || c == '['; });
+            max_depth = std::max<size_t>(max_depth, levels);
+        }
+        max_depth = std::max<size_t>(max_depth, settings.csvDepth());
+    }
+
+    // Each output file starts with the header row
+    void reset() override {
+        line = "seq,thread,frame,time,command,result,duration_ns";
+        for (const std::string &param : settings.csvParams()) {
+            line += ',';
+            field(param);
+        }
+        line += ",args\n";
+        settings.stream().write(line.data(), line.size());
+    }
+
+    void beginCall(const ApiDumpCallInfo &call) override {
+        line.clear();
+        line += std::to_string(call.sequence);
+        line += ',';
+        line += std::to_string(call.thread);
+        line += ',';
+        line += std::to_string(call.frame);
+        line += ',';
+        if (settings.showTimestamp()) line += std::to_string(call.timestamp_us);
+        line += ',';
+        line += call.name;
+        line += ',';
+        duration_ns = call.duration_ns;
+        result.clear();
+        args.clear();
+        columns.assign(settings.csvParams().size(), std::string());
+        path.clear();
+        scopes.clear();
+        in_params = false;
+    }
+    void endCall() override {
+        field(result);
+        line += ',';
+        line += std::to_string(duration_ns);
+        for (const std::string &column : columns) {
+            line += ',';
+            field(column);
+        }
+        line += ',';
+        field(args);
+        line += '\n';
+        settings.stream().write(line.data(), line.size());
+    }
+    void beginParams() override { in_params = true; }
+    void endParams() override {}
+
+    void beginStruct(const char *name, const char *type, const void *address) override { beginScope(name, false); }
+    void endStruct() override { endScope(); }
+    void beginArray(const char *name, const char *type, const void *address, uint64_t count) override {
+        beginScope(name, true);
+    }
+    void endArray() override { endScope(); }
+
+    void emitNull(const char *name, const char *type) override { value(name, "null"); }
+    void emitSigned(const char *name, const char *type, int64_t value) override { this->value(name, std::to_string(value)); }
+    void emitUnsigned(const char *name, const char *type, uint64_t value) override { this->value(name, std::to_string(value)); }
+    void emitFloat(const char *name, const char *type, double value) override {
+        char number[32];
+        snprintf(number, sizeof(number), "%.9g", value);
+        this->value(name, number);
+    }
+    void emitBool(const char *name, const char *type, bool value) override { this->value(name, value ? "true" : "false"); }
+    void emitString(const char *name, const char *type, const char *value, size_t length) override {
+        this->value(name, std::string(value, length));
+    }
+    void emitEnum(const char *name, const char *type, int64_t value, const char *enumerant) override {
+        this->value(name, enumerant ? std::string(enumerant) : std::to_string(value));
+    }
+    void emitFlags(const char *name, const char *type, uint64_t value, const ApiDumpBitmaskNames *bitmask_names) override {
+        this->value(name, std::to_string(value));
+    }
+    void emitHandle(const char *name, const char *type, uint64_t value) override {
+        address(name, reinterpret_cast<const void *>(static_cast<uintptr_t>(value)));
+    }
+    void emitAddress(const char *name, const char *type, const void *value) override { address(name, value); }
+
+    // A row per command, with the number of calls in the args column: ,,0,,vkCmdDraw,,,count=120
+    void emitCallCounts(uint64_t frame, const ApiDumpCallCount *counts, size_t count) override {
+        line.clear();
+        for (size_t i = 0; i < count; i++) {
+            line += ",,";
+            line += std::to_string(frame);
+            line += ",,";
+            line += counts[i].name;
+            line += ",,";
+            line.append(settings.csvParams().size(), ',');
+            line += ",count=";
+            line += std::to_string(counts[i].count);
+            line += '\n';
+        }
+        settings.stream().write(line.data(), line.size());
+    }
+
+   private:
+    struct Scope {
+        size_t path_length;  // Length of the path before the struct or array was entered
+        bool is_array;
+        uint64_t next_index;
+    };
+
+    // Appends the name of a value to the path, returns false when the value is too deep to be written
+    bool enter(const char *name) {
+        if (scopes.size() > max_depth) return false;
+        if (scopes.empty()) {
+            path = name ? name : "";
+        } else if (scopes.back().is_array) {
+            path += '[';
+            path += std::to_string(scopes.back().next_index++);
+            path += ']';
+        } else {
+            path += '.';
+            if (name) path += name;
+        }
+        return true;
+    }
+
+    void beginScope(const char *name, bool is_array) {
+        const size_t length = path.size();
+        enter(name);
+        scopes.push_back({length, is_array, 0});
+    }
+    void endScope() {
+        path.resize(scopes.back().path_length);
+        scopes.pop_back();
+    }
+
+    void value(const char *name, const std::string &text) {
+        if (!in_params) {
+            result = text;
+            return;
+        }
+        const size_t length = path.size();
+        if (!enter(name)) return;
+        const std::vector<std::string> &params = settings.csvParams();
+        for (size_t i = 0; i < params.size(); i++) {
+            if (params[i] == path) columns[i] = text;
+        }
+        if (scopes.size() <= settings.csvDepth()) {
+            if (!args.empty()) args += ' ';
+            args += path;
+            args += '=';
+            args += text;
+        }
+        path.resize(length);
+    }
+
+    void address(const char *name, const void *value) {
+        if (value == nullptr) {
+            this->value(name, "null");
+        } else if (!settings.showAddress()) {
+            this->value(name, "address");
+        } else {
+            char text[32];
+            snprintf(text, sizeof(text), "0x%" PRIx64, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+            this->value(name, text);
+        }
+    }
+
+    // Quotes the fields holding a separator, a quote or a new line, quotes are doubled
+    void field(const std::string &text) {
+        if (text.find_first_of(",\"\r\n") == std::string::npos) {
+            line += text;
+            return;
+        }
+        line += '"';
+        for (char c : text) {
+            if (c == '"') line += '"';
+            line += c;
+        }
+        line += '"';
+    }
+
+    const ApiDumpSettings &settings;
+    size_t max_depth = 0;
+    std::string line;
+    std::string result;
+    std::string args;
+    std::vector<std::string> columns;
+    std::string path;
+    std::vector<Scope> scopes;
+    uint64_t duration_ns = 0;
+    bool in_params = false;
+};
+
+// Emitters keep the state of the stream they write to, so each thread file of file_per_thread has its own
+template <typename Emitter>
+ApiDumpEmitter *getFormatEmitter(const ApiDumpSettings &settings) {
+    if (settings.filePerThread()) {
+        static thread_local Emitter thread_emitter(settings);
+        return &thread_emitter;
+    }
+    static Emitter emitter(settings);
+    return &emitter;
+}
+
+ApiDumpEmitter *getEmitter(const ApiDumpSettings &settings) {
+    switch (settings.format()) {
+#if defined(API_DUMP_FORMAT_JSON)
+        case ApiDumpFormat::Json:
+            return getFormatEmitter<ApiDumpJsonEmitter>(settings);
+#endif
+#if defined(API_DUMP_FORMAT_BINARY)
+        case ApiDumpFormat::Binary:
+            return getFormatEmitter<ApiDumpBinaryEmitter>(settings);
+#endif
+#if defined(API_DUMP_FORMAT_NDJSON)
+        case ApiDumpFormat::Ndjson:
+            return getFormatEmitter<ApiDumpNdjsonEmitter>(settings);
+#endif
+#if defined(API_DUMP_FORMAT_CSV)
+        case ApiDumpFormat::Csv:
+            return getFormatEmitter<ApiDumpCsvEmitter>(settings);
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+}  // namespace
+
+void dump_reflected_call(ApiDumpInstance &dump_inst, const ApiDumpFunctionInfo &function, const void *result,
+                         const void *const *args) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    ApiDumpEmitter *emitter = getEmitter(settings);
+    if (emitter == nullptr) return;
+    if (settings.beginOutputRecord(dump_inst.threadID())) api_dump_start_reflected_output(settings);
+
+    ApiDumpCallInfo call{};
+    call.name = function.name;
+    call.sequence = dump_inst.callIndex();
+    call.return_type = function.result ? function.result->type_name : "void";
+    call.thread = dump_inst.threadID();
+    call.frame = dump_inst.frameCount();
+    if (settings.format() == ApiDumpFormat::Csv) call.duration_ns = dump_inst.callDurationNs();
+    if (settings.showTimestamp()) call.timestamp_us = dump_inst.current_time_since_start().count();
+
+    Walker walker(*emitter, settings);
+    emitter->beginCall(call);
+    if (function.result && result) walker.element(*function.result, "result", function.result->type_name, result);
+    if (settings.showParams()) {
+        for (uint32_t i = 0; i < function.param_count; i++) {
+            const ApiDumpMemberInfo &param = function.params[i];
+            if (param.store) param.store(args);
+        }
+        emitter->beginParams();
+        for (uint32_t i = 0; i < function.param_count; i++) {
+            walker.member(function.params[i], args[function.params[i].offset], args);
+        }
+        emitter->endParams();
+    }
+    emitter->endCall();
+    settings.flushCallOutput();
+}
+
+void dump_reflected_call_counts(ApiDumpInstance &dump_inst, const ApiDumpCallCount *counts, size_t count) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    ApiDumpEmitter *emitter = getEmitter(settings);
+    if (emitter == nullptr) return;
+    if (settings.beginOutputRecord(dump_inst.threadID())) api_dump_start_reflected_output(settings);
+
+    emitter->emitCallCounts(dump_inst.frameCount(), counts, count);
+    settings.flushCallOutput();
+}
+
+void dump_reflected_struct(ApiDumpEmitter &emitter, const ApiDumpSettings &settings, const ApiDumpStructInfo &info,
+                           const char *name, const void *object) {
+    Walker(emitter, settings).structure(info, name, info.name, object);
+}
+
+void api_dump_flags_to_string(uint64_t value, const ApiDumpBitmaskNames &bitmask_names, std::string &out) {
+    api_dump_for_each_flag_name(bitmask_names, value, [&out](const char *name) {
+        if (!out.empty()) out += " | ";
+        out += name;
+    });
+}
+
+void api_dump_start_reflected_output(const ApiDumpSettings &settings) {
+    ApiDumpEmitter *emitter = getEmitter(settings);
+    if (emitter == nullptr) return;
+
+    emitter->reset();
+    if (settings.format() == ApiDumpFormat::Binary) {
+        // Written at once, the output socket queues or drops each write as a whole
+        char header[sizeof(kApiDumpBinaryMagic) + sizeof(kApiDumpBinaryVersion)];
+        memcpy(header, kApiDumpBinaryMagic, sizeof(kApiDumpBinaryMagic));
+        memcpy(header + sizeof(kApiDumpBinaryMagic), &kApiDumpBinaryVersion, sizeof(kApiDumpBinaryVersion));
+        settings.stream().write(header, sizeof(header));
+    }
+}
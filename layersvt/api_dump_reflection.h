@@ -0,0 +1,208 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Table driven dumping of Vulkan calls.
+//
+// api_dump_reflection_tables.cpp is generated from vk.xml and describes every struct, union and function with the tables
+// below. A single walker (dump_reflected_call) reads the tables and reports each value to an ApiDumpEmitter, so the json,
+// ndjson, binary and csv formats only add an emitter each. The text and html formats keep their generated back ends.
+//
+// The tables only use constant initializers, so they are placed in read-only data and need no start-up initialization.
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class ApiDumpInstance;
+class ApiDumpSettings;
+struct ApiDumpCallCount;
+
+// Kind of value described by a reflection table entry, after removing pointers and arrays.
+enum class ApiDumpTypeTag : uint8_t {
+    Void,         // void* - only the address is dumped
+    PNext,        // pNext chain, dumped as the chained structs
+    Bool32,       // VkBool32
+    SInt,         // Signed integer of ApiDumpMemberInfo::size bytes
+    UInt,         // Unsigned integer of ApiDumpMemberInfo::size bytes
+    Float,        // float or double depending on ApiDumpMemberInfo::size
+    CString,      // const char*
+    CharArray,    // char[N], N is ApiDumpMemberInfo::fixed_length
+    Enum,         // Enumerant, named with ApiDumpMemberInfo::enum_names
+    Flags,        // Bitmask, decomposed with ApiDumpMemberInfo::bitmask_names
+    Handle,       // Dispatchable or non-dispatchable handle
+    Struct,       // Struct described by ApiDumpMemberInfo::struct_info
+    Union,        // Union described by ApiDumpMemberInfo::struct_info
+    FuncPointer,  // PFN_* function pointer, only the address is dumped
+    Opaque,       // Platform and video std types, dumped as their raw value (or address when they are too large)
+};
+
+// Name tables shared with the text and html back ends, see api_dump.h
+struct ApiDumpEnumNames;
+struct ApiDumpBitmaskNames;
+
+// The context is the struct/union that owns the member, or the `const void *const *` argument array for function parameters.
+typedef uint64_t (*ApiDumpLengthFn)(const void *context);
+typedef bool (*ApiDumpConditionFn)(const void *context);
+typedef void (*ApiDumpStoreFn)(const void *context);
+
+struct ApiDumpStructInfo;
+
+struct ApiDumpMemberInfo {
+    const char *name;
+    const char *type_name;                     // Type as written in vk.xml, ie "const VkImageCreateInfo*"
+    ApiDumpTypeTag tag;                        // Kind of the element type
+    uint16_t size;                             // Size in bytes of scalar element types, 0 when the element is never read
+    uint8_t pointer_levels;                    // Number of pointers to follow to reach the element(s)
+    bool is_shader_code;                       // VkShaderModuleCreateInfo::pCode, only dumped with the show_shader setting
+    uint32_t offset;                           // offsetof() the member, or the parameter index
+    uint32_t fixed_length;                     // Capacity of in-place arrays such as float blendConstants[4], 0 otherwise
+    ApiDumpLengthFn length;                    // Element count of arrays, nullptr if the member isn't an array
+    ApiDumpConditionFn condition;              // Returns false when the member must not be read, nullptr if always valid
+    ApiDumpStoreFn store;                      // Records state needed while dumping other members, nullptr if none
+    const ApiDumpStructInfo *struct_info;      // Struct and Union tags
+    const ApiDumpEnumNames *enum_names;        // Enum tag
+    const ApiDumpBitmaskNames *bitmask_names;  // Flags tag, nullptr if the bitmask has no named bits
+};
+
+struct ApiDumpStructInfo {
+    const char *name;
+    uint32_t size;
+    int32_t s_type;  // VkStructureType of the struct, or -1 if it doesn't have one
+    bool is_union;
+    const ApiDumpMemberInfo *members;
+    uint32_t member_count;
+};
+
+struct ApiDumpFunctionInfo {
+    const char *name;
+    const ApiDumpMemberInfo *result;  // nullptr for functions returning void
+    const ApiDumpMemberInfo *params;
+    uint32_t param_count;
+};
+
+// Generated lookups
+const ApiDumpStructInfo *api_dump_struct_info_from_stype(int32_t s_type);
+
+// Identifies the call being dumped.
+struct ApiDumpCallInfo {
+    const char *name;
+    const char *return_type;
+    uint64_t sequence;  // Global order of the call, shared by all threads
+    uint64_t thread;
+    uint64_t frame;
+    uint64_t timestamp_us;  // 0 unless the timestamp setting is enabled
+    uint64_t duration_ns;   // Time spent down the chain, only measured for the csv output
+};
+
+// Receives the values found by the walker. Names and types are nullptr for array elements.
+class ApiDumpEmitter {
+   public:
+    virtual ~ApiDumpEmitter() {}
+
+    // Called when the output restarts from the beginning, ie a new file
+    virtual void reset() {}
+
+    virtual void beginCall(const ApiDumpCallInfo &call) = 0;
+    virtual void endCall() = 0;
+    virtual void beginParams() = 0;
+    virtual void endParams() = 0;
+
+    virtual void beginStruct(const char *name, const char *type, const void *address) = 0;
+    virtual void endStruct() = 0;
+    // Unions are closed by endStruct()
+    virtual void beginUnion(const char *name, const char *type, const void *address) { beginStruct(name, type, address); }
+    virtual void beginArray(const char *name, const char *type, const void *address, uint64_t count) = 0;
+    virtual void endArray() = 0;
+
+    virtual void emitNull(const char *name, const char *type) = 0;
+    virtual void emitSigned(const char *name, const char *type, int64_t value) = 0;
+    virtual void emitUnsigned(const char *name, const char *type, uint64_t value) = 0;
+    virtual void emitFloat(const char *name, const char *type, double value) = 0;
+    virtual void emitBool(const char *name, const char *type, bool value) = 0;
+    virtual void emitString(const char *name, const char *type, const char *value, size_t length) = 0;
+    virtual void emitEnum(const char *name, const char *type, int64_t value, const char *enumerant) = 0;
+    virtual void emitFlags(const char *name, const char *type, uint64_t value, const ApiDumpBitmaskNames *bitmask_names) = 0;
+    virtual void emitHandle(const char *name, const char *type, uint64_t value) = 0;
+    virtual void emitAddress(const char *name, const char *type, const void *value) = 0;
+    virtual void emitOpaque(const char *name, const char *type, uint64_t value) { emitUnsigned(name, type, value); }
+
+    // VkShaderModuleCreateInfo::pCode without the show_shader setting
+    virtual void emitShaderCode(const char *name, const char *type, const void *code) { emitAddress(name, type, code); }
+    // Members that must not be read, see ApiDumpMemberInfo::condition
+    virtual void emitUnused(const char *name, const char *type) {}
+    // Called before a value the walker reached through a pointer, with the address it was read from
+    virtual void valueAddress(const void *address) {}
+
+    // Calls counted during a frame in statistics mode, sorted by name
+    virtual void emitCallCounts(uint64_t frame, const ApiDumpCallCount *counts, size_t count) = 0;
+};
+
+// Dumps a call through the emitter of the current output format. result is nullptr for void functions and args holds the
+// address of each parameter.
+void dump_reflected_call(ApiDumpInstance &dump_inst, const ApiDumpFunctionInfo &function, const void *result,
+                         const void *const *args);
+
+// Dumps the calls counted during the current frame in statistics mode
+void dump_reflected_call_counts(ApiDumpInstance &dump_inst, const ApiDumpCallCount *counts, size_t count);
+
+// Walks a single struct or union, used by emitters that dump values outside of a call.
+void dump_reflected_struct(ApiDumpEmitter &emitter, const ApiDumpSettings &settings, const ApiDumpStructInfo &info,
+                           const char *name, const void *object);
+
+// Appends the names of the bits set in value, separated by " | ", to out.
+void api_dump_flags_to_string(uint64_t value, const ApiDumpBitmaskNames &bitmask_names, std::string &out);
+
+//============================== Binary Format ==============================//
+//
+// The binary format is a stream of little-endian records following a file header:
+//   header: "VKAPIDMP" magic, uint32 version
+//   call:   uint8 ApiDumpBinaryTag::Call, uint64 sequence, uint64 thread, uint64 frame, uint64 timestamp_us, string name,
+//           string return type, optional value named "result", uint8 ApiDumpBinaryTag::Params, values, uint8 End
+//   value:  uint8 tag, string name, string type, payload
+//   counts: uint8 ApiDumpBinaryTag::CallCounts, uint64 frame, uint32 count, count x (string name, uint64 calls)
+//
+// Strings used for names and types are interned: a uint32 id, followed by a uint32 length and the characters when the id is
+// seen for the first time in the stream. Id 0 is a null string. Strings holding data (ApiDumpBinaryTag::String) are always
+// written in full as a uint32 length and the characters.
+
+const char kApiDumpBinaryMagic[8] = {'V', 'K', 'A', 'P', 'I', 'D', 'M', 'P'};
+const uint32_t kApiDumpBinaryVersion = 2;  // Version 1 calls have no sequence
+
+enum class ApiDumpBinaryTag : uint8_t {
+    End = 0,       // Closes a Call, Params, Struct or Array
+    Call = 1,
+    Params = 2,
+    Null = 3,      // No payload
+    Signed = 4,    // int64
+    Unsigned = 5,  // uint64
+    Float = 6,     // double
+    Bool = 7,      // uint8
+    String = 8,    // uint32 length, characters
+    Enum = 9,      // int64 value, interned enumerant name (0 if unknown)
+    Flags = 10,    // uint64 value, interned bit names separated by " | "
+    Handle = 11,   // uint64
+    Address = 12,  // uint64
+    Struct = 13,   // uint64 address, values, End
+    Array = 14,    // uint64 address, uint64 count, values, End
+    CallCounts = 15,
+};
+
+// Called when the output starts in a new file: writes the binary file header and forgets the strings interned in the previous
+// file. With file_per_thread, applies to the file of the calling thread.
+void api_dump_start_reflected_output(const ApiDumpSettings &settings);
@@ -0,0 +1,239 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "api_dump_socket.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+ApiDumpSocketBuf::ApiDumpSocketBuf(const std::string &path, size_t buffer_size, ApiDumpBackpressure backpressure,
+                                   std::chrono::milliseconds reconnect_interval)
+    : path(path), backpressure(backpressure), reconnect_interval(reconnect_interval), ring(std::max<size_t>(buffer_size, 1)) {
+    sender = std::thread(&ApiDumpSocketBuf::run, this);
+}
+
+ApiDumpSocketBuf::~ApiDumpSocketBuf() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    data_available.notify_all();
+    space_available.notify_all();
+    sender.join();
+}
+
+bool ApiDumpSocketBuf::beginRecord() {
+    if (backpressure == ApiDumpBackpressure::Block) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space_available.wait(lock, [this] { return stopping || connected; });
+    }
+    return restart.exchange(false, std::memory_order_acq_rel);
+}
+
+std::streamsize ApiDumpSocketBuf::xsputn(const char *data, std::streamsize size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const size_t record_size = static_cast<size_t>(size);
+
+    if (backpressure == ApiDumpBackpressure::Drop) {
+        if (!connected || ring.size() - used < record_size) {
+            drop();
+        } else {
+            push(data, record_size);
+        }
+        return size;
+    }
+
+    // Records larger than the buffer are queued in pieces. If the reader reconnects in the middle, the rest of the record
+    // would start the new stream, so it is dropped instead.
+    const uint64_t record_connection = connection;
+    size_t written = 0;
+    while (written < record_size) {
+        space_available.wait(lock, [this] { return stopping || (connected && used < ring.size()); });
+        if (stopping) break;
+        if (connection != record_connection && written > 0) {
+            drop();
+            break;
+        }
+        const size_t piece = std::min(record_size - written, ring.size() - used);
+        push(data + written, piece);
+        written += piece;
+    }
+    return size;
+}
+
+ApiDumpSocketBuf::int_type ApiDumpSocketBuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    const char character = traits_type::to_char_type(c);
+    xsputn(&character, 1);
+    return c;
+}
+
+// Called with the mutex locked and enough space in the ring
+void ApiDumpSocketBuf::push(const char *data, size_t size) {
+    size_t tail = (head + used) % ring.size();
+    const size_t first = std::min(size, ring.size() - tail);
+    memcpy(ring.data() + tail, data, first);
+    memcpy(ring.data(), data + first, size - first);
+    used += size;
+    data_available.notify_one();
+}
+
+// Called with the mutex locked
+void ApiDumpSocketBuf::drop() {
+    dropped_records.fetch_add(1, std::memory_order_relaxed);
+    restart.store(true, std::memory_order_release);
+}
+
+void ApiDumpSocketBuf::run() {
+#if !defined(_WIN32)
+    // A reader going away must not kill the application with SIGPIPE, writes return EPIPE instead
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping || (connected && used > 0)) {
+        if (!connected) {
+            lock.unlock();
+            const bool success = connectToReader();
+            lock.lock();
+            if (success) {
+                connected = true;
+                connection++;
+                restart.store(true, std::memory_order_release);
+                space_available.notify_all();
+            } else {
+                data_available.wait_for(lock, reconnect_interval, [this] { return stopping; });
+            }
+            continue;
+        }
+
+        data_available.wait(lock, [this] { return stopping || used > 0; });
+        if (used == 0) continue;
+
+        // The dumping threads only write to the free part of the ring, so the data can be sent without the lock
+        const size_t size = std::min(used, ring.size() - head);
+        const char *data = ring.data() + head;
+        lock.unlock();
+        const bool success = sendToReader(data, size);
+        lock.lock();
+
+        if (success) {
+            head = (head + size) % ring.size();
+            used -= size;
+        } else {
+            // What was queued for the previous reader can't be sent to the next one, it depends on the records already sent
+            disconnectFromReader();
+            connected = false;
+            head = 0;
+            used = 0;
+            drop();
+        }
+        space_available.notify_all();
+    }
+
+    if (connected) {
+        disconnectFromReader();
+        connected = false;
+    }
+}
+
+#if defined(_WIN32)
+
+bool ApiDumpSocketBuf::connectToReader() {
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    pipe = handle;
+    return true;
+}
+
+void ApiDumpSocketBuf::disconnectFromReader() {
+    CloseHandle(static_cast<HANDLE>(pipe));
+    pipe = nullptr;
+}
+
+bool ApiDumpSocketBuf::sendToReader(const char *data, size_t size) {
+    while (size > 0) {
+        DWORD written = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1 << 30));
+        if (!WriteFile(static_cast<HANDLE>(pipe), data, chunk, &written, nullptr)) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+#else
+
+bool ApiDumpSocketBuf::connectToReader() {
+    // A named pipe (FIFO) is opened for writing, anything else is expected to be a listening Unix domain socket.
+    // Opening a FIFO without blocking fails until a reader has opened it.
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISFIFO(info.st_mode)) {
+        fd = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+        if (fd < 0) return false;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        return true;
+    }
+
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void ApiDumpSocketBuf::disconnectFromReader() {
+    close(fd);
+    fd = -1;
+}
+
+bool ApiDumpSocketBuf::sendToReader(const char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Streams the ndjson and binary output to a reader on the same machine, through a Unix domain socket or a named pipe.
+//
+// The layer is the client: a background thread connects to the reader, and connects again whenever the reader goes away.
+// Records are copied to a bounded ring buffer by the dumping threads and sent by the background thread, so a slow reader
+// either blocks the application or loses records, depending on ApiDumpBackpressure.
+//
+// Each connection is a complete stream: the first record written after connecting must be preceded by the stream header,
+// which beginRecord() reports. Records are also restarted after some were dropped, because the binary format refers to the
+// strings interned by the previous records.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class ApiDumpBackpressure {
+    Block,  // Wait for the reader, the application is as slow as the reader
+    Drop,   // Drop the records that don't fit in the buffer, or that are written while no reader is connected
+};
+
+// Unbuffered stream buffer, each write to the stream is a record that is queued, or dropped, as a whole.
+class ApiDumpSocketBuf final : public std::streambuf {
+   public:
+    ApiDumpSocketBuf(const std::string &path, size_t buffer_size, ApiDumpBackpressure backpressure,
+                     std::chrono::milliseconds reconnect_interval);
+    ~ApiDumpSocketBuf() override;
+
+    ApiDumpSocketBuf(const ApiDumpSocketBuf &) = delete;
+    ApiDumpSocketBuf &operator=(const ApiDumpSocketBuf &) = delete;
+
+    // Called before writing each record. Blocks until a reader is connected with the Block policy. Returns true when the
+    // stream must be restarted with a header before the record.
+    bool beginRecord();
+
+    uint64_t droppedRecords() const { return dropped_records.load(std::memory_order_relaxed); }
+
+   protected:
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+    int_type overflow(int_type c) override;
+
+   private:
+    void run();
+    bool connectToReader();
+    void disconnectFromReader();
+    bool sendToReader(const char *data, size_t size);
+    void push(const char *data, size_t size);
+    void drop();
+
+    const std::string path;
+    const ApiDumpBackpressure backpressure;
+    const std::chrono::milliseconds reconnect_interval;
+
+    std::mutex mutex;
+    std::condition_variable data_available;
+    std::condition_variable space_available;
+    std::vector<char> ring;
+    size_t head = 0;  // Next byte to send
+    size_t used = 0;
+    bool connected = false;
+    uint64_t connection = 0;  // Incremented by each connection, so a record split by a reconnection can be detected
+    bool stopping = false;
+
+    std::atomic<bool> restart{false};
+    std::atomic<uint64_t> dropped_records{0};
+
+#if defined(_WIN32)
+    void *pipe = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    std::thread sender;
+};
@@ -0,0 +1,343 @@
+/* Copyright (c) 2024 Valve Corporation
+ * Copyright (c) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time api_dump adds to each call. The layer library is loaded directly and placed over the stub driver, so
+// no loader, ICD or GPU is needed. Each command is measured through the layer, and directly on the stub as the baseline,
+// on 1 to 16 threads.
+//
+// The layer settings are read once per process, so a run measures a single output format:
+//
+//     benchmark_api_dump --format=ndjson --benchmark_out=ndjson.json --benchmark_out_format=json
+//
+// The other arguments are passed to Google Benchmark.
+
+#include "stub_driver.h"
+
+#include <vulkan/vk_layer.h>
+#include <vulkan/vulkan.h>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace {
+
+const int kMaxThreads = 16;
+
+struct Options {
+    std::string format = "text";
+    std::string output = "api_dump_benchmark";
+    std::string flush_policy = "on_size";
+};
+
+// Loads the layer library and finds its vkGetInstanceProcAddr and vkGetDeviceProcAddr
+bool LoadLayer(const char *path, PFN_vkGetInstanceProcAddr &gipa, PFN_vkGetDeviceProcAddr &gdpa) {
+#if defined(_WIN32)
+    HMODULE library = LoadLibraryA(path);
+    if (library == nullptr) return false;
+    gipa = reinterpret_cast<PFN_vkGetInstanceProcAddr>(GetProcAddress(library, "vkGetInstanceProcAddr"));
+    gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(GetProcAddress(library, "vkGetDeviceProcAddr"));
+#else
+    void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) return false;
+    gipa = reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(library, "vkGetInstanceProcAddr"));
+    gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(dlsym(library, "vkGetDeviceProcAddr"));
+#endif
+    return gipa != nullptr && gdpa != nullptr;
+}
+
+// An instance and a device created through the top of a chain, either the layer over the stub driver or the stub alone
+class Chain {
+   public:
+    bool init(PFN_vkGetInstanceProcAddr gipa, PFN_vkGetDeviceProcAddr gdpa, const Options *options) {
+        VkApplicationInfo app_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+        app_info.pApplicationName = "benchmark_api_dump";
+        app_info.apiVersion = VK_API_VERSION_1_3;
+
+        const VkBool32 use_file = VK_TRUE;
+        const char *format = options ? options->format.c_str() : nullptr;
+        const char *output = options ? options->output.c_str() : nullptr;
+        const char *flush_policy = options ? options->flush_policy.c_str() : nullptr;
+        const VkLayerSettingEXT settings[] = {
+            {"VK_LAYER_LUNARG_api_dump", "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &format},
+            {"VK_LAYER_LUNARG_api_dump", "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+            {"VK_LAYER_LUNARG_api_dump", "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output},
+            {"VK_LAYER_LUNARG_api_dump", "flush_policy", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &flush_policy}};
+        VkLayerSettingsCreateInfoEXT settings_info = {VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT};
+        settings_info.settingCount = static_cast<uint32_t>(std::size(settings));
+        settings_info.pSettings = settings;
+
+        // What the loader passes to the first layer, pointing it to the next element of the chain
+        VkLayerInstanceLink instance_link = {};
+        instance_link.pfnNextGetInstanceProcAddr = stub_driver::GetInstanceProcAddr;
+        VkLayerInstanceCreateInfo instance_chain = {VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO};
+        instance_chain.pNext = options ? &settings_info : nullptr;
+        instance_chain.function = VK_LAYER_LINK_INFO;
+        instance_chain.u.pLayerInfo = &instance_link;
+
+        VkInstanceCreateInfo instance_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+        instance_info.pNext = &instance_chain;
+        instance_info.pApplicationInfo = &app_info;
+
+        auto create_instance = reinterpret_cast<PFN_vkCreateInstance>(gipa(VK_NULL_HANDLE, "vkCreateInstance"));
+        if (create_instance == nullptr || create_instance(&instance_info, nullptr, &instance) != VK_SUCCESS) return false;
+
+        auto enumerate_physical_devices =
+            reinterpret_cast<PFN_vkEnumeratePhysicalDevices>(gipa(instance, "vkEnumeratePhysicalDevices"));
+        uint32_t physical_device_count = 1;
+        if (enumerate_physical_devices(instance, &physical_device_count, &physical_device) != VK_SUCCESS) return false;
+
+        VkLayerDeviceLink device_link = {};
+        device_link.pfnNextGetInstanceProcAddr = stub_driver::GetInstanceProcAddr;
+        device_link.pfnNextGetDeviceProcAddr = stub_driver::GetDeviceProcAddr;
+        VkLayerDeviceCreateInfo device_chain = {VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO};
+        device_chain.function = VK_LAYER_LINK_INFO;
+        device_chain.u.pLayerInfo = &device_link;
+
+        const float priority = 1.0f;
+        VkDeviceQueueCreateInfo queue_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+        queue_info.queueCount = 1;
+        queue_info.pQueuePriorities = &priority;
+        VkDeviceCreateInfo device_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+        device_info.pNext = &device_chain;
+        device_info.queueCreateInfoCount = 1;
+        device_info.pQueueCreateInfos = &queue_info;
+
+        auto create_device = reinterpret_cast<PFN_vkCreateDevice>(gipa(instance, "vkCreateDevice"));
+        if (create_device(physical_device, &device_info, nullptr, &device) != VK_SUCCESS) return false;
+
+        CmdDraw = reinterpret_cast<PFN_vkCmdDraw>(gdpa(device, "vkCmdDraw"));
+        UpdateDescriptorSets = reinterpret_cast<PFN_vkUpdateDescriptorSets>(gdpa(device, "vkUpdateDescriptorSets"));
+        CreateGraphicsPipelines = reinterpret_cast<PFN_vkCreateGraphicsPipelines>(gdpa(device, "vkCreateGraphicsPipelines"));
+        if (CmdDraw == nullptr || UpdateDescriptorSets == nullptr || CreateGraphicsPipelines == nullptr) return false;
+
+        // A command buffer per thread, so the threads record concurrently as they would in an application
+        VkCommandPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        auto create_command_pool = reinterpret_cast<PFN_vkCreateCommandPool>(gdpa(device, "vkCreateCommandPool"));
+        if (create_command_pool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS) return false;
+
+        VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocate_info.commandPool = command_pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = kMaxThreads;
+        auto allocate_command_buffers =
+            reinterpret_cast<PFN_vkAllocateCommandBuffers>(gdpa(device, "vkAllocateCommandBuffers"));
+        return allocate_command_buffers(device, &allocate_info, command_buffers.data()) == VK_SUCCESS;
+    }
+
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    std::array<VkCommandBuffer, kMaxThreads> command_buffers = {};
+
+    PFN_vkCmdDraw CmdDraw = nullptr;
+    PFN_vkUpdateDescriptorSets UpdateDescriptorSets = nullptr;
+    PFN_vkCreateGraphicsPipelines CreateGraphicsPipelines = nullptr;
+};
+
+template <typename T>
+T FakeHandle(uint64_t value) {
+    return (T)(value * 16);
+}
+
+void BM_CmdDraw(benchmark::State &state, Chain *chain) {
+    VkCommandBuffer command_buffer = chain->command_buffers[state.thread_index()];
+    for (auto _ : state) {
+        chain->CmdDraw(command_buffer, 3, 1, 0, 0);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A uniform buffer and a combined image sampler, the two most common descriptors
+void BM_UpdateDescriptorSets(benchmark::State &state, Chain *chain) {
+    const VkDescriptorBufferInfo buffer_info = {FakeHandle<VkBuffer>(1), 0, 256};
+    const VkDescriptorImageInfo image_info = {FakeHandle<VkSampler>(2), FakeHandle<VkImageView>(3),
+                                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet writes[2] = {{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET}, {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET}};
+    writes[0].dstSet = FakeHandle<VkDescriptorSet>(4);
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[0].pBufferInfo = &buffer_info;
+    writes[1].dstSet = FakeHandle<VkDescriptorSet>(4);
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].pImageInfo = &image_info;
+
+    for (auto _ : state) {
+        chain->UpdateDescriptorSets(chain->device, 2, writes, 0, nullptr);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A vertex and fragment shader pipeline with the usual fixed function state, rendering to one color attachment
+void BM_CreateGraphicsPipelines(benchmark::State &state, Chain *chain) {
+    VkPipelineShaderStageCreateInfo stages[2] = {{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
+                                                 {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}};
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = FakeHandle<VkShaderModule>(1);
+    stages[0].pName = "main";
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = FakeHandle<VkShaderModule>(2);
+    stages[1].pName = "main";
+
+    const VkVertexInputBindingDescription binding = {0, 32, VK_VERTEX_INPUT_RATE_VERTEX};
+    const VkVertexInputAttributeDescription attributes[3] = {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+                                                             {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 12},
+                                                             {2, 0, VK_FORMAT_R32G32_SFLOAT, 24}};
+    VkPipelineVertexInputStateCreateInfo vertex_input = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertex_input.vertexBindingDescriptionCount = 1;
+    vertex_input.pVertexBindingDescriptions = &binding;
+    vertex_input.vertexAttributeDescriptionCount = 3;
+    vertex_input.pVertexAttributeDescriptions = attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewport = {VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample = {VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil = {VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depth_stencil.depthTestEnable = VK_TRUE;
+    depth_stencil.depthWriteEnable = VK_TRUE;
+    depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState blend_attachment = {};
+    blend_attachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo color_blend = {VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    color_blend.attachmentCount = 1;
+    color_blend.pAttachments = &blend_attachment;
+
+    const VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamic_states;
+
+    VkGraphicsPipelineCreateInfo create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    create_info.stageCount = 2;
+    create_info.pStages = stages;
+    create_info.pVertexInputState = &vertex_input;
+    create_info.pInputAssemblyState = &input_assembly;
+    create_info.pViewportState = &viewport;
+    create_info.pRasterizationState = &rasterization;
+    create_info.pMultisampleState = &multisample;
+    create_info.pDepthStencilState = &depth_stencil;
+    create_info.pColorBlendState = &color_blend;
+    create_info.pDynamicState = &dynamic;
+    create_info.layout = FakeHandle<VkPipelineLayout>(3);
+    create_info.renderPass = FakeHandle<VkRenderPass>(4);
+
+    // The stub pipelines hold nothing, so they aren't destroyed
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    for (auto _ : state) {
+        chain->CreateGraphicsPipelines(chain->device, VK_NULL_HANDLE, 1, &create_info, nullptr, &pipeline);
+        benchmark::DoNotOptimize(pipeline);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void RegisterBenchmarks(const std::string &target, Chain *chain) {
+    for (auto *registered : {benchmark::RegisterBenchmark((target + "/vkCmdDraw").c_str(), BM_CmdDraw, chain),
+                             benchmark::RegisterBenchmark((target + "/vkUpdateDescriptorSets").c_str(),
+                                                          BM_UpdateDescriptorSets, chain),
+                             benchmark::RegisterBenchmark((target + "/vkCreateGraphicsPipelines").c_str(),
+                                                          BM_CreateGraphicsPipelines, chain)}) {
+        registered->ThreadRange(1, kMaxThreads)->UseRealTime();
+    }
+}
+
+// Takes the arguments of the benchmark out of argv, leaving those of Google Benchmark
+bool ParseOptions(int *argc, char **argv, Options &options) {
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--format=", 0) == 0) {
+            options.format = arg.substr(std::strlen("--format="));
+        } else if (arg.rfind("--output=", 0) == 0) {
+            options.output = arg.substr(std::strlen("--output="));
+        } else if (arg.rfind("--flush_policy=", 0) == 0) {
+            options.flush_policy = arg.substr(std::strlen("--flush_policy="));
+        } else if (arg == "--help") {
+            fprintf(stderr,
+                    "Usage: benchmark_api_dump [--format=text|html|json|ndjson|binary|csv] [--output=<file>]\n"
+                    "                          [--flush_policy=<policy>] [Google Benchmark options]\n"
+                    "Measures the time api_dump adds to each call, over a stub driver.\n"
+                    "  --format        Output format of the layer, text by default\n"
+                    "  --output        Output file of the layer, the extension of the format is appended\n"
+                    "  --flush_policy  flush_policy setting of the layer, on_size by default\n");
+            return false;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(&argc, argv, options)) return 1;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    PFN_vkGetInstanceProcAddr layer_gipa = nullptr;
+    PFN_vkGetDeviceProcAddr layer_gdpa = nullptr;
+    if (!LoadLayer(API_DUMP_LAYER_PATH, layer_gipa, layer_gdpa)) {
+        fprintf(stderr, "Could not load %s\n", API_DUMP_LAYER_PATH);
+        return 1;
+    }
+
+    static Chain stub;
+    static Chain api_dump;
+    if (!stub.init(stub_driver::GetInstanceProcAddr, stub_driver::GetDeviceProcAddr, nullptr) ||
+        !api_dump.init(layer_gipa, layer_gdpa, &options)) {
+        fprintf(stderr, "Could not create the instance and device of the benchmark\n");
+        return 1;
+    }
+    benchmark::AddCustomContext("api_dump_format", options.format);
+    benchmark::AddCustomContext("api_dump_flush_policy", options.flush_policy);
+
+    RegisterBenchmarks("stub", &stub);
+    RegisterBenchmarks("api_dump", &api_dump);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2024 Valve Corporation
+ * Copyright (c) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stub_driver.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace stub_driver {
+
+namespace {
+
+struct Instance : DispatchableObject {
+    DispatchableObject physical_device;
+};
+
+template <typename T>
+T ToHandle(DispatchableObject *object) {
+    return reinterpret_cast<T>(object);
+}
+
+template <typename T>
+DispatchableObject *FromHandle(T handle) {
+    return reinterpret_cast<DispatchableObject *>(handle);
+}
+
+// Non-dispatchable handles are never dereferenced, they only have to be unique
+template <typename T>
+T NewHandle() {
+    static std::atomic<uint64_t> next_handle{1};
+    return (T)(next_handle.fetch_add(1, std::memory_order_relaxed) * 16);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *, const VkAllocationCallbacks *, VkInstance *pInstance) {
+    Instance *instance = new Instance;
+    instance->loader_data = instance;
+    instance->physical_device.loader_data = instance;
+    *pInstance = ToHandle<VkInstance>(instance);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocationCallbacks *) {
+    delete static_cast<Instance *>(FromHandle(instance));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uint32_t *pPhysicalDeviceCount,
+                                                        VkPhysicalDevice *pPhysicalDevices) {
+    if (pPhysicalDevices == nullptr) {
+        *pPhysicalDeviceCount = 1;
+        return VK_SUCCESS;
+    }
+    if (*pPhysicalDeviceCount == 0) return VK_INCOMPLETE;
+    *pPhysicalDeviceCount = 1;
+    pPhysicalDevices[0] = ToHandle<VkPhysicalDevice>(&static_cast<Instance *>(FromHandle(instance))->physical_device);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice, const VkDeviceCreateInfo *, const VkAllocationCallbacks *,
+                                            VkDevice *pDevice) {
+    DispatchableObject *device = new DispatchableObject;
+    device->loader_data = device;
+    *pDevice = ToHandle<VkDevice>(device);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCallbacks *) { delete FromHandle(device); }
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateCommandPool(VkDevice, const VkCommandPoolCreateInfo *, const VkAllocationCallbacks *,
+                                                 VkCommandPool *pCommandPool) {
+    *pCommandPool = NewHandle<VkCommandPool>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyCommandPool(VkDevice, VkCommandPool, const VkAllocationCallbacks *) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL AllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo *pAllocateInfo,
+                                                      VkCommandBuffer *pCommandBuffers) {
+    for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++) {
+        pCommandBuffers[i] = ToHandle<VkCommandBuffer>(new DispatchableObject{FromHandle(device)->loader_data});
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL FreeCommandBuffers(VkDevice, VkCommandPool, uint32_t commandBufferCount,
+                                              const VkCommandBuffer *pCommandBuffers) {
+    for (uint32_t i = 0; i < commandBufferCount; i++) {
+        delete FromHandle(pCommandBuffers[i]);
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdDraw(VkCommandBuffer, uint32_t, uint32_t, uint32_t, uint32_t) {}
+
+VKAPI_ATTR void VKAPI_CALL UpdateDescriptorSets(VkDevice, uint32_t, const VkWriteDescriptorSet *, uint32_t,
+                                                const VkCopyDescriptorSet *) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateGraphicsPipelines(VkDevice, VkPipelineCache, uint32_t createInfoCount,
+                                                       const VkGraphicsPipelineCreateInfo *, const VkAllocationCallbacks *,
+                                                       VkPipeline *pPipelines) {
+    for (uint32_t i = 0; i < createInfoCount; i++) {
+        pPipelines[i] = NewHandle<VkPipeline>();
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyPipeline(VkDevice, VkPipeline, const VkAllocationCallbacks *) {}
+
+#define STUB_COMMAND(name) {"vk" #name, reinterpret_cast<PFN_vkVoidFunction>(name)}
+
+const std::unordered_map<std::string_view, PFN_vkVoidFunction> &Commands() {
+    static const std::unordered_map<std::string_view, PFN_vkVoidFunction> commands = {
+        STUB_COMMAND(GetInstanceProcAddr),
+        STUB_COMMAND(GetDeviceProcAddr),
+        STUB_COMMAND(CreateInstance),
+        STUB_COMMAND(DestroyInstance),
+        STUB_COMMAND(EnumeratePhysicalDevices),
+        STUB_COMMAND(CreateDevice),
+        STUB_COMMAND(DestroyDevice),
+        STUB_COMMAND(CreateCommandPool),
+        STUB_COMMAND(DestroyCommandPool),
+        STUB_COMMAND(AllocateCommandBuffers),
+        STUB_COMMAND(FreeCommandBuffers),
+        STUB_COMMAND(CmdDraw),
+        STUB_COMMAND(UpdateDescriptorSets),
+        STUB_COMMAND(CreateGraphicsPipelines),
+        STUB_COMMAND(DestroyPipeline),
+    };
+    return commands;
+}
+
+PFN_vkVoidFunction FindCommand(const char *pName) {
+    auto found = Commands().find(pName);
+    return found != Commands().end() ? found->second : nullptr;
+}
+
+}  // namespace
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance, const char *pName) { return FindCommand(pName); }
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice, const char *pName) { return FindCommand(pName); }
+
+}  // namespace stub_driver
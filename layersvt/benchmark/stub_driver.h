@@ -0,0 +1,36 @@
+/* Copyright (c) 2024 Valve Corporation
+ * Copyright (c) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A driver which returns canned results without doing any work. It is placed below a layer as the next element of its
+// chain, so the layer can be measured in process, without a loader, an ICD or a GPU.
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace stub_driver {
+
+// Dispatchable handles start with the dispatch key the loader would store there, which the layers use to find their
+// dispatch tables. Physical devices share the key of their instance, queues and command buffers the key of their device.
+struct DispatchableObject {
+    void *loader_data;
+};
+
+// Returns the stub commands, for any instance or device. Commands the stub doesn't implement return nullptr.
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance instance, const char *pName);
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice device, const char *pName);
+
+}  // namespace stub_driver
@@ -21,12 +21,22 @@
  * Author: Tony Barbour <tony@lunarg.com>
  */
 #include "vk_layer_table.h"
+#include "monitor_frame_stats.h"
+#include "monitor_frame_log.h"
+#include "monitor_memory.h"
+#include "monitor_telemetry.h"
+#include "monitor_workload.h"
 #include <vulkan/layer/vk_layer_settings.hpp>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -39,12 +49,69 @@
 #endif
 
 #define TITLE_LENGTH 1000
-#define FPS_LENGTH 24
+
+const char *kSettingsKeyReport = "report";
+const char *kSettingsKeyLogFile = "log_file";
+const char *kSettingsKeyLogFormat = "log_format";
+const char *kSettingsKeyTelemetry = "telemetry";
+const char *kSettingsKeyMemoryBudgetInterval = "memory_budget_interval";
+
+// How often the title bar is updated, and the window of the FPS it shows
+static const std::chrono::milliseconds kTitleUpdatePeriod(500);
+
+struct monitor_layer_settings {
+    bool report = false;   // Print the report of each swapchain and device when it is destroyed
+    std::string log_file;  // Write a record of each presented frame to this file, if not empty
+    monitor::frame_log_format log_format = monitor::frame_log_format::csv;
+    bool telemetry = false;  // Publish the frame statistics of each swapchain in shared memory
+    uint32_t memory_budget_interval = 0;  // Sample the memory budget of each device every this many presents, if not 0
+};
+
+// The settings are read by the first instance and apply until the last one is destroyed, so they are only written while no
+// other thread reads them
+static monitor_layer_settings monitor_settings;
+
+// The frame log and the telemetry segment are opened with the first instance and closed with the last one
+static std::mutex instance_lock;
+static uint32_t instance_count = 0;
+static monitor::frame_log frame_log;
+static monitor::frame_clock::time_point frame_log_epoch;
+static monitor::telemetry_segment telemetry;
+
 struct monitor_layer_data {
     VkuDeviceDispatchTable *device_dispatch_table{};
     VkuInstanceDispatchTable *instance_dispatch_table{};
 
     PFN_vkQueuePresentKHR pfnQueuePresentKHR{};
+    VkPhysicalDevice gpu{};
+    VkDevice device{};
+
+    PFN_vkSetDeviceLoaderData pfn_dev_init{};
+
+    // Only set for instances, the core vkGetPhysicalDeviceMemoryProperties2 needs both the instance and the device at 1.1
+    uint32_t api_version = VK_API_VERSION_1_0;
+    bool properties2_enabled = false;  // VK_KHR_get_physical_device_properties2 is enabled
+    std::unique_ptr<monitor::workload_counters> workload;  // Only allocated for devices
+
+    // Set when the memory budget of the device is sampled
+    PFN_vkGetPhysicalDeviceMemoryProperties2 pfn_get_memory_properties2{};
+    std::atomic<uint64_t> memory_presents{0};
+
+    // The workload of the device, for the presents of all its queues and threads
+    std::mutex present_lock;  // Guards the members below
+    monitor::frame_clock::time_point created{};
+    monitor::frame_clock::time_point period_start{};  // Start of the current title update period
+    monitor::workload_counts period_workload{};
+    uint64_t period_presents = 0;
+    monitor::blocked_times period_blocked_ns{};
+    std::string title_workload;                 // Workload and blocked time of the last complete period
+    monitor::blocked_times total_blocked_ns{};  // For the report
+    std::unique_ptr<monitor::memory_trend> memory_trend;  // Only allocated when the memory budget is sampled
+    std::string title_memory;                             // Memory usage of the last sample
+};
+
+// The window of a surface, whose title shows the statistics of the swapchain presenting to it
+struct monitor_window {
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
     HWND hwnd{};
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
@@ -54,14 +121,20 @@ struct monitor_layer_data {
 #endif
     char base_title[TITLE_LENGTH]{};
     bool got_title = false;
-    VkPhysicalDevice gpu{};
-    VkDevice device{};
+};
 
-    PFN_vkSetDeviceLoaderData pfn_dev_init{};
-    int lastFrame{};
-    time_t lastTime{};
-    float fps{};
-    int frame{};
+// Each swapchain is timed on its own, so an application with several windows, or presenting several swapchains at once,
+// gets the frame times of each one
+struct monitor_swapchain_data {
+    monitor_layer_data *device_data{};
+    monitor_window *window{};  // nullptr if the surface was not created through the layer
+    std::atomic<uint64_t> presents{0};
+
+    // The application already synchronizes the presents of a swapchain, so the lock is not contended
+    std::mutex lock;  // Guards the members below
+    std::unique_ptr<monitor::frame_times> frame_times;
+    monitor::frame_clock::time_point last_title_update{};
+    int telemetry_slot = -1;  // Slot of the swapchain in the telemetry segment, -1 if it has none
 };
 
 #if defined(VK_USE_PLATFORM_XCB_KHR)
@@ -76,11 +149,86 @@ static struct {
 } xcb = {NULL};
 #endif
 
-static std::unordered_map<VkPhysicalDevice, VkInstance> layer_instances;
-static std::unordered_map<void *, monitor_layer_data *> layer_data_map;
+static layer_data_store<VkPhysicalDevice, VkInstance> layer_instances;
+static layer_data_store<dispatch_key, monitor_layer_data> layer_data_map;
+static layer_data_store<VkSurfaceKHR, monitor_window> window_map;
+static layer_data_store<VkSwapchainKHR, monitor_swapchain_data> swapchain_map;
+
+// Devices destroyed so far, a change invalidates the workload cache of every thread
+static std::atomic<uint64_t> destroyed_devices{0};
 
-template monitor_layer_data *GetLayerDataPtr<monitor_layer_data>(void *data_key,
-                                                                 std::unordered_map<void *, monitor_layer_data *> &data_map);
+// The device each thread last counted work for, so that counting a draw does not lock layer_data_map
+static thread_local struct {
+    dispatch_key key = nullptr;
+    uint64_t destroyed_devices = 0;
+    monitor_layer_data *data = nullptr;
+    monitor::workload_counters::thread_block *block = nullptr;
+} workload_cache;
+
+// Returns the layer data of the device of a device, queue or command buffer, with workload_cache set to it
+static monitor_layer_data *cached_device_data(void *object) {
+    const dispatch_key key = get_dispatch_key(object);
+    const uint64_t destroyed = destroyed_devices.load(std::memory_order_acquire);
+    if (workload_cache.key != key || workload_cache.destroyed_devices != destroyed) {
+        workload_cache.key = key;
+        workload_cache.destroyed_devices = destroyed;
+        workload_cache.data = layer_data_map.find(key);
+        workload_cache.block = workload_cache.data->workload->block_of_this_thread();
+    }
+    return workload_cache.data;
+}
+
+// Counts work for the device of a device, queue or command buffer and returns the layer data of the device
+static monitor_layer_data *count_workload(void *object, monitor::workload_counter counter, uint64_t count) {
+    monitor_layer_data *data = cached_device_data(object);
+    monitor::workload_counters::add(*workload_cache.block, counter, count);
+    return data;
+}
+
+// Adds the time since start to the time the calling thread was blocked in call
+static void add_blocked(monitor::workload_counters::thread_block *block, monitor::blocking_call call,
+                        monitor::frame_clock::time_point start) {
+    const auto blocked = std::chrono::duration_cast<std::chrono::nanoseconds>(monitor::frame_clock::now() - start);
+    monitor::workload_counters::add_blocked(*block, call, blocked.count());
+}
+
+// Enables the memory budget sampling of a device if its physical device supports VK_EXT_memory_budget
+static void init_memory_sampling(monitor_layer_data *my_device_data, VkPhysicalDevice gpu) {
+    const monitor_layer_data *my_instance_data = layer_data_map.find(get_dispatch_key(gpu));
+    VkuInstanceDispatchTable *pTable = my_instance_data->instance_dispatch_table;
+
+    uint32_t count = 0;
+    pTable->EnumerateDeviceExtensionProperties(gpu, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    pTable->EnumerateDeviceExtensionProperties(gpu, nullptr, &count, extensions.data());
+    const bool supported = std::any_of(extensions.begin(), extensions.begin() + count, [](const VkExtensionProperties &extension) {
+        return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+    });
+
+    VkPhysicalDeviceProperties properties;
+    pTable->GetPhysicalDeviceProperties(gpu, &properties);
+    PFN_vkGetPhysicalDeviceMemoryProperties2 get_memory_properties2 = nullptr;
+    if (my_instance_data->api_version >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1) {
+        get_memory_properties2 = pTable->GetPhysicalDeviceMemoryProperties2;
+    } else if (my_instance_data->properties2_enabled) {
+        get_memory_properties2 = pTable->GetPhysicalDeviceMemoryProperties2KHR;
+    }
+
+    if (!supported) {
+        fprintf(stderr, "Monitor layer: %s does not support VK_EXT_memory_budget, its memory budget is not sampled\n",
+                properties.deviceName);
+        return;
+    }
+    if (get_memory_properties2 == nullptr) {
+        fprintf(stderr,
+                "Monitor layer: the memory budget of %s is not sampled, it needs Vulkan 1.1 or "
+                "VK_KHR_get_physical_device_properties2\n",
+                properties.deviceName);
+        return;
+    }
+    my_device_data->pfn_get_memory_properties2 = get_memory_properties2;
+    my_device_data->memory_trend.reset(new monitor::memory_trend);
+}
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDeviceCreateInfo *pCreateInfo,
                                               const VkAllocationCallbacks *pAllocator, VkDevice *pDevice) {
@@ -89,7 +237,12 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
     assert(chain_info->u.pLayerInfo);
     PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
     PFN_vkGetDeviceProcAddr fpGetDeviceProcAddr = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
-    PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(layer_instances.at(gpu), "vkCreateDevice");
+    // The physical device is unknown if the application didn't get it from vkEnumeratePhysicalDevices*
+    VkInstance *instance = layer_instances.find(gpu);
+    if (instance == nullptr) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(*instance, "vkCreateDevice");
     if (fpCreateDevice == NULL) {
         return VK_ERROR_INITIALIZATION_FAILED;
     }
@@ -102,7 +255,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
         return result;
     }
 
-    monitor_layer_data *my_device_data = GetLayerDataPtr(get_dispatch_key(*pDevice), layer_data_map);
+    monitor_layer_data *my_device_data = layer_data_map.emplace(get_dispatch_key(*pDevice));
 
     // Setup device dispatch table
     my_device_data->device_dispatch_table = new VkuDeviceDispatchTable;
@@ -118,10 +271,10 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
 
     my_device_data->gpu = gpu;
     my_device_data->device = *pDevice;
-    my_device_data->frame = 0;
-    my_device_data->lastFrame = 0;
-    my_device_data->fps = 0.0;
-    time(&my_device_data->lastTime);
+    my_device_data->workload.reset(new monitor::workload_counters);
+    my_device_data->created = monitor::frame_clock::now();
+    my_device_data->period_start = my_device_data->created;
+    if (monitor_settings.memory_budget_interval > 0) init_memory_sampling(my_device_data, gpu);
 
     // Get our WSI hooks in
     VkuDeviceDispatchTable *pTable = my_device_data->device_dispatch_table;
@@ -133,16 +286,14 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, uint32_t *pPhysicalDeviceCount,
                                                           VkPhysicalDevice *pPhysicalDevices) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(key);
     VkuInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
 
     VkResult result = pTable->EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
 
     if (pPhysicalDevices != nullptr) {
         for (int i = 0; i < *pPhysicalDeviceCount; ++i) {
-            if (layer_instances.count(pPhysicalDevices[i]) == 0) {
-                layer_instances.insert({pPhysicalDevices[i], instance});
-            }
+            layer_instances.emplace(pPhysicalDevices[i], instance);
         }
     }
 
@@ -152,7 +303,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, u
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instance, uint32_t *pPhysicalDeviceGroupCount,
                                                                VkPhysicalDeviceGroupProperties *pPhysicalDeviceGroupProperties) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(key);
     VkuInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
 
     VkResult result = pTable->EnumeratePhysicalDeviceGroups(instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
@@ -160,9 +311,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instan
     if (pPhysicalDeviceGroupProperties != nullptr) {
         for (int i = 0; i < *pPhysicalDeviceGroupCount; ++i) {
             for (int j = 0; j < pPhysicalDeviceGroupProperties[i].physicalDeviceCount; ++j) {
-                if (layer_instances.count(pPhysicalDeviceGroupProperties[i].physicalDevices[j]) == 0) {
-                    layer_instances.insert({pPhysicalDeviceGroupProperties[i].physicalDevices[j], instance});
-                }
+                layer_instances.emplace(pPhysicalDeviceGroupProperties[i].physicalDevices[j], instance);
             }
         }
     }
@@ -172,12 +321,56 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instan
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device, const VkAllocationCallbacks *pAllocator) {
     dispatch_key key = get_dispatch_key(device);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(key);
     VkuDeviceDispatchTable *pTable = my_data->device_dispatch_table;
     pTable->DeviceWaitIdle(device);
     pTable->DestroyDevice(device, pAllocator);
     delete pTable;
+
+    if (monitor_settings.report) {
+        const auto lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(monitor::frame_clock::now() - my_data->created);
+        const std::string report = monitor::format_blocked_report(my_data->total_blocked_ns, lifetime.count());
+        fprintf(stdout, "Monitor layer report for device %p:\n%s", static_cast<void *>(device), report.c_str());
+        if (my_data->memory_trend) fputs(monitor::format_memory_report(*my_data->memory_trend).c_str(), stdout);
+        fflush(stdout);
+    }
+    // Counted once the data is gone, so a thread that sees the new count can't cache the data of the destroyed device
     layer_data_map.erase(key);
+    destroyed_devices.fetch_add(1, std::memory_order_release);
+}
+
+// Reads the settings of the layer from the create info of an instance
+static monitor_layer_settings read_settings(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator) {
+    monitor_layer_settings settings;
+    VkuLayerSettingSet layerSettingSet = VK_NULL_HANDLE;
+    vkuCreateLayerSettingSet("VK_LAYER_LUNARG_monitor", vkuFindLayerSettingsCreateInfo(pCreateInfo), pAllocator, nullptr,
+                             &layerSettingSet);
+    if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyReport)) {
+        vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyReport, settings.report);
+    }
+    if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyLogFile)) {
+        vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyLogFile, settings.log_file);
+    }
+    if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyLogFormat)) {
+        std::string log_format;
+        vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyLogFormat, log_format);
+        if (log_format == "binary") {
+            settings.log_format = monitor::frame_log_format::binary;
+        } else if (log_format == "csv") {
+            settings.log_format = monitor::frame_log_format::csv;
+        } else {
+            fprintf(stderr, "Monitor layer: unknown log_format \"%s\", writing csv\n", log_format.c_str());
+            settings.log_format = monitor::frame_log_format::csv;
+        }
+    }
+    if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyTelemetry)) {
+        vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyTelemetry, settings.telemetry);
+    }
+    if (vkuHasLayerSetting(layerSettingSet, kSettingsKeyMemoryBudgetInterval)) {
+        vkuGetLayerSettingValue(layerSettingSet, kSettingsKeyMemoryBudgetInterval, settings.memory_budget_interval);
+    }
+    vkuDestroyLayerSettingSet(layerSettingSet, pAllocator);
+    return settings;
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
@@ -197,13 +390,36 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCre
     VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
     if (result != VK_SUCCESS) return result;
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(*pInstance), layer_data_map);
+    {
+        std::lock_guard<std::mutex> lock(instance_lock);
+        if (instance_count++ == 0) {
+            monitor_settings = read_settings(pCreateInfo, pAllocator);
+            if (!monitor_settings.log_file.empty()) {
+                frame_log_epoch = monitor::frame_clock::now();
+                const bool with_memory_log = monitor_settings.memory_budget_interval > 0;
+                if (!frame_log.open(monitor_settings.log_file, monitor_settings.log_format, with_memory_log)) {
+                    fprintf(stderr, "Monitor layer: could not open the frame log %s\n", monitor_settings.log_file.c_str());
+                }
+            }
+            if (monitor_settings.telemetry && !telemetry.open()) {
+                fprintf(stderr, "Monitor layer: could not create the telemetry shared memory segment\n");
+            }
+        }
+    }
+
+    monitor_layer_data *my_data = layer_data_map.emplace(get_dispatch_key(*pInstance));
     my_data->instance_dispatch_table = new VkuInstanceDispatchTable;
     vkuInitInstanceDispatchTable(*pInstance, my_data->instance_dispatch_table, fpGetInstanceProcAddr);
+    if (pCreateInfo->pApplicationInfo != nullptr && pCreateInfo->pApplicationInfo->apiVersion != 0) {
+        my_data->api_version = pCreateInfo->pApplicationInfo->apiVersion;
+    }
+    for (uint32_t i = 0; i < pCreateInfo->enabledExtensionCount; i++) {
+        if (strcmp(pCreateInfo->ppEnabledExtensionNames[i], VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            my_data->properties2_enabled = true;
+        }
+    }
 
 #if defined(VK_USE_PLATFORM_XCB_KHR)
-    // Initialize connection to null in case vkCreateXcbSurfaceKHR is never called
-    my_data->connection = nullptr;
     // Load the xcb library and initialize xcb function pointers
     if (!xcb.xcbLib) {
         xcb.xcbLib = dlopen("libxcb.so", RTLD_NOW | RTLD_LOCAL);
@@ -232,54 +448,467 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCre
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(key);
     VkuInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
     pTable->DestroyInstance(instance, pAllocator);
     delete pTable;
     layer_data_map.erase(key);
+
+    std::lock_guard<std::mutex> lock(instance_lock);
+    if (--instance_count == 0) {
+        frame_log.close();
+        telemetry.close();
+    }
 }
 
-VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo) {
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(queue), layer_data_map);
-
-    time_t now;
-    time(&now);
-    float seconds = (float)difftime(now, my_data->lastTime);
-
-    if (seconds > 0.5) {
-        char str[TITLE_LENGTH + FPS_LENGTH];
-        char fpsstr[FPS_LENGTH];
-        monitor_layer_data *my_instance_data = GetLayerDataPtr(get_dispatch_key(my_data->gpu), layer_data_map);
-        my_data->fps = (my_data->frame - my_data->lastFrame) / seconds;
-        my_data->lastFrame = my_data->frame;
-        my_data->lastTime = now;
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-        if (IsWindow(my_instance_data->hwnd) && !my_instance_data->got_title) {
-            GetWindowText(my_instance_data->hwnd, my_instance_data->base_title, TITLE_LENGTH);
-            my_instance_data->got_title = true;
+// Queries the budget and usage of the memory heaps of the device, for the title bar, the report and the memory log
+static void sample_memory(monitor_layer_data *my_data, uint64_t present, monitor::frame_clock::time_point now) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2, &budget};
+    my_data->pfn_get_memory_properties2(my_data->gpu, &properties);
+
+    monitor::memory_sample sample;
+    sample.heap_count = std::min(properties.memoryProperties.memoryHeapCount, monitor::kMaxMemoryHeaps);
+    for (uint32_t i = 0; i < sample.heap_count; i++) {
+        sample.heaps[i].budget = budget.heapBudget[i];
+        sample.heaps[i].usage = budget.heapUsage[i];
+        sample.heaps[i].device_local = (properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    if (frame_log.has_memory_log()) {
+        monitor::memory_record record;
+        record.present = present;
+        record.present_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - frame_log_epoch).count();
+        record.device = reinterpret_cast<uintptr_t>(my_data->device);
+        for (uint32_t i = 0; i < sample.heap_count; i++) {
+            record.heap = i;
+            record.device_local = sample.heaps[i].device_local;
+            record.budget = sample.heaps[i].budget;
+            record.usage = sample.heaps[i].usage;
+            frame_log.record(record);
         }
+    }
+
+    std::lock_guard<std::mutex> lock(my_data->present_lock);
+    my_data->memory_trend->add(sample);
+    my_data->title_memory = monitor::format_title_memory(sample);
+}
+
+// Collects the workload of the device since its previous present, samples its memory budget when due, and returns the
+// title text of the workload of the last complete period and of the last memory sample
+static std::string present_device(monitor_layer_data *my_data, monitor::frame_clock::time_point now,
+                                  monitor::frame_workload &frame_workload) {
+    frame_workload = my_data->workload->collect();
+
+    // The query costs about as much as a submit, so it is only done every memory_budget_interval presents
+    if (my_data->pfn_get_memory_properties2 != nullptr) {
+        const uint64_t present = my_data->memory_presents.fetch_add(1, std::memory_order_relaxed);
+        if (present % monitor_settings.memory_budget_interval == 0) sample_memory(my_data, present, now);
+    }
+
+    std::lock_guard<std::mutex> lock(my_data->present_lock);
+    for (uint32_t i = 0; i < monitor::kWorkloadCounterCount; i++) my_data->period_workload[i] += frame_workload.counts[i];
+    for (uint32_t i = 0; i < monitor::kBlockingCallCount; i++) {
+        my_data->period_blocked_ns[i] += frame_workload.blocked_ns[i];
+        my_data->total_blocked_ns[i] += frame_workload.blocked_ns[i];
+    }
+    my_data->period_presents++;
+
+    if (now - my_data->period_start >= kTitleUpdatePeriod) {
+        const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(now - my_data->period_start);
+        my_data->title_workload = monitor::format_title_workload(my_data->period_workload, my_data->period_presents) +
+                                  monitor::format_title_blocked(my_data->period_blocked_ns, period.count());
+        my_data->period_start = now;
+        my_data->period_workload = {};
+        my_data->period_presents = 0;
+        my_data->period_blocked_ns = {};
+    }
+    return my_data->title_workload + my_data->title_memory;
+}
+
+static void update_title(monitor_window *window, const std::string &statistics) {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+    if (IsWindow(window->hwnd) && !window->got_title) {
+        GetWindowText(window->hwnd, window->base_title, TITLE_LENGTH);
+        window->got_title = true;
+    }
 #endif
-        sprintf(fpsstr, "   FPS = %.2f", my_data->fps);
-        strcpy(str, my_instance_data->base_title);
-        strcat(str, fpsstr);
+    const std::string str = window->base_title + statistics;
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
-        if (IsWindow(my_instance_data->hwnd)) {
-            SetWindowText(my_instance_data->hwnd, str);
-        }
+    if (IsWindow(window->hwnd)) {
+        SetWindowText(window->hwnd, str.c_str());
+    }
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-        if (xcb.xcbLib && my_instance_data->xcb_fps && my_instance_data->connection) {
-            xcb.change_property(my_instance_data->connection, XCB_PROP_MODE_REPLACE, my_instance_data->xcb_window, XCB_ATOM_WM_NAME,
-                                XCB_ATOM_STRING, 8, strlen(str), str);
-            xcb.flush(my_instance_data->connection);
-        }
+    if (xcb.xcbLib && window->xcb_fps && window->connection) {
+        xcb.change_property(window->connection, XCB_PROP_MODE_REPLACE, window->xcb_window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                            str.size(), str.c_str());
+        xcb.flush(window->connection);
+    }
 #endif
+}
+
+static void present_swapchain(VkQueue queue, VkSwapchainKHR swapchain, monitor_swapchain_data *swapchain_data,
+                              monitor::frame_clock::time_point now, const monitor::frame_workload &frame_workload,
+                              const std::string &title_workload) {
+    std::lock_guard<std::mutex> lock(swapchain_data->lock);
+    const monitor::frame_clock::time_point previous = swapchain_data->frame_times->last_present();
+    const bool measured = swapchain_data->frame_times->present(now);
+    const uint64_t frame = swapchain_data->presents.fetch_add(1, std::memory_order_relaxed);
+
+    if (frame_log.is_open()) {
+        monitor::frame_record record;
+        record.frame = frame;
+        record.present_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - frame_log_epoch).count();
+        record.delta_ns = measured ? std::chrono::duration_cast<std::chrono::nanoseconds>(now - previous).count() : 0;
+        record.queue = reinterpret_cast<uintptr_t>(queue);
+        record.swapchain = (uint64_t)(swapchain);
+        std::copy(frame_workload.counts.begin(), frame_workload.counts.end(), record.workload);
+        record.blocked_gpu_ns = monitor::blocked_on_gpu(frame_workload.blocked_ns);
+        record.blocked_swapchain_ns = monitor::blocked_on_swapchain(frame_workload.blocked_ns);
+        frame_log.record(record);
+    }
+
+    if (now - swapchain_data->last_title_update < kTitleUpdatePeriod) return;
+    swapchain_data->last_title_update = now;
+
+    // The FPS is over the last update period as it always was, the lows, p99 and stutters over all the kept frames
+    monitor::frame_statistics stats = swapchain_data->frame_times->compute();
+    stats.average_fps = swapchain_data->frame_times->compute(kTitleUpdatePeriod).average_fps;
+
+    if (swapchain_data->telemetry_slot >= 0) {
+        monitor::telemetry_swapchain published = {};
+        published.in_use = 1;
+        published.window_frames = stats.frame_count;
+        published.device = reinterpret_cast<uintptr_t>(swapchain_data->device_data->device);
+        published.swapchain = (uint64_t)(swapchain);
+        published.total_frames = swapchain_data->frame_times->total_frames();
+        published.update_ns = telemetry.elapsed_ns();
+        published.average_fps = stats.average_fps;
+        published.low_1_percent_fps = stats.low_1_percent_fps;
+        published.low_0_1_percent_fps = stats.low_0_1_percent_fps;
+        published.p50_ms = stats.p50_ms;
+        published.p95_ms = stats.p95_ms;
+        published.p99_ms = stats.p99_ms;
+        published.stutter_count = stats.stutter_count;
+        telemetry.publish(swapchain_data->telemetry_slot, published);
+    }
+
+    if (swapchain_data->window != nullptr) {
+        update_title(swapchain_data->window, monitor::format_title_statistics(stats) + title_workload);
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo) {
+    monitor_layer_data *my_data = cached_device_data(queue);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+
+    const monitor::frame_clock::time_point now = monitor::frame_clock::now();
+    monitor::frame_workload frame_workload;
+    const std::string title_workload = present_device(my_data, now, frame_workload);
+    for (uint32_t i = 0; pPresentInfo != nullptr && i < pPresentInfo->swapchainCount; i++) {
+        const VkSwapchainKHR swapchain = pPresentInfo->pSwapchains[i];
+        monitor_swapchain_data *swapchain_data = swapchain_map.find(swapchain);
+        if (swapchain_data == nullptr) continue;
+        present_swapchain(queue, swapchain, swapchain_data, now, frame_workload, title_workload);
+
+        // The workload of the present is logged once, in the record of its first swapchain
+        frame_workload = {};
     }
-    my_data->frame++;
 
+    // The present blocks in the next frame, which it starts
+    const monitor::frame_clock::time_point present_start = monitor::frame_clock::now();
     VkResult result = my_data->pfnQueuePresentKHR(queue, pPresentInfo);
+    add_blocked(block, monitor::kBlockingPresent, present_start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(VkDevice device, const VkSwapchainCreateInfoKHR *pCreateInfo,
+                                                    const VkAllocationCallbacks *pAllocator, VkSwapchainKHR *pSwapchain) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    VkResult result = my_data->device_dispatch_table->CreateSwapchainKHR(device, pCreateInfo, pAllocator, pSwapchain);
+    if (result != VK_SUCCESS) return result;
+
+    monitor_swapchain_data *swapchain_data = swapchain_map.emplace(*pSwapchain);
+    swapchain_data->device_data = my_data;
+    swapchain_data->window = window_map.find(pCreateInfo->surface);
+    swapchain_data->frame_times.reset(new monitor::frame_times);
+    swapchain_data->last_title_update = monitor::frame_clock::now();
+    swapchain_data->telemetry_slot = telemetry.claim(reinterpret_cast<uintptr_t>(device), (uint64_t)(*pSwapchain));
     return result;
 }
 
+VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain,
+                                                 const VkAllocationCallbacks *pAllocator) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    my_data->device_dispatch_table->DestroySwapchainKHR(device, swapchain, pAllocator);
+
+    monitor_swapchain_data *swapchain_data = swapchain_map.find(swapchain);
+    if (swapchain_data == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(swapchain_data->lock);
+        if (monitor_settings.report && swapchain_data->frame_times->total_frames() > 0) {
+            const std::string report = monitor::format_report(swapchain_data->frame_times->compute());
+            fprintf(stdout, "Monitor layer report for swapchain 0x%" PRIx64 " of device %p:\n%s", (uint64_t)(swapchain),
+                    static_cast<void *>(device), report.c_str());
+            fflush(stdout);
+        }
+        telemetry.release(swapchain_data->telemetry_slot);
+    }
+    swapchain_map.erase(swapchain);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkWaitForFences(VkDevice device, uint32_t fenceCount, const VkFence *pFences, VkBool32 waitAll,
+                                               uint64_t timeout) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->WaitForFences(device, fenceCount, pFences, waitAll, timeout);
+    add_blocked(block, monitor::kBlockingWaitForFences, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkWaitSemaphores(VkDevice device, const VkSemaphoreWaitInfo *pWaitInfo, uint64_t timeout) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->WaitSemaphores(device, pWaitInfo, timeout);
+    add_blocked(block, monitor::kBlockingWaitSemaphores, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkWaitSemaphoresKHR(VkDevice device, const VkSemaphoreWaitInfo *pWaitInfo, uint64_t timeout) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->WaitSemaphoresKHR(device, pWaitInfo, timeout);
+    add_blocked(block, monitor::kBlockingWaitSemaphores, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueWaitIdle(VkQueue queue) {
+    monitor_layer_data *my_data = cached_device_data(queue);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->QueueWaitIdle(queue);
+    add_blocked(block, monitor::kBlockingQueueWaitIdle, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkDeviceWaitIdle(VkDevice device) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->DeviceWaitIdle(device);
+    add_blocked(block, monitor::kBlockingDeviceWaitIdle, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetQueryPoolResults(VkDevice device, VkQueryPool queryPool, uint32_t firstQuery,
+                                                     uint32_t queryCount, size_t dataSize, void *pData, VkDeviceSize stride,
+                                                     VkQueryResultFlags flags) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->GetQueryPoolResults(device, queryPool, firstQuery, queryCount, dataSize,
+                                                                          pData, stride, flags);
+    add_blocked(block, monitor::kBlockingGetQueryPoolResults, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAcquireNextImageKHR(VkDevice device, VkSwapchainKHR swapchain, uint64_t timeout,
+                                                     VkSemaphore semaphore, VkFence fence, uint32_t *pImageIndex) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result =
+        my_data->device_dispatch_table->AcquireNextImageKHR(device, swapchain, timeout, semaphore, fence, pImageIndex);
+    add_blocked(block, monitor::kBlockingAcquireNextImage, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAcquireNextImage2KHR(VkDevice device, const VkAcquireNextImageInfoKHR *pAcquireInfo,
+                                                      uint32_t *pImageIndex) {
+    monitor_layer_data *my_data = cached_device_data(device);
+    monitor::workload_counters::thread_block *block = workload_cache.block;
+    const monitor::frame_clock::time_point start = monitor::frame_clock::now();
+    VkResult result = my_data->device_dispatch_table->AcquireNextImage2KHR(device, pAcquireInfo, pImageIndex);
+    add_blocked(block, monitor::kBlockingAcquireNextImage, start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo *pSubmits, VkFence fence) {
+    uint64_t command_buffers = 0;
+    for (uint32_t i = 0; i < submitCount; i++) command_buffers += pSubmits[i].commandBufferCount;
+    monitor_layer_data *my_data = count_workload(queue, monitor::kWorkloadSubmits, 1);
+    monitor::workload_counters::add(*workload_cache.block, monitor::kWorkloadCommandBuffers, command_buffers);
+    return my_data->device_dispatch_table->QueueSubmit(queue, submitCount, pSubmits, fence);
+}
+
+static uint64_t count_command_buffers(uint32_t submitCount, const VkSubmitInfo2 *pSubmits) {
+    uint64_t command_buffers = 0;
+    for (uint32_t i = 0; i < submitCount; i++) command_buffers += pSubmits[i].commandBufferInfoCount;
+    return command_buffers;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits, VkFence fence) {
+    monitor_layer_data *my_data = count_workload(queue, monitor::kWorkloadSubmits, 1);
+    monitor::workload_counters::add(*workload_cache.block, monitor::kWorkloadCommandBuffers,
+                                    count_command_buffers(submitCount, pSubmits));
+    return my_data->device_dispatch_table->QueueSubmit2(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit2KHR(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits,
+                                                 VkFence fence) {
+    monitor_layer_data *my_data = count_workload(queue, monitor::kWorkloadSubmits, 1);
+    monitor::workload_counters::add(*workload_cache.block, monitor::kWorkloadCommandBuffers,
+                                    count_command_buffers(submitCount, pSubmits));
+    return my_data->device_dispatch_table->QueueSubmit2KHR(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount,
+                                     uint32_t firstVertex, uint32_t firstInstance) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount,
+                                            uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset,
+                                                   firstInstance);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                             uint32_t drawCount, uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                    uint32_t drawCount, uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                  VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                                  uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset,
+                                                         maxDrawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndirectCountKHR(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                     VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                                     uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndirectCountKHR(commandBuffer, buffer, offset, countBuffer, countBufferOffset,
+                                                            maxDrawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                         VkBuffer countBuffer, VkDeviceSize countBufferOffset,
+                                                         uint32_t maxDrawCount, uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset,
+                                                                maxDrawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexedIndirectCountKHR(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                            VkBuffer countBuffer, VkDeviceSize countBufferOffset,
+                                                            uint32_t maxDrawCount, uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawIndexedIndirectCountKHR(commandBuffer, buffer, offset, countBuffer,
+                                                                   countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawMeshTasksEXT(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY,
+                                                 uint32_t groupCountZ) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawMeshTasksEXT(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawMeshTasksIndirectEXT(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                         uint32_t drawCount, uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawMeshTasksIndirectEXT(commandBuffer, buffer, offset, drawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawMeshTasksIndirectCountEXT(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                                                              VkDeviceSize offset, VkBuffer countBuffer,
+                                                              VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                                              uint32_t stride) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDraws, 1);
+    my_data->device_dispatch_table->CmdDrawMeshTasksIndirectCountEXT(commandBuffer, buffer, offset, countBuffer,
+                                                                     countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY,
+                                         uint32_t groupCountZ) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDispatches, 1);
+    my_data->device_dispatch_table->CmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDispatches, 1);
+    my_data->device_dispatch_table->CmdDispatchIndirect(commandBuffer, buffer, offset);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDispatchBase(VkCommandBuffer commandBuffer, uint32_t baseGroupX, uint32_t baseGroupY,
+                                             uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY,
+                                             uint32_t groupCountZ) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDispatches, 1);
+    my_data->device_dispatch_table->CmdDispatchBase(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY,
+                                                    groupCountZ);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdDispatchBaseKHR(VkCommandBuffer commandBuffer, uint32_t baseGroupX, uint32_t baseGroupY,
+                                                uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY,
+                                                uint32_t groupCountZ) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDispatches, 1);
+    my_data->device_dispatch_table->CmdDispatchBaseKHR(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX,
+                                                       groupCountY, groupCountZ);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSets(VkDevice device, uint32_t descriptorWriteCount,
+                                                  const VkWriteDescriptorSet *pDescriptorWrites, uint32_t descriptorCopyCount,
+                                                  const VkCopyDescriptorSet *pDescriptorCopies) {
+    monitor_layer_data *my_data =
+        count_workload(device, monitor::kWorkloadDescriptorUpdates, uint64_t(descriptorWriteCount) + descriptorCopyCount);
+    my_data->device_dispatch_table->UpdateDescriptorSets(device, descriptorWriteCount, pDescriptorWrites, descriptorCopyCount,
+                                                         pDescriptorCopies);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet descriptorSet,
+                                                             VkDescriptorUpdateTemplate descriptorUpdateTemplate,
+                                                             const void *pData) {
+    monitor_layer_data *my_data = count_workload(device, monitor::kWorkloadDescriptorUpdates, 1);
+    my_data->device_dispatch_table->UpdateDescriptorSetWithTemplate(device, descriptorSet, descriptorUpdateTemplate, pData);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSetWithTemplateKHR(VkDevice device, VkDescriptorSet descriptorSet,
+                                                                VkDescriptorUpdateTemplate descriptorUpdateTemplate,
+                                                                const void *pData) {
+    monitor_layer_data *my_data = count_workload(device, monitor::kWorkloadDescriptorUpdates, 1);
+    my_data->device_dispatch_table->UpdateDescriptorSetWithTemplateKHR(device, descriptorSet, descriptorUpdateTemplate, pData);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPushDescriptorSetKHR(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint,
+                                                     VkPipelineLayout layout, uint32_t set, uint32_t descriptorWriteCount,
+                                                     const VkWriteDescriptorSet *pDescriptorWrites) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDescriptorUpdates, descriptorWriteCount);
+    my_data->device_dispatch_table->CmdPushDescriptorSetKHR(commandBuffer, pipelineBindPoint, layout, set, descriptorWriteCount,
+                                                            pDescriptorWrites);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPushDescriptorSetWithTemplateKHR(VkCommandBuffer commandBuffer,
+                                                                 VkDescriptorUpdateTemplate descriptorUpdateTemplate,
+                                                                 VkPipelineLayout layout, uint32_t set, const void *pData) {
+    monitor_layer_data *my_data = count_workload(commandBuffer, monitor::kWorkloadDescriptorUpdates, 1);
+    my_data->device_dispatch_table->CmdPushDescriptorSetWithTemplateKHR(commandBuffer, descriptorUpdateTemplate, layout, set,
+                                                                        pData);
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDevice physicalDevice, uint32_t *pToolCount,
                                                                     VkPhysicalDeviceToolPropertiesEXT *pToolProperties) {
     static const VkPhysicalDeviceToolPropertiesEXT monitor_layer_tool_props = {
@@ -298,7 +927,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDe
         (*pToolCount)--;
     }
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(physicalDevice), layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(get_dispatch_key(physicalDevice));
     VkResult result =
         my_data->instance_dispatch_table->GetPhysicalDeviceToolPropertiesEXT(physicalDevice, pToolCount, pToolProperties);
 
@@ -314,10 +943,12 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDe
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateWin32SurfaceKHR(VkInstance instance, const VkWin32SurfaceCreateInfoKHR *pCreateInfo,
                                                        const VkAllocationCallbacks *pAllocator, VkSurfaceKHR *pSurface) {
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
-    my_data->hwnd = pCreateInfo->hwnd;
+    monitor_layer_data *my_data = layer_data_map.find(get_dispatch_key(instance));
 
     VkResult result = my_data->instance_dispatch_table->CreateWin32SurfaceKHR(instance, pCreateInfo, pAllocator, pSurface);
+    if (result == VK_SUCCESS) {
+        window_map.emplace(*pSurface)->hwnd = pCreateInfo->hwnd;
+    }
     return result;
 }
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
@@ -329,35 +960,43 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateXcbSurfaceKHR(VkInstance instance, const
     xcb_atom_t property = XCB_ATOM_WM_NAME;
     xcb_atom_t type = XCB_ATOM_STRING;
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
+    monitor_layer_data *my_data = layer_data_map.find(get_dispatch_key(instance));
+
+    VkResult result = my_data->instance_dispatch_table->CreateXcbSurfaceKHR(instance, pCreateInfo, pAllocator, pSurface);
+    if (result != VK_SUCCESS) return result;
 
     if (!xcb.xcbLib and !xcbErrorPrinted) {
         fprintf(stderr, "Monitor layer libxcb.so load failure, will not be able to display frame rate\n");
         xcbErrorPrinted = true;
     }
     if (xcb.xcbLib) {
-        my_data->xcb_window = pCreateInfo->window;
-        my_data->connection = pCreateInfo->connection;
-        cookie = xcb.get_property(my_data->connection, 0, my_data->xcb_window, property, type, 0, 0);
-        if ((reply = xcb.get_property_reply(my_data->connection, cookie, NULL))) {
-            my_data->xcb_fps = true;
+        monitor_window *window = window_map.emplace(*pSurface);
+        window->xcb_window = pCreateInfo->window;
+        window->connection = pCreateInfo->connection;
+        cookie = xcb.get_property(window->connection, 0, window->xcb_window, property, type, 0, 0);
+        if ((reply = xcb.get_property_reply(window->connection, cookie, NULL))) {
+            window->xcb_fps = true;
             int len = xcb.get_property_value_length(reply);
             if (len > TITLE_LENGTH) {
-                my_data->xcb_fps = false;
+                window->xcb_fps = false;
             } else if (len > 0) {
-                strcpy(my_data->base_title, (char *)xcb.get_property_value(reply));
+                strcpy(window->base_title, (char *)xcb.get_property_value(reply));
             } else {
                 // No window title - make base title null string
-                my_data->base_title[0] = 0;
+                window->base_title[0] = 0;
             }
         }
     }
-
-    VkResult result = my_data->instance_dispatch_table->CreateXcbSurfaceKHR(instance, pCreateInfo, pAllocator, pSurface);
     return result;
 }
 #endif
 
+VKAPI_ATTR void VKAPI_CALL vkDestroySurfaceKHR(VkInstance instance, VkSurfaceKHR surface, const VkAllocationCallbacks *pAllocator) {
+    monitor_layer_data *my_data = layer_data_map.find(get_dispatch_key(instance));
+    my_data->instance_dispatch_table->DestroySurfaceKHR(instance, surface, pAllocator);
+    window_map.erase(surface);
+}
+
 #if defined(__GNUC__) && __GNUC__ >= 4
 #define EXPORT_FUNCTION __attribute__((visibility("default")))
 #elif defined(__SUNPRO_C) && (__SUNPRO_C >= 0x590)
@@ -378,11 +1017,52 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkD
     if (dev == NULL) return NULL;
 
     monitor_layer_data *dev_data;
-    dev_data = GetLayerDataPtr(get_dispatch_key(dev), layer_data_map);
+    dev_data = layer_data_map.find(get_dispatch_key(dev));
     VkuDeviceDispatchTable *pTable = dev_data->device_dispatch_table;
 
     if (pTable->GetDeviceProcAddr == NULL) return NULL;
-    return pTable->GetDeviceProcAddr(dev, funcName);
+    PFN_vkVoidFunction next = pTable->GetDeviceProcAddr(dev, funcName);
+
+    // The workload counters and blocked times, only for the commands the device has
+#define ADD_HOOK(fn) \
+    if (!strncmp(#fn, funcName, sizeof(#fn))) return next != NULL ? (PFN_vkVoidFunction)fn : NULL
+
+    ADD_HOOK(vkQueueSubmit);
+    ADD_HOOK(vkQueueSubmit2);
+    ADD_HOOK(vkQueueSubmit2KHR);
+    ADD_HOOK(vkCmdDraw);
+    ADD_HOOK(vkCmdDrawIndexed);
+    ADD_HOOK(vkCmdDrawIndirect);
+    ADD_HOOK(vkCmdDrawIndexedIndirect);
+    ADD_HOOK(vkCmdDrawIndirectCount);
+    ADD_HOOK(vkCmdDrawIndirectCountKHR);
+    ADD_HOOK(vkCmdDrawIndexedIndirectCount);
+    ADD_HOOK(vkCmdDrawIndexedIndirectCountKHR);
+    ADD_HOOK(vkCmdDrawMeshTasksEXT);
+    ADD_HOOK(vkCmdDrawMeshTasksIndirectEXT);
+    ADD_HOOK(vkCmdDrawMeshTasksIndirectCountEXT);
+    ADD_HOOK(vkCmdDispatch);
+    ADD_HOOK(vkCmdDispatchIndirect);
+    ADD_HOOK(vkCmdDispatchBase);
+    ADD_HOOK(vkCmdDispatchBaseKHR);
+    ADD_HOOK(vkUpdateDescriptorSets);
+    ADD_HOOK(vkUpdateDescriptorSetWithTemplate);
+    ADD_HOOK(vkUpdateDescriptorSetWithTemplateKHR);
+    ADD_HOOK(vkCmdPushDescriptorSetKHR);
+    ADD_HOOK(vkCmdPushDescriptorSetWithTemplateKHR);
+    ADD_HOOK(vkWaitForFences);
+    ADD_HOOK(vkWaitSemaphores);
+    ADD_HOOK(vkWaitSemaphoresKHR);
+    ADD_HOOK(vkQueueWaitIdle);
+    ADD_HOOK(vkDeviceWaitIdle);
+    ADD_HOOK(vkGetQueryPoolResults);
+    ADD_HOOK(vkAcquireNextImageKHR);
+    ADD_HOOK(vkAcquireNextImage2KHR);
+    ADD_HOOK(vkCreateSwapchainKHR);
+    ADD_HOOK(vkDestroySwapchainKHR);
+#undef ADD_HOOK
+
+    return next;
 }
 
 EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char *funcName) {
@@ -396,6 +1076,7 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(V
     ADD_HOOK(vkDestroyInstance);
     ADD_HOOK(vkGetInstanceProcAddr);
     ADD_HOOK(vkGetPhysicalDeviceToolPropertiesEXT);
+    ADD_HOOK(vkDestroySurfaceKHR);
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
     ADD_HOOK(vkCreateWin32SurfaceKHR);
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
@@ -406,7 +1087,7 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(V
     if (instance == NULL) return NULL;
 
     monitor_layer_data *instance_data;
-    instance_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
+    instance_data = layer_data_map.find(get_dispatch_key(instance));
     VkuInstanceDispatchTable *pTable = instance_data->instance_dispatch_table;
 
     if (pTable->GetInstanceProcAddr == NULL) return NULL;
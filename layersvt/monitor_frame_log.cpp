@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_frame_log.h"
+
+#include <chrono>
+#include <cinttypes>
+
+namespace monitor {
+
+std::string memory_log_path(const std::string &frame_log_path) {
+    const size_t name = frame_log_path.find_last_of("/\\");
+    const size_t extension = frame_log_path.rfind('.');
+    if (extension == std::string::npos || (name != std::string::npos && extension < name) || extension == name + 1) {
+        return frame_log_path + ".memory";
+    }
+    return frame_log_path.substr(0, extension) + ".memory" + frame_log_path.substr(extension);
+}
+
+bool frame_log::open(const std::string &path, frame_log_format log_format, bool with_memory_log) {
+    if (file != nullptr) return true;
+
+    const char *mode = log_format == frame_log_format::binary ? "wb" : "w";
+    file = fopen(path.c_str(), mode);
+    if (file == nullptr) return false;
+    if (with_memory_log) {
+        memory_file = fopen(memory_log_path(path).c_str(), mode);
+        if (memory_file == nullptr) {
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+    }
+
+    format = log_format;
+    if (format == frame_log_format::binary) {
+        const frame_log_header header = {{'V', 'K', 'M', 'O', 'N', 'F', 'T', '\0'}, kFrameLogVersion, sizeof(frame_record)};
+        fwrite(&header, sizeof(header), 1, file);
+    } else {
+        fputs("frame,present_ns,delta_ns,queue,swapchain,submits,command_buffers,draws,dispatches,descriptor_updates,"
+              "blocked_gpu_ns,blocked_swapchain_ns\n",
+              file);
+    }
+    if (memory_file != nullptr) {
+        if (format == frame_log_format::binary) {
+            const frame_log_header header = {{'V', 'K', 'M', 'O', 'N', 'M', 'B', '\0'}, kMemoryLogVersion, sizeof(memory_record)};
+            fwrite(&header, sizeof(header), 1, memory_file);
+        } else {
+            fputs("present,present_ns,device,heap,device_local,budget,usage\n", memory_file);
+        }
+        active_memory.reserve(kMemoryBufferRecords);
+        spare_memory.reserve(kMemoryBufferRecords);
+    }
+
+    active.reserve(kBufferRecords);
+    spare.reserve(kBufferRecords);
+    stopping = false;
+    dropped = 0;
+    writer = std::thread(&frame_log::run, this);
+    return true;
+}
+
+void frame_log::close() {
+    if (file == nullptr) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    if (dropped > 0) {
+        fprintf(stderr, "Monitor layer: the frame log fell behind, %" PRIu64 " records were dropped\n", dropped);
+    }
+    fclose(file);
+    file = nullptr;
+    if (memory_file != nullptr) {
+        fclose(memory_file);
+        memory_file = nullptr;
+    }
+}
+
+void frame_log::record(const frame_record &record) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        if (active.size() == kBufferRecords) {
+            dropped++;
+            return;
+        }
+        active.push_back(record);
+        full = active.size() == kBufferRecords;
+    }
+    if (full) wake.notify_one();
+}
+
+void frame_log::record(const memory_record &record) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || memory_file == nullptr) return;
+        if (active_memory.size() == kMemoryBufferRecords) {
+            dropped++;
+            return;
+        }
+        active_memory.push_back(record);
+        full = active_memory.size() == kMemoryBufferRecords;
+    }
+    if (full) wake.notify_one();
+}
+
+void frame_log::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait_for(lock, std::chrono::milliseconds(100), [this] {
+            return stopping || active.size() == kBufferRecords || active_memory.size() == kMemoryBufferRecords;
+        });
+        const bool stop = stopping;
+        active.swap(spare);
+        active_memory.swap(spare_memory);
+
+        lock.unlock();
+        write(spare);
+        spare.clear();
+        write(spare_memory);
+        spare_memory.clear();
+        lock.lock();
+
+        if (stop) break;
+    }
+    // Records added while the last buffers were written
+    lock.unlock();
+    write(active);
+    active.clear();
+    write(active_memory);
+    active_memory.clear();
+}
+
+void frame_log::write(const std::vector<frame_record> &records) {
+    if (records.empty()) return;
+    if (format == frame_log_format::binary) {
+        fwrite(records.data(), sizeof(frame_record), records.size(), file);
+    } else {
+        for (const frame_record &record : records) {
+            fprintf(file,
+                    "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",0x%" PRIx64 ",0x%" PRIx64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                    ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                    record.frame, record.present_ns, record.delta_ns, record.queue, record.swapchain,
+                    record.workload[kWorkloadSubmits], record.workload[kWorkloadCommandBuffers], record.workload[kWorkloadDraws],
+                    record.workload[kWorkloadDispatches], record.workload[kWorkloadDescriptorUpdates], record.blocked_gpu_ns,
+                    record.blocked_swapchain_ns);
+        }
+    }
+    fflush(file);
+}
+
+void frame_log::write(const std::vector<memory_record> &records) {
+    if (records.empty()) return;
+    if (format == frame_log_format::binary) {
+        fwrite(records.data(), sizeof(memory_record), records.size(), memory_file);
+    } else {
+        for (const memory_record &record : records) {
+            fprintf(memory_file, "%" PRIu64 ",%" PRIu64 ",0x%" PRIx64 ",%u,%u,%" PRIu64 ",%" PRIu64 "\n", record.present,
+                    record.present_ns, record.device, record.heap, record.device_local, record.budget, record.usage);
+        }
+    }
+    fflush(memory_file);
+}
+
+}  // namespace monitor
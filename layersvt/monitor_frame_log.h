@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "monitor_workload.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monitor {
+
+// One presented frame of one swapchain. The workload and blocked times are those of the present, so a present of several
+// swapchains has them in the record of its first swapchain and zeros in the others.
+struct frame_record {
+    uint64_t frame;       // Index of the frame on its swapchain, from 0
+    uint64_t present_ns;  // Time of the present, from the opening of the log
+    uint64_t delta_ns;    // Time since the previous present of the swapchain, 0 for its first frame
+    uint64_t queue;
+    uint64_t swapchain;
+    uint64_t workload[kWorkloadCounterCount];  // API calls of the device since its previous present, see workload_counter
+    uint64_t blocked_gpu_ns;                   // Time the threads waited for the GPU since the previous present
+    uint64_t blocked_swapchain_ns;             // Time the threads waited in acquires and presents since the previous present
+};
+
+// The budget and usage of one memory heap of a device, sampled at a present
+struct memory_record {
+    uint64_t present;       // Index of the present on its device, from 0
+    uint64_t present_ns;    // Time of the present, from the opening of the log
+    uint64_t device;
+    uint32_t heap;
+    uint32_t device_local;  // 1 for a VK_MEMORY_HEAP_DEVICE_LOCAL_BIT heap
+    uint64_t budget;
+    uint64_t usage;
+};
+
+enum class frame_log_format { csv, binary };
+
+// Versions of the binary logs, changed with the meaning or layout of their records
+constexpr uint32_t kFrameLogVersion = 1;
+constexpr uint32_t kMemoryLogVersion = 1;
+
+// The binary log is a frame_log_header followed by frame_records, in the byte order of the machine that wrote it. The
+// memory log is the same with memory_records.
+struct frame_log_header {
+    char magic[8];  // "VKMONFT\0", "VKMONMB\0" for the memory log
+    uint32_t version;
+    uint32_t record_size;
+};
+
+// The memory log of a frame log, the frame log path with .memory before its extension
+std::string memory_log_path(const std::string &frame_log_path);
+
+// Writes frame records, and optionally memory records to the memory log, from a background thread.
+//
+// record() copies the record into one of two preallocated buffers under a short lock. The thread swaps the buffers when
+// one is full or every 100 ms and writes the full one, formatting it as CSV if needed, so presenting never waits on the
+// disk. If the thread falls behind by a whole buffer, records are dropped and counted rather than blocking the present.
+class frame_log {
+   public:
+    ~frame_log() { close(); }
+
+    bool open(const std::string &path, frame_log_format format, bool with_memory_log);
+    void close();
+    bool is_open() const { return file != nullptr; }
+    bool has_memory_log() const { return memory_file != nullptr; }
+
+    void record(const frame_record &record);
+    void record(const memory_record &record);
+
+   private:
+    static constexpr size_t kBufferRecords = 4096;
+    static constexpr size_t kMemoryBufferRecords = 1024;
+
+    void run();
+    void write(const std::vector<frame_record> &records);
+    void write(const std::vector<memory_record> &records);
+
+    FILE *file = nullptr;
+    FILE *memory_file = nullptr;
+    frame_log_format format = frame_log_format::csv;
+    std::thread writer;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<frame_record> active;  // Filled by record(), guarded by mutex
+    std::vector<frame_record> spare;   // Written by the thread
+    std::vector<memory_record> active_memory;
+    std::vector<memory_record> spare_memory;
+    bool stopping = false;
+    uint64_t dropped = 0;
+};
+
+}  // namespace monitor
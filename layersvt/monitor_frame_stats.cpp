@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace monitor {
+
+bool frame_times::present(frame_clock::time_point now) {
+    const bool measured = started;
+    if (measured) {
+        ring_ms[next] = std::chrono::duration<float, std::milli>(now - last).count();
+        next = (next + 1) % kCapacity;
+        count = std::min(count + 1, kCapacity);
+        total++;
+    }
+    last = now;
+    started = true;
+    return measured;
+}
+
+// Nearest-rank percentile of sorted frame times: the smallest one that at least percent of the frames don't exceed
+static double percentile(const std::vector<float> &sorted, double percent) {
+    size_t rank = static_cast<size_t>(std::ceil(percent * sorted.size() / 100.0));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+// Frame rate over the slowest fraction of sorted frame times, at least one frame
+static double low_fps(const std::vector<float> &sorted, double fraction) {
+    const size_t slowest = std::max<size_t>(static_cast<size_t>(sorted.size() * fraction), 1);
+    double total_ms = 0.0;
+    for (size_t i = sorted.size() - slowest; i < sorted.size(); i++) total_ms += sorted[i];
+    return total_ms > 0.0 ? 1000.0 * slowest / total_ms : 0.0;
+}
+
+frame_statistics frame_times::compute(frame_clock::duration window) const {
+    frame_statistics stats;
+
+    // Walks back from the newest frame until the window is covered
+    const double window_ms = window == frame_clock::duration::max()
+                                 ? HUGE_VAL
+                                 : std::chrono::duration<double, std::milli>(window).count();
+    std::vector<float> sorted;
+    sorted.reserve(count);
+    double covered_ms = 0.0;
+    for (size_t i = 0; i < count && covered_ms < window_ms; i++) {
+        const float ms = ring_ms[(next + kCapacity - 1 - i) % kCapacity];
+        sorted.push_back(ms);
+        covered_ms += ms;
+    }
+    if (sorted.empty()) return stats;
+    std::sort(sorted.begin(), sorted.end());
+
+    double total_ms = 0.0;
+    for (float ms : sorted) total_ms += ms;
+
+    stats.frame_count = static_cast<uint32_t>(sorted.size());
+    stats.average_fps = total_ms > 0.0 ? 1000.0 * sorted.size() / total_ms : 0.0;
+    stats.low_1_percent_fps = low_fps(sorted, 0.01);
+    stats.low_0_1_percent_fps = low_fps(sorted, 0.001);
+    stats.p50_ms = percentile(sorted, 50.0);
+    stats.p95_ms = percentile(sorted, 95.0);
+    stats.p99_ms = percentile(sorted, 99.0);
+
+    const double stutter_ms = 2.0 * stats.p50_ms;
+    stats.stutter_count = static_cast<uint32_t>(sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), stutter_ms));
+
+    auto bucket_begin = sorted.begin();
+    for (size_t i = 0; i < kHistogramBoundsMs.size(); i++) {
+        auto bucket_end = std::upper_bound(bucket_begin, sorted.end(), kHistogramBoundsMs[i]);
+        stats.histogram[i] = static_cast<uint32_t>(bucket_end - bucket_begin);
+        bucket_begin = bucket_end;
+    }
+    stats.histogram.back() = static_cast<uint32_t>(sorted.end() - bucket_begin);
+
+    return stats;
+}
+
+std::string format_title_statistics(const frame_statistics &stats) {
+    char text[128];
+    snprintf(text, sizeof(text), "   FPS = %.2f   1%% low = %.1f   p99 = %.2f ms   stutters = %u", stats.average_fps,
+             stats.low_1_percent_fps, stats.p99_ms, stats.stutter_count);
+    return text;
+}
+
+std::string format_report(const frame_statistics &stats) {
+    char line[128];
+    std::string report;
+
+    snprintf(line, sizeof(line), "Frame times over the last %u frames:\n", stats.frame_count);
+    report += line;
+    snprintf(line, sizeof(line), "  average FPS       %10.2f\n", stats.average_fps);
+    report += line;
+    snprintf(line, sizeof(line), "  1%% low FPS        %10.2f\n", stats.low_1_percent_fps);
+    report += line;
+    snprintf(line, sizeof(line), "  0.1%% low FPS      %10.2f\n", stats.low_0_1_percent_fps);
+    report += line;
+    snprintf(line, sizeof(line), "  p50 / p95 / p99   %7.2f / %.2f / %.2f ms\n", stats.p50_ms, stats.p95_ms, stats.p99_ms);
+    report += line;
+    snprintf(line, sizeof(line), "  stutters          %10u (over 2x the median)\n", stats.stutter_count);
+    report += line;
+
+    // One bar per bucket, the longest is 40 characters
+    const uint32_t largest = *std::max_element(stats.histogram.begin(), stats.histogram.end());
+    report += "Frame time histogram:\n";
+    for (size_t i = 0; i < stats.histogram.size(); i++) {
+        if (i < kHistogramBoundsMs.size()) {
+            snprintf(line, sizeof(line), "  <= %6.2f ms %7u ", kHistogramBoundsMs[i], stats.histogram[i]);
+        } else {
+            snprintf(line, sizeof(line), "   > %6.2f ms %7u ", kHistogramBoundsMs.back(), stats.histogram[i]);
+        }
+        report += line;
+        const size_t bar = largest > 0 ? (static_cast<size_t>(stats.histogram[i]) * 40 + largest - 1) / largest : 0;
+        report.append(bar, '#');
+        report += '\n';
+    }
+    return report;
+}
+
+}  // namespace monitor
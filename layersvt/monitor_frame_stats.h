@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace monitor {
+
+typedef std::chrono::steady_clock frame_clock;
+
+// Upper bounds of the frame time histogram buckets, in milliseconds: the frame times of 240, 120, 90, 60, 30, 20 and
+// 10 frames per second. A last bucket counts the frames slower than that.
+constexpr std::array<double, 7> kHistogramBoundsMs = {4.17, 8.33, 11.11, 16.67, 33.33, 50.0, 100.0};
+
+// Statistics of the frame times in a frame_times window
+struct frame_statistics {
+    uint32_t frame_count = 0;
+    double average_fps = 0.0;
+    double low_1_percent_fps = 0.0;    // Frame rate of the slowest 1% of the frames
+    double low_0_1_percent_fps = 0.0;  // Frame rate of the slowest 0.1% of the frames
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    uint32_t stutter_count = 0;  // Frames that took more than twice the median
+    std::array<uint32_t, kHistogramBoundsMs.size() + 1> histogram{};
+};
+
+// Present-to-present frame times, measured with a steady clock. The last kCapacity frames are kept in a ring, so the
+// statistics describe the recent frames, about a minute at 60 frames per second.
+class frame_times {
+   public:
+    static constexpr size_t kCapacity = 4096;
+
+    // Records a present at now, returns false for the first present, which has no previous one to measure from
+    bool present(frame_clock::time_point now);
+
+    // Statistics of the frames presented in the last window, all the kept frames by default
+    frame_statistics compute(frame_clock::duration window = frame_clock::duration::max()) const;
+
+    frame_clock::time_point last_present() const { return last; }
+    uint64_t total_frames() const { return total; }
+
+   private:
+    std::array<float, kCapacity> ring_ms{};
+    size_t next = 0;
+    size_t count = 0;
+    uint64_t total = 0;
+    frame_clock::time_point last{};
+    bool started = false;
+};
+
+// The statistics the title bar shows after the application's title
+std::string format_title_statistics(const frame_statistics &stats);
+
+// A multi-line report of the statistics, with the histogram of the frame times to show the pacing
+std::string format_report(const frame_statistics &stats);
+
+}  // namespace monitor
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_memory.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace monitor {
+
+void memory_trend::add(const memory_sample &sample) {
+    if (samples == 0) first = sample;
+    last = sample;
+    for (uint32_t i = 0; i < sample.heap_count; i++) peak[i] = std::max(peak[i], sample.heaps[i].usage);
+    samples++;
+}
+
+static double megabytes(uint64_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+std::string format_title_memory(const memory_sample &sample) {
+    uint64_t budget = 0;
+    uint64_t usage = 0;
+    for (uint32_t i = 0; i < sample.heap_count; i++) {
+        if (!sample.heaps[i].device_local) continue;
+        budget += sample.heaps[i].budget;
+        usage += sample.heaps[i].usage;
+    }
+    if (budget == 0) return std::string();
+
+    char text[64];
+    snprintf(text, sizeof(text), "   VRAM = %.0f / %.0f MB", megabytes(usage), megabytes(budget));
+    return text;
+}
+
+std::string format_memory_report(const memory_trend &trend) {
+    if (trend.sample_count() == 0) return std::string();
+
+    char line[160];
+    std::string report;
+    snprintf(line, sizeof(line), "Memory heap usage over %llu samples, in MB:\n",
+             static_cast<unsigned long long>(trend.sample_count()));
+    report += line;
+    const memory_sample &first = trend.first_sample();
+    const memory_sample &last = trend.last_sample();
+    for (uint32_t i = 0; i < last.heap_count; i++) {
+        const double growth = megabytes(last.heaps[i].usage) - megabytes(first.heaps[i].usage);
+        snprintf(line, sizeof(line), "  heap %2u%s first %10.1f   last %10.1f (%+.1f)   peak %10.1f   budget %10.1f\n", i,
+                 last.heaps[i].device_local ? " (device local)" : "               ", megabytes(first.heaps[i].usage),
+                 megabytes(last.heaps[i].usage), growth, megabytes(trend.peak_usage(i)), megabytes(last.heaps[i].budget));
+        report += line;
+    }
+    return report;
+}
+
+}  // namespace monitor
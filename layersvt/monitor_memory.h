@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace monitor {
+
+// VK_MAX_MEMORY_HEAPS
+constexpr uint32_t kMaxMemoryHeaps = 16;
+
+// The VK_EXT_memory_budget budget and usage of each memory heap of a device, in bytes
+struct memory_sample {
+    struct heap {
+        uint64_t budget = 0;
+        uint64_t usage = 0;
+        bool device_local = false;
+    };
+    uint32_t heap_count = 0;
+    std::array<heap, kMaxMemoryHeaps> heaps{};
+};
+
+// The usage of each heap over the samples of a device, to show how it grows over a session
+class memory_trend {
+   public:
+    void add(const memory_sample &sample);
+
+    uint64_t sample_count() const { return samples; }
+    const memory_sample &first_sample() const { return first; }
+    const memory_sample &last_sample() const { return last; }
+    uint64_t peak_usage(uint32_t heap) const { return peak[heap]; }
+
+   private:
+    uint64_t samples = 0;
+    memory_sample first;
+    memory_sample last;
+    std::array<uint64_t, kMaxMemoryHeaps> peak{};
+};
+
+// The usage and budget of the device local heaps, for the title bar
+std::string format_title_memory(const memory_sample &sample);
+
+// The first, last and peak usage of each heap, for the report
+std::string format_memory_report(const memory_trend &trend);
+
+}  // namespace monitor
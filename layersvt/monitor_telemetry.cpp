@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_telemetry.h"
+
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MONITOR_TELEMETRY_SUPPORTED 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace monitor {
+
+static uint64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool telemetry_segment::open() {
+#ifdef MONITOR_TELEMETRY_SUPPORTED
+    if (layout != nullptr) return true;
+
+    name = telemetry_segment_name(static_cast<uint64_t>(getpid()));
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, sizeof(telemetry_layout)) == 0) {
+        memory = mmap(nullptr, sizeof(telemetry_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // The segment is zero filled, so every slot starts unused with an even sequence
+    layout = static_cast<telemetry_layout *>(memory);
+    layout->version = kTelemetryVersion;
+    layout->slot_count = kTelemetryMaxSwapchains;
+    layout->process_id = static_cast<uint64_t>(getpid());
+    epoch_ns = steady_ns();
+
+    // Readers check the magic last, once the header is complete
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(layout->magic, kTelemetryMagic, sizeof(kTelemetryMagic));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void telemetry_segment::close() {
+#ifdef MONITOR_TELEMETRY_SUPPORTED
+    if (layout == nullptr) return;
+
+    munmap(layout, sizeof(telemetry_layout));
+    shm_unlink(name.c_str());
+    layout = nullptr;
+    for (bool &used : claimed) used = false;
+#endif
+}
+
+int telemetry_segment::claim(uint64_t device, uint64_t swapchain) {
+    if (layout == nullptr) return -1;
+
+    std::lock_guard<std::mutex> lock(claim_mutex);
+    for (uint32_t i = 0; i < kTelemetryMaxSwapchains; i++) {
+        if (claimed[i]) continue;
+        claimed[i] = true;
+
+        telemetry_swapchain initial = {};
+        initial.in_use = 1;
+        initial.device = device;
+        initial.swapchain = swapchain;
+        initial.update_ns = elapsed_ns();
+        telemetry_write(layout->slots[i], initial);
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void telemetry_segment::publish(int slot, const telemetry_swapchain &swapchain) {
+    if (layout == nullptr || slot < 0) return;
+    telemetry_write(layout->slots[slot], swapchain);
+}
+
+void telemetry_segment::release(int slot) {
+    if (layout == nullptr || slot < 0) return;
+
+    std::lock_guard<std::mutex> lock(claim_mutex);
+    telemetry_swapchain released = {};
+    released.update_ns = elapsed_ns();
+    telemetry_write(layout->slots[slot], released);
+    claimed[slot] = false;
+}
+
+uint64_t telemetry_segment::elapsed_ns() const { return steady_ns() - epoch_ns; }
+
+}  // namespace monitor
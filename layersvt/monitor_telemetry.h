@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Layout of the shared memory segment the monitor layer publishes its frame statistics in, shared by the layer and the
+// readers. The segment of a process is named /vk_monitor.<pid>.
+//
+// Each swapchain has a slot protected by a sequence lock: the layer makes the sequence odd, writes the slot and makes the
+// sequence even again, so a reader copies the slot and retries if the sequence was odd or changed meanwhile. Readers never
+// block the layer and publishing costs the layer no system call.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace monitor {
+
+constexpr char kTelemetryMagic[8] = "VKMONTM";
+constexpr uint32_t kTelemetryVersion = 1;
+constexpr uint32_t kTelemetryMaxSwapchains = 16;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The sequence locks are shared with other processes");
+
+// Frame statistics of one swapchain, see frame_statistics
+struct telemetry_swapchain {
+    uint32_t in_use;  // 0 once the swapchain is destroyed
+    uint32_t window_frames;
+    uint64_t device;        // VkDevice handle, for display
+    uint64_t swapchain;     // VkSwapchainKHR handle, for display
+    uint64_t total_frames;  // Frames presented since the swapchain was created
+    uint64_t update_ns;     // Time of the update, from the creation of the segment
+    double average_fps;
+    double low_1_percent_fps;
+    double low_0_1_percent_fps;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    uint32_t stutter_count;
+    uint32_t reserved;
+};
+
+struct telemetry_slot {
+    std::atomic<uint32_t> sequence;  // Odd while the layer writes the slot
+    uint32_t reserved;
+    telemetry_swapchain swapchain;
+};
+
+struct telemetry_layout {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t process_id;
+    telemetry_slot slots[kTelemetryMaxSwapchains];
+};
+
+inline std::string telemetry_segment_name(uint64_t process_id) { return "/vk_monitor." + std::to_string(process_id); }
+
+// Writes a slot, there must be a single writer per slot
+inline void telemetry_write(telemetry_slot &slot, const telemetry_swapchain &swapchain) {
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.swapchain, &swapchain, sizeof(swapchain));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Copies a slot, returns false if the layer kept writing it during all the attempts
+inline bool telemetry_read(const telemetry_slot &slot, telemetry_swapchain &swapchain) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) continue;
+        memcpy(&swapchain, &slot.swapchain, sizeof(swapchain));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) return true;
+    }
+    return false;
+}
+
+// The layer side: creates the segment of the process and hands out its slots
+class telemetry_segment {
+   public:
+    ~telemetry_segment() { close(); }
+
+    bool open();
+    void close();
+    bool is_open() const { return layout != nullptr; }
+
+    // Returns the slot of a new swapchain, or -1 if the segment is not open or all the slots are used
+    int claim(uint64_t device, uint64_t swapchain);
+    void publish(int slot, const telemetry_swapchain &swapchain);
+    void release(int slot);
+
+    // Time from the creation of the segment, to fill telemetry_swapchain::update_ns
+    uint64_t elapsed_ns() const;
+
+   private:
+    telemetry_layout *layout = nullptr;
+    std::string name;
+    std::mutex claim_mutex;
+    bool claimed[kTelemetryMaxSwapchains] = {};
+    uint64_t epoch_ns = 0;
+};
+
+}  // namespace monitor
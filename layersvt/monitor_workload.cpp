@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_workload.h"
+
+#include <cstdio>
+
+namespace monitor {
+
+workload_counters::thread_block *workload_counters::block_of_this_thread() {
+    const std::thread::id self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<thread_block> &block : blocks) {
+        if (block->owner == self) return block.get();
+    }
+    blocks.emplace_back(new thread_block);
+    blocks.back()->owner = self;
+    return blocks.back().get();
+}
+
+frame_workload workload_counters::collect() {
+    frame_workload total;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<thread_block> &block : blocks) {
+        for (uint32_t i = 0; i < kWorkloadCounterCount; i++) total.counts[i] += block->counts[i].load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < kBlockingCallCount; i++) {
+            total.blocked_ns[i] += block->blocked_ns[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // The blocks only grow, so the work of the frame is the difference with the previous totals
+    frame_workload frame;
+    for (uint32_t i = 0; i < kWorkloadCounterCount; i++) frame.counts[i] = total.counts[i] - collected.counts[i];
+    for (uint32_t i = 0; i < kBlockingCallCount; i++) frame.blocked_ns[i] = total.blocked_ns[i] - collected.blocked_ns[i];
+    collected = total;
+    return frame;
+}
+
+std::string format_title_workload(const workload_counts &counts, uint64_t frames) {
+    if (frames == 0) return std::string();
+
+    char text[192];
+    snprintf(text, sizeof(text),
+             "   per frame: submits = %.1f   cmd buffers = %.1f   draws = %.0f   dispatches = %.0f   descriptors = %.0f",
+             static_cast<double>(counts[kWorkloadSubmits]) / frames, static_cast<double>(counts[kWorkloadCommandBuffers]) / frames,
+             static_cast<double>(counts[kWorkloadDraws]) / frames, static_cast<double>(counts[kWorkloadDispatches]) / frames,
+             static_cast<double>(counts[kWorkloadDescriptorUpdates]) / frames);
+    return text;
+}
+
+// Share of frame_ns, in percent
+static double percent_of(uint64_t ns, uint64_t frame_ns) { return frame_ns > 0 ? 100.0 * ns / frame_ns : 0.0; }
+
+std::string format_title_blocked(const blocked_times &blocked_ns, uint64_t frame_ns) {
+    if (frame_ns == 0) return std::string();
+
+    const uint64_t gpu_ns = blocked_on_gpu(blocked_ns);
+    const uint64_t swapchain_ns = blocked_on_swapchain(blocked_ns);
+    char text[96];
+    snprintf(text, sizeof(text), "   blocked = %.0f%% (GPU %.0f%%, swapchain %.0f%%)", percent_of(gpu_ns + swapchain_ns, frame_ns),
+             percent_of(gpu_ns, frame_ns), percent_of(swapchain_ns, frame_ns));
+    return text;
+}
+
+std::string format_blocked_report(const blocked_times &blocked_ns, uint64_t frame_ns) {
+    static const char *const kNames[kBlockingCallCount] = {
+        "vkWaitForFences",       "vkWaitSemaphores",      "vkQueueWaitIdle",   "vkDeviceWaitIdle",
+        "vkGetQueryPoolResults", "vkAcquireNextImageKHR", "vkQueuePresentKHR",
+    };
+
+    char line[128];
+    std::string report;
+    snprintf(line, sizeof(line), "Time blocked over %.3f s of frames:\n", frame_ns / 1e9);
+    report += line;
+    for (uint32_t i = 0; i < kBlockingCallCount; i++) {
+        snprintf(line, sizeof(line), "  %-22s %10.2f ms %6.1f%%\n", kNames[i], blocked_ns[i] / 1e6,
+                 percent_of(blocked_ns[i], frame_ns));
+        report += line;
+    }
+    snprintf(line, sizeof(line), "  %-22s %10.2f ms %6.1f%%\n", "on the GPU", blocked_on_gpu(blocked_ns) / 1e6,
+             percent_of(blocked_on_gpu(blocked_ns), frame_ns));
+    report += line;
+    snprintf(line, sizeof(line), "  %-22s %10.2f ms %6.1f%%\n", "on the swapchain", blocked_on_swapchain(blocked_ns) / 1e6,
+             percent_of(blocked_on_swapchain(blocked_ns), frame_ns));
+    report += line;
+    return report;
+}
+
+}  // namespace monitor
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 Valve Corporation
+ * Copyright (C) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monitor {
+
+// The API calls counted per frame, in the order of the frame log columns
+enum workload_counter : uint32_t {
+    kWorkloadSubmits,            // vkQueueSubmit and vkQueueSubmit2 calls
+    kWorkloadCommandBuffers,     // Command buffers submitted
+    kWorkloadDraws,              // vkCmdDraw* calls recorded
+    kWorkloadDispatches,         // vkCmdDispatch* calls recorded
+    kWorkloadDescriptorUpdates,  // Descriptor writes, copies and template updates, pushed or not
+    kWorkloadCounterCount
+};
+
+typedef std::array<uint64_t, kWorkloadCounterCount> workload_counts;
+
+// The calls in which the CPU waits for the GPU or the swapchain, api_dump's BLOCKING_API_CALLS. The GPU ones come first.
+enum blocking_call : uint32_t {
+    kBlockingWaitForFences,        // vkWaitForFences
+    kBlockingWaitSemaphores,       // vkWaitSemaphores
+    kBlockingQueueWaitIdle,        // vkQueueWaitIdle
+    kBlockingDeviceWaitIdle,       // vkDeviceWaitIdle
+    kBlockingGetQueryPoolResults,  // vkGetQueryPoolResults
+    kBlockingAcquireNextImage,     // vkAcquireNextImageKHR and vkAcquireNextImage2KHR
+    kBlockingPresent,              // vkQueuePresentKHR, counted in the frame after the one it presents
+    kBlockingCallCount
+};
+
+constexpr uint32_t kFirstSwapchainBlockingCall = kBlockingAcquireNextImage;
+
+// Nanoseconds spent in each blocking_call
+typedef std::array<uint64_t, kBlockingCallCount> blocked_times;
+
+inline uint64_t blocked_on_gpu(const blocked_times &blocked_ns) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < kFirstSwapchainBlockingCall; i++) total += blocked_ns[i];
+    return total;
+}
+
+inline uint64_t blocked_on_swapchain(const blocked_times &blocked_ns) {
+    uint64_t total = 0;
+    for (uint32_t i = kFirstSwapchainBlockingCall; i < kBlockingCallCount; i++) total += blocked_ns[i];
+    return total;
+}
+
+// What the threads did for a device during a frame
+struct frame_workload {
+    workload_counts counts{};
+    blocked_times blocked_ns{};
+};
+
+// The workload counters of one device.
+//
+// Each thread counts in its own cache line aligned block of relaxed atomics, which only that thread writes, so counting
+// costs a plain add and threads recording in parallel never share a line. collect() sums the blocks at present.
+class workload_counters {
+   public:
+    struct alignas(64) thread_block {
+        std::array<std::atomic<uint64_t>, kWorkloadCounterCount> counts{};
+        std::array<std::atomic<uint64_t>, kBlockingCallCount> blocked_ns{};
+        std::thread::id owner;
+    };
+
+    // The block of the calling thread, created the first time the thread counts for the device. It lives as long as
+    // the counters, so callers can keep it.
+    thread_block *block_of_this_thread();
+
+    static void add(thread_block &block, workload_counter counter, uint64_t count) {
+        std::atomic<uint64_t> &value = block.counts[counter];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    static void add_blocked(thread_block &block, blocking_call call, uint64_t ns) {
+        std::atomic<uint64_t> &value = block.blocked_ns[call];
+        value.store(value.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    // The work done since the previous call
+    frame_workload collect();
+
+   private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<thread_block>> blocks;
+    frame_workload collected;
+};
+
+// The average counts per frame the title bar shows after the frame statistics
+std::string format_title_workload(const workload_counts &counts, uint64_t frames);
+
+// The share of frame_ns the CPU was blocked, for the title bar
+std::string format_title_blocked(const blocked_times &blocked_ns, uint64_t frame_ns);
+
+// The time spent in each blocking call over frame_ns, for the report
+std::string format_blocked_report(const blocked_times &blocked_ns, uint64_t frame_ns);
+
+}  // namespace monitor
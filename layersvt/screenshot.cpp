@@ -65,12 +65,12 @@ enum class colorSpaceFormat { UNDEFINED, UNORM, SNORM, USCALED, SSCALED, UINT, S
 
 colorSpaceFormat userColorSpaceFormat = colorSpaceFormat::UNDEFINED;
 
-// unordered map: associates Vulkan dispatchable objects to a dispatch table
+// map: associates the dispatch key of a device, and so of its queues and command buffers, to a dispatch table
 typedef struct {
     VkuDeviceDispatchTable *device_dispatch_table;
     PFN_vkSetDeviceLoaderData pfn_dev_init;
 } DispatchMapStruct;
-static unordered_map<VkDevice, DispatchMapStruct *> dispatchMap;
+static layer_data_store<dispatch_key, DispatchMapStruct> dispatchMap;
 
 // unordered map: associates a swap chain with a device, image extent, format,
 // and list of images
@@ -78,9 +78,9 @@ typedef struct {
     VkDevice device;
     VkExtent2D imageExtent;
     VkFormat format;
-    VkImage *imageList;
+    std::vector<VkImage> imageList;
 } SwapchainMapStruct;
-static unordered_map<VkSwapchainKHR, SwapchainMapStruct *> swapchainMap;
+static layer_data_store<VkSwapchainKHR, SwapchainMapStruct> swapchainMap;
 
 // unordered map: associates an image with a device, image extent, and format
 typedef struct {
@@ -88,9 +88,9 @@ typedef struct {
     VkExtent2D imageExtent;
     VkFormat format;
 } ImageMapStruct;
-static unordered_map<VkImage, ImageMapStruct *> imageMap;
+static layer_data_store<VkImage, ImageMapStruct> imageMap;
 
-// unordered map: associates a device with per device info -
+// map: associates a device with per device info -
 //   wsi capability
 //   set of queues created for this device
 //   queue to queueFamilyIndex map
@@ -101,13 +101,13 @@ typedef struct {
     unordered_map<VkQueue, uint32_t> queueIndexMap;
     VkPhysicalDevice physicalDevice;
 } DeviceMapStruct;
-static unordered_map<VkDevice, DeviceMapStruct *> deviceMap;
+static layer_data_store<VkDevice, DeviceMapStruct> deviceMap;
 
-// unordered map: associates a physical device with an instance
+// map: associates a physical device with an instance
 typedef struct {
     VkInstance instance;
 } PhysDeviceMapStruct;
-static unordered_map<VkPhysicalDevice, PhysDeviceMapStruct *> physDeviceMap;
+static layer_data_store<VkPhysicalDevice, PhysDeviceMapStruct> physDeviceMap;
 
 // set: list of frames to take screenshots without duplication.
 static set<int> screenshotFrames;
@@ -237,21 +237,10 @@ static bool memory_type_from_properties(VkPhysicalDeviceMemoryProperties *memory
     return false;
 }
 
-static DispatchMapStruct *get_dispatch_info(VkDevice dev) {
-    auto it = dispatchMap.find(dev);
-    if (it == dispatchMap.end())
-        return NULL;
-    else
-        return it->second;
-}
+// dev may also be a queue or a command buffer, they share the dispatch key of their device
+static DispatchMapStruct *get_dispatch_info(VkDevice dev) { return dispatchMap.find(get_dispatch_key(dev)); }
 
-static DeviceMapStruct *get_device_info(VkDevice dev) {
-    auto it = deviceMap.find(dev);
-    if (it == deviceMap.end())
-        return NULL;
-    else
-        return it->second;
-}
+static DeviceMapStruct *get_device_info(VkDevice dev) { return deviceMap.find(dev); }
 
 static void init_screenshot(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator) {
     VkuLayerSettingSet layerSettingSet = VK_NULL_HANDLE;
@@ -322,7 +311,7 @@ VkQueue getQueueForScreenshot(VkDevice device) {
         return queue;
     }
 
-    pInstanceTable = instance_dispatch_table(physDeviceMap[devMap->physicalDevice]->instance);
+    pInstanceTable = instance_dispatch_table(physDeviceMap.find(devMap->physicalDevice)->instance);
     assert(pInstanceTable);
     pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(devMap->physicalDevice, &count, NULL);
 
@@ -337,14 +326,13 @@ VkQueue getQueueForScreenshot(VkDevice device) {
         pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(devMap->physicalDevice, &count, queueProps.data());
 
         // Iterate over all queues for this device, searching for a queue that is graphics and present capable
-        deviceMap[device]->queues.begin();
-        for (auto it = deviceMap[device]->queues.begin(); it != deviceMap[device]->queues.end(); it++) {
+        for (auto it = devMap->queues.begin(); it != devMap->queues.end(); it++) {
             queue = *it;
-            graphicsCapable = ((queueProps[deviceMap[device]->queueIndexMap[queue]].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0);
+            graphicsCapable = ((queueProps[devMap->queueIndexMap[queue]].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0);
 #if defined(_WIN32)
             presentCapable =
                 instance_dispatch_table(devMap->physicalDevice)
-                    ->GetPhysicalDeviceWin32PresentationSupportKHR(devMap->physicalDevice, deviceMap[device]->queueIndexMap[queue]);
+                    ->GetPhysicalDeviceWin32PresentationSupportKHR(devMap->physicalDevice, devMap->queueIndexMap[queue]);
 #elif not defined(__ANDROID__)
             // Everthing else not Windows or Android
             // TODO: Make a function call to get present support from vkGetPhysicalDeviceXlibPresentationSupportKHR,
@@ -407,13 +395,14 @@ static bool writePPM(const char *filename, VkImage image1) {
     bool pass;
 
     // Bail immediately if we can't find the image.
-    if (imageMap.empty() || imageMap.find(image1) == imageMap.end()) return false;
+    ImageMapStruct *imageMapElem = imageMap.find(image1);
+    if (imageMapElem == NULL) return false;
 
     // Collect object info from maps.  This info is generally recorded
     // by the other functions hooked in this layer.
-    VkDevice device = imageMap[image1]->device;
-    VkPhysicalDevice physicalDevice = deviceMap[device]->physicalDevice;
-    VkInstance instance = physDeviceMap[physicalDevice]->instance;
+    VkDevice device = imageMapElem->device;
+    VkPhysicalDevice physicalDevice = get_device_info(device)->physicalDevice;
+    VkInstance instance = physDeviceMap.find(physicalDevice)->instance;
     DispatchMapStruct *dispMap = get_dispatch_info(device);
     if (NULL == dispMap) {
         assert(0);
@@ -437,9 +426,9 @@ static bool writePPM(const char *filename, VkImage image1) {
     // Gather incoming image info and check image format for compatibility with
     // the target format.
     // This function supports both 24-bit and 32-bit swapchain images.
-    uint32_t const width = imageMap[image1]->imageExtent.width;
-    uint32_t const height = imageMap[image1]->imageExtent.height;
-    VkFormat const format = imageMap[image1]->format;
+    uint32_t const width = imageMapElem->imageExtent.width;
+    uint32_t const height = imageMapElem->imageExtent.height;
+    VkFormat const format = imageMapElem->format;
     uint32_t const numChannels = vkuFormatComponentCount(format);
 
     if ((3 != numChannels) && (4 != numChannels)) {
@@ -739,8 +728,9 @@ static bool writePPM(const char *filename, VkImage image1) {
     VkCommandPoolCreateInfo cmd_pool_info = {};
     cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     cmd_pool_info.pNext = NULL;
-    auto it = deviceMap[device]->queueIndexMap.find(queue);
-    assert(it != deviceMap[device]->queueIndexMap.end());
+    DeviceMapStruct *devMap = get_device_info(device);
+    auto it = devMap->queueIndexMap.find(queue);
+    assert(it != devMap->queueIndexMap.end());
     cmd_pool_info.queueFamilyIndex = it->second;
     cmd_pool_info.flags = 0;
 
@@ -754,14 +744,8 @@ static bool writePPM(const char *filename, VkImage image1) {
     assert(!err);
     if (VK_SUCCESS != err) return false;
 
-    VkDevice cmdBuf = static_cast<VkDevice>(static_cast<void *>(data.commandBuffer));
-    if (deviceMap.find(cmdBuf) != deviceMap.end()) {
-        // Remove element with key cmdBuf from deviceMap so we can replace it
-        deviceMap.erase(cmdBuf);
-    }
-    dispatchMap.emplace(cmdBuf, dispMap);
-    VkuDeviceDispatchTable *pTableCommandBuffer;
-    pTableCommandBuffer = get_dispatch_info(cmdBuf)->device_dispatch_table;
+    // The command buffer shares the dispatch table of its device
+    VkuDeviceDispatchTable *pTableCommandBuffer = dispMap->device_dispatch_table;
 
     // We have just created a dispatchable object, but the dispatch table has
     // not been placed in the object yet.  When a "normal" application creates
@@ -1028,7 +1012,12 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDevice
     assert(chain_info->u.pLayerInfo);
     PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
     PFN_vkGetDeviceProcAddr fpGetDeviceProcAddr = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
-    VkInstance instance = physDeviceMap[gpu]->instance;
+    // The physical device is unknown if the application didn't get it from vkEnumeratePhysicalDevices*
+    PhysDeviceMapStruct *physDeviceMapElem = physDeviceMap.find(gpu);
+    if (physDeviceMapElem == NULL) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    VkInstance instance = physDeviceMapElem->instance;
     PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(instance, "vkCreateDevice");
     if (fpCreateDevice == NULL) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -1042,12 +1031,10 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDevice
         return result;
     }
 
-    assert(deviceMap.find(*pDevice) == deviceMap.end());
-    DeviceMapStruct *deviceMapElem = new DeviceMapStruct;
-    deviceMap[*pDevice] = deviceMapElem;
-    assert(dispatchMap.find(*pDevice) == dispatchMap.end());
-    DispatchMapStruct *dispatchMapElem = new DispatchMapStruct;
-    dispatchMap[*pDevice] = dispatchMapElem;
+    assert(deviceMap.find(*pDevice) == nullptr);
+    DeviceMapStruct *deviceMapElem = deviceMap.emplace(*pDevice);
+    assert(dispatchMap.find(get_dispatch_key(*pDevice)) == nullptr);
+    DispatchMapStruct *dispatchMapElem = dispatchMap.emplace(get_dispatch_key(*pDevice));
 
     // Setup device dispatch table
     dispatchMapElem->device_dispatch_table = new VkuDeviceDispatchTable;
@@ -1076,11 +1063,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
     if (result == VK_SUCCESS && *pPhysicalDeviceCount > 0 && pPhysicalDevices) {
         for (uint32_t i = 0; i < *pPhysicalDeviceCount; i++) {
             // Create a mapping from a physicalDevice to an instance
-            if (physDeviceMap[pPhysicalDevices[i]] == NULL) {
-                PhysDeviceMapStruct *physDeviceMapElem = new PhysDeviceMapStruct;
-                physDeviceMap[pPhysicalDevices[i]] = physDeviceMapElem;
-            }
-            physDeviceMap[pPhysicalDevices[i]]->instance = instance;
+            physDeviceMap.emplace(pPhysicalDevices[i])->instance = instance;
         }
     }
     return result;
@@ -1095,11 +1078,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDeviceGroups(VkInstance instance
         for (uint32_t i = 0; i < *pPhysicalDeviceGroupCount; i++) {
             for (uint32_t j = 0; j < pPhysicalDeviceGroupProperties[i].physicalDeviceCount; j++) {
                 // Create a mapping from each physicalDevice to an instance
-                if (physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]] == NULL) {
-                    PhysDeviceMapStruct *physDeviceMapElem = new PhysDeviceMapStruct;
-                    physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]] = physDeviceMapElem;
-                }
-                physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]]->instance = instance;
+                physDeviceMap.emplace(pPhysicalDeviceGroupProperties[i].physicalDevices[j])->instance = instance;
             }
         }
     }
@@ -1107,6 +1086,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDeviceGroups(VkInstance instance
 }
 
 VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCallbacks *pAllocator) {
+    dispatch_key key = get_dispatch_key(device);
     DispatchMapStruct *dispMap = get_dispatch_info(device);
     DeviceMapStruct *devMap = get_device_info(device);
     assert(dispMap);
@@ -1116,9 +1096,7 @@ VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCall
 
     std::lock_guard<std::mutex> lg(globalLock);
     delete pDisp;
-    delete dispMap;
-    delete devMap;
-
+    dispatchMap.erase(key);
     deviceMap.erase(device);
 }
 
@@ -1132,20 +1110,15 @@ VKAPI_ATTR void VKAPI_CALL GetDeviceQueue(VkDevice device, uint32_t queueFamilyI
     std::lock_guard<std::mutex> lg(globalLock);
 
     // Add this queue to deviceMap[device].queues, and queueFamilyIndex to deviceMap[device].queueIndexMap
-    if (deviceMap.find(device) != deviceMap.end()) {
-        deviceMap[device]->queues.emplace(*pQueue);
+    DeviceMapStruct *devMap = get_device_info(device);
+    if (devMap != NULL) {
+        devMap->queues.emplace(*pQueue);
 
-        if (deviceMap[device]->queueIndexMap.find(*pQueue) != deviceMap[device]->queueIndexMap.end())
-            deviceMap[device]->queueIndexMap.erase(*pQueue);
-        deviceMap[device]->queueIndexMap.emplace(*pQueue, queueFamilyIndex);
+        if (devMap->queueIndexMap.find(*pQueue) != devMap->queueIndexMap.end()) devMap->queueIndexMap.erase(*pQueue);
+        devMap->queueIndexMap.emplace(*pQueue, queueFamilyIndex);
     }
 
-    // queues are dispatchable objects.
-    // Create dispatchMap entry with this queue as its key.
-    // Copy the device dispatch table to the new dispatch table.
-    VkDevice que = static_cast<VkDevice>(static_cast<void *>(*pQueue));
-    if (dispatchMap.find(que) != dispatchMap.end()) dispatchMap.erase(que);
-    dispatchMap.emplace(que, dispMap);
+    // queues are dispatchable objects, they find the dispatch table of the device through its dispatch key
 }
 
 VKAPI_ATTR void VKAPI_CALL GetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2 *pQueueInfo, VkQueue *pQueue) {
@@ -1174,16 +1147,12 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateSwapchainKHR(VkDevice device, const VkSwapc
     if (result == VK_SUCCESS) {
         // Create a mapping for a swapchain to a device, image extent, and
         // format
-        SwapchainMapStruct *swapchainMapElem = new SwapchainMapStruct;
+        // If there's a (destroyed) swapchain with the same handle, remove it from the swapchainMap
+        swapchainMap.erase(*pSwapchain);
+        SwapchainMapStruct *swapchainMapElem = swapchainMap.emplace(*pSwapchain);
         swapchainMapElem->device = device;
         swapchainMapElem->imageExtent = pCreateInfo->imageExtent;
         swapchainMapElem->format = pCreateInfo->imageFormat;
-        // If there's a (destroyed) swapchain with the same handle, remove it from the swapchainMap
-        if (swapchainMap.find(*pSwapchain) != swapchainMap.end()) {
-            delete swapchainMap[*pSwapchain];
-            swapchainMap.erase(*pSwapchain);
-        }
-        swapchainMap.insert(make_pair(*pSwapchain, swapchainMapElem));
 
         // Create a mapping for the swapchain object into the dispatch table
         // TODO is this needed? screenshot_device_table_map.emplace((void
@@ -1207,30 +1176,19 @@ VKAPI_ATTR VkResult VKAPI_CALL GetSwapchainImagesKHR(VkDevice device, VkSwapchai
         return result;
     }
 
-    if (result == VK_SUCCESS && pSwapchainImages && !swapchainMap.empty() && swapchainMap.find(swapchain) != swapchainMap.end()) {
-        unsigned i;
-
-        for (i = 0; i < *pCount; i++) {
+    SwapchainMapStruct *swapchainMapElem = swapchainMap.find(swapchain);
+    if (result == VK_SUCCESS && pSwapchainImages && swapchainMapElem != NULL) {
+        for (uint32_t i = 0; i < *pCount; i++) {
             // Create a mapping for an image to a device, image extent, and
             // format
-            if (imageMap[pSwapchainImages[i]] == NULL) {
-                ImageMapStruct *imageMapElem = new ImageMapStruct;
-                imageMap[pSwapchainImages[i]] = imageMapElem;
-            }
-            imageMap[pSwapchainImages[i]]->device = swapchainMap[swapchain]->device;
-            imageMap[pSwapchainImages[i]]->imageExtent = swapchainMap[swapchain]->imageExtent;
-            imageMap[pSwapchainImages[i]]->format = swapchainMap[swapchain]->format;
+            ImageMapStruct *imageMapElem = imageMap.emplace(pSwapchainImages[i]);
+            imageMapElem->device = swapchainMapElem->device;
+            imageMapElem->imageExtent = swapchainMapElem->imageExtent;
+            imageMapElem->format = swapchainMapElem->format;
         }
 
         // Add list of images to swapchain to image map
-        SwapchainMapStruct *swapchainMapElem = swapchainMap[swapchain];
-        if (i >= 1 && swapchainMapElem) {
-            VkImage *imageList = new VkImage[i];
-            swapchainMapElem->imageList = imageList;
-            for (unsigned j = 0; j < i; j++) {
-                swapchainMapElem->imageList[j] = pSwapchainImages[j];
-            }
-        }
+        swapchainMapElem->imageList.assign(pSwapchainImages, pSwapchainImages + *pCount);
     }
     return result;
 }
@@ -1264,7 +1222,11 @@ VKAPI_ATTR VkResult VKAPI_CALL QueuePresentKHR(VkQueue queue, const VkPresentInf
                 // If there are 0 swapchains, skip taking the snapshot
                 if (pPresentInfo && pPresentInfo->swapchainCount > 0) {
                     swapchain = pPresentInfo->pSwapchains[0];
-                    image = swapchainMap[swapchain]->imageList[pPresentInfo->pImageIndices[0]];
+                    SwapchainMapStruct *swapchainMapElem = swapchainMap.find(swapchain);
+                    image = VK_NULL_HANDLE;
+                    if (swapchainMapElem != NULL && pPresentInfo->pImageIndices[0] < swapchainMapElem->imageList.size()) {
+                        image = swapchainMapElem->imageList[pPresentInfo->pImageIndices[0]];
+                    }
                     if (writePPM(fileName.c_str(), image)) {
 #ifdef ANDROID
                         __android_log_print(ANDROID_LOG_INFO, "screenshot", "Screen capture file is: %s", fileName.c_str());
@@ -1285,18 +1247,6 @@ VKAPI_ATTR VkResult VKAPI_CALL QueuePresentKHR(VkQueue queue, const VkPresentInf
 
                 if (screenshotFrames.empty() && isEndOfScreenShotFrameRange(frameNumber, &screenShotFrameRange)) {
                     // Free all our maps since we are done with them.
-                    for (auto swapchainIter = swapchainMap.begin(); swapchainIter != swapchainMap.end(); swapchainIter++) {
-                        SwapchainMapStruct *swapchainMapElem = swapchainIter->second;
-                        delete swapchainMapElem;
-                    }
-                    for (auto imageIter = imageMap.begin(); imageIter != imageMap.end(); imageIter++) {
-                        ImageMapStruct *imageMapElem = imageIter->second;
-                        delete imageMapElem;
-                    }
-                    for (auto physDeviceIter = physDeviceMap.begin(); physDeviceIter != physDeviceMap.end(); physDeviceIter++) {
-                        PhysDeviceMapStruct *physDeviceMapElem = physDeviceIter->second;
-                        delete physDeviceMapElem;
-                    }
                     swapchainMap.clear();
                     imageMap.clear();
                     physDeviceMap.clear();
@@ -13,18 +13,67 @@
  */
 
 #include "layer_test_helper.h"
+#include "api_dump_json.h"
+#include "vk_layer_table.h"
 
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_beta.h>
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
 
 static const char* kLayerName = "VK_LAYER_LUNARG_api_dump";
 
+// Returns the content of an output file of the tests, empty if there is none
+static std::string ReadOutput(const std::string& filename) {
+    std::ifstream file(std::string(TEST_BINARY_PATH) + "/test/" + filename, std::ios::binary);
+    std::stringstream content;
+    if (file.is_open()) content << file.rdbuf();
+    return content.str();
+}
+
+// Returns the content of the JSON string holding value
+static std::string JsonEscape(const std::string& value) {
+    std::string escaped;
+    api_dump_json_escape(escaped, value.data(), value.size());
+    return escaped;
+}
+
+#if defined(API_DUMP_DIFF_PATH) || defined(API_DUMP_QUERY_PATH)
+// Runs one of the command line tools built with the layer, returns its exit code
+static int RunTool(const char* tool, const std::string& arguments) {
+    std::string command = std::string("\"") + tool + "\"" + arguments;
+#if defined(_WIN32)
+    // cmd.exe removes the first and last quotes of the command
+    command = "\"" + command + "\"";
+    return std::system(command.c_str());
+#else
+    const int status = std::system(command.c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+#endif
+
 class ApiDumpTests : public VkTestFramework {
    public:
     ~ApiDumpTests(){};
@@ -63,3 +112,683 @@ TEST_F(ApiDumpTests, init_layer) {
 
     EXPECT_STREQ(file_start_content_read.c_str(), file_start_content_expected);
 }
+
+#if defined(API_DUMP_FORMAT_BINARY)
+TEST_F(ApiDumpTests, binary_output) {
+    TEST_DESCRIPTION("Test the binary output format writes its file header");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output.bin";
+    const char* output_format = "binary";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format}};
+
+    layer_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.Init(settings);
+    EXPECT_EQ(err, VK_SUCCESS);
+
+    const std::string path = std::string(TEST_BINARY_PATH) + "/test/" + filename_string;
+    FILE* file = fopen(path.c_str(), "rb");
+    ASSERT_TRUE(file != NULL);
+
+    char magic[8] = {};
+    fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    EXPECT_EQ(std::memcmp(magic, "VKAPIDMP", sizeof(magic)), 0);
+}
+#endif
+
+TEST_F(ApiDumpTests, flush_every_frame) {
+    TEST_DESCRIPTION("Test the output flushed at the end of each frame stays buffered while no frame ends");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_every_frame.txt";
+    const char* flush_policy = "every_frame";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "flush_policy", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &flush_policy}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+
+        // Nothing is presented, so vkCreateInstance is still in the buffer
+        EXPECT_TRUE(ReadOutput(filename_string).empty());
+    }
+
+    // The rest is flushed when the layer is unloaded
+    const std::string content = ReadOutput(filename_string);
+    EXPECT_NE(content.find("vkCreateInstance"), std::string::npos);
+    EXPECT_NE(content.find("vkDestroyInstance"), std::string::npos);
+}
+
+TEST_F(ApiDumpTests, flush_on_size) {
+    TEST_DESCRIPTION("Test the output flushed in flush_size chunks is written before the frame ends, and not call by call");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_on_size.txt";
+    const char* flush_policy = "on_size";
+    const uint32_t flush_size = 64;
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "flush_policy", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &flush_policy},
+        {kLayerName, "flush_size", VK_LAYER_SETTING_TYPE_UINT32_EXT, 1, &flush_size}};
+
+    std::string written;
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+        written = ReadOutput(filename_string);
+    }
+    const std::string content = ReadOutput(filename_string);
+
+    // The dump of vkCreateInstance is larger than flush_size, so it is written without waiting for a frame to end, and the
+    // calls after it are still to be written
+    EXPECT_GT(written.size(), flush_size);
+    EXPECT_LT(written.size(), content.size());
+    EXPECT_EQ(content.compare(0, written.size(), written), 0);
+    EXPECT_EQ(written.find("vkDestroyInstance"), std::string::npos);
+    EXPECT_NE(content.find("vkDestroyInstance"), std::string::npos);
+}
+
+#if defined(API_DUMP_FORMAT_NDJSON)
+TEST_F(ApiDumpTests, output_socket_without_reader) {
+    TEST_DESCRIPTION("Test creating an instance streaming ndjson to a socket nobody listens to, the calls are dropped");
+
+    const char* output_format = "ndjson";
+    const char* output_socket = "api_dump_test_no_reader.sock";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format},
+        {kLayerName, "output_socket", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_socket}};
+
+    layer_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.Init(settings);
+    EXPECT_EQ(err, VK_SUCCESS);
+}
+
+#if defined(__linux__)
+TEST_F(ApiDumpTests, output_socket) {
+    TEST_DESCRIPTION("Test the ndjson records streamed to a socket are received whole and in order");
+
+    const std::string socket_path = "/tmp/api_dump_test." + std::to_string(getpid()) + ".sock";
+    unlink(socket_path.c_str());
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    ASSERT_EQ(bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+
+    // Reads everything the layer sends until it closes the connection when it is unloaded
+    std::string received;
+    std::thread reader([&] {
+        const int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) return;
+        char buffer[4096];
+        for (ssize_t size; (size = read(connection, buffer, sizeof(buffer))) > 0;) received.append(buffer, size);
+        close(connection);
+    });
+
+    const char* output_format = "ndjson";
+    const char* output_socket = socket_path.c_str();
+    const char* socket_backpressure = "block";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format},
+        {kLayerName, "output_socket", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_socket},
+        {kLayerName, "socket_backpressure", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &socket_backpressure}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    reader.join();
+    close(listener);
+    unlink(socket_path.c_str());
+
+    std::stringstream records(received);
+    std::string create_record, destroy_record;
+    std::getline(records, create_record);
+    std::getline(records, destroy_record);
+    EXPECT_EQ(create_record.rfind("{\"seq\":0,", 0), 0u);
+    EXPECT_NE(create_record.find("\"name\":\"vkCreateInstance\""), std::string::npos);
+    EXPECT_NE(destroy_record.find("\"name\":\"vkDestroyInstance\""), std::string::npos);
+    EXPECT_EQ(received.back(), '\n');
+}
+#endif
+
+TEST_F(ApiDumpTests, file_per_thread) {
+    TEST_DESCRIPTION("Test each thread writes its calls to its own ndjson file");
+
+    VkBool32 use_file = VK_TRUE;
+    VkBool32 file_per_thread = VK_TRUE;
+    const char* filename_string = "api_dump_output_per_thread.ndjson";
+    const char* output_format = "ndjson";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format},
+        {kLayerName, "file_per_thread", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &file_per_thread}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    std::ifstream file(std::string(TEST_BINARY_PATH) + "/test/" + filename_string + ".0");
+    ASSERT_TRUE(file.is_open());
+
+    // Both calls are made by the main thread, so they are in its file, in order
+    std::string create_record, destroy_record;
+    std::getline(file, create_record);
+    std::getline(file, destroy_record);
+    EXPECT_EQ(create_record.rfind("{\"seq\":0,\"thread\":0,", 0), 0u);
+    EXPECT_NE(create_record.find("\"name\":\"vkCreateInstance\""), std::string::npos);
+    EXPECT_NE(destroy_record.find("\"name\":\"vkDestroyInstance\""), std::string::npos);
+}
+
+TEST_F(ApiDumpTests, ndjson_records) {
+    TEST_DESCRIPTION("Test the ndjson records have the result and the parameters walked down through their structs and arrays");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_records.ndjson";
+    const char* output_format = "ndjson";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    std::stringstream records(ReadOutput(filename_string));
+    std::string create_record, destroy_record;
+    std::getline(records, create_record);
+    std::getline(records, destroy_record);
+
+    EXPECT_EQ(create_record.rfind("{\"seq\":0,\"thread\":0,\"frame\":0,\"name\":\"vkCreateInstance\",\"returnType\":\"VkResult\","
+                                  "\"result\":\"VK_SUCCESS\",\"args\":{\"pCreateInfo\":{"
+                                  "\"sType\":\"VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO\",",
+                                  0),
+              0u);
+#ifdef __APPLE__
+    EXPECT_NE(create_record.find("\"flags\":\"1 (VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR)\""), std::string::npos);
+#else
+    EXPECT_NE(create_record.find("\"flags\":\"0\""), std::string::npos);
+#endif
+    EXPECT_NE(create_record.find("\"apiVersion\":"), std::string::npos);
+    EXPECT_NE(create_record.find("\"enabledLayerCount\":1,\"ppEnabledLayerNames\":[\"VK_LAYER_LUNARG_api_dump\"]"),
+              std::string::npos);
+    EXPECT_NE(create_record.find("\"pAllocator\":null"), std::string::npos);
+
+    EXPECT_EQ(destroy_record.rfind("{\"seq\":1,\"thread\":0,\"frame\":0,\"name\":\"vkDestroyInstance\",\"returnType\":\"void\","
+                                   "\"args\":{\"instance\":",
+                                   0),
+              0u);
+    EXPECT_EQ(destroy_record.substr(destroy_record.size() - 20), ",\"pAllocator\":null}}");
+}
+#endif
+
+TEST_F(ApiDumpTests, html_pages) {
+    TEST_DESCRIPTION("Test the html output written in pages sharing a style sheet, with an index linking to them");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_pages.html";
+    const char* output_format = "html";
+    int32_t frames_per_page = 1;
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format},
+        {kLayerName, "html_frames_per_page", VK_LAYER_SETTING_TYPE_INT32_EXT, 1, &frames_per_page}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    // Nothing is presented, so both calls are on the page of frame 0, linking to the shared style sheet
+    const std::string page = ReadOutput("api_dump_output_pages.frame0.html");
+    EXPECT_EQ(page.rfind("<!doctype html>", 0), 0u);
+    EXPECT_NE(page.find("<link rel='stylesheet' href='api_dump_output_pages.css'>"), std::string::npos);
+    EXPECT_EQ(page.find("<style"), std::string::npos);
+    EXPECT_NE(page.find("vkCreateInstance"), std::string::npos);
+    EXPECT_NE(page.find("vkDestroyInstance"), std::string::npos);
+    EXPECT_FALSE(ReadOutput("api_dump_output_pages.css").empty());
+    EXPECT_TRUE(ReadOutput("api_dump_output_pages.frame1.html").empty());
+
+    // The index has a row for the page, with its number of calls and size, once the page is completed
+    const std::string index = ReadOutput(filename_string);
+    const std::string row = "<tr><td><a href='api_dump_output_pages.frame0.html'>0</a></td><td>2</td><td>" +
+                            std::to_string(page.size()) + "</td></tr>\n";
+    EXPECT_NE(index.find(row), std::string::npos);
+    EXPECT_EQ(index.find("<tr><td>"), index.rfind("<tr><td>"));
+    EXPECT_EQ(index.size() - index.rfind("</table></body></html>\n"), std::strlen("</table></body></html>\n"));
+}
+
+#if defined(API_DUMP_FORMAT_CSV)
+TEST_F(ApiDumpTests, csv_output) {
+    TEST_DESCRIPTION("Test the csv output writes a row per call under its header row, with the parameter columns filled");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output.csv";
+    const char* output_format = "csv";
+    const char* csv_params = "pCreateInfo.enabledLayerCount";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format},
+        {kLayerName, "csv_params", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &csv_params}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    // Splits a row into its fields, quoted fields have their quotes doubled
+    const auto split = [](const std::string& row) {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (quoted && row[i] == '"' && i + 1 < row.size() && row[i + 1] == '"') {
+                fields.back() += row[++i];
+            } else if (row[i] == '"') {
+                quoted = !quoted;
+            } else if (row[i] == ',' && !quoted) {
+                fields.emplace_back();
+            } else {
+                fields.back() += row[i];
+            }
+        }
+        return fields;
+    };
+
+    std::stringstream rows(ReadOutput(filename_string));
+    std::string header, create_row, destroy_row;
+    std::getline(rows, header);
+    std::getline(rows, create_row);
+    std::getline(rows, destroy_row);
+    EXPECT_EQ(header, "seq,thread,frame,time,command,result,duration_ns,pCreateInfo.enabledLayerCount,args");
+
+    // seq, thread, frame, time (empty without timestamps), command, result, duration_ns, enabledLayerCount, args
+    const std::vector<std::string> create = split(create_row);
+    ASSERT_EQ(create.size(), 9u);
+    EXPECT_EQ(create[0], "0");
+    EXPECT_EQ(create[1], "0");
+    EXPECT_EQ(create[2], "0");
+    EXPECT_EQ(create[3], "");
+    EXPECT_EQ(create[4], "vkCreateInstance");
+    EXPECT_EQ(create[5], "VK_SUCCESS");
+    EXPECT_GT(std::stoull(create[6]), 0u);
+    EXPECT_EQ(create[7], "1");
+    EXPECT_NE(create[8].find("pAllocator=null"), std::string::npos);
+
+    // vkDestroyInstance returns nothing and has no pCreateInfo
+    const std::vector<std::string> destroy = split(destroy_row);
+    ASSERT_EQ(destroy.size(), 9u);
+    EXPECT_EQ(destroy[4], "vkDestroyInstance");
+    EXPECT_EQ(destroy[5], "");
+    EXPECT_GT(std::stoull(destroy[6]), 0u);
+    EXPECT_EQ(destroy[7], "");
+}
+#endif
+
+#if defined(API_DUMP_FORMAT_JSON)
+TEST_F(ApiDumpTests, json_output) {
+    TEST_DESCRIPTION("Test the json output writes the result and the parameters of each call as objects nested in the args");
+
+    VkBool32 use_file = VK_TRUE;
+    VkBool32 no_addr = VK_TRUE;
+    const char* filename_string = "api_dump_output.json";
+    const char* output_format = "json";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "no_addr", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &no_addr},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    const std::string content = ReadOutput(filename_string);
+    EXPECT_NE(content.find("            \"returnType\" : \"VkResult\",\n"
+                           "            \"returnValue\" : \"VK_SUCCESS\",\n"
+                           "            \"args\" :\n"
+                           "            [\n"
+                           "                {\n"
+                           "                    \"type\" : \"const VkInstanceCreateInfo*\",\n"
+                           "                    \"name\" : \"pCreateInfo\",\n"
+                           "                    \"address\" : \"address\",\n"
+                           "                    \"members\" :\n"
+                           "                    [\n"
+                           "                        {\n"
+                           "                            \"type\" : \"VkStructureType\",\n"
+                           "                            \"name\" : \"sType\",\n"
+                           "                            \"value\" : \"VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO\"\n"
+                           "                        },\n"),
+              std::string::npos);
+    EXPECT_NE(content.find("                            \"type\" : \"const char* const*\",\n"
+                           "                            \"name\" : \"ppEnabledLayerNames\",\n"
+                           "                            \"address\" : \"address\",\n"
+                           "                            \"elements\" :\n"
+                           "                            [\n"
+                           "                                {\n"
+                           "                                    \"type\" : \"const char* const\",\n"
+                           "                                    \"name\" : \"[0]\",\n"
+                           "                                    \"value\" : \"VK_LAYER_LUNARG_api_dump\"\n"
+                           "                                }\n"
+                           "                            ]\n"),
+              std::string::npos);
+    EXPECT_NE(content.find("                    \"type\" : \"const VkAllocationCallbacks*\",\n"
+                           "                    \"name\" : \"pAllocator\",\n"
+                           "                    \"address\" : \"address\"\n"
+                           "                }"),
+              std::string::npos);
+    EXPECT_NE(content.find("            \"name\" : \"vkDestroyInstance\",\n"), std::string::npos);
+    EXPECT_NE(content.find("            \"returnType\" : \"void\",\n"
+                           "            \"args\" :\n"),
+              std::string::npos);
+}
+#endif
+
+TEST_F(ApiDumpTests, command_range) {
+    TEST_DESCRIPTION("Test selecting the calls to dump by their index among the calls of the command");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_command_range.txt";
+    const char* command_range = "vkCreateInstance:0; vkQueueSubmit:2-8";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "command_range", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &command_range}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    const std::string content = ReadOutput(filename_string);
+
+    // vkDestroyInstance isn't listed, so it isn't dumped
+    EXPECT_NE(content.find("vkCreateInstance"), std::string::npos);
+    EXPECT_EQ(content.find("vkDestroyInstance"), std::string::npos);
+}
+
+TEST_F(ApiDumpTests, call_range) {
+    TEST_DESCRIPTION("Test selecting the calls to dump by their index among all the calls");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_call_range.txt";
+    const char* call_range = "0";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "call_range", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &call_range}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    const std::string content = ReadOutput(filename_string);
+
+    EXPECT_NE(content.find("vkCreateInstance"), std::string::npos);
+    EXPECT_EQ(content.find("vkDestroyInstance"), std::string::npos);
+}
+
+TEST_F(ApiDumpTests, control_file) {
+    TEST_DESCRIPTION("Test the commands of the control file apply from the creation of the instance and the file is consumed");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_control_file.txt";
+    const std::string control_path = std::string(TEST_BINARY_PATH) + "/test/api_dump_control.txt";
+    const char* control_file = control_path.c_str();
+
+    std::ofstream(control_path) << "# Start with capture off\ncapture off\n";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "control_file", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &control_file}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    EXPECT_FALSE(std::ifstream(control_path).is_open());
+    EXPECT_FALSE(std::ifstream(control_path + ".applying").is_open());
+
+    const std::string content = ReadOutput(filename_string);
+    EXPECT_EQ(content.find("vkCreateInstance"), std::string::npos);
+    EXPECT_EQ(content.find("vkDestroyInstance"), std::string::npos);
+}
+
+#if defined(API_DUMP_FORMAT_NDJSON) && defined(API_DUMP_FORMAT_BINARY) && defined(API_DUMP_DIFF_PATH)
+TEST_F(ApiDumpTests, diff_formats) {
+    TEST_DESCRIPTION("Test api_dump_diff finds no difference between the ndjson and binary captures of the same calls");
+
+    VkBool32 use_file = VK_TRUE;
+    const std::string directory = std::string(TEST_BINARY_PATH) + "/test/";
+    const char* formats[] = {"ndjson", "binary"};
+    const char* filenames[] = {"api_dump_output_diff.ndjson", "api_dump_output_diff.bin"};
+
+    for (int i = 0; i < 2; ++i) {
+        const std::vector<VkLayerSettingEXT> settings = {
+            {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+            {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filenames[i]},
+            {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &formats[i]}};
+
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    // Handles and addresses differ between the two runs
+    const std::string captures = " \"" + directory + filenames[0] + "\" \"" + directory + filenames[1] + "\"";
+    EXPECT_EQ(RunTool(API_DUMP_DIFF_PATH, captures), 0);
+    EXPECT_EQ(RunTool(API_DUMP_DIFF_PATH, " --handles ids" + captures), 0);
+}
+#endif
+
+#if defined(API_DUMP_FORMAT_NDJSON) && defined(API_DUMP_QUERY_PATH)
+TEST_F(ApiDumpTests, query_capture) {
+    TEST_DESCRIPTION("Test api_dump_query finds the calls of an ndjson capture by name and by frame");
+
+    VkBool32 use_file = VK_TRUE;
+    const char* filename_string = "api_dump_output_query.ndjson";
+    const char* output_format = "ndjson";
+
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "file", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &use_file},
+        {kLayerName, "log_filename", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &filename_string},
+        {kLayerName, "output_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &output_format}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    // The results are printed to stdout, the statistics to stderr
+    const std::string directory = std::string(TEST_BINARY_PATH) + "/test/";
+    const std::string capture = " \"" + directory + filename_string + "\"";
+    const std::string result = " > \"" + directory + "api_dump_output_query.txt\"";
+
+    ASSERT_EQ(RunTool(API_DUMP_QUERY_PATH, " --reindex --count --name vkCreateInstance" + capture + result), 0);
+    EXPECT_EQ(ReadOutput("api_dump_output_query.txt"), "1\n");
+
+    ASSERT_EQ(RunTool(API_DUMP_QUERY_PATH, " --count --frames 1-5" + capture + result), 0);
+    EXPECT_EQ(ReadOutput("api_dump_output_query.txt"), "0\n");
+
+    // --records prints the records found as they are in the capture
+    ASSERT_EQ(RunTool(API_DUMP_QUERY_PATH, " --records --name vkDestroyInstance" + capture + result), 0);
+    const std::string records = ReadOutput("api_dump_output_query.txt");
+    const std::string content = ReadOutput(filename_string);
+    const size_t name = content.find("\"name\":\"vkDestroyInstance\"");
+    ASSERT_NE(name, std::string::npos);
+    const size_t record = content.rfind('\n', name) + 1;
+    EXPECT_EQ(records, content.substr(record, content.find('\n', name) + 1 - record));
+}
+#endif
+
+TEST_F(ApiDumpTests, json_escape) {
+    TEST_DESCRIPTION("Test the JSON strings escape quotes, backslashes and control characters, and copy the other ASCII bytes");
+
+    EXPECT_EQ(JsonEscape(""), "");
+    EXPECT_EQ(JsonEscape("VK_LAYER_LUNARG_api_dump"), "VK_LAYER_LUNARG_api_dump");
+    EXPECT_EQ(JsonEscape("\"quoted\" C:\\path"), "\\\"quoted\\\" C:\\\\path");
+    EXPECT_EQ(JsonEscape("\b\f\n\r\t"), "\\b\\f\\n\\r\\t");
+    EXPECT_EQ(JsonEscape(std::string("\x00\x01\x1f", 3)), "\\u0000\\u0001\\u001f");
+    EXPECT_EQ(JsonEscape(" ~\x7f"), " ~\x7f");
+}
+
+TEST_F(ApiDumpTests, json_escape_utf8) {
+    TEST_DESCRIPTION("Test the JSON strings copy valid UTF-8 and replace each byte of malformed UTF-8 with U+FFFD");
+
+    // 2, 3 and 4 byte sequences, up to U+10FFFF
+    const std::string valid = "\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf";
+    EXPECT_EQ(JsonEscape(valid), valid);
+
+    // Truncated sequences, at the end of the string and before an ASCII byte
+    EXPECT_EQ(JsonEscape("\xe2\x82"), "\\ufffd\\ufffd");
+    EXPECT_EQ(JsonEscape("\xf0\x9f\x98" "a"), "\\ufffd\\ufffd\\ufffda");
+
+    // Stray continuation byte and lead bytes that are never valid
+    EXPECT_EQ(JsonEscape("\x80"), "\\ufffd");
+    EXPECT_EQ(JsonEscape("\xf5\x80\x80\x80"), "\\ufffd\\ufffd\\ufffd\\ufffd");
+
+    // Overlong encodings of '/'
+    EXPECT_EQ(JsonEscape("\xc0\xaf"), "\\ufffd\\ufffd");
+    EXPECT_EQ(JsonEscape("\xe0\x80\xaf"), "\\ufffd\\ufffd\\ufffd");
+    EXPECT_EQ(JsonEscape("\xf0\x80\x80\xaf"), "\\ufffd\\ufffd\\ufffd\\ufffd");
+
+    // Surrogates U+D800 and U+DFFF, and U+110000
+    EXPECT_EQ(JsonEscape("\xed\xa0\x80"), "\\ufffd\\ufffd\\ufffd");
+    EXPECT_EQ(JsonEscape("\xed\xbf\xbf"), "\\ufffd\\ufffd\\ufffd");
+    EXPECT_EQ(JsonEscape("\xf4\x90\x80\x80"), "\\ufffd\\ufffd\\ufffd\\ufffd");
+}
+
+TEST_F(ApiDumpTests, json_escape_block_boundaries) {
+    TEST_DESCRIPTION("Test the JSON strings are escaped the same wherever the special bytes are in the 16 byte blocks");
+
+    // The strings are long enough to be scanned by blocks of 16 bytes, then byte by byte for what is left
+    for (size_t length = 15; length <= 49; length++) {
+        for (size_t position = 0; position < length; position++) {
+            const std::string before(position, 'a');
+            const std::string after(length - position - 1, 'b');
+            EXPECT_EQ(JsonEscape(before + '\n' + after), before + "\\n" + after) << length << " " << position;
+            EXPECT_EQ(JsonEscape(before + '"' + after), before + "\\\"" + after) << length << " " << position;
+            EXPECT_EQ(JsonEscape(before + '\x1f' + after), before + "\\u001f" + after) << length << " " << position;
+
+            // UTF-8 sequences straddling the end of a block are copied whole, or replaced when they are cut by the string end
+            const std::string euro = "\xe2\x82\xac";
+            if (position + euro.size() <= length) {
+                const std::string tail(length - position - euro.size(), 'b');
+                EXPECT_EQ(JsonEscape(before + euro + tail), before + euro + tail) << length << " " << position;
+            } else {
+                const std::string cut = euro.substr(0, length - position);
+                EXPECT_EQ(JsonEscape(before + cut), before + (cut.size() == 1 ? "\\ufffd" : "\\ufffd\\ufffd"))
+                    << length << " " << position;
+            }
+        }
+    }
+}
+
+TEST_F(ApiDumpTests, dispatch_table_map_concurrent_lookups) {
+    TEST_DESCRIPTION("Test the dispatch table lookups always find the live tables while other threads add and remove tables");
+
+    struct Table {
+        int id;
+    };
+    static Table tables[512];
+    // Dispatch keys point to loader dispatch tables, so they are aligned like them
+    alignas(16) static char keys[512][16];
+    const int kLiveCount = 50;
+
+    dispatch_table_map<Table> map;
+    for (int k = 0; k < kLiveCount; k++) map.insert(keys[k], &tables[k]);
+
+    // The readers look up the tables that stay live, as the calls on the other devices do
+    std::atomic<bool> done{false};
+    std::atomic<int> misses{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                for (int k = 0; k < kLiveCount; k++) {
+                    if (map.find(keys[k]) != &tables[k]) misses++;
+                }
+            }
+        });
+    }
+
+    // Meanwhile the other tables are added and removed in a random order, and the map is compared with a reference
+    std::mt19937 random(1);
+    std::map<int, bool> reference;
+    int mismatches = 0;
+    for (int op = 0; op < 100000; op++) {
+        const int k = kLiveCount + static_cast<int>(random() % 400);
+        if (reference[k]) {
+            if (map.erase(keys[k]) != &tables[k]) mismatches++;
+        } else {
+            if (map.insert(keys[k], &tables[k]) != &tables[k]) mismatches++;
+        }
+        reference[k] = !reference[k];
+        if (op % 1000 == 0) {
+            for (const auto& entry : reference) {
+                if ((map.find(keys[entry.first]) != nullptr) != entry.second) mismatches++;
+            }
+        }
+    }
+    done = true;
+    for (std::thread& reader : readers) reader.join();
+
+    EXPECT_EQ(misses.load(), 0);
+    EXPECT_EQ(mismatches, 0);
+
+    // Once every table is removed, the keys can be used again for new tables
+    for (int k = 0; k < kLiveCount; k++) EXPECT_EQ(map.erase(keys[k]), &tables[k]);
+    for (const auto& entry : reference) {
+        if (entry.second) {
+            EXPECT_EQ(map.erase(keys[entry.first]), &tables[entry.first]);
+        }
+    }
+    EXPECT_EQ(map.find(keys[0]), nullptr);
+    EXPECT_EQ(map.insert(keys[0], &tables[1]), &tables[1]);
+    EXPECT_EQ(map.insert(keys[0], &tables[2]), &tables[1]);
+    EXPECT_EQ(map.find(keys[0]), &tables[1]);
+}
@@ -17,11 +17,71 @@
 
 #include <gtest/gtest.h>
 #include "layer_test_helper.h"
+#include "monitor_frame_log.h"
+#include "monitor_frame_stats.h"
+#include "monitor_memory.h"
+#include "monitor_telemetry.h"
+#include "monitor_workload.h"
 
+#include <atomic>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 static const char* kLayerName = "VK_LAYER_LUNARG_monitor";
 
+#if defined(__linux__)
+// Maps the telemetry segment of the process read only, as the readers do, returns nullptr if there is none
+static const monitor::telemetry_layout* MapTelemetry() {
+    const int fd = shm_open(monitor::telemetry_segment_name(getpid()).c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    void* memory = mmap(nullptr, sizeof(monitor::telemetry_layout), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? nullptr : static_cast<const monitor::telemetry_layout*>(memory);
+}
+#endif
+
+// Creates a device with a queue of the first physical device, returns VK_NULL_HANDLE if there is no physical device
+static VkDevice CreateDevice(VkInstance instance) {
+    uint32_t gpu_count = 1;
+    VkPhysicalDevice gpu = VK_NULL_HANDLE;
+    const VkResult result = vkEnumeratePhysicalDevices(instance, &gpu_count, &gpu);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || gpu_count == 0) return VK_NULL_HANDLE;
+
+    const float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+    VkDeviceCreateInfo device_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+
+    VkDevice device = VK_NULL_HANDLE;
+    if (vkCreateDevice(gpu, &device_info, nullptr, &device) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return device;
+}
+
+// Presents a frame after each of the frame times, in milliseconds, the first present only starts the timing
+static void PresentFrames(monitor::frame_times& times, const std::vector<int>& frame_ms) {
+    monitor::frame_clock::time_point now{};
+    times.present(now);
+    for (int ms : frame_ms) {
+        now += std::chrono::milliseconds(ms);
+        times.present(now);
+    }
+}
+
 class MonitorTests : public VkTestFramework {
    public:
     ~MonitorTests(){};
@@ -37,3 +97,485 @@ TEST_F(MonitorTests, init_layer) {
     VkResult err = inst_builder.Init(kLayerName);
     EXPECT_EQ(err, VK_SUCCESS);
 }
+
+TEST_F(MonitorTests, report_setting) {
+    TEST_DESCRIPTION("Test the report of a device is printed when the device is destroyed, only with the report setting");
+
+    const VkBool32 report = VK_TRUE;
+    const std::vector<VkLayerSettingEXT> settings = {{kLayerName, "report", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &report}};
+
+    layer_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.Init(settings);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkDevice device = CreateDevice(inst_builder.GetInstance());
+    if (device == VK_NULL_HANDLE) GTEST_SKIP() << "No physical device to create a device with";
+
+    testing::internal::CaptureStdout();
+    vkDestroyDevice(device, nullptr);
+    const std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output.rfind("Monitor layer report for device ", 0), 0u);
+    EXPECT_NE(output.find("Time blocked over "), std::string::npos);
+    EXPECT_NE(output.find("  vkDeviceWaitIdle "), std::string::npos);
+    EXPECT_NE(output.find("  on the swapchain "), std::string::npos);
+}
+
+TEST_F(MonitorTests, report_setting_off) {
+    TEST_DESCRIPTION("Test nothing is printed when a device is destroyed without the report setting");
+
+    layer_test::VulkanInstanceBuilder inst_builder;
+    VkResult err = inst_builder.Init(kLayerName);
+    ASSERT_EQ(err, VK_SUCCESS);
+
+    VkDevice device = CreateDevice(inst_builder.GetInstance());
+    if (device == VK_NULL_HANDLE) GTEST_SKIP() << "No physical device to create a device with";
+
+    testing::internal::CaptureStdout();
+    vkDestroyDevice(device, nullptr);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+}
+
+TEST_F(MonitorTests, frame_log) {
+    TEST_DESCRIPTION("Test the frame log is created with its header, without any frame presented");
+
+    const char* log_file = "monitor_frame_log.csv";
+    const char* log_format = "csv";
+    const std::vector<VkLayerSettingEXT> settings = {{kLayerName, "log_file", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &log_file},
+                                                     {kLayerName, "log_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &log_format}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    const std::string path = std::string(TEST_BINARY_PATH) + "/test/" + log_file;
+    std::ifstream log(path);
+    ASSERT_TRUE(log.is_open());
+    std::string header;
+    std::getline(log, header);
+    EXPECT_EQ(header,
+              "frame,present_ns,delta_ns,queue,swapchain,submits,command_buffers,draws,dispatches,descriptor_updates,"
+              "blocked_gpu_ns,blocked_swapchain_ns");
+}
+
+TEST_F(MonitorTests, frame_log_binary) {
+    TEST_DESCRIPTION("Test the binary frame log starts with its header");
+
+    const char* log_file = "monitor_frame_log.bin";
+    const char* log_format = "binary";
+    const std::vector<VkLayerSettingEXT> settings = {{kLayerName, "log_file", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &log_file},
+                                                     {kLayerName, "log_format", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &log_format}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    std::ifstream log(std::string(TEST_BINARY_PATH) + "/test/" + log_file, std::ios::binary);
+    ASSERT_TRUE(log.is_open());
+    monitor::frame_log_header header{};
+    log.read(reinterpret_cast<char*>(&header), sizeof(header));
+    EXPECT_EQ(std::memcmp(header.magic, "VKMONFT", sizeof(header.magic)), 0);
+    EXPECT_EQ(header.version, 1u);
+    EXPECT_EQ(header.record_size, 96u);
+
+    // No frame was presented
+    EXPECT_EQ(log.peek(), std::ifstream::traits_type::eof());
+}
+
+TEST_F(MonitorTests, memory_log) {
+    TEST_DESCRIPTION("Test the memory log is created next to the frame log when the memory budget is sampled");
+
+    const char* log_file = "monitor_memory_budget.csv";
+    const uint32_t memory_budget_interval = 60;
+    const std::vector<VkLayerSettingEXT> settings = {
+        {kLayerName, "log_file", VK_LAYER_SETTING_TYPE_STRING_EXT, 1, &log_file},
+        {kLayerName, "memory_budget_interval", VK_LAYER_SETTING_TYPE_UINT32_EXT, 1, &memory_budget_interval}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+    }
+
+    std::ifstream log(std::string(TEST_BINARY_PATH) + "/test/monitor_memory_budget.memory.csv");
+    ASSERT_TRUE(log.is_open());
+    std::string header;
+    std::getline(log, header);
+    EXPECT_EQ(header, "present,present_ns,device,heap,device_local,budget,usage");
+}
+
+#if defined(__linux__)
+TEST_F(MonitorTests, telemetry) {
+    TEST_DESCRIPTION("Test the telemetry shared memory segment exists from the first instance to the last one");
+
+    const VkBool32 telemetry = VK_TRUE;
+    const std::vector<VkLayerSettingEXT> settings = {{kLayerName, "telemetry", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &telemetry}};
+
+    {
+        layer_test::VulkanInstanceBuilder inst_builder;
+        VkResult err = inst_builder.Init(settings);
+        EXPECT_EQ(err, VK_SUCCESS);
+
+        const monitor::telemetry_layout* layout = MapTelemetry();
+        ASSERT_TRUE(layout != nullptr);
+        EXPECT_STREQ(layout->magic, "VKMONTM");
+        EXPECT_EQ(layout->version, monitor::kTelemetryVersion);
+        EXPECT_EQ(layout->slot_count, monitor::kTelemetryMaxSwapchains);
+        EXPECT_EQ(layout->process_id, static_cast<uint64_t>(getpid()));
+
+        // No swapchain was created
+        for (const monitor::telemetry_slot& slot : layout->slots) {
+            monitor::telemetry_swapchain swapchain;
+            ASSERT_TRUE(monitor::telemetry_read(slot, swapchain));
+            EXPECT_EQ(swapchain.in_use, 0u);
+        }
+        munmap(const_cast<monitor::telemetry_layout*>(layout), sizeof(monitor::telemetry_layout));
+    }
+    EXPECT_TRUE(MapTelemetry() == nullptr);
+}
+
+TEST_F(MonitorTests, telemetry_segment_slots) {
+    TEST_DESCRIPTION("Test the telemetry segment hands out its slots to the swapchains and publishes their statistics");
+
+    monitor::telemetry_segment segment;
+    EXPECT_EQ(segment.claim(0x10, 0x20), -1);
+    ASSERT_TRUE(segment.open());
+    const monitor::telemetry_layout* layout = MapTelemetry();
+    ASSERT_TRUE(layout != nullptr);
+
+    EXPECT_EQ(segment.claim(0x10, 0x20), 0);
+    EXPECT_EQ(segment.claim(0x10, 0x21), 1);
+    monitor::telemetry_swapchain swapchain;
+    ASSERT_TRUE(monitor::telemetry_read(layout->slots[1], swapchain));
+    EXPECT_EQ(swapchain.in_use, 1u);
+    EXPECT_EQ(swapchain.device, 0x10u);
+    EXPECT_EQ(swapchain.swapchain, 0x21u);
+    EXPECT_EQ(swapchain.total_frames, 0u);
+
+    monitor::telemetry_swapchain published = swapchain;
+    published.total_frames = 600;
+    published.average_fps = 60.0;
+    published.p99_ms = 17.5;
+    segment.publish(1, published);
+    ASSERT_TRUE(monitor::telemetry_read(layout->slots[1], swapchain));
+    EXPECT_EQ(swapchain.total_frames, 600u);
+    EXPECT_EQ(swapchain.average_fps, 60.0);
+    EXPECT_EQ(swapchain.p99_ms, 17.5);
+
+    // A released slot is unused and goes to the next swapchain
+    segment.release(0);
+    ASSERT_TRUE(monitor::telemetry_read(layout->slots[0], swapchain));
+    EXPECT_EQ(swapchain.in_use, 0u);
+    EXPECT_EQ(segment.claim(0x10, 0x22), 0);
+    for (uint32_t i = 2; i < monitor::kTelemetryMaxSwapchains; i++) EXPECT_EQ(segment.claim(0x10, 0x30 + i), static_cast<int>(i));
+    EXPECT_EQ(segment.claim(0x10, 0x40), -1);
+
+    munmap(const_cast<monitor::telemetry_layout*>(layout), sizeof(monitor::telemetry_layout));
+    segment.close();
+    EXPECT_TRUE(MapTelemetry() == nullptr);
+}
+#endif
+
+TEST_F(MonitorTests, workload_collect) {
+    TEST_DESCRIPTION("Test the workload of a frame sums the blocks of all the threads, counted since the previous frame");
+
+    monitor::workload_counters counters;
+    monitor::workload_counters::thread_block* block = counters.block_of_this_thread();
+    EXPECT_EQ(counters.block_of_this_thread(), block);
+
+    monitor::workload_counters::add(*block, monitor::kWorkloadDraws, 3);
+    monitor::workload_counters::add(*block, monitor::kWorkloadDraws, 2);
+    monitor::workload_counters::add_blocked(*block, monitor::kBlockingWaitForFences, 1000);
+    std::thread([&counters] {
+        monitor::workload_counters::thread_block* other = counters.block_of_this_thread();
+        monitor::workload_counters::add(*other, monitor::kWorkloadDraws, 10);
+        monitor::workload_counters::add(*other, monitor::kWorkloadSubmits, 1);
+        monitor::workload_counters::add_blocked(*other, monitor::kBlockingPresent, 500);
+    }).join();
+
+    const monitor::frame_workload first = counters.collect();
+    EXPECT_EQ(first.counts[monitor::kWorkloadDraws], 15u);
+    EXPECT_EQ(first.counts[monitor::kWorkloadSubmits], 1u);
+    EXPECT_EQ(first.counts[monitor::kWorkloadDispatches], 0u);
+    EXPECT_EQ(monitor::blocked_on_gpu(first.blocked_ns), 1000u);
+    EXPECT_EQ(monitor::blocked_on_swapchain(first.blocked_ns), 500u);
+
+    // The next frame only has what was counted after the first one was collected
+    monitor::workload_counters::add(*block, monitor::kWorkloadDraws, 4);
+    const monitor::frame_workload second = counters.collect();
+    EXPECT_EQ(second.counts[monitor::kWorkloadDraws], 4u);
+    EXPECT_EQ(second.counts[monitor::kWorkloadSubmits], 0u);
+    EXPECT_EQ(monitor::blocked_on_gpu(second.blocked_ns), 0u);
+
+    const monitor::frame_workload empty = counters.collect();
+    EXPECT_EQ(empty.counts[monitor::kWorkloadDraws], 0u);
+}
+
+TEST_F(MonitorTests, frame_times_percentiles) {
+    TEST_DESCRIPTION("Test the frame time percentiles are the nearest-rank ones");
+
+    monitor::frame_times times;
+    EXPECT_EQ(times.compute().frame_count, 0u);
+
+    // 1 to 100 ms
+    std::vector<int> frame_ms;
+    for (int ms = 1; ms <= 100; ms++) frame_ms.push_back(ms);
+    PresentFrames(times, frame_ms);
+    monitor::frame_statistics stats = times.compute();
+    EXPECT_EQ(times.total_frames(), 100u);
+    EXPECT_EQ(stats.frame_count, 100u);
+    EXPECT_DOUBLE_EQ(stats.average_fps, 1000.0 * 100 / 5050);
+    EXPECT_DOUBLE_EQ(stats.p50_ms, 50.0);
+    EXPECT_DOUBLE_EQ(stats.p95_ms, 95.0);
+    EXPECT_DOUBLE_EQ(stats.p99_ms, 99.0);
+
+    // The rank is rounded up: the 95th percentile of 12 frames is the 12th, 95% of them being 11.4 frames
+    monitor::frame_times twelve;
+    PresentFrames(twelve, {12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1});
+    stats = twelve.compute();
+    EXPECT_DOUBLE_EQ(stats.p50_ms, 6.0);
+    EXPECT_DOUBLE_EQ(stats.p95_ms, 12.0);
+    EXPECT_DOUBLE_EQ(stats.p99_ms, 12.0);
+
+    // The first present only starts the timing, and a single frame is every percentile
+    monitor::frame_times single;
+    EXPECT_FALSE(single.present(monitor::frame_clock::time_point{}));
+    EXPECT_TRUE(single.present(monitor::frame_clock::time_point{} + std::chrono::milliseconds(16)));
+    stats = single.compute();
+    EXPECT_DOUBLE_EQ(stats.p50_ms, 16.0);
+    EXPECT_DOUBLE_EQ(stats.p99_ms, 16.0);
+}
+
+TEST_F(MonitorTests, frame_times_lows_and_stutters) {
+    TEST_DESCRIPTION("Test the 1% and 0.1% lows, the stutters and the histogram of the frame times");
+
+    // 995 frames of 10 ms, 4 of 20 ms and 1 of 50 ms
+    std::vector<int> frame_ms(995, 10);
+    frame_ms.insert(frame_ms.end(), {20, 20, 20, 20, 50});
+    monitor::frame_times times;
+    PresentFrames(times, frame_ms);
+    monitor::frame_statistics stats = times.compute();
+    EXPECT_EQ(stats.frame_count, 1000u);
+
+    // The slowest 10 frames take 180 ms, the slowest one 50 ms
+    EXPECT_DOUBLE_EQ(stats.low_1_percent_fps, 1000.0 * 10 / 180);
+    EXPECT_DOUBLE_EQ(stats.low_0_1_percent_fps, 20.0);
+
+    // Frames over twice the 10 ms median
+    EXPECT_EQ(stats.stutter_count, 1u);
+
+    EXPECT_EQ(stats.histogram[0], 0u);    // <= 4.17 ms
+    EXPECT_EQ(stats.histogram[2], 995u);  // <= 11.11 ms
+    EXPECT_EQ(stats.histogram[4], 4u);    // <= 33.33 ms
+    EXPECT_EQ(stats.histogram[5], 1u);    // <= 50 ms
+    EXPECT_EQ(stats.histogram.back(), 0u);
+
+    // Only the newest frames that cover the last 100 ms: the 50 ms frame and three 20 ms ones
+    stats = times.compute(std::chrono::milliseconds(100));
+    EXPECT_EQ(stats.frame_count, 4u);
+    EXPECT_DOUBLE_EQ(stats.p50_ms, 20.0);
+    EXPECT_EQ(stats.stutter_count, 1u);
+
+    // The ring keeps the last frames only
+    monitor::frame_times full;
+    std::vector<int> many(monitor::frame_times::kCapacity, 5);
+    many.insert(many.end(), 10, 40);
+    PresentFrames(full, many);
+    stats = full.compute();
+    EXPECT_EQ(full.total_frames(), monitor::frame_times::kCapacity + 10);
+    EXPECT_EQ(stats.frame_count, monitor::frame_times::kCapacity);
+    EXPECT_EQ(stats.stutter_count, 10u);
+}
+
+TEST_F(MonitorTests, frame_log_csv_records) {
+    TEST_DESCRIPTION("Test the frame log writes a csv line per record, in the order they were recorded");
+
+    const std::string path = std::string(TEST_BINARY_PATH) + "/test/monitor_frame_log_records.csv";
+    monitor::frame_log log;
+    ASSERT_TRUE(log.open(path, monitor::frame_log_format::csv, false));
+    EXPECT_TRUE(log.is_open());
+    EXPECT_FALSE(log.has_memory_log());
+    log.record(monitor::frame_record{0, 1000, 0, 0x10, 0x20, {1, 2, 3, 4, 5}, 6, 7});
+    log.record(monitor::frame_record{1, 17000, 16000, 0x10, 0x20, {1, 1, 120, 0, 8}, 2000, 300});
+    log.close();
+    EXPECT_FALSE(log.is_open());
+
+    std::ifstream file(path);
+    std::string header, first, second, end;
+    std::getline(file, header);
+    std::getline(file, first);
+    std::getline(file, second);
+    EXPECT_EQ(first, "0,1000,0,0x10,0x20,1,2,3,4,5,6,7");
+    EXPECT_EQ(second, "1,17000,16000,0x10,0x20,1,1,120,0,8,2000,300");
+    EXPECT_FALSE(std::getline(file, end));
+}
+
+TEST_F(MonitorTests, frame_log_binary_records) {
+    TEST_DESCRIPTION("Test the binary frame and memory logs have their header followed by the records as they are in memory");
+
+    const std::string path = std::string(TEST_BINARY_PATH) + "/test/monitor_frame_log_records.bin";
+    EXPECT_EQ(monitor::memory_log_path(path), std::string(TEST_BINARY_PATH) + "/test/monitor_frame_log_records.memory.bin");
+
+    const monitor::frame_record frame = {3, 50000, 16000, 0x10, 0x20, {1, 2, 3, 4, 5}, 6, 7};
+    const monitor::memory_record memory = {3, 50000, 0x30, 1, 1, 1ull << 32, 1ull << 30};
+    monitor::frame_log log;
+    ASSERT_TRUE(log.open(path, monitor::frame_log_format::binary, true));
+    EXPECT_TRUE(log.has_memory_log());
+    log.record(frame);
+    log.record(memory);
+    log.close();
+
+    std::ifstream file(path, std::ios::binary);
+    monitor::frame_log_header header{};
+    monitor::frame_record read_frame{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&read_frame), sizeof(read_frame));
+    EXPECT_EQ(std::memcmp(header.magic, "VKMONFT", sizeof(header.magic)), 0);
+    EXPECT_EQ(header.version, monitor::kFrameLogVersion);
+    EXPECT_EQ(header.record_size, sizeof(monitor::frame_record));
+    EXPECT_EQ(std::memcmp(&read_frame, &frame, sizeof(frame)), 0);
+    EXPECT_EQ(file.peek(), std::ifstream::traits_type::eof());
+
+    std::ifstream memory_file(monitor::memory_log_path(path), std::ios::binary);
+    monitor::memory_record read_memory{};
+    memory_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    memory_file.read(reinterpret_cast<char*>(&read_memory), sizeof(read_memory));
+    EXPECT_EQ(std::memcmp(header.magic, "VKMONMB", sizeof(header.magic)), 0);
+    EXPECT_EQ(header.version, monitor::kMemoryLogVersion);
+    EXPECT_EQ(header.record_size, 48u);
+    EXPECT_EQ(std::memcmp(&read_memory, &memory, sizeof(memory)), 0);
+    EXPECT_EQ(memory_file.peek(), std::ifstream::traits_type::eof());
+}
+
+TEST_F(MonitorTests, memory_log_path) {
+    TEST_DESCRIPTION("Test the memory log is named after the frame log, with .memory before the extension");
+
+    EXPECT_EQ(monitor::memory_log_path("frames.csv"), "frames.memory.csv");
+    EXPECT_EQ(monitor::memory_log_path("logs/frames"), "logs/frames.memory");
+    EXPECT_EQ(monitor::memory_log_path("logs.d/frames"), "logs.d/frames.memory");
+    EXPECT_EQ(monitor::memory_log_path("logs/.frames"), "logs/.frames.memory");
+}
+
+TEST_F(MonitorTests, memory_trend) {
+    TEST_DESCRIPTION("Test the memory report has the first, last and peak usage of each heap over the samples");
+
+    monitor::memory_trend trend;
+    EXPECT_EQ(monitor::format_memory_report(trend), "");
+
+    const uint64_t MB = 1024 * 1024;
+    monitor::memory_sample sample;
+    sample.heap_count = 2;
+    sample.heaps[0] = {8192 * MB, 1024 * MB, true};
+    sample.heaps[1] = {4096 * MB, 64 * MB, false};
+    trend.add(sample);
+    sample.heaps[0].usage = 3072 * MB;
+    trend.add(sample);
+    sample.heaps[0].usage = 2048 * MB;
+    sample.heaps[1].usage = 32 * MB;
+    trend.add(sample);
+
+    EXPECT_EQ(trend.sample_count(), 3u);
+    EXPECT_EQ(trend.first_sample().heaps[0].usage, 1024 * MB);
+    EXPECT_EQ(trend.last_sample().heaps[0].usage, 2048 * MB);
+    EXPECT_EQ(trend.peak_usage(0), 3072 * MB);
+    EXPECT_EQ(trend.peak_usage(1), 64 * MB);
+
+    const std::string report = monitor::format_memory_report(trend);
+    EXPECT_EQ(report.rfind("Memory heap usage over 3 samples, in MB:\n", 0), 0u);
+    EXPECT_NE(report.find("heap  0 (device local) first     1024.0   last     2048.0 (+1024.0)   peak     3072.0"),
+              std::string::npos);
+    EXPECT_NE(report.find("budget     8192.0\n"), std::string::npos);
+    EXPECT_NE(report.find("first       64.0   last       32.0 (-32.0)   peak       64.0   budget     4096.0"), std::string::npos);
+
+    // The title bar only shows the device local heaps, and nothing without a budget
+    EXPECT_EQ(monitor::format_title_memory(sample), "   VRAM = 2048 / 8192 MB");
+    EXPECT_EQ(monitor::format_title_memory(monitor::memory_sample{}), "");
+}
+
+TEST_F(MonitorTests, memory_log_records) {
+    TEST_DESCRIPTION("Test the memory log writes a csv line per heap sample, and nothing when the log has no memory log");
+
+    const std::string path = std::string(TEST_BINARY_PATH) + "/test/monitor_memory_records.csv";
+    monitor::frame_log log;
+    ASSERT_TRUE(log.open(path, monitor::frame_log_format::csv, true));
+    log.record(monitor::memory_record{60, 1000000, 0x30, 0, 1, 8589934592, 1073741824});
+    log.record(monitor::memory_record{60, 1000000, 0x30, 1, 0, 4294967296, 67108864});
+    log.close();
+
+    std::ifstream file(monitor::memory_log_path(path));
+    std::string header, first, second, end;
+    std::getline(file, header);
+    std::getline(file, first);
+    std::getline(file, second);
+    EXPECT_EQ(header, "present,present_ns,device,heap,device_local,budget,usage");
+    EXPECT_EQ(first, "60,1000000,0x30,0,1,8589934592,1073741824");
+    EXPECT_EQ(second, "60,1000000,0x30,1,0,4294967296,67108864");
+    EXPECT_FALSE(std::getline(file, end));
+
+    // Without a memory log, the memory records are ignored
+    const std::string frames_only = std::string(TEST_BINARY_PATH) + "/test/monitor_frames_only.csv";
+    std::remove(monitor::memory_log_path(frames_only).c_str());
+    ASSERT_TRUE(log.open(frames_only, monitor::frame_log_format::csv, false));
+    log.record(monitor::memory_record{0, 0, 0x30, 0, 1, 1, 1});
+    log.close();
+    EXPECT_FALSE(std::ifstream(monitor::memory_log_path(frames_only)).is_open());
+}
+
+TEST_F(MonitorTests, telemetry_read) {
+    TEST_DESCRIPTION("Test a telemetry slot is only read while the layer isn't writing it");
+
+    monitor::telemetry_slot slot{};
+    monitor::telemetry_swapchain written{};
+    written.in_use = 1;
+    written.total_frames = 42;
+    written.p50_ms = 16.6;
+    monitor::telemetry_write(slot, written);
+    EXPECT_EQ(slot.sequence.load(), 2u);
+
+    monitor::telemetry_swapchain read{};
+    ASSERT_TRUE(monitor::telemetry_read(slot, read));
+    EXPECT_EQ(std::memcmp(&read, &written, sizeof(read)), 0);
+
+    // An odd sequence is a write in progress
+    slot.sequence.store(3);
+    EXPECT_FALSE(monitor::telemetry_read(slot, read));
+    slot.sequence.store(4);
+    EXPECT_TRUE(monitor::telemetry_read(slot, read));
+}
+
+TEST_F(MonitorTests, telemetry_read_while_written) {
+    TEST_DESCRIPTION("Test a telemetry slot read while another thread writes it is never a mix of two writes");
+
+    // Every field of a write has the same value, so a torn read has fields that differ
+    monitor::telemetry_slot slot{};
+    std::atomic<bool> done{false};
+    std::thread writer([&slot, &done] {
+        for (uint64_t value = 1; !done.load(std::memory_order_relaxed); value++) {
+            monitor::telemetry_swapchain swapchain{};
+            swapchain.device = value;
+            swapchain.swapchain = value;
+            swapchain.total_frames = value;
+            swapchain.update_ns = value;
+            swapchain.average_fps = static_cast<double>(value);
+            swapchain.p99_ms = static_cast<double>(value);
+            monitor::telemetry_write(slot, swapchain);
+        }
+    });
+
+    uint32_t torn = 0;
+    for (int i = 0; i < 100000; i++) {
+        monitor::telemetry_swapchain swapchain;
+        if (!monitor::telemetry_read(slot, swapchain)) continue;
+        const uint64_t value = swapchain.device;
+        if (swapchain.swapchain != value || swapchain.total_frames != value || swapchain.update_ns != value ||
+            swapchain.average_fps != static_cast<double>(value) || swapchain.p99_ms != static_cast<double>(value)) {
+            torn++;
+        }
+    }
+    done = true;
+    writer.join();
+    EXPECT_EQ(torn, 0u);
+}
@@ -0,0 +1,1080 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares two api_dump captures of the same content, for example before and after a driver or engine update.
+//
+// The captures can be json, ndjson or binary files, in any combination. They are read one frame at a time by a thread each,
+// and the frames with the same number are compared by a pool of threads: the calls are aligned by name with the Myers
+// difference algorithm, then the parameters of the aligned calls are compared. Only a few frames are in memory at any
+// time, whatever the size of the captures.
+//
+// Addresses and handle values change from one run to the next, so they are only compared as null or not null. With
+// --handles ids, they are replaced by the order in which the capture first used them, which finds calls using a
+// different object while ignoring where the driver allocated it. The json and ndjson output write both as hexadecimal
+// strings, so the binary output compares handles and addresses the same way, and bitmasks as the json formats write them,
+// for a capture to compare equal to itself whatever its format.
+
+#include "api_dump_records.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <before> <after>\n"
+            "Compares two api_dump captures frame by frame, reporting the calls removed, inserted and changed.\n"
+            "The captures can be json, ndjson or binary files.\n"
+            "\n"
+            "Options:\n"
+            "  --handles ignore|ids  Compare handles and addresses as null or not null (default), or by the order they were\n"
+            "                        first used in\n"
+            "  --ignore <parameter>  Don't compare the parameter, or member, with this name, for example pUserData\n"
+            "  --threads <n>         Number of threads comparing frames, the number of cores by default\n"
+            "  --output <file>       Write the report to <file> instead of stdout\n"
+            "\n"
+            "Exits with 0 when the captures are the same, 1 when they differ and 2 on error.\n",
+            program);
+}
+
+enum class HandleMode { Ignore, Ids };
+
+struct Options {
+    std::string before;
+    std::string after;
+    std::string output;
+    HandleMode handles = HandleMode::Ignore;
+    std::vector<std::string> ignored;
+    unsigned threads = 0;
+};
+
+//=================================== Calls ===================================//
+
+// A parameter, struct member or array element, flattened to its path: pCreateInfo.pQueueCreateInfos[0].queueCount
+struct DiffValue {
+    std::string path;
+    std::string value;
+};
+
+struct DiffCall {
+    std::string name;
+    bool has_sequence = false;
+    uint64_t sequence = 0;
+    std::vector<DiffValue> values;
+};
+
+struct DiffFrame {
+    uint64_t number = 0;
+    std::vector<DiffCall> calls;
+};
+
+// Turns the values of a capture into comparable text. Each capture has its own, handle ids are numbered per capture.
+class ValueNormalizer {
+   public:
+    ValueNormalizer(const Options &options) : handles(options.handles), ignored(options.ignored) {}
+
+    bool isIgnored(const std::string &path) const {
+        for (const std::string &name : ignored) {
+            // Matches the name as the whole path, or as its last component
+            if (path.size() < name.size() || path.compare(path.size() - name.size(), name.size(), name) != 0) continue;
+            if (path.size() == name.size() || path[path.size() - name.size() - 1] == '.') return true;
+        }
+        return false;
+    }
+
+    void add(DiffCall &call, const std::string &path, std::string value) const {
+        if (!isIgnored(path)) call.values.push_back({path, std::move(value)});
+    }
+
+    // A handle or an address
+    std::string handle(uint64_t value) {
+        if (value == 0) return "null";
+        if (handles == HandleMode::Ignore) return "not null";
+        auto inserted = handle_ids.emplace(value, handle_ids.size() + 1);
+        return "#" + std::to_string(inserted.first->second);
+    }
+
+    // "3 (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)", as written by the json and ndjson output
+    static std::string flags(uint64_t value, const std::string &names) {
+        return names.empty() ? std::to_string(value) : std::to_string(value) + " (" + names + ")";
+    }
+
+    // The text formats don't tell handles from addresses, both are written as hexadecimal strings, or "address" when
+    // show_address is off
+    std::string text(const std::string &value) {
+        if (value == "address") return "not null";
+        if (value == "NULL" || value == "0x0") return "null";
+        if (value.size() < 3 || value[0] != '0' || value[1] != 'x') return value;
+        if (value.find_first_not_of("0123456789abcdefABCDEF", 2) != std::string::npos) return value;
+        return handle(strtoull(value.c_str() + 2, nullptr, 16));
+    }
+
+   private:
+    const HandleMode handles;
+    const std::vector<std::string> &ignored;
+    std::unordered_map<uint64_t, uint64_t> handle_ids;
+};
+
+//==================================== JSON ====================================//
+
+// Just enough JSON to read the records of the json and ndjson output. Arrays are objects with empty member names.
+struct JsonValue {
+    enum class Kind { Null, Bool, Number, String, Object, Array };
+    Kind kind = Kind::Null;
+    std::string text;  // Scalars
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue *find(const char *key) const {
+        for (const auto &member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+    bool isContainer() const { return kind == Kind::Object || kind == Kind::Array; }
+};
+
+class JsonParser {
+   public:
+    JsonParser(const char *data, size_t size) : position(data), end(data + size) {}
+
+    bool parse(JsonValue &value) {
+        skipSpace();
+        if (position == end) return false;
+        switch (*position) {
+            case '{':
+                return parseContainer(value, JsonValue::Kind::Object, '}');
+            case '[':
+                return parseContainer(value, JsonValue::Kind::Array, ']');
+            case '"':
+                value.kind = JsonValue::Kind::String;
+                return parseString(value.text);
+            default:
+                break;
+        }
+        const char *start = position;
+        while (position < end && (isalnum(static_cast<unsigned char>(*position)) || *position == '+' || *position == '-' ||
+                                  *position == '.')) {
+            position++;
+        }
+        value.text.assign(start, position);
+        if (value.text == "null") {
+            value.kind = JsonValue::Kind::Null;
+        } else if (value.text == "true" || value.text == "false") {
+            value.kind = JsonValue::Kind::Bool;
+        } else {
+            value.kind = JsonValue::Kind::Number;
+        }
+        return !value.text.empty();
+    }
+
+   private:
+    bool parseContainer(JsonValue &value, JsonValue::Kind kind, char close) {
+        value.kind = kind;
+        position++;
+        skipSpace();
+        if (position < end && *position == close) {
+            position++;
+            return true;
+        }
+        for (;;) {
+            value.members.emplace_back();
+            auto &member = value.members.back();
+            if (kind == JsonValue::Kind::Object) {
+                skipSpace();
+                if (position == end || *position != '"' || !parseString(member.first)) return false;
+                skipSpace();
+                if (position == end || *position++ != ':') return false;
+            }
+            if (!parse(member.second)) return false;
+            skipSpace();
+            if (position == end) return false;
+            const char separator = *position++;
+            if (separator == close) return true;
+            if (separator != ',') return false;
+        }
+    }
+
+    bool parseString(std::string &text) {
+        position++;
+        while (position < end && *position != '"') {
+            if (*position != '\\') {
+                text += *position++;
+                continue;
+            }
+            if (++position == end) return false;
+            const char escaped = *position++;
+            switch (escaped) {
+                case 'b':
+                    text += '\b';
+                    break;
+                case 'f':
+                    text += '\f';
+                    break;
+                case 'n':
+                    text += '\n';
+                    break;
+                case 'r':
+                    text += '\r';
+                    break;
+                case 't':
+                    text += '\t';
+                    break;
+                case 'u': {
+                    if (end - position < 4) return false;
+                    const unsigned code = static_cast<unsigned>(strtoul(std::string(position, 4).c_str(), nullptr, 16));
+                    position += 4;
+                    appendUtf8(text, code);
+                    break;
+                }
+                default:
+                    text += escaped;
+                    break;
+            }
+        }
+        if (position == end) return false;
+        position++;
+        return true;
+    }
+
+    static void appendUtf8(std::string &text, unsigned code) {
+        if (code < 0x80) {
+            text += static_cast<char>(code);
+        } else if (code < 0x800) {
+            text += static_cast<char>(0xC0 | (code >> 6));
+            text += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            text += static_cast<char>(0xE0 | (code >> 12));
+            text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    void skipSpace() {
+        while (position < end && isspace(static_cast<unsigned char>(*position))) position++;
+    }
+
+    const char *position;
+    const char *end;
+};
+
+//================================== Captures ==================================//
+
+// Reads a capture one frame at a time
+class Capture {
+   public:
+    explicit Capture(const Options &options) : normalizer(options) {}
+    virtual ~Capture() = default;
+
+    // Returns false at the end of the capture or on error
+    virtual bool nextFrame(DiffFrame &frame) = 0;
+
+    const std::string &getError() const { return error; }
+
+   protected:
+    bool fail(const std::string &message) {
+        if (error.empty()) error = message;
+        return false;
+    }
+
+    ValueNormalizer normalizer;
+    std::string error;
+};
+
+// The ndjson and binary output, a record per call. The frames are the runs of calls with the same frame number; calls of
+// another thread still numbered with the previous frame stay in the current one.
+class RecordCapture final : public Capture {
+   public:
+    RecordCapture(const std::string &path, const Options &options) : Capture(options), reader(path, pool) {
+        if (!reader.getError().empty()) fail(reader.getError());
+    }
+
+    bool nextFrame(DiffFrame &frame) override {
+        if (!error.empty()) return false;
+        if (!has_pending && !readRecord()) return false;
+
+        frame.number = pending.frame;
+        frame.calls.clear();
+        do {
+            if (pending.is_call) {
+                frame.calls.emplace_back();
+                if (!decode(pending, frame.calls.back())) return false;
+            }
+            if (!readRecord()) return error.empty();
+        } while (pending.frame <= frame.number);
+        return true;
+    }
+
+   private:
+    bool readRecord() {
+        has_pending = reader.next(pending);
+        if (!has_pending && !reader.getError().empty()) fail(reader.getError());
+        return has_pending;
+    }
+
+    bool decode(const ApiDumpRecord &record, DiffCall &call) {
+        call.has_sequence = record.has_sequence;
+        call.sequence = record.sequence;
+        if (!reader.isBinary()) {
+            return decodeNdjson(record, call) || fail(reader.getPath() + ": invalid ndjson record in frame " +
+                                                       std::to_string(record.frame));
+        }
+        BinaryDecoder decoder(record, pool, normalizer, call);
+        return decoder.decode() || fail(reader.getPath() + ": invalid binary record in frame " + std::to_string(record.frame));
+    }
+
+    bool decodeNdjson(const ApiDumpRecord &record, DiffCall &call) {
+        JsonValue object;
+        JsonParser parser(record.bytes.data(), record.bytes.size());
+        if (!parser.parse(object) || object.kind != JsonValue::Kind::Object) return false;
+        const JsonValue *name = object.find("name");
+        if (name == nullptr) return false;
+        call.name = name->text;
+        if (const JsonValue *result = object.find("result")) flatten(call, "result", *result);
+        if (const JsonValue *args = object.find("args")) {
+            for (const auto &arg : args->members) flatten(call, arg.first, arg.second);
+        }
+        return true;
+    }
+
+    void flatten(DiffCall &call, const std::string &path, const JsonValue &value) {
+        if (normalizer.isIgnored(path)) return;
+        if (!value.isContainer()) {
+            normalizer.add(call, path, value.kind == JsonValue::Kind::String ? normalizer.text(value.text) : value.text);
+            return;
+        }
+        for (size_t i = 0; i < value.members.size(); i++) {
+            const auto &member = value.members[i];
+            flatten(call, value.kind == JsonValue::Kind::Array ? path + "[" + std::to_string(i) + "]" : path + "." + member.first,
+                    member.second);
+        }
+    }
+
+    // Walks a binary record as written by the binary emitter, the interned strings having been replaced by pool ids
+    class BinaryDecoder {
+       public:
+        BinaryDecoder(const ApiDumpRecord &record, const ApiDumpStringPool &pool, ValueNormalizer &normalizer, DiffCall &call)
+            : record(record), pool(pool), normalizer(normalizer), call(call) {}
+
+        bool decode() {
+            // Tag, sequence, thread, frame, timestamp
+            position = 1 + 4 * sizeof(uint64_t);
+            call.name = string();
+            string();  // Return type
+            while (valid && position < record.bytes.size()) {
+                const ApiDumpBinaryTag tag = static_cast<ApiDumpBinaryTag>(read<uint8_t>());
+                if (tag == ApiDumpBinaryTag::End) return valid;
+                if (tag == ApiDumpBinaryTag::Params) {
+                    values("");
+                    continue;
+                }
+                value(tag, "");
+            }
+            return false;
+        }
+
+       private:
+        // Values until the End tag closing the scope
+        void values(const std::string &parent) {
+            for (uint64_t index = 0; valid && position < record.bytes.size(); index++) {
+                const ApiDumpBinaryTag tag = static_cast<ApiDumpBinaryTag>(read<uint8_t>());
+                if (tag == ApiDumpBinaryTag::End) return;
+                value(tag, parent, index);
+            }
+            valid = false;
+        }
+
+        void value(ApiDumpBinaryTag tag, const std::string &parent, uint64_t index = 0) {
+            const std::string name = string();
+            string();  // Type
+            std::string path;
+            if (name.empty()) {
+                path = parent + "[" + std::to_string(index) + "]";
+            } else {
+                path = parent.empty() ? name : parent + "." + name;
+            }
+
+            switch (tag) {
+                case ApiDumpBinaryTag::Null:
+                    normalizer.add(call, path, "null");
+                    break;
+                case ApiDumpBinaryTag::Signed:
+                    normalizer.add(call, path, std::to_string(read<int64_t>()));
+                    break;
+                case ApiDumpBinaryTag::Unsigned:
+                    normalizer.add(call, path, std::to_string(read<uint64_t>()));
+                    break;
+                case ApiDumpBinaryTag::Float: {
+                    char text[32];
+                    snprintf(text, sizeof(text), "%.9g", read<double>());
+                    normalizer.add(call, path, text);
+                    break;
+                }
+                case ApiDumpBinaryTag::Bool:
+                    normalizer.add(call, path, read<uint8_t>() ? "true" : "false");
+                    break;
+                case ApiDumpBinaryTag::String: {
+                    const uint32_t length = read<uint32_t>();
+                    if (record.bytes.size() - position < length) {
+                        valid = false;
+                        return;
+                    }
+                    normalizer.add(call, path, record.bytes.substr(position, length));
+                    position += length;
+                    break;
+                }
+                case ApiDumpBinaryTag::Enum: {
+                    const int64_t number = read<int64_t>();
+                    const std::string enumerant = string();
+                    normalizer.add(call, path, enumerant.empty() ? std::to_string(number) : enumerant);
+                    break;
+                }
+                case ApiDumpBinaryTag::Flags: {
+                    const uint64_t number = read<uint64_t>();
+                    const std::string names = string();
+                    normalizer.add(call, path, ValueNormalizer::flags(number, names));
+                    break;
+                }
+                case ApiDumpBinaryTag::Handle:
+                    normalizer.add(call, path, normalizer.handle(read<uint64_t>()));
+                    break;
+                case ApiDumpBinaryTag::Address:
+                    normalizer.add(call, path, normalizer.handle(read<uint64_t>()));
+                    break;
+                case ApiDumpBinaryTag::Struct:
+                    read<uint64_t>();
+                    scope(path);
+                    break;
+                case ApiDumpBinaryTag::Array:
+                    read<uint64_t>();
+                    read<uint64_t>();
+                    scope(path);
+                    break;
+                default:
+                    valid = false;
+                    break;
+            }
+        }
+
+        // Ignored members are still walked, their values aren't kept
+        void scope(const std::string &path) {
+            if (!normalizer.isIgnored(path)) {
+                values(path);
+                return;
+            }
+            const size_t count = call.values.size();
+            values(path);
+            call.values.resize(count);
+        }
+
+        template <typename T>
+        T read() {
+            T value{};
+            if (record.bytes.size() - position < sizeof(T)) {
+                valid = false;
+                position = record.bytes.size();
+                return value;
+            }
+            memcpy(&value, record.bytes.data() + position, sizeof(T));
+            position += sizeof(T);
+            return value;
+        }
+
+        // The strings were removed from the bytes by the reader, they are taken in the order they were read
+        std::string string() {
+            if (next_string >= record.strings.size() || record.strings[next_string].first != position) {
+                valid = false;
+                return std::string();
+            }
+            const uint32_t id = record.strings[next_string++].second;
+            return id == UINT32_MAX ? std::string() : pool.get(id);
+        }
+
+        const ApiDumpRecord &record;
+        const ApiDumpStringPool &pool;
+        ValueNormalizer &normalizer;
+        DiffCall &call;
+        size_t position = 0;
+        size_t next_string = 0;
+        bool valid = true;
+    };
+
+    ApiDumpStringPool pool;
+    ApiDumpRecordReader reader;
+    ApiDumpRecord pending;
+    bool has_pending = false;
+};
+
+// The json output: an array of frames, {"frameNumber":"0","apiCalls":[...]}, each read and parsed on its own. A capture
+// cut short by a crash ends at its last complete frame.
+class JsonCapture final : public Capture {
+   public:
+    JsonCapture(const std::string &path, const Options &options) : Capture(options), path(path), buffer(1 << 20) {
+        file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        file.open(path, std::ios_base::in | std::ios_base::binary);
+        if (!file.is_open()) {
+            fail("can't open " + path);
+            return;
+        }
+        file >> std::ws;
+        if (file.get() != '[') fail(path + ": not a json capture");
+    }
+
+    bool nextFrame(DiffFrame &frame) override {
+        if (!error.empty() || !readElement()) return false;
+
+        JsonValue object;
+        JsonParser parser(element.data(), element.size());
+        if (!parser.parse(object) || object.kind != JsonValue::Kind::Object) return fail(path + ": invalid frame");
+
+        const JsonValue *number = object.find("frameNumber");
+        frame.number = number ? strtoull(number->text.c_str(), nullptr, 10) : frame_index;
+        frame_index++;
+        frame.calls.clear();
+        const JsonValue *calls = object.find("apiCalls");
+        if (calls == nullptr) return true;
+        for (const auto &entry : calls->members) {
+            const JsonValue *name = entry.second.find("name");
+            if (name == nullptr) continue;  // Call counts of statistics mode
+            frame.calls.emplace_back();
+            DiffCall &call = frame.calls.back();
+            call.name = name->text;
+            if (const JsonValue *result = entry.second.find("returnValue")) flattenResult(call, *result);
+            if (const JsonValue *args = entry.second.find("args")) {
+                for (const auto &arg : args->members) flatten(call, "", arg.second);
+            }
+        }
+        return true;
+    }
+
+   private:
+    // Copies the next element of the top level array, without parsing it
+    bool readElement() {
+        element.clear();
+        file >> std::ws;
+        int c = file.get();
+        if (c == ',') {
+            file >> std::ws;
+            c = file.get();
+        }
+        if (c != '{') return false;  // End of the array, or of a truncated capture
+
+        element.push_back('{');
+        int depth = 1;
+        bool in_string = false;
+        while (depth > 0) {
+            c = file.get();
+            if (c == std::char_traits<char>::eof()) return false;
+            element.push_back(static_cast<char>(c));
+            if (in_string) {
+                if (c == '\\') {
+                    c = file.get();
+                    if (c == std::char_traits<char>::eof()) return false;
+                    element.push_back(static_cast<char>(c));
+                } else if (c == '"') {
+                    in_string = false;
+                }
+            } else if (c == '"') {
+                in_string = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            }
+        }
+        return true;
+    }
+
+    void flattenResult(DiffCall &call, const JsonValue &result) {
+        if (result.isContainer()) {
+            flatten(call, "", result);
+        } else {
+            normalizer.add(call, "result", normalizer.text(result.text));
+        }
+    }
+
+    // A value is {"type":...,"name":...,"address":...} followed by its "value", "members" or "elements". The address of
+    // pointers is only kept when the value is missing, for null pointers and empty arrays.
+    void flatten(DiffCall &call, const std::string &parent, const JsonValue &node) {
+        const JsonValue *name = node.find("name");
+        std::string path = name ? name->text : std::string();
+        if (!parent.empty()) path = !path.empty() && path[0] == '[' ? parent + path : parent + "." + path;
+        if (normalizer.isIgnored(path)) return;
+
+        if (const JsonValue *value = node.find("value")) {
+            normalizer.add(call, path, value->isContainer() ? std::string() : normalizer.text(value->text));
+        } else if (const JsonValue *members = node.find("members")) {
+            for (const auto &member : members->members) flatten(call, path, member.second);
+        } else if (const JsonValue *elements = node.find("elements")) {
+            for (const auto &element : elements->members) flatten(call, path, element.second);
+        } else if (const JsonValue *address = node.find("address")) {
+            normalizer.add(call, path, normalizer.text(address->text));
+        }
+    }
+
+    const std::string path;
+    std::vector<char> buffer;  // Declared before file so that it outlives it
+    std::ifstream file;
+    std::string element;
+    uint64_t frame_index = 0;
+};
+
+std::unique_ptr<Capture> OpenCapture(const std::string &path, const Options &options) {
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    file >> std::ws;
+    if (file.peek() == '[') return std::make_unique<JsonCapture>(path, options);
+    return std::make_unique<RecordCapture>(path, options);
+}
+
+//================================ Frame Diff =================================//
+
+enum class EditOp { Equal, Remove, Insert };
+
+struct Edit {
+    EditOp op;
+    size_t before;  // Index in the frame of the capture the call comes from, both for Equal
+    size_t after;
+};
+
+// Shortest edit script between two sequences, with the linear space variant of the Myers algorithm: the middle of the
+// path is found by searching from both ends, then both halves are solved recursively.
+class SequenceDiff {
+   public:
+    SequenceDiff(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) : a(a), b(b) {}
+
+    std::vector<Edit> run() {
+        diff(0, a.size(), 0, b.size());
+        return std::move(edits);
+    }
+
+   private:
+    void diff(size_t a_begin, size_t a_end, size_t b_begin, size_t b_end) {
+        // The common prefix and suffix are matched directly, they are most of the frame when the captures are similar
+        size_t prefix = 0;
+        while (a_begin + prefix < a_end && b_begin + prefix < b_end && a[a_begin + prefix] == b[b_begin + prefix]) prefix++;
+        for (size_t i = 0; i < prefix; i++) edits.push_back({EditOp::Equal, a_begin + i, b_begin + i});
+        a_begin += prefix;
+        b_begin += prefix;
+        size_t suffix = 0;
+        while (a_end - suffix > a_begin && b_end - suffix > b_begin && a[a_end - suffix - 1] == b[b_end - suffix - 1]) suffix++;
+        a_end -= suffix;
+        b_end -= suffix;
+
+        if (a_begin == a_end) {
+            for (size_t j = b_begin; j < b_end; j++) edits.push_back({EditOp::Insert, a_begin, j});
+        } else if (b_begin == b_end) {
+            for (size_t i = a_begin; i < a_end; i++) edits.push_back({EditOp::Remove, i, b_begin});
+        } else {
+            bisect(a_begin, a_end, b_begin, b_end);
+        }
+
+        for (size_t i = 0; i < suffix; i++) edits.push_back({EditOp::Equal, a_end + i, b_end + i});
+    }
+
+    void bisect(size_t a_begin, size_t a_end, size_t b_begin, size_t b_end) {
+        const int64_t n = static_cast<int64_t>(a_end - a_begin);
+        const int64_t m = static_cast<int64_t>(b_end - b_begin);
+        const int64_t max_d = (n + m + 1) / 2;
+        const int64_t offset = max_d + 1;
+        const int64_t length = 2 * max_d + 3;
+        std::vector<int64_t> forward(length, -1), backward(length, -1);
+        forward[offset + 1] = 0;
+        backward[offset + 1] = 0;
+        const int64_t delta = n - m;
+        // With an odd delta the paths overlap while extending the forward one, with an even delta the backward one
+        const bool front = (delta & 1) != 0;
+        int64_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+        for (int64_t d = 0; d < max_d; d++) {
+            for (int64_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                const int64_t k1_offset = offset + k1;
+                int64_t x1 = (k1 == -d || (k1 != d && forward[k1_offset - 1] < forward[k1_offset + 1]))
+                                 ? forward[k1_offset + 1]
+                                 : forward[k1_offset - 1] + 1;
+                int64_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a[a_begin + x1] == b[b_begin + y1]) {
+                    x1++;
+                    y1++;
+                }
+                forward[k1_offset] = x1;
+                if (x1 > n) {
+                    k1_end += 2;
+                } else if (y1 > m) {
+                    k1_start += 2;
+                } else if (front) {
+                    const int64_t k2_offset = offset + delta - k1;
+                    if (k2_offset >= 0 && k2_offset < length && backward[k2_offset] != -1 && x1 >= n - backward[k2_offset]) {
+                        split(a_begin, a_end, b_begin, b_end, x1, y1);
+                        return;
+                    }
+                }
+            }
+            for (int64_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                const int64_t k2_offset = offset + k2;
+                int64_t x2 = (k2 == -d || (k2 != d && backward[k2_offset - 1] < backward[k2_offset + 1]))
+                                 ? backward[k2_offset + 1]
+                                 : backward[k2_offset - 1] + 1;
+                int64_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && a[a_end - x2 - 1] == b[b_end - y2 - 1]) {
+                    x2++;
+                    y2++;
+                }
+                backward[k2_offset] = x2;
+                if (x2 > n) {
+                    k2_end += 2;
+                } else if (y2 > m) {
+                    k2_start += 2;
+                } else if (!front) {
+                    const int64_t k1_offset = offset + delta - k2;
+                    if (k1_offset >= 0 && k1_offset < length && forward[k1_offset] != -1) {
+                        const int64_t x1 = forward[k1_offset];
+                        const int64_t y1 = offset + x1 - k1_offset;
+                        if (x1 >= n - x2) {
+                            split(a_begin, a_end, b_begin, b_end, x1, y1);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Nothing in common
+        for (size_t i = a_begin; i < a_end; i++) edits.push_back({EditOp::Remove, i, b_begin});
+        for (size_t j = b_begin; j < b_end; j++) edits.push_back({EditOp::Insert, a_end, j});
+    }
+
+    void split(size_t a_begin, size_t a_end, size_t b_begin, size_t b_end, int64_t x, int64_t y) {
+        diff(a_begin, a_begin + static_cast<size_t>(x), b_begin, b_begin + static_cast<size_t>(y));
+        diff(a_begin + static_cast<size_t>(x), a_end, b_begin + static_cast<size_t>(y), b_end);
+    }
+
+    const std::vector<uint32_t> &a;
+    const std::vector<uint32_t> &b;
+    std::vector<Edit> edits;
+};
+
+struct DiffTotals {
+    uint64_t frames = 0;
+    uint64_t different_frames = 0;
+    uint64_t removed = 0;
+    uint64_t inserted = 0;
+    uint64_t changed = 0;
+
+    void add(const DiffTotals &other) {
+        frames += other.frames;
+        different_frames += other.different_frames;
+        removed += other.removed;
+        inserted += other.inserted;
+        changed += other.changed;
+    }
+};
+
+struct DiffResult {
+    DiffTotals totals;
+    std::string report;
+};
+
+std::string CallPosition(const DiffCall &call, size_t index) {
+    std::string text = "call " + std::to_string(index);
+    if (call.has_sequence) text += ", seq " + std::to_string(call.sequence);
+    return text;
+}
+
+// Appends the parameter differences of two calls with the same name to the report, returns false if there are none
+bool DiffValues(const DiffCall &before, const DiffCall &after, std::string &report) {
+    bool different = false;
+    auto line = [&](const std::string &path, const std::string &text) {
+        report += "      " + path + ": " + text + "\n";
+        different = true;
+    };
+
+    // The values of a call almost always have the same paths, in the same order
+    const bool same_paths = before.values.size() == after.values.size() &&
+                            std::equal(before.values.begin(), before.values.end(), after.values.begin(),
+                                       [](const DiffValue &x, const DiffValue &y) { return x.path == y.path; });
+    if (same_paths) {
+        for (size_t i = 0; i < before.values.size(); i++) {
+            if (before.values[i].value != after.values[i].value) {
+                line(before.values[i].path, before.values[i].value + " -> " + after.values[i].value);
+            }
+        }
+        return different;
+    }
+
+    std::unordered_map<std::string, const DiffValue *> after_values;
+    for (const DiffValue &value : after.values) after_values.emplace(value.path, &value);
+    for (const DiffValue &value : before.values) {
+        auto found = after_values.find(value.path);
+        if (found == after_values.end()) {
+            line(value.path, value.value + " -> (none)");
+            continue;
+        }
+        if (found->second->value != value.value) line(value.path, value.value + " -> " + found->second->value);
+        after_values.erase(found);
+    }
+    for (const DiffValue &value : after.values) {
+        if (after_values.count(value.path)) line(value.path, "(none) -> " + value.value);
+    }
+    return different;
+}
+
+DiffResult DiffFrames(uint64_t number, const DiffFrame &before, const DiffFrame &after) {
+    // Calls are aligned by name, numbered for quicker comparisons
+    std::unordered_map<std::string, uint32_t> names;
+    std::vector<uint32_t> a, b;
+    a.reserve(before.calls.size());
+    b.reserve(after.calls.size());
+    for (const DiffCall &call : before.calls) a.push_back(names.emplace(call.name, static_cast<uint32_t>(names.size())).first->second);
+    for (const DiffCall &call : after.calls) b.push_back(names.emplace(call.name, static_cast<uint32_t>(names.size())).first->second);
+
+    DiffResult result;
+    result.totals.frames = 1;
+    std::string calls;
+    for (const Edit &edit : SequenceDiff(a, b).run()) {
+        if (edit.op == EditOp::Remove) {
+            const DiffCall &call = before.calls[edit.before];
+            calls += "  - " + call.name + " [" + CallPosition(call, edit.before) + "]\n";
+            result.totals.removed++;
+        } else if (edit.op == EditOp::Insert) {
+            const DiffCall &call = after.calls[edit.after];
+            calls += "  + " + call.name + " [" + CallPosition(call, edit.after) + "]\n";
+            result.totals.inserted++;
+        } else {
+            const DiffCall &before_call = before.calls[edit.before];
+            const DiffCall &after_call = after.calls[edit.after];
+            std::string values;
+            if (!DiffValues(before_call, after_call, values)) continue;
+            calls += "  ~ " + before_call.name + " [" + CallPosition(before_call, edit.before) + " -> " +
+                     CallPosition(after_call, edit.after) + "]\n" + values;
+            result.totals.changed++;
+        }
+    }
+
+    if (!calls.empty()) {
+        result.totals.different_frames = 1;
+        result.report = "frame " + std::to_string(number) + ": " + std::to_string(result.totals.removed) + " removed, " +
+                        std::to_string(result.totals.inserted) + " inserted, " + std::to_string(result.totals.changed) +
+                        " changed\n" + calls;
+    }
+    return result;
+}
+
+//================================== Threads ==================================//
+
+// Reads the frames of a capture on its own thread, so parsing both captures and comparing frames overlap
+class FrameReader {
+   public:
+    FrameReader(std::unique_ptr<Capture> capture, size_t queue_size) : capture(std::move(capture)), frames(queue_size) {
+        thread = std::thread([this] {
+            for (;;) {
+                auto frame = std::make_unique<DiffFrame>();
+                if (!this->capture->nextFrame(*frame) || !frames.push(std::move(frame))) break;
+            }
+            frames.close();
+        });
+    }
+    ~FrameReader() {
+        frames.close();
+        thread.join();
+    }
+
+    // Returns nullptr at the end of the capture
+    std::unique_ptr<DiffFrame> next() {
+        std::unique_ptr<DiffFrame> frame;
+        frames.pop(frame);
+        return frame;
+    }
+
+    // Valid once next() returned nullptr
+    const std::string &getError() const { return capture->getError(); }
+
+   private:
+    std::unique_ptr<Capture> capture;
+    ApiDumpQueue<std::unique_ptr<DiffFrame>> frames;
+    std::thread thread;
+};
+
+struct DiffJob {
+    uint64_t index = 0;
+    uint64_t number = 0;
+    std::unique_ptr<DiffFrame> before;  // nullptr when the frame is only in one of the captures
+    std::unique_ptr<DiffFrame> after;
+};
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--handles" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "ignore") {
+                options.handles = HandleMode::Ignore;
+            } else if (mode == "ids") {
+                options.handles = HandleMode::Ids;
+            } else {
+                return false;
+            }
+        } else if (arg == "--ignore" && i + 1 < argc) {
+            options.ignored.push_back(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.before.empty()) {
+            options.before = arg;
+        } else if (!arg.empty() && arg[0] != '-' && options.after.empty()) {
+            options.after = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.after.empty();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    if (options.threads == 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::ofstream output_file;
+    if (!options.output.empty()) {
+        output_file.open(options.output, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        if (!output_file.is_open()) {
+            fprintf(stderr, "api_dump_diff: can't open %s\n", options.output.c_str());
+            return 2;
+        }
+    }
+    std::ostream &output = options.output.empty() ? std::cout : output_file;
+
+    std::unique_ptr<Capture> captures[2] = {OpenCapture(options.before, options), OpenCapture(options.after, options)};
+    for (const auto &capture : captures) {
+        if (!capture->getError().empty()) {
+            fprintf(stderr, "api_dump_diff: %s\n", capture->getError().c_str());
+            return 2;
+        }
+    }
+    output << "--- " << options.before << "\n+++ " << options.after << "\n";
+
+    // At most this many frames are being compared or waiting to be reported, the readers hold a few more
+    const size_t max_pending = 2 * options.threads;
+    FrameReader before(std::move(captures[0]), options.threads);
+    FrameReader after(std::move(captures[1]), options.threads);
+
+    std::mutex results_mutex;
+    std::condition_variable result_ready;
+    std::map<uint64_t, DiffResult> results;
+    ApiDumpQueue<DiffJob> jobs(max_pending);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < options.threads; i++) {
+        workers.emplace_back([&] {
+            DiffJob job;
+            while (jobs.pop(job)) {
+                const DiffFrame empty;
+                DiffResult result = DiffFrames(job.number, job.before ? *job.before : empty, job.after ? *job.after : empty);
+                job.before.reset();
+                job.after.reset();
+                std::lock_guard<std::mutex> lock(results_mutex);
+                results.emplace(job.index, std::move(result));
+                result_ready.notify_one();
+            }
+        });
+    }
+
+    // Reports the frames in order, waiting until at most max_remaining frames are being compared or waiting to be reported
+    DiffTotals totals;
+    uint64_t submitted = 0;
+    uint64_t reported = 0;
+    auto report = [&](size_t max_remaining) {
+        std::unique_lock<std::mutex> lock(results_mutex);
+        for (;;) {
+            auto next = results.find(reported);
+            if (next == results.end()) {
+                if (submitted - reported <= max_remaining) return;
+                result_ready.wait(lock);
+                continue;
+            }
+            DiffResult result = std::move(next->second);
+            results.erase(next);
+            reported++;
+            lock.unlock();
+            totals.add(result.totals);
+            output << result.report;
+            lock.lock();
+        }
+    };
+
+    // Frames are paired by number, a frame missing from one of the captures is compared with an empty frame
+    std::unique_ptr<DiffFrame> before_frame = before.next();
+    std::unique_ptr<DiffFrame> after_frame = after.next();
+    while (before_frame || after_frame) {
+        DiffJob job;
+        job.index = submitted;
+        if (before_frame && (!after_frame || before_frame->number <= after_frame->number)) {
+            job.number = before_frame->number;
+            if (after_frame && after_frame->number == before_frame->number) {
+                job.after = std::move(after_frame);
+                after_frame = after.next();
+            }
+            job.before = std::move(before_frame);
+            before_frame = before.next();
+        } else {
+            job.number = after_frame->number;
+            job.after = std::move(after_frame);
+            after_frame = after.next();
+        }
+        report(max_pending - 1);
+        {
+            std::lock_guard<std::mutex> lock(results_mutex);
+            submitted++;
+        }
+        jobs.push(std::move(job));
+    }
+    jobs.close();
+    report(0);
+    for (std::thread &worker : workers) worker.join();
+
+    output << totals.frames << " frames compared, " << totals.different_frames << " different: " << totals.removed
+           << " calls removed, " << totals.inserted << " inserted, " << totals.changed << " changed\n";
+    output.flush();
+
+    int result = totals.different_frames > 0 ? 1 : 0;
+    for (const FrameReader *reader : {&before, &after}) {
+        if (!reader->getError().empty()) {
+            fprintf(stderr, "api_dump_diff: %s\n", reader->getError().c_str());
+            result = 2;
+        }
+    }
+    return result;
+}
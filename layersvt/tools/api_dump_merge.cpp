@@ -0,0 +1,129 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Merges the files written by api_dump with file_per_thread into a single capture, in the order of the calls.
+//
+// Each file is already sorted by sequence number, so the files are merged k ways: only the next record of each file is in
+// memory. Records without a sequence number, such as the call counts of statistics mode, stay after the record preceding
+// them in their file.
+
+#include "api_dump_records.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace {
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--output <file>] <file>...\n"
+            "Merges the ndjson or binary files written by api_dump with file_per_thread, ordered by call sequence.\n"
+            "The merged capture is written to stdout unless --output is given.\n",
+            program);
+}
+
+struct Input {
+    std::unique_ptr<ApiDumpRecordReader> reader;
+    ApiDumpRecord record;
+    uint64_t order = 0;  // Sequence of the record, or of the previous record of the file when it has none
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::string output_path;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-') {
+            paths.push_back(arg);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (paths.empty()) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    ApiDumpStringPool pool;
+    std::vector<Input> inputs(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        inputs[i].reader = std::make_unique<ApiDumpRecordReader>(paths[i], pool);
+        if (!inputs[i].reader->getError().empty()) {
+            fprintf(stderr, "api_dump_merge: %s\n", inputs[i].reader->getError().c_str());
+            return 1;
+        }
+        if (inputs[i].reader->isBinary() != inputs[0].reader->isBinary()) {
+            fprintf(stderr, "api_dump_merge: %s and %s have different formats\n", paths[0].c_str(), paths[i].c_str());
+            return 1;
+        }
+    }
+
+    std::vector<char> output_buffer(1 << 20);
+    std::ofstream output_file;
+    if (!output_path.empty()) {
+        output_file.rdbuf()->pubsetbuf(output_buffer.data(), output_buffer.size());
+        output_file.open(output_path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+        if (!output_file.is_open()) {
+            fprintf(stderr, "api_dump_merge: can't open %s\n", output_path.c_str());
+            return 1;
+        }
+    }
+    std::ostream &output = output_path.empty() ? std::cout : output_file;
+    ApiDumpRecordWriter writer(output, inputs[0].reader->isBinary(), pool);
+
+    // Smallest order first, then the first file given
+    typedef std::pair<uint64_t, size_t> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    auto advance = [&](size_t index) {
+        Input &input = inputs[index];
+        if (!input.reader->next(input.record)) return;
+        if (input.record.has_sequence) input.order = input.record.sequence;
+        queue.emplace(input.order, index);
+    };
+    for (size_t i = 0; i < inputs.size(); i++) advance(i);
+
+    uint64_t records = 0;
+    while (!queue.empty()) {
+        const size_t index = queue.top().second;
+        queue.pop();
+        writer.write(inputs[index].record);
+        records++;
+        advance(index);
+    }
+    output.flush();
+
+    int result = 0;
+    for (const Input &input : inputs) {
+        if (!input.reader->getError().empty()) {
+            fprintf(stderr, "api_dump_merge: %s\n", input.reader->getError().c_str());
+            result = 1;
+        }
+    }
+    fprintf(stderr, "api_dump_merge: %llu records merged from %zu files\n", static_cast<unsigned long long>(records),
+            inputs.size());
+    return result;
+}
@@ -0,0 +1,807 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Finds calls in an ndjson or binary api_dump capture, such as the vkQueueSubmit calls of frames 100 to 200 on thread 3.
+//
+// The first query builds an index next to the capture, <capture>.idx, and the following ones only read the index. The
+// index stores a column per field of the calls: sequence, frame, thread, timestamp, name, VkResult and the handles used
+// by the call. A query only loads the columns it filters or prints, and scans them.
+//
+// Indexing is split on frame boundaries between threads. An ndjson capture is cut into byte ranges, each read by its own
+// thread. A binary capture interns its strings as it goes, so it is read by a single thread, which hands batches of whole
+// frames to the others.
+
+#include "api_dump_records.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <capture>\n"
+            "Finds the calls of an ndjson or binary api_dump capture matching all the filters given.\n"
+            "The capture is indexed in <capture>.idx the first time it is queried.\n"
+            "\n"
+            "Filters:\n"
+            "  --name <function>     Calls to this function, can be given several times\n"
+            "  --frames <first>[-<last>]\n"
+            "                        Calls in these frames\n"
+            "  --thread <n>          Calls from this thread\n"
+            "  --errors              Calls returning a VK_ERROR_* result\n"
+            "  --result <VkResult>   Calls returning this result, for example VK_TIMEOUT\n"
+            "  --handle <0x...>      Calls using this handle\n"
+            "\n"
+            "Options:\n"
+            "  --count               Only print the number of calls found\n"
+            "  --records             Print the ndjson records of the calls found rather than a summary\n"
+            "  --limit <n>           Stop after n calls\n"
+            "  --index <file>        Index file, <capture>.idx by default\n"
+            "  --reindex             Build the index again even if it is up to date\n"
+            "  --threads <n>         Number of threads indexing the capture, the number of cores by default\n",
+            program);
+}
+
+struct Options {
+    std::string capture;
+    std::string index;
+    bool reindex = false;
+    unsigned threads = 0;
+
+    std::vector<std::string> names;
+    bool has_frames = false;
+    uint64_t first_frame = 0;
+    uint64_t last_frame = UINT64_MAX;
+    bool has_thread = false;
+    uint32_t thread = 0;
+    bool errors = false;
+    std::string result;
+    bool has_handle = false;
+    uint64_t handle = 0;
+
+    bool count = false;
+    bool records = false;
+    uint64_t limit = UINT64_MAX;
+};
+
+const uint32_t kNoString = UINT32_MAX;
+const uint64_t kNoSequence = UINT64_MAX;  // Captures written before sequence numbers, replaced by the row number
+
+//================================ Index Data =================================//
+
+// Strings are numbered in the order they are first seen
+class StringTable {
+   public:
+    uint32_t intern(const char *value, size_t length) {
+        lookup.assign(value, length);
+        auto inserted = ids.emplace(lookup, static_cast<uint32_t>(strings.size()));
+        if (inserted.second) strings.push_back(lookup);
+        return inserted.first->second;
+    }
+    uint32_t find(const std::string &value) const {
+        auto found = ids.find(value);
+        return found == ids.end() ? kNoString : found->second;
+    }
+    const std::string &get(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+
+   private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> strings;
+    std::string lookup;
+};
+
+// A row per call, in the order of the capture
+struct IndexColumns {
+    std::vector<uint64_t> sequence;
+    std::vector<uint64_t> frame;
+    std::vector<uint32_t> thread;
+    std::vector<uint64_t> timestamp;
+    std::vector<uint32_t> name;
+    std::vector<uint32_t> result;  // Name of the VkResult, or kNoString
+    std::vector<uint8_t> error;    // 1 for negative VkResults
+    std::vector<uint64_t> offset;  // Offset of the ndjson record in the capture, 0 for binary captures
+    std::vector<uint32_t> handle_count;
+    std::vector<uint64_t> handles;  // The non-null handles of each call, one call after the other
+};
+
+// The columns of a part of the capture. The string ids are local to the segment, or ids in the string pool of the binary
+// reader.
+struct IndexSegment {
+    IndexColumns columns;
+    StringTable strings;
+    bool pool_ids = false;
+    std::string error;
+
+    void addRow(const ApiDumpRecord &record, uint64_t offset) {
+        columns.sequence.push_back(record.has_sequence ? record.sequence : kNoSequence);
+        columns.frame.push_back(record.frame);
+        columns.thread.push_back(static_cast<uint32_t>(record.thread));
+        columns.timestamp.push_back(record.timestamp_us);
+        columns.offset.push_back(offset);
+    }
+    void endRow(uint32_t name, uint32_t result, bool error, size_t handle_count) {
+        columns.name.push_back(name);
+        columns.result.push_back(result);
+        columns.error.push_back(error ? 1 : 0);
+        columns.handle_count.push_back(static_cast<uint32_t>(handle_count));
+    }
+};
+
+//================================== Indexing ==================================//
+
+bool IsHandle(const char *text, size_t length) {
+    if (length < 3 || text[0] != '0' || text[1] != 'x') return false;
+    for (size_t i = 2; i < length; i++) {
+        if (!isxdigit(static_cast<unsigned char>(text[i]))) return false;
+    }
+    return true;
+}
+
+// Indexes an ndjson record. The name and result are members of the top level object, the handles are the hexadecimal
+// strings found in the arguments. ndjson writes handles and addresses the same way, so addresses are indexed as well.
+void IndexNdjsonRecord(ApiDumpRecord &record, uint64_t offset, IndexSegment &segment) {
+    ApiDumpRecordReader::parseNdjson(record);
+    if (!record.is_call) return;
+    segment.addRow(record, offset);
+
+    const std::string &line = record.bytes;
+    const size_t handle_start = segment.columns.handles.size();
+    uint32_t name = kNoString;
+    uint32_t result = kNoString;
+    bool error = false;
+    const char *key = nullptr;
+    size_t key_length = 0;
+    int depth = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        const char c = line[i];
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '"') {
+            const size_t start = i + 1;
+            for (i = start; i < line.size() && line[i] != '"'; i++) {
+                if (line[i] == '\\') i++;
+            }
+            const char *text = line.data() + start;
+            const size_t length = std::min(i, line.size()) - start;
+            if (i + 1 < line.size() && line[i + 1] == ':') {
+                key = text;
+                key_length = length;
+            } else if (depth > 1) {
+                if (IsHandle(text, length)) segment.columns.handles.push_back(strtoull(text + 2, nullptr, 16));
+            } else if (key_length == 4 && memcmp(key, "name", 4) == 0) {
+                name = segment.strings.intern(text, length);
+            } else if (key_length == 6 && memcmp(key, "result", 6) == 0 && length > 3 && memcmp(text, "VK_", 3) == 0) {
+                result = segment.strings.intern(text, length);
+                error = length > 9 && memcmp(text, "VK_ERROR_", 9) == 0;
+            }
+        } else if (c == '-' && depth == 1 && key_length == 6 && memcmp(key, "result", 6) == 0) {
+            error = true;  // VkResult without a name
+        }
+    }
+    segment.endRow(name, result, error, segment.columns.handles.size() - handle_start);
+}
+
+// Indexes the ndjson lines starting in [begin, end)
+void IndexNdjsonRange(const std::string &path, uint64_t begin, uint64_t end, IndexSegment &segment) {
+    std::vector<char> buffer(1 << 20);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios_base::in | std::ios_base::binary);
+    if (!file.is_open()) {
+        segment.error = "can't open " + path;
+        return;
+    }
+    file.seekg(static_cast<std::streamoff>(begin));
+    ApiDumpRecord record;
+    uint64_t offset = begin;
+    while (offset < end && std::getline(file, record.bytes)) {
+        const uint64_t line_offset = offset;
+        offset += record.bytes.size() + 1;
+        if (record.bytes.empty()) continue;
+        record.is_call = false;
+        record.has_sequence = false;
+        record.sequence = record.thread = record.frame = record.timestamp_us = 0;
+        IndexNdjsonRecord(record, line_offset, segment);
+    }
+}
+
+// Frame of the ndjson line starting at offset, or UINT64_MAX at the end of the file
+uint64_t NdjsonFrameAt(std::ifstream &file, uint64_t offset) {
+    ApiDumpRecord record;
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    if (!std::getline(file, record.bytes)) return UINT64_MAX;
+    ApiDumpRecordReader::parseNdjson(record);
+    return record.frame;
+}
+
+// Cuts an ndjson capture into ranges of about the same size, starting at the first line of a frame
+std::vector<uint64_t> SplitNdjson(const std::string &path, uint64_t size, size_t parts) {
+    std::vector<uint64_t> boundaries = {0};
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    std::string line;
+    for (size_t part = 1; part < parts; part++) {
+        const uint64_t target = size * part / parts;
+        const uint64_t limit = size * (part + 1) / parts;
+        if (target <= boundaries.back()) continue;
+
+        // Skip to the next line, then to the next frame
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(target - 1));
+        if (!std::getline(file, line)) break;
+        uint64_t offset = target - 1 + line.size() + 1;
+        const uint64_t frame = NdjsonFrameAt(file, offset);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        while (offset < limit && std::getline(file, line)) {
+            ApiDumpRecord record;
+            record.bytes = line;
+            ApiDumpRecordReader::parseNdjson(record);
+            if (record.frame != frame) break;
+            offset += line.size() + 1;
+        }
+        // Frames larger than a part are not split
+        if (offset < limit && offset < size && offset > boundaries.back()) boundaries.push_back(offset);
+    }
+    boundaries.push_back(size);
+    return boundaries;
+}
+
+std::vector<IndexSegment> IndexNdjson(const std::string &path, uint64_t size, unsigned threads) {
+    // Several ranges per thread, so that threads given the smaller ranges take more of them
+    const size_t parts = std::max<uint64_t>(1, std::min<uint64_t>(threads * 4, size / (4 << 20)));
+    const std::vector<uint64_t> boundaries = SplitNdjson(path, size, parts);
+    std::vector<IndexSegment> segments(boundaries.size() - 1);
+    std::atomic<size_t> next_segment(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min<size_t>(threads, segments.size()); i++) {
+        workers.emplace_back([&] {
+            for (size_t segment = next_segment++; segment < segments.size(); segment = next_segment++) {
+                IndexNdjsonRange(path, boundaries[segment], boundaries[segment + 1], segments[segment]);
+            }
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+    return segments;
+}
+
+// Indexes a binary record. The interned strings take no bytes in the record, they are counted to find the VkResult name.
+bool IndexBinaryRecord(const ApiDumpRecord &record, IndexSegment &segment) {
+    if (record.strings.empty()) return false;
+    segment.addRow(record, 0);
+
+    const std::string &bytes = record.bytes;
+    const size_t handle_start = segment.columns.handles.size();
+    uint32_t result = kNoString;
+    bool error = false;
+    bool in_params = false;
+    // Tag, sequence, thread, frame, timestamp, then the name and return type strings
+    size_t position = 1 + 4 * sizeof(uint64_t);
+    size_t next_string = 2;
+    auto read = [&](void *value, size_t size) {
+        if (bytes.size() - position < size) return false;
+        memcpy(value, bytes.data() + position, size);
+        position += size;
+        return true;
+    };
+    auto skip = [&](size_t size) {
+        if (bytes.size() - position < size) return false;
+        position += size;
+        return true;
+    };
+
+    bool valid = position <= bytes.size();
+    while (valid && position < bytes.size()) {
+        const ApiDumpBinaryTag tag = static_cast<ApiDumpBinaryTag>(bytes[position++]);
+        if (tag == ApiDumpBinaryTag::End) continue;
+        if (tag == ApiDumpBinaryTag::Params) {
+            in_params = true;
+            continue;
+        }
+        next_string += 2;  // Name and type
+        switch (tag) {
+            case ApiDumpBinaryTag::Null:
+                break;
+            case ApiDumpBinaryTag::Signed:
+            case ApiDumpBinaryTag::Unsigned:
+            case ApiDumpBinaryTag::Float:
+            case ApiDumpBinaryTag::Address:
+            case ApiDumpBinaryTag::Struct:
+                valid = skip(sizeof(uint64_t));
+                break;
+            case ApiDumpBinaryTag::Array:
+                valid = skip(2 * sizeof(uint64_t));
+                break;
+            case ApiDumpBinaryTag::Bool:
+                valid = skip(sizeof(uint8_t));
+                break;
+            case ApiDumpBinaryTag::String: {
+                uint32_t length = 0;
+                valid = read(&length, sizeof(length)) && skip(length);
+                break;
+            }
+            case ApiDumpBinaryTag::Handle: {
+                uint64_t value = 0;
+                valid = read(&value, sizeof(value));
+                if (value != 0) segment.columns.handles.push_back(value);
+                break;
+            }
+            case ApiDumpBinaryTag::Enum: {
+                int64_t value = 0;
+                valid = read(&value, sizeof(value)) && next_string < record.strings.size();
+                if (valid && !in_params) {
+                    result = record.strings[next_string].second == UINT32_MAX ? kNoString : record.strings[next_string].second;
+                    error = value < 0;
+                }
+                next_string++;
+                break;
+            }
+            case ApiDumpBinaryTag::Flags:
+                valid = skip(sizeof(uint64_t));
+                next_string++;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+    segment.endRow(record.strings[0].second, result, error, segment.columns.handles.size() - handle_start);
+    return valid;
+}
+
+struct BinaryBatch {
+    uint64_t index = 0;
+    std::vector<ApiDumpRecord> records;
+};
+
+std::vector<IndexSegment> IndexBinary(const std::string &path, unsigned threads, ApiDumpStringPool &pool, std::string &error) {
+    ApiDumpRecordReader reader(path, pool);
+    if (!reader.getError().empty()) {
+        error = reader.getError();
+        return {};
+    }
+
+    std::mutex segments_mutex;
+    std::map<uint64_t, IndexSegment> segments;
+    ApiDumpQueue<BinaryBatch> batches(2 * threads);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([&] {
+            BinaryBatch batch;
+            while (batches.pop(batch)) {
+                IndexSegment segment;
+                segment.pool_ids = true;
+                for (const ApiDumpRecord &record : batch.records) {
+                    if (record.is_call && !IndexBinaryRecord(record, segment) && segment.error.empty()) {
+                        segment.error = path + ": invalid record in frame " + std::to_string(record.frame);
+                    }
+                }
+                std::lock_guard<std::mutex> lock(segments_mutex);
+                segments.emplace(batch.index, std::move(segment));
+            }
+        });
+    }
+
+    // Batches hold whole frames, and at least a few thousand records
+    const size_t min_batch_records = 4096;
+    BinaryBatch batch;
+    ApiDumpRecord record;
+    while (reader.next(record)) {
+        if (batch.records.size() >= min_batch_records && record.frame != batch.records.back().frame) {
+            const uint64_t next_index = batch.index + 1;
+            batches.push(std::move(batch));
+            batch = BinaryBatch();
+            batch.index = next_index;
+        }
+        batch.records.push_back(std::move(record));
+    }
+    batches.push(std::move(batch));
+    batches.close();
+    for (std::thread &worker : workers) worker.join();
+    error = reader.getError();
+
+    std::vector<IndexSegment> ordered;
+    ordered.reserve(segments.size());
+    for (auto &segment : segments) ordered.push_back(std::move(segment.second));
+    return ordered;
+}
+
+//================================ Index File =================================//
+
+const char kIndexMagic[8] = {'A', 'P', 'I', 'D', 'U', 'M', 'P', 'I'};
+const uint32_t kIndexVersion = 1;
+
+// Header: magic, version, size of the capture, number of rows, number of handles, then the strings and the columns
+struct IndexHeader {
+    uint64_t capture_size = 0;
+    uint64_t rows = 0;
+    uint64_t handles = 0;
+};
+
+enum class Column { Sequence, Frame, Thread, Timestamp, Name, Result, Error, Offset, HandleCount, Handles, Count };
+
+size_t ColumnElementSize(Column column) {
+    switch (column) {
+        case Column::Thread:
+        case Column::Name:
+        case Column::Result:
+        case Column::HandleCount:
+            return sizeof(uint32_t);
+        case Column::Error:
+            return sizeof(uint8_t);
+        default:
+            return sizeof(uint64_t);
+    }
+}
+
+template <typename T>
+void WriteValue(std::ostream &stream, T value) {
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteColumn(std::ostream &stream, const std::vector<IndexSegment> &segments, std::vector<T> IndexColumns::*column,
+                 const std::vector<std::vector<uint32_t>> *string_ids = nullptr) {
+    for (size_t i = 0; i < segments.size(); i++) {
+        const std::vector<T> &values = segments[i].columns.*column;
+        if (string_ids == nullptr) {
+            stream.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+            continue;
+        }
+        for (T value : values) WriteValue<uint32_t>(stream, value == kNoString ? kNoString : (*string_ids)[i][value]);
+    }
+}
+
+// Concatenates the segments, giving the strings of all segments a single numbering
+bool WriteIndex(const std::string &path, uint64_t capture_size, std::vector<IndexSegment> &segments,
+                const ApiDumpStringPool *pool) {
+    StringTable strings;
+    std::vector<std::vector<uint32_t>> string_ids(segments.size());
+    IndexHeader header;
+    header.capture_size = capture_size;
+    for (size_t i = 0; i < segments.size(); i++) {
+        IndexSegment &segment = segments[i];
+        for (size_t row = 0; row < segment.columns.sequence.size(); row++) {
+            if (segment.columns.sequence[row] == kNoSequence) segment.columns.sequence[row] = header.rows + row;
+        }
+        header.rows += segment.columns.frame.size();
+        header.handles += segment.columns.handles.size();
+
+        auto map_id = [&](uint32_t id) {
+            if (id == kNoString) return;
+            if (id >= string_ids[i].size()) string_ids[i].resize(id + 1, kNoString);
+            if (string_ids[i][id] != kNoString) return;
+            const std::string &text = segment.pool_ids ? pool->get(id) : segment.strings.get(id);
+            string_ids[i][id] = strings.intern(text.data(), text.size());
+        };
+        for (uint32_t id : segment.columns.name) map_id(id);
+        for (uint32_t id : segment.columns.result) map_id(id);
+    }
+
+    std::vector<char> buffer(1 << 20);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    if (!file.is_open()) return false;
+
+    file.write(kIndexMagic, sizeof(kIndexMagic));
+    WriteValue(file, kIndexVersion);
+    WriteValue(file, header.capture_size);
+    WriteValue(file, header.rows);
+    WriteValue(file, header.handles);
+    WriteValue(file, static_cast<uint32_t>(strings.size()));
+    for (uint32_t id = 0; id < strings.size(); id++) {
+        WriteValue(file, static_cast<uint32_t>(strings.get(id).size()));
+        file.write(strings.get(id).data(), strings.get(id).size());
+    }
+
+    // In the order of Column
+    WriteColumn(file, segments, &IndexColumns::sequence);
+    WriteColumn(file, segments, &IndexColumns::frame);
+    WriteColumn(file, segments, &IndexColumns::thread);
+    WriteColumn(file, segments, &IndexColumns::timestamp);
+    WriteColumn(file, segments, &IndexColumns::name, &string_ids);
+    WriteColumn(file, segments, &IndexColumns::result, &string_ids);
+    WriteColumn(file, segments, &IndexColumns::error);
+    WriteColumn(file, segments, &IndexColumns::offset);
+    WriteColumn(file, segments, &IndexColumns::handle_count);
+    WriteColumn(file, segments, &IndexColumns::handles);
+    file.flush();
+    return file.good();
+}
+
+// Loads the columns of an index file on demand
+class IndexReader {
+   public:
+    explicit IndexReader(const std::string &path) {
+        file.open(path, std::ios_base::in | std::ios_base::binary);
+        if (!file.is_open()) return;
+
+        char magic[sizeof(kIndexMagic)] = {};
+        uint32_t version = 0;
+        file.read(magic, sizeof(magic));
+        read(version);
+        if (!file || memcmp(magic, kIndexMagic, sizeof(magic)) != 0 || version != kIndexVersion) return;
+        read(header.capture_size);
+        read(header.rows);
+        read(header.handles);
+        uint32_t string_count = 0;
+        read(string_count);
+        std::string text;
+        for (uint32_t i = 0; i < string_count && file; i++) {
+            uint32_t length = 0;
+            read(length);
+            text.resize(length);
+            file.read(&text[0], length);
+            strings.intern(text.data(), text.size());
+        }
+        valid = static_cast<bool>(file);
+
+        uint64_t offset = static_cast<uint64_t>(file.tellg());
+        for (size_t column = 0; column < static_cast<size_t>(Column::Count); column++) {
+            column_offsets[column] = offset;
+            const uint64_t count = static_cast<Column>(column) == Column::Handles ? header.handles : header.rows;
+            offset += count * ColumnElementSize(static_cast<Column>(column));
+        }
+    }
+
+    bool isValid() const { return valid; }
+    const IndexHeader &getHeader() const { return header; }
+    const StringTable &getStrings() const { return strings; }
+
+    template <typename T>
+    bool load(Column column, std::vector<T> &values) {
+        const uint64_t count = column == Column::Handles ? header.handles : header.rows;
+        values.resize(count);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(column_offsets[static_cast<size_t>(column)]));
+        file.read(reinterpret_cast<char *>(values.data()), count * sizeof(T));
+        return static_cast<bool>(file);
+    }
+
+   private:
+    template <typename T>
+    void read(T &value) {
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    std::ifstream file;
+    IndexHeader header;
+    StringTable strings;
+    uint64_t column_offsets[static_cast<size_t>(Column::Count)] = {};
+    bool valid = false;
+};
+
+uint64_t FileSize(const std::string &path) {
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+    return file.is_open() ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+bool BuildIndex(const Options &options, uint64_t capture_size) {
+    const auto start = std::chrono::steady_clock::now();
+    bool binary = false;
+    {
+        std::ifstream file(options.capture, std::ios_base::in | std::ios_base::binary);
+        if (!file.is_open()) {
+            fprintf(stderr, "api_dump_query: can't open %s\n", options.capture.c_str());
+            return false;
+        }
+        binary = file.peek() == kApiDumpBinaryMagic[0];
+    }
+
+    ApiDumpStringPool pool;
+    std::string error;
+    std::vector<IndexSegment> segments = binary ? IndexBinary(options.capture, options.threads, pool, error)
+                                                : IndexNdjson(options.capture, capture_size, options.threads);
+    for (const IndexSegment &segment : segments) {
+        if (error.empty()) error = segment.error;
+    }
+    if (!error.empty()) {
+        fprintf(stderr, "api_dump_query: %s\n", error.c_str());
+        return false;
+    }
+    if (!WriteIndex(options.index, capture_size, segments, &pool)) {
+        fprintf(stderr, "api_dump_query: can't write %s\n", options.index.c_str());
+        return false;
+    }
+
+    uint64_t rows = 0;
+    for (const IndexSegment &segment : segments) rows += segment.columns.frame.size();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    fprintf(stderr, "api_dump_query: indexed %" PRIu64 " calls in %lld ms\n", rows, static_cast<long long>(elapsed.count()));
+    return true;
+}
+
+//=================================== Query ===================================//
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            options.names.push_back(argv[++i]);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            const std::string range = argv[++i];
+            const size_t dash = range.find('-');
+            options.has_frames = true;
+            options.first_frame = strtoull(range.c_str(), nullptr, 10);
+            options.last_frame = dash == std::string::npos ? options.first_frame : strtoull(range.c_str() + dash + 1, nullptr, 10);
+        } else if (arg == "--thread" && i + 1 < argc) {
+            options.has_thread = true;
+            options.thread = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--errors") {
+            options.errors = true;
+        } else if (arg == "--result" && i + 1 < argc) {
+            options.result = argv[++i];
+        } else if (arg == "--handle" && i + 1 < argc) {
+            options.has_handle = true;
+            options.handle = strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--count") {
+            options.count = true;
+        } else if (arg == "--records") {
+            options.records = true;
+        } else if (arg == "--limit" && i + 1 < argc) {
+            options.limit = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--index" && i + 1 < argc) {
+            options.index = argv[++i];
+        } else if (arg == "--reindex") {
+            options.reindex = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (!arg.empty() && arg[0] != '-' && options.capture.empty()) {
+            options.capture = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.capture.empty();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (options.threads == 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (options.index.empty()) options.index = options.capture + ".idx";
+
+    // The index is built again when the capture changed size, for example when the application was run again
+    const uint64_t capture_size = FileSize(options.capture);
+    bool up_to_date = false;
+    if (!options.reindex) {
+        IndexReader index(options.index);
+        up_to_date = index.isValid() && index.getHeader().capture_size == capture_size;
+    }
+    if (!up_to_date && !BuildIndex(options, capture_size)) return 1;
+
+    const auto start = std::chrono::steady_clock::now();
+    IndexReader index(options.index);
+    if (!index.isValid()) {
+        fprintf(stderr, "api_dump_query: invalid index %s\n", options.index.c_str());
+        return 1;
+    }
+    const StringTable &strings = index.getStrings();
+    const uint64_t rows = index.getHeader().rows;
+
+    // Only the columns used by the filters and the output are loaded
+    std::vector<uint64_t> sequence, frame, timestamp, offset, handles;
+    std::vector<uint32_t> thread, name, result, handle_count;
+    std::vector<uint8_t> error;
+    std::vector<bool> wanted_names;
+    uint32_t wanted_result = kNoString;
+    bool loaded = true;
+    const bool summary = !options.count && !options.records;
+    if (!options.names.empty()) {
+        wanted_names.resize(strings.size());
+        for (const std::string &function : options.names) {
+            const uint32_t id = strings.find(function);
+            if (id != kNoString) wanted_names[id] = true;
+        }
+    }
+    if (!options.result.empty()) wanted_result = strings.find(options.result);
+    if (options.has_frames) loaded &= index.load(Column::Frame, frame);
+    if (options.has_thread) loaded &= index.load(Column::Thread, thread);
+    if (!options.names.empty()) loaded &= index.load(Column::Name, name);
+    if (options.errors) loaded &= index.load(Column::Error, error);
+    if (!options.result.empty()) loaded &= index.load(Column::Result, result);
+    if (options.has_handle) loaded &= index.load(Column::HandleCount, handle_count) && index.load(Column::Handles, handles);
+    if (summary) {
+        if (frame.empty()) loaded &= index.load(Column::Frame, frame);
+        if (thread.empty()) loaded &= index.load(Column::Thread, thread);
+        if (name.empty()) loaded &= index.load(Column::Name, name);
+        if (result.empty()) loaded &= index.load(Column::Result, result);
+        loaded &= index.load(Column::Sequence, sequence) && index.load(Column::Timestamp, timestamp);
+    }
+    if (options.records) loaded &= index.load(Column::Offset, offset);
+    if (!loaded) {
+        fprintf(stderr, "api_dump_query: truncated index %s\n", options.index.c_str());
+        return 1;
+    }
+
+    std::ifstream capture;
+    std::string line;
+    if (options.records) {
+        capture.open(options.capture, std::ios_base::in | std::ios_base::binary);
+        if (!capture.is_open() || capture.peek() == kApiDumpBinaryMagic[0]) {
+            fprintf(stderr, "api_dump_query: --records needs an ndjson capture\n");
+            return 1;
+        }
+    }
+
+    std::vector<char> output_buffer(1 << 20);
+    std::cout.rdbuf()->pubsetbuf(output_buffer.data(), output_buffer.size());
+    if (summary) std::cout << "seq\tframe\tthread\ttime\tname\tresult\n";
+
+    uint64_t matches = 0;
+    uint64_t handle_position = 0;
+    for (uint64_t row = 0; row < rows && matches < options.limit; row++) {
+        if (options.has_handle) {
+            const uint64_t begin = handle_position;
+            handle_position += handle_count[row];
+            if (std::find(handles.begin() + begin, handles.begin() + handle_position, options.handle) ==
+                handles.begin() + handle_position) {
+                continue;
+            }
+        }
+        if (options.has_frames && (frame[row] < options.first_frame || frame[row] > options.last_frame)) continue;
+        if (options.has_thread && thread[row] != options.thread) continue;
+        if (!options.names.empty() && (name[row] == kNoString || !wanted_names[name[row]])) continue;
+        if (options.errors && !error[row]) continue;
+        if (!options.result.empty() && (wanted_result == kNoString || result[row] != wanted_result)) continue;
+
+        matches++;
+        if (options.count) continue;
+        if (options.records) {
+            capture.clear();
+            capture.seekg(static_cast<std::streamoff>(offset[row]));
+            std::getline(capture, line);
+            std::cout << line << '\n';
+            continue;
+        }
+        std::cout << sequence[row] << '\t' << frame[row] << '\t' << thread[row] << '\t' << timestamp[row] << '\t'
+                  << (name[row] == kNoString ? "" : strings.get(name[row])) << '\t'
+                  << (result[row] == kNoString ? "" : strings.get(result[row])) << '\n';
+    }
+    if (options.count) std::cout << matches << '\n';
+    std::cout.flush();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    fprintf(stderr, "api_dump_query: %" PRIu64 " of %" PRIu64 " calls found in %lld ms\n", matches, rows,
+            static_cast<long long>(elapsed.count()));
+    return 0;
+}
@@ -0,0 +1,253 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Receives the api_dump output streamed with the output_socket setting.
+//
+// The reader listens on a Unix domain socket, a named pipe (FIFO) or a Windows named pipe, and writes each connection of the
+// layer to stdout or to a file. Each connection is a complete ndjson or binary stream: with --output, the first connection is
+// written to the given file and the following ones to <file>.<n>, like the rotated api_dump files.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kBinaryMagic[8] = {'V', 'K', 'A', 'P', 'I', 'D', 'M', 'P'};
+
+struct Options {
+    std::string path;
+    std::string output;
+    bool fifo = false;
+    uint64_t connections = 0;  // 0 means no limit
+};
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <path>\n"
+            "Receives the api_dump output streamed to <path> with the output_socket setting.\n"
+            "\n"
+            "Options:\n"
+            "  --fifo               Create and read a named pipe (FIFO) instead of listening on a Unix domain socket\n"
+            "  --output <file>      Write the first connection to <file> and the next ones to <file>.<n>, instead of stdout\n"
+            "  --connections <n>    Exit after <n> connections\n"
+            "\n"
+            "On Windows, <path> is a named pipe such as \\\\.\\pipe\\api_dump.\n",
+            program);
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--fifo") {
+            options.fifo = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "--connections" && i + 1 < argc) {
+            options.connections = strtoull(argv[++i], nullptr, 10);
+        } else if (options.path.empty() && arg.size() > 0 && arg[0] != '-') {
+            options.path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.path.empty();
+}
+
+// <file>.<n>, keeping the extension last
+std::string ConnectionOutputName(const std::string &output, uint64_t connection) {
+    if (connection == 0) return output;
+    const size_t slash = output.find_last_of("/\\");
+    size_t dot = output.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = output.size();
+    std::string name = output;
+    name.insert(dot, "." + std::to_string(connection));
+    return name;
+}
+
+// Copies a connection to the output and reports what was received
+class Connection {
+   public:
+    Connection(const Options &options, uint64_t index) : index(index) {
+        if (options.output.empty()) {
+            file = stdout;
+        } else {
+            file = fopen(ConnectionOutputName(options.output, index).c_str(), "wb");
+            if (file == nullptr) fprintf(stderr, "api_dump_reader: can't open the output file for connection %llu\n",
+                                         static_cast<unsigned long long>(index));
+        }
+    }
+
+    ~Connection() {
+        if (file != nullptr) {
+            fflush(file);
+            if (file != stdout) fclose(file);
+        }
+        const bool binary = header.size() == sizeof(kBinaryMagic) && memcmp(header.data(), kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+        if (binary) {
+            fprintf(stderr, "api_dump_reader: connection %llu closed, %llu bytes of binary output\n",
+                    static_cast<unsigned long long>(index), static_cast<unsigned long long>(bytes));
+        } else {
+            fprintf(stderr, "api_dump_reader: connection %llu closed, %llu bytes, %llu ndjson records\n",
+                    static_cast<unsigned long long>(index), static_cast<unsigned long long>(bytes),
+                    static_cast<unsigned long long>(lines));
+        }
+    }
+
+    void receive(const char *data, size_t size) {
+        bytes += size;
+        for (size_t i = 0; i < size && header.size() < sizeof(kBinaryMagic); i++) header.push_back(data[i]);
+        for (size_t i = 0; i < size; i++) lines += data[i] == '\n';
+        if (file != nullptr) fwrite(data, 1, size, file);
+    }
+
+   private:
+    const uint64_t index;
+    FILE *file = nullptr;
+    std::vector<char> header;
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+};
+
+#if defined(_WIN32)
+
+int Run(const Options &options) {
+    for (uint64_t index = 0; options.connections == 0 || index < options.connections; index++) {
+        HANDLE pipe = CreateNamedPipeA(options.path.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1,
+                                       0, 1 << 20, 0, nullptr);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            fprintf(stderr, "api_dump_reader: can't create the named pipe %s\n", options.path.c_str());
+            return 1;
+        }
+        if (!ConnectNamedPipe(pipe, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED) {
+            CloseHandle(pipe);
+            continue;
+        }
+
+        Connection connection(options, index);
+        std::vector<char> buffer(1 << 16);
+        DWORD size = 0;
+        while (ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), &size, nullptr) && size > 0) {
+            connection.receive(buffer.data(), size);
+        }
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+    return 0;
+}
+
+#else
+
+void ReadConnection(int fd, Connection &connection) {
+    std::vector<char> buffer(1 << 16);
+    for (;;) {
+        const ssize_t size = read(fd, buffer.data(), buffer.size());
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) break;
+        connection.receive(buffer.data(), static_cast<size_t>(size));
+    }
+}
+
+int RunFifo(const Options &options) {
+    struct stat info;
+    if (stat(options.path.c_str(), &info) != 0) {
+        if (mkfifo(options.path.c_str(), 0600) != 0) {
+            fprintf(stderr, "api_dump_reader: can't create the named pipe %s: %s\n", options.path.c_str(), strerror(errno));
+            return 1;
+        }
+    } else if (!S_ISFIFO(info.st_mode)) {
+        fprintf(stderr, "api_dump_reader: %s exists and isn't a named pipe\n", options.path.c_str());
+        return 1;
+    }
+
+    for (uint64_t index = 0; options.connections == 0 || index < options.connections; index++) {
+        // Blocks until the layer opens the pipe for writing, and reads until it closes it
+        const int fd = open(options.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "api_dump_reader: can't open %s: %s\n", options.path.c_str(), strerror(errno));
+            return 1;
+        }
+        Connection connection(options, index);
+        ReadConnection(fd, connection);
+        close(fd);
+    }
+    return 0;
+}
+
+int RunSocket(const Options &options) {
+    sockaddr_un address = {};
+    if (options.path.size() >= sizeof(address.sun_path)) {
+        fprintf(stderr, "api_dump_reader: the socket path %s is too long\n", options.path.c_str());
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, options.path.c_str(), options.path.size() + 1);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(options.path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, 1) != 0) {
+        fprintf(stderr, "api_dump_reader: can't listen on %s: %s\n", options.path.c_str(), strerror(errno));
+        return 1;
+    }
+
+    for (uint64_t index = 0; options.connections == 0 || index < options.connections; index++) {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                index--;
+                continue;
+            }
+            fprintf(stderr, "api_dump_reader: accept failed: %s\n", strerror(errno));
+            break;
+        }
+        Connection connection(options, index);
+        ReadConnection(fd, connection);
+        close(fd);
+    }
+
+    close(listener);
+    unlink(options.path.c_str());
+    return 0;
+}
+
+int Run(const Options &options) { return options.fifo ? RunFifo(options) : RunSocket(options); }
+
+#endif
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    return Run(options);
+}
@@ -0,0 +1,387 @@
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Streaming access to the ndjson and binary api_dump output, shared by the command line tools.
+//
+// Records are read one at a time, so the tools use a bounded amount of memory whatever the size of the capture. Binary
+// records keep their bytes, with the interned strings replaced by references to an ApiDumpStringPool shared by all the
+// inputs of a tool, so records read from several streams can be written to a single one.
+
+#include "api_dump_reflection.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Strings of the binary records, numbered in the order they are first seen
+class ApiDumpStringPool {
+   public:
+    uint32_t intern(const std::string &value) {
+        auto inserted = ids.emplace(value, static_cast<uint32_t>(strings.size()));
+        if (inserted.second) strings.push_back(value);
+        return inserted.first->second;
+    }
+    const std::string &get(uint32_t id) const { return strings[id]; }
+
+   private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> strings;
+};
+
+struct ApiDumpRecord {
+    bool is_call = false;    // false for the call counts of statistics mode
+    bool has_sequence = false;
+    uint64_t sequence = 0;
+    uint64_t thread = 0;
+    uint64_t frame = 0;
+    uint64_t timestamp_us = 0;
+
+    // ndjson: the line, including the new line
+    // binary: the record without its interned strings, which are inserted at the given offsets
+    std::string bytes;
+    std::vector<std::pair<size_t, uint32_t>> strings;  // Offset in bytes, id in the pool, or UINT32_MAX for a null string
+};
+
+class ApiDumpRecordReader {
+   public:
+    ApiDumpRecordReader(const std::string &path, ApiDumpStringPool &pool) : path(path), pool(pool), buffer(1 << 20) {
+        file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        file.open(path, std::ios_base::in | std::ios_base::binary);
+        if (!file.is_open()) {
+            error = "can't open " + path;
+            return;
+        }
+        binary = file.peek() == kApiDumpBinaryMagic[0];
+    }
+
+    bool isBinary() const { return binary; }
+    const std::string &getPath() const { return path; }
+
+    // Empty unless reading stopped because of an error
+    const std::string &getError() const { return error; }
+
+    // Returns false at the end of the stream or on error
+    bool next(ApiDumpRecord &record) {
+        if (!error.empty()) return false;
+        record = ApiDumpRecord{};
+        return binary ? nextBinary(record) : nextNdjson(record);
+    }
+
+    // Fills the fields of a record from its ndjson line, in bytes
+    static void parseNdjson(ApiDumpRecord &record) {
+        // The scalar members come first: {"seq":0,"thread":0,"frame":0,"time":0,"name":...} or {"frame":0,"callCounts":...}
+        record.is_call = record.bytes.find("\"callCounts\":") == std::string::npos;
+        size_t position = 1;
+        while (position < record.bytes.size() && record.bytes[position] == '"') {
+            const size_t key_end = record.bytes.find("\":", position + 1);
+            if (key_end == std::string::npos) break;
+            const std::string key = record.bytes.substr(position + 1, key_end - position - 1);
+            size_t value = key_end + 2;
+            if (value >= record.bytes.size() || record.bytes[value] < '0' || record.bytes[value] > '9') break;
+            uint64_t number = 0;
+            while (value < record.bytes.size() && record.bytes[value] >= '0' && record.bytes[value] <= '9') {
+                number = number * 10 + static_cast<uint64_t>(record.bytes[value++] - '0');
+            }
+            if (key == "seq") {
+                record.sequence = number;
+                record.has_sequence = true;
+            } else if (key == "thread") {
+                record.thread = number;
+            } else if (key == "frame") {
+                record.frame = number;
+            } else if (key == "time") {
+                record.timestamp_us = number;
+            }
+            if (value >= record.bytes.size() || record.bytes[value] != ',') break;
+            position = value + 1;
+        }
+    }
+
+   private:
+    bool nextNdjson(ApiDumpRecord &record) {
+        do {
+            if (!std::getline(file, record.bytes)) return false;
+        } while (record.bytes.empty());
+        record.bytes.push_back('\n');
+        parseNdjson(record);
+        return true;
+    }
+
+    bool nextBinary(ApiDumpRecord &record) {
+        int tag = file.get();
+        if (tag == std::char_traits<char>::eof()) return false;
+
+        // Streams restart with a header, for example when the output socket reconnects
+        while (tag == kApiDumpBinaryMagic[0]) {
+            char magic[sizeof(kApiDumpBinaryMagic)] = {static_cast<char>(tag)};
+            file.read(magic + 1, sizeof(magic) - 1);
+            uint32_t file_version = 0;
+            file.read(reinterpret_cast<char *>(&file_version), sizeof(file_version));
+            if (!file || memcmp(magic, kApiDumpBinaryMagic, sizeof(magic)) != 0) return fail("invalid binary header");
+            if (file_version == 0 || file_version > kApiDumpBinaryVersion) return fail("unsupported binary version");
+            version = file_version;
+            ids.clear();
+            tag = file.get();
+            if (tag == std::char_traits<char>::eof()) return false;
+        }
+        if (version == 0) return fail("missing binary header");
+
+        record.bytes.push_back(static_cast<char>(tag));
+        if (tag == static_cast<int>(ApiDumpBinaryTag::CallCounts)) {
+            record.frame = copy<uint64_t>(record);
+            const uint32_t count = copy<uint32_t>(record);
+            for (uint32_t i = 0; i < count && file; i++) {
+                copyString(record);
+                copy<uint64_t>(record);
+            }
+        } else if (tag == static_cast<int>(ApiDumpBinaryTag::Call)) {
+            record.is_call = true;
+            // Records are converted to the current version, version 1 had no sequence
+            if (version >= 2) {
+                record.sequence = copy<uint64_t>(record);
+                record.has_sequence = true;
+            } else {
+                record.bytes.append(sizeof(uint64_t), '\0');
+            }
+            record.thread = copy<uint64_t>(record);
+            record.frame = copy<uint64_t>(record);
+            record.timestamp_us = copy<uint64_t>(record);
+            copyString(record);
+            copyString(record);
+            copyValues(record);
+        } else {
+            return fail("unexpected record tag " + std::to_string(tag));
+        }
+
+        if (!file) return fail("truncated record");
+        return error.empty();
+    }
+
+    // Copies values until the End tag closing the call
+    void copyValues(ApiDumpRecord &record) {
+        uint32_t depth = 1;
+        while (depth > 0 && file && error.empty()) {
+            const ApiDumpBinaryTag tag = static_cast<ApiDumpBinaryTag>(copy<uint8_t>(record));
+            if (tag == ApiDumpBinaryTag::End) {
+                depth--;
+                continue;
+            }
+            if (tag == ApiDumpBinaryTag::Params) {
+                depth++;
+                continue;
+            }
+            copyString(record);
+            copyString(record);
+            switch (tag) {
+                case ApiDumpBinaryTag::Null:
+                    break;
+                case ApiDumpBinaryTag::Signed:
+                case ApiDumpBinaryTag::Unsigned:
+                case ApiDumpBinaryTag::Float:
+                case ApiDumpBinaryTag::Handle:
+                case ApiDumpBinaryTag::Address:
+                    copy<uint64_t>(record);
+                    break;
+                case ApiDumpBinaryTag::Bool:
+                    copy<uint8_t>(record);
+                    break;
+                case ApiDumpBinaryTag::String: {
+                    const uint32_t length = copy<uint32_t>(record);
+                    copyBytes(record, length);
+                    break;
+                }
+                case ApiDumpBinaryTag::Enum:
+                case ApiDumpBinaryTag::Flags:
+                    copy<uint64_t>(record);
+                    copyString(record);
+                    break;
+                case ApiDumpBinaryTag::Struct:
+                    copy<uint64_t>(record);
+                    depth++;
+                    break;
+                case ApiDumpBinaryTag::Array:
+                    copy<uint64_t>(record);
+                    copy<uint64_t>(record);
+                    depth++;
+                    break;
+                default:
+                    fail("unexpected value tag " + std::to_string(static_cast<int>(tag)));
+                    break;
+            }
+        }
+    }
+
+    template <typename T>
+    T copy(ApiDumpRecord &record) {
+        T value{};
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+        record.bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        return value;
+    }
+
+    void copyBytes(ApiDumpRecord &record, uint32_t length) {
+        const size_t offset = record.bytes.size();
+        record.bytes.resize(offset + length);
+        file.read(&record.bytes[offset], length);
+    }
+
+    // Interned string: the id, followed by its length and characters the first time it is seen in the stream
+    void copyString(ApiDumpRecord &record) {
+        uint32_t id = 0;
+        file.read(reinterpret_cast<char *>(&id), sizeof(id));
+        if (id == 0) {
+            record.strings.emplace_back(record.bytes.size(), UINT32_MAX);
+            return;
+        }
+        if (id >= ids.size()) {
+            uint32_t length = 0;
+            file.read(reinterpret_cast<char *>(&length), sizeof(length));
+            std::string value(length, '\0');
+            file.read(&value[0], length);
+            if (!file) return;
+            ids.resize(id + 1, UINT32_MAX);
+            ids[id] = pool.intern(value);
+        }
+        if (ids[id] == UINT32_MAX) {
+            fail("unknown string id " + std::to_string(id));
+            return;
+        }
+        record.strings.emplace_back(record.bytes.size(), ids[id]);
+    }
+
+    bool fail(const std::string &message) {
+        if (error.empty()) error = path + ": " + message;
+        return false;
+    }
+
+    const std::string path;
+    ApiDumpStringPool &pool;
+    std::vector<char> buffer;  // Declared before file so that it outlives it
+    std::ifstream file;
+    bool binary = false;
+    uint32_t version = 0;
+    std::vector<uint32_t> ids;  // Stream id to pool id
+    std::string error;
+};
+
+// Writes records read by ApiDumpRecordReader, interning the strings of binary records again for the output stream
+class ApiDumpRecordWriter {
+   public:
+    ApiDumpRecordWriter(std::ostream &stream, bool binary, const ApiDumpStringPool &pool)
+        : stream(stream), binary(binary), pool(pool) {
+        if (binary) {
+            stream.write(kApiDumpBinaryMagic, sizeof(kApiDumpBinaryMagic));
+            stream.write(reinterpret_cast<const char *>(&kApiDumpBinaryVersion), sizeof(kApiDumpBinaryVersion));
+        }
+    }
+
+    void write(const ApiDumpRecord &record) {
+        if (!binary) {
+            stream.write(record.bytes.data(), record.bytes.size());
+            return;
+        }
+
+        size_t position = 0;
+        for (const auto &string : record.strings) {
+            stream.write(record.bytes.data() + position, string.first - position);
+            position = string.first;
+            writeString(string.second);
+        }
+        stream.write(record.bytes.data() + position, record.bytes.size() - position);
+    }
+
+   private:
+    void writeString(uint32_t pool_id) {
+        if (pool_id == UINT32_MAX) {
+            writeValue(uint32_t(0));
+            return;
+        }
+        if (pool_id >= ids.size()) ids.resize(pool_id + 1, 0);
+        if (ids[pool_id] != 0) {
+            writeValue(ids[pool_id]);
+            return;
+        }
+        ids[pool_id] = next_id++;
+        const std::string &value = pool.get(pool_id);
+        writeValue(ids[pool_id]);
+        writeValue(static_cast<uint32_t>(value.size()));
+        stream.write(value.data(), value.size());
+    }
+
+    template <typename T>
+    void writeValue(T value) {
+        stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    std::ostream &stream;
+    const bool binary;
+    const ApiDumpStringPool &pool;
+    std::vector<uint32_t> ids;  // Pool id to output id, 0 until written
+    uint32_t next_id = 1;
+};
+
+// Hands work from a thread to others, making the producer wait while the queue is full so memory use stays bounded
+template <typename T>
+class ApiDumpQueue {
+   public:
+    explicit ApiDumpQueue(size_t capacity) : capacity(capacity) {}
+
+    // Returns false if the queue was closed
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space_available.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(value));
+        item_available.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and empty
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        item_available.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        value = std::move(items.front());
+        items.pop_front();
+        space_available.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        item_available.notify_all();
+        space_available.notify_all();
+    }
+
+   private:
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable item_available;
+    std::condition_variable space_available;
+    std::deque<T> items;
+    bool closed = false;
+};
@@ -0,0 +1,139 @@
+/* Copyright (c) 2024 Valve Corporation
+ * Copyright (c) 2024 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Prints the frame statistics the monitor layer publishes in shared memory when its telemetry setting is enabled.
+//
+// The segment is mapped read only and polled, the application is never interrupted.
+
+#include "monitor_telemetry.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void PrintUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <pid | segment>\n"
+            "Prints the frame statistics the monitor layer of a process publishes in shared memory.\n"
+            "The segment of a process is /vk_monitor.<pid>.\n"
+            "\n"
+            "Options:\n"
+            "  --interval <ms>       Time between two prints, 500 ms by default\n"
+            "  --count <n>           Stop after n prints, 0 to never stop, the default\n",
+            program);
+}
+
+struct Options {
+    std::string segment;
+    uint32_t interval_ms = 500;
+    uint64_t count = 0;
+};
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--interval" && i + 1 < argc) {
+            options.interval_ms = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--count" && i + 1 < argc) {
+            options.count = strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] != '-' && options.segment.empty()) {
+            // A process id or the name of the segment itself
+            const bool is_pid = arg.find_first_not_of("0123456789") == std::string::npos;
+            options.segment = is_pid ? monitor::telemetry_segment_name(strtoull(arg.c_str(), nullptr, 10)) : arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.segment.empty();
+}
+
+const monitor::telemetry_layout *MapSegment(const std::string &name) {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(monitor::telemetry_layout)) {
+        memory = mmap(nullptr, sizeof(monitor::telemetry_layout), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    return memory == MAP_FAILED ? nullptr : static_cast<const monitor::telemetry_layout *>(memory);
+}
+
+void PrintSwapchains(const monitor::telemetry_layout &layout) {
+    bool any = false;
+    for (uint32_t i = 0; i < layout.slot_count && i < monitor::kTelemetryMaxSwapchains; i++) {
+        monitor::telemetry_swapchain swapchain;
+        if (!monitor::telemetry_read(layout.slots[i], swapchain)) {
+            printf("slot %u: busy\n", i);
+            continue;
+        }
+        if (!swapchain.in_use) continue;
+        any = true;
+        printf("slot %u: swapchain 0x%" PRIx64 " of device 0x%" PRIx64 " at %.3f s: %" PRIu64
+               " frames, FPS = %.2f, 1%% low = %.1f, 0.1%% low = %.1f, p50 / p95 / p99 = %.2f / %.2f / %.2f ms, "
+               "stutters = %u over %u frames\n",
+               i, swapchain.swapchain, swapchain.device, swapchain.update_ns / 1e9, swapchain.total_frames,
+               swapchain.average_fps, swapchain.low_1_percent_fps, swapchain.low_0_1_percent_fps, swapchain.p50_ms,
+               swapchain.p95_ms, swapchain.p99_ms, swapchain.stutter_count, swapchain.window_frames);
+    }
+    if (!any) printf("no swapchain\n");
+    fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    const monitor::telemetry_layout *layout = MapSegment(options.segment);
+    if (layout == nullptr) {
+        fprintf(stderr, "monitor_telemetry_reader: could not open %s, is the telemetry setting of the monitor layer enabled?\n",
+                options.segment.c_str());
+        return 1;
+    }
+    if (memcmp(layout->magic, monitor::kTelemetryMagic, sizeof(monitor::kTelemetryMagic)) != 0 ||
+        layout->version != monitor::kTelemetryVersion) {
+        fprintf(stderr, "monitor_telemetry_reader: %s is not a version %u monitor telemetry segment\n", options.segment.c_str(),
+                monitor::kTelemetryVersion);
+        return 1;
+    }
+
+    // Once the application destroys its last instance, the segment is unlinked and stops changing
+    for (uint64_t printed = 0; options.count == 0 || printed < options.count; printed++) {
+        if (printed > 0) std::this_thread::sleep_for(std::chrono::milliseconds(options.interval_ms));
+        printf("process %" PRIu64 "\n", layout->process_id);
+        PrintSwapchains(*layout);
+    }
+
+    munmap(const_cast<monitor::telemetry_layout *>(layout), sizeof(monitor::telemetry_layout));
+    return 0;
+}
@@ -22,59 +22,16 @@
 #include "vulkan/vk_layer.h"
 #include "vk_layer_table.h"
 
-static device_table_map tableMap;
-static instance_table_map tableInstanceMap;
+device_table_map device_dispatch_tables;
+instance_table_map instance_dispatch_tables;
 
-dispatch_key get_dispatch_key(const void *object) { return (dispatch_key) * (VkuDeviceDispatchTable **)object; }
+void destroy_dispatch_table(device_table_map &map, dispatch_key key) { delete map.erase(key); }
 
-// Map lookup must be thread safe
-VkuDeviceDispatchTable *device_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    device_table_map::const_iterator it = tableMap.find((void *)key);
-    assert(it != tableMap.end() && "Not able to find device dispatch entry");
-    return it->second;
-}
-
-VkuInstanceDispatchTable *instance_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    instance_table_map::const_iterator it = tableInstanceMap.find((void *)key);
-    assert(it != tableInstanceMap.end() && "Not able to find instance dispatch entry");
-    return it->second;
-}
-
-void destroy_dispatch_table(device_table_map &map, dispatch_key key) {
-    device_table_map::const_iterator it = map.find((void *)key);
-    if (it != map.end()) {
-        delete it->second;
-        map.erase(it);
-    }
-}
-
-void destroy_dispatch_table(instance_table_map &map, dispatch_key key) {
-    instance_table_map::const_iterator it = map.find((void *)key);
-    if (it != map.end()) {
-        delete it->second;
-        map.erase(it);
-    }
-}
+void destroy_dispatch_table(instance_table_map &map, dispatch_key key) { delete map.erase(key); }
 
-void destroy_device_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableMap, key); }
+void destroy_device_dispatch_table(dispatch_key key) { destroy_dispatch_table(device_dispatch_tables, key); }
 
-void destroy_instance_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableInstanceMap, key); }
-
-VkuDeviceDispatchTable *get_dispatch_table(device_table_map &map, void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    device_table_map::const_iterator it = map.find((void *)key);
-    assert(it != map.end() && "Not able to find device dispatch entry");
-    return it->second;
-}
-
-VkuInstanceDispatchTable *get_dispatch_table(instance_table_map &map, void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    instance_table_map::const_iterator it = map.find((void *)key);
-    assert(it != map.end() && "Not able to find instance dispatch entry");
-    return it->second;
-}
+void destroy_instance_dispatch_table(dispatch_key key) { destroy_dispatch_table(instance_dispatch_tables, key); }
 
 VkLayerInstanceCreateInfo *get_chain_info(const VkInstanceCreateInfo *pCreateInfo, VkLayerFunction func) {
     VkLayerInstanceCreateInfo *chain_info = (VkLayerInstanceCreateInfo *)pCreateInfo->pNext;
@@ -102,47 +59,48 @@ VkLayerDeviceCreateInfo *get_chain_info(const VkDeviceCreateInfo *pCreateInfo, V
  * If use the object themselves as key to map then implies Create entrypoints have to be intercepted
  * and a new key inserted into map */
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa, instance_table_map &map) {
-    VkuInstanceDispatchTable *pTable;
     dispatch_key key = get_dispatch_key(instance);
-    instance_table_map::const_iterator it = map.find((void *)key);
-
-    if (it == map.end()) {
-        pTable = new VkuInstanceDispatchTable;
-        map[(void *)key] = pTable;
-    } else {
-        return it->second;
+    VkuInstanceDispatchTable *pTable = map.find(key);
+    if (pTable != nullptr) {
+        return pTable;
     }
 
+    // Fill the table before publishing it, other threads may look it up as soon as it is in the map
+    pTable = new VkuInstanceDispatchTable;
     vkuInitInstanceDispatchTable(instance, pTable, gpa);
 
     // Setup func pointers that are required but not externally exposed.  These won't be added to the instance dispatch table by
     // default.
     pTable->GetPhysicalDeviceProcAddr = (PFN_GetPhysicalDeviceProcAddr)gpa(instance, "vk_layerGetPhysicalDeviceProcAddr");
 
-    return pTable;
+    VkuInstanceDispatchTable *pMapped = map.insert(key, pTable);
+    if (pMapped != pTable) {
+        delete pTable;
+    }
+    return pMapped;
 }
 
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa) {
-    return initInstanceTable(instance, gpa, tableInstanceMap);
+    return initInstanceTable(instance, gpa, instance_dispatch_tables);
 }
 
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa, device_table_map &map) {
-    VkuDeviceDispatchTable *pTable;
     dispatch_key key = get_dispatch_key(device);
-    device_table_map::const_iterator it = map.find((void *)key);
-
-    if (it == map.end()) {
-        pTable = new VkuDeviceDispatchTable;
-        map[(void *)key] = pTable;
-    } else {
-        return it->second;
+    VkuDeviceDispatchTable *pTable = map.find(key);
+    if (pTable != nullptr) {
+        return pTable;
     }
 
+    pTable = new VkuDeviceDispatchTable;
     vkuInitDeviceDispatchTable(device, pTable, gpa);
 
-    return pTable;
+    VkuDeviceDispatchTable *pMapped = map.insert(key, pTable);
+    if (pMapped != pTable) {
+        delete pTable;
+    }
+    return pMapped;
 }
 
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa) {
-    return initDeviceTable(device, gpa, tableMap);
+    return initDeviceTable(device, gpa, device_dispatch_tables);
 }
@@ -22,27 +22,206 @@
 #include <vulkan/utility/vk_dispatch_table.h>
 #include "vulkan/vk_layer.h"
 #include "vulkan/vulkan.h"
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <cstring>
 
-typedef std::unordered_map<void *, VkuDeviceDispatchTable *> device_table_map;
-typedef std::unordered_map<void *, VkuInstanceDispatchTable *> instance_table_map;
+typedef void *dispatch_key;
+
+// Read-mostly map from dispatch key to dispatch table.
+//
+// Tables are looked up on every intercepted call but only added or removed when an instance or device is created or destroyed,
+// so find() is wait-free: it probes an open-addressing array that writers only ever publish whole through an atomic pointer.
+// insert() and erase() serialize on a mutex. Erasing clears the value and leaves the key behind while the probe sequence of a
+// live key goes through the slot, the slot is then taken back by the next key inserted on the same probe sequence. When the
+// array gets half full it is copied into one four times the size of the live entries. The old arrays are kept because a reader
+// may still be probing them, until the last table is erased: then no object can be in use, so nothing probes them anymore.
+template <typename TABLE_T>
+class dispatch_table_map {
+   public:
+    dispatch_table_map() : storage(new Storage(kInitialCapacity, nullptr)) {}
+    ~dispatch_table_map() { delete storage.load(std::memory_order_relaxed); }
+
+    dispatch_table_map(const dispatch_table_map &) = delete;
+    dispatch_table_map &operator=(const dispatch_table_map &) = delete;
+
+    // Returns the table for key, or nullptr if there is none
+    TABLE_T *find(dispatch_key key) const {
+        const Storage *current = storage.load(std::memory_order_acquire);
+        for (size_t i = hash(key) & current->mask;; i = (i + 1) & current->mask) {
+            const void *slot_key = current->slots[i].key.load(std::memory_order_acquire);
+            if (slot_key == key) return current->slots[i].value.load(std::memory_order_acquire);
+            if (slot_key == nullptr) return nullptr;
+        }
+    }
+
+    // Adds table for key and returns it. If key already has a table, that one is kept and returned instead.
+    TABLE_T *insert(dispatch_key key, TABLE_T *table) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        Storage *current = storage.load(std::memory_order_relaxed);
+        Slot *erased = nullptr;
+        Slot *slot = find_slot(current, key, &erased);
+        if (slot->key.load(std::memory_order_relaxed) == key) {
+            TABLE_T *existing = slot->value.load(std::memory_order_relaxed);
+            if (existing != nullptr) return existing;
+            slot->value.store(table, std::memory_order_release);
+            current->live++;
+            return table;
+        }
+        if (erased != nullptr) {
+            // Readers probing for other keys only compare the key of the slot, so replacing the erased key keeps their probe
+            // sequences intact
+            slot = erased;
+        } else {
+            if ((current->used + 1) * 2 > current->mask + 1) {
+                current = grow(current);
+                slot = find_slot(current, key, nullptr);
+            }
+            current->used++;
+        }
+        // The value must be visible before the key, a reader that finds the key reads the value right after
+        slot->value.store(table, std::memory_order_relaxed);
+        slot->key.store(key, std::memory_order_release);
+        current->live++;
+        return table;
+    }
+
+    // Removes the table for key and returns it so the caller can free it, or nullptr if there is none
+    TABLE_T *erase(dispatch_key key) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        Storage *current = storage.load(std::memory_order_relaxed);
+        Slot *slot = find_slot(current, key, nullptr);
+        if (slot->key.load(std::memory_order_relaxed) != key) return nullptr;
+        TABLE_T *table = slot->value.exchange(nullptr, std::memory_order_acq_rel);
+        if (table == nullptr) return nullptr;
+        if (--current->live == 0) current->previous.reset();
+        clear_erased(current, static_cast<size_t>(slot - current->slots.get()));
+        return table;
+    }
+
+   private:
+    static constexpr size_t kInitialCapacity = 16;
+
+    struct Slot {
+        std::atomic<void *> key{nullptr};
+        std::atomic<TABLE_T *> value{nullptr};
+    };
+
+    struct Storage {
+        Storage(size_t capacity, Storage *retired) : mask(capacity - 1), slots(new Slot[capacity]), previous(retired) {}
+        const size_t mask;
+        size_t used = 0;  // Slots with a key, including erased ones
+        size_t live = 0;  // Slots with a table
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<Storage> previous;  // Retired storage a reader may still be probing
+    };
+
+    // Dispatch keys are pointers to loader dispatch tables, so the low bits carry no information
+    static size_t hash(const void *key) {
+        return static_cast<size_t>((reinterpret_cast<uintptr_t>(key) >> 4) * UINT64_C(0x9E3779B97F4A7C15) >> 16);
+    }
+
+    // Returns the slot holding key, or the empty slot it would be inserted in. If erased is not null, it is set to the first
+    // slot of another key erased on the way, if any.
+    static Slot *find_slot(Storage *current, const void *key, Slot **erased) {
+        for (size_t i = hash(key) & current->mask;; i = (i + 1) & current->mask) {
+            Slot *slot = &current->slots[i];
+            const void *slot_key = slot->key.load(std::memory_order_relaxed);
+            if (slot_key == key || slot_key == nullptr) return slot;
+            if (erased != nullptr && *erased == nullptr && slot->value.load(std::memory_order_relaxed) == nullptr) {
+                *erased = slot;
+            }
+        }
+    }
+
+    // Empties the erased slots of the run of keys around index that no probe sequence of a live key goes through, so a reader
+    // can't miss a live key and erased slots don't pile up until the array has to grow
+    static void clear_erased(Storage *current, size_t index) {
+        size_t begin = index;
+        while (current->slots[(begin - 1) & current->mask].key.load(std::memory_order_relaxed) != nullptr) {
+            begin = (begin - 1) & current->mask;
+        }
+        const auto offset = [&](size_t i) { return (i - begin) & current->mask; };
+
+        for (size_t i = begin; current->slots[i].key.load(std::memory_order_relaxed) != nullptr; i = (i + 1) & current->mask) {
+            if (current->slots[i].value.load(std::memory_order_relaxed) != nullptr) continue;
+            bool probed = false;
+            for (size_t j = (i + 1) & current->mask; !probed; j = (j + 1) & current->mask) {
+                const void *key = current->slots[j].key.load(std::memory_order_relaxed);
+                if (key == nullptr) break;
+                probed = current->slots[j].value.load(std::memory_order_relaxed) != nullptr &&
+                         offset(hash(key) & current->mask) <= offset(i);
+            }
+            if (!probed) {
+                current->slots[i].key.store(nullptr, std::memory_order_relaxed);
+                current->used--;
+            }
+        }
+    }
+
+    Storage *grow(Storage *current) {
+        size_t capacity = kInitialCapacity;
+        while (capacity < (current->live + 1) * 4) capacity *= 2;
+
+        Storage *grown = new Storage(capacity, current);
+        for (size_t i = 0; i <= current->mask; i++) {
+            TABLE_T *table = current->slots[i].value.load(std::memory_order_relaxed);
+            if (table == nullptr) continue;
+            void *key = current->slots[i].key.load(std::memory_order_relaxed);
+            Slot *slot = find_slot(grown, key, nullptr);
+            slot->value.store(table, std::memory_order_relaxed);
+            slot->key.store(key, std::memory_order_relaxed);
+            grown->used++;
+            grown->live++;
+        }
+        storage.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    std::atomic<Storage *> storage;
+    std::mutex write_mutex;
+};
+
+typedef dispatch_table_map<VkuDeviceDispatchTable> device_table_map;
+typedef dispatch_table_map<VkuInstanceDispatchTable> instance_table_map;
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa, device_table_map &map);
 VkuDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa);
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa, instance_table_map &map);
 VkuInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa);
 
-typedef void *dispatch_key;
+// The tables looked up by device_dispatch_table() and instance_dispatch_table()
+extern device_table_map device_dispatch_tables;
+extern instance_table_map instance_dispatch_tables;
 
-dispatch_key get_dispatch_key(const void *object);
+// The lookups below run on every intercepted call, so they are inline: the dispatch key load and a single probe of the
+// table map in the common case, without a call into vk_layer_table.cpp.
+inline dispatch_key get_dispatch_key(const void *object) { return (dispatch_key) * (VkuDeviceDispatchTable **)object; }
 
-VkuDeviceDispatchTable *device_dispatch_table(void *object);
+inline VkuDeviceDispatchTable *get_dispatch_table(device_table_map &map, void *object) {
+    VkuDeviceDispatchTable *pTable = map.find(get_dispatch_key(object));
+    assert(pTable != nullptr && "Not able to find device dispatch entry");
+    return pTable;
+}
 
-VkuInstanceDispatchTable *instance_dispatch_table(void *object);
+inline VkuInstanceDispatchTable *get_dispatch_table(instance_table_map &map, void *object) {
+    VkuInstanceDispatchTable *pTable = map.find(get_dispatch_key(object));
+    assert(pTable != nullptr && "Not able to find instance dispatch entry");
+    return pTable;
+}
 
-VkuDeviceDispatchTable *get_dispatch_table(device_table_map &map, void *object);
+inline VkuDeviceDispatchTable *device_dispatch_table(void *object) { return get_dispatch_table(device_dispatch_tables, object); }
 
-VkuInstanceDispatchTable *get_dispatch_table(instance_table_map &map, void *object);
+inline VkuInstanceDispatchTable *instance_dispatch_table(void *object) {
+    return get_dispatch_table(instance_dispatch_tables, object);
+}
 
 VkLayerInstanceCreateInfo *get_chain_info(const VkInstanceCreateInfo *pCreateInfo, VkLayerFunction func);
 VkLayerDeviceCreateInfo *get_chain_info(const VkDeviceCreateInfo *pCreateInfo, VkLayerFunction func);
@@ -52,22 +231,164 @@ void destroy_instance_dispatch_table(dispatch_key key);
 void destroy_dispatch_table(device_table_map &map, dispatch_key key);
 void destroy_dispatch_table(instance_table_map &map, dispatch_key key);
 
-// For the given data key, look up the layer_data instance from given layer_data_map
-template <typename DATA_T>
-DATA_T *GetLayerDataPtr(void *data_key, std::unordered_map<void *, DATA_T *> &layer_data_map) {
-    DATA_T *debug_data;
-    /* TODO: We probably should lock here, or have caller lock */
-    auto got = layer_data_map.find(data_key);
+// Thread-safe map from a handle or dispatch key to the data a layer keeps for it.
+//
+// The keys are spread over SHARD_COUNT shards, each with its own mutex, open-addressing index and pool of DATA_T slots, so
+// threads working on different objects rarely contend and adding an object does not allocate once its shard has grown.
+// Lifetime is explicit: emplace() constructs the data and erase() destroys it. The pointers returned stay valid until the
+// data is erased; as with the handles themselves, the application must not use an object while another thread destroys it.
+template <typename KEY_T, typename DATA_T, size_t SHARD_COUNT = 16>
+class layer_data_store {
+   public:
+    layer_data_store() = default;
+    ~layer_data_store() { clear(); }
+
+    layer_data_store(const layer_data_store &) = delete;
+    layer_data_store &operator=(const layer_data_store &) = delete;
 
-    if (got == layer_data_map.end()) {
-        debug_data = new DATA_T;
-        layer_data_map[(void *)data_key] = debug_data;
-    } else {
-        debug_data = got->second;
+    // Constructs the data of key from args and returns it. If key already has data, that is returned instead.
+    template <typename... ARGS>
+    DATA_T *emplace(KEY_T key, ARGS &&...args) {
+        const uint64_t hash = key_hash(key);
+        Shard &shard = shards[(hash >> 56) % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry *entry = shard.find_entry(key, hash);
+        if (entry != nullptr) return entry->data;
+        DATA_T *data = new (shard.allocate()) DATA_T(std::forward<ARGS>(args)...);
+        shard.insert_entry(key, hash, data);
+        return data;
     }
 
-    return debug_data;
-}
+    // Returns the data of key, or nullptr if there is none
+    DATA_T *find(KEY_T key) {
+        const uint64_t hash = key_hash(key);
+        Shard &shard = shards[(hash >> 56) % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry *entry = shard.find_entry(key, hash);
+        return entry != nullptr ? entry->data : nullptr;
+    }
+
+    // Destroys the data of key, returns false if there was none
+    bool erase(KEY_T key) {
+        const uint64_t hash = key_hash(key);
+        Shard &shard = shards[(hash >> 56) % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry *entry = shard.find_entry(key, hash);
+        if (entry == nullptr) return false;
+        shard.release(entry->data);
+        entry->state = Entry::kErased;
+        shard.count--;
+        return true;
+    }
+
+    // Destroys the data of every key
+    void clear() {
+        for (Shard &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (Entry &entry : shard.entries) {
+                if (entry.state == Entry::kUsed) shard.release(entry.data);
+            }
+            shard.entries.clear();
+            shard.count = 0;
+            shard.used = 0;
+        }
+    }
+
+   private:
+    static constexpr size_t kSlotsPerBlock = 32;
+
+    struct Entry {
+        enum State : uint8_t { kEmpty, kUsed, kErased };
+        KEY_T key;
+        DATA_T *data;
+        State state;
+    };
+
+    // Storage for one DATA_T, or the link to the next free slot of the pool while it holds none
+    union Slot {
+        Slot *next_free;
+        alignas(DATA_T) unsigned char storage[sizeof(DATA_T)];
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;  // Open addressing, the size is 0 or a power of two
+        size_t count = 0;            // Entries holding data
+        size_t used = 0;             // Entries holding data or erased
+        std::vector<std::unique_ptr<Slot[]>> blocks;
+        Slot *free_slots = nullptr;
+
+        Entry *find_entry(KEY_T key, uint64_t hash) {
+            if (entries.empty()) return nullptr;
+            const size_t mask = entries.size() - 1;
+            for (size_t i = (hash >> 24) & mask;; i = (i + 1) & mask) {
+                Entry &entry = entries[i];
+                if (entry.state == Entry::kEmpty) return nullptr;
+                if (entry.state == Entry::kUsed && entry.key == key) return &entry;
+            }
+        }
+
+        void insert_entry(KEY_T key, uint64_t hash, DATA_T *data) {
+            if ((used + 1) * 2 > entries.size()) rehash();
+            const size_t mask = entries.size() - 1;
+            size_t i = (hash >> 24) & mask;
+            while (entries[i].state == Entry::kUsed) i = (i + 1) & mask;
+            if (entries[i].state == Entry::kEmpty) used++;
+            entries[i] = {key, data, Entry::kUsed};
+            count++;
+        }
+
+        // Drops the erased entries, and doubles the size if more than a quarter of it would still be in use
+        void rehash() {
+            size_t size = 16;
+            while (size < (count + 1) * 4) size *= 2;
+            std::vector<Entry> previous = std::move(entries);
+            entries.assign(size, Entry{KEY_T{}, nullptr, Entry::kEmpty});
+            used = count;
+            for (const Entry &entry : previous) {
+                if (entry.state != Entry::kUsed) continue;
+                size_t i = (key_hash(entry.key) >> 24) & (size - 1);
+                while (entries[i].state != Entry::kEmpty) i = (i + 1) & (size - 1);
+                entries[i] = entry;
+            }
+        }
+
+        void *allocate() {
+            if (free_slots == nullptr) {
+                blocks.emplace_back(new Slot[kSlotsPerBlock]);
+                for (size_t i = 0; i < kSlotsPerBlock; i++) {
+                    blocks.back()[i].next_free = free_slots;
+                    free_slots = &blocks.back()[i];
+                }
+            }
+            Slot *slot = free_slots;
+            free_slots = slot->next_free;
+            return slot->storage;
+        }
+
+        void release(DATA_T *data) {
+            data->~DATA_T();
+            Slot *slot = reinterpret_cast<Slot *>(data);
+            slot->next_free = free_slots;
+            free_slots = slot;
+        }
+    };
+
+    // Handles and dispatch keys are aligned pointers or driver chosen 64-bit values, so they are mixed before use. The top
+    // byte picks the shard and the bits from 24 up the entry in it.
+    static uint64_t key_hash(KEY_T key) {
+        uint64_t bits;
+        if constexpr (std::is_pointer_v<KEY_T>) {
+            bits = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+        } else {
+            bits = static_cast<uint64_t>(key);
+        }
+        bits ^= bits >> 29;
+        return bits * UINT64_C(0x9E3779B97F4A7C15);
+    }
+
+    Shard shards[SHARD_COUNT];
+};
 
 inline VkResult util_GetExtensionProperties(const uint32_t count, const VkExtensionProperties *layer_extensions, uint32_t *pCount,
                                             VkExtensionProperties *pProperties) {
@@ -35,9 +35,14 @@
 # Currently, the API dump layer generates the following files from the following strings:
 #   * api_dump.cpp: COMMON_CODEGEN - Provides all entrypoints for functions and dispatches the calls
 #       to the proper back end
-#   * api_dump_text.h: TEXT_CODEGEN - Provides the back end for dumping to a text file
-#   * api_dump_html.h: HTML_CODEGEN - Provides the back end for dumping to a html document
-#   * api_dump_json.h: JSON_CODEGEN - Provides the back end for dumping to a JSON file
+#   * api_dump_backends.h: BACKENDS_CODEGEN - Declares the per-function entrypoints of each back end
+#   * api_dump_text.cpp: TEXT_CODEGEN - Provides the back end for dumping to a text file
+#   * api_dump_html.cpp: HTML_CODEGEN - Provides the back end for dumping to a html document
+#   * api_dump_video_{text,html}.h: The same back ends for the video std headers, included by the back end above
+#   * api_dump_reflection_tables.cpp: REFLECTION_CODEGEN - Describes every struct, union and function in tables walked by
+#       api_dump_reflection.cpp, which implements the json, binary, ndjson and csv formats
+#
+# Each back end is its own translation unit and only the formats listed in APIDUMP_OUTPUT_FORMATS are built.
 #
 
 import os,re,sys,string
@@ -52,6 +57,12 @@ BLOCKING_API_CALLS = [
     'vkQueueWaitIdle', 'vkAcquireNextImageKHR', 'vkGetQueryPoolResults',
 ]
 
+# Calls that lock the output mutex even when call_range or command_range don't select them: vkQueuePresentKHR starts the
+# next frame, and the destroy calls free the dispatch tables the other calls use.
+SERIALIZED_API_CALLS = [
+    'vkQueuePresentKHR', 'vkDestroyInstance', 'vkDestroyDevice',
+]
+
 COMMON_CODEGEN = """
 /* Copyright (c) 2015-2016, 2021 Valve Corporation
  * Copyright (c) 2015-2016, 2021 LunarG, Inc.
@@ -78,9 +89,8 @@ COMMON_CODEGEN = """
  * This file is generated from the Khronos Vulkan XML API Registry.
  */
 
-#include "api_dump_text.h"
-#include "api_dump_html.h"
-#include "api_dump_json.h"
+#include "api_dump.h"
+#include "api_dump_backends.h"
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
@@ -96,8 +106,11 @@ COMMON_CODEGEN = """
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance)
 {{
-    ApiDumpInstance::current().outputMutex()->lock();
+    std::recursive_mutex* output_mutex = ApiDumpInstance::current().outputMutex();
+    output_mutex->lock();
     ApiDumpInstance::current().initLayerSettings(pCreateInfo, pAllocator);
+    static std::atomic<uint64_t> command_calls{{0}};
+    ApiDumpInstance::current().beginCall("vkCreateInstance", command_calls, true);
     dump_function_head(ApiDumpInstance::current(), "vkCreateInstance", "pCreateInfo, pAllocator, pInstance", "VkResult");
 
     // Get the function pointer
@@ -112,6 +125,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCre
 
     // Call the function and create the dispatch table
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    ApiDumpInstance::current().startCallTimer();
     VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
     if(result == VK_SUCCESS) {{
         initInstanceTable(*pInstance, fpGetInstanceProcAddr);
@@ -121,24 +135,40 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCre
     if (ApiDumpInstance::current().shouldDumpOutput()) {{
         switch(ApiDumpInstance::current().settings().format())
         {{
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ &pCreateInfo, &pAllocator, &pInstance }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_vkCreateInstance, &result, args);
+                break;
+            }}
+#endif
+            default:
                 break;
         }}
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
+    output_mutex->unlock();
     return result;
 }}
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDevice* pDevice)
 {{
-    ApiDumpInstance::current().outputMutex()->lock();
+    static std::atomic<uint64_t> command_calls{{0}};
+    std::recursive_mutex* output_mutex = ApiDumpInstance::current().beginCall("vkCreateDevice", command_calls, true);
+    output_mutex->lock();
     dump_function_head(ApiDumpInstance::current(), "vkCreateDevice", "physicalDevice, pCreateInfo, pAllocator, pDevice", "VkResult");
 
     // Get the function pointer
@@ -154,6 +184,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, c
 
     // Call the function and create the dispatch table
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    ApiDumpInstance::current().startCallTimer();
     VkResult result = fpCreateDevice(physicalDevice, pCreateInfo, pAllocator, pDevice);
     if(result == VK_SUCCESS) {{
         initDeviceTable(*pDevice, fpGetDeviceProcAddr);
@@ -163,18 +194,32 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, c
     if (ApiDumpInstance::current().shouldDumpOutput()) {{
         switch(ApiDumpInstance::current().settings().format())
         {{
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ &physicalDevice, &pCreateInfo, &pAllocator, &pDevice }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_vkCreateDevice, &result, args);
+                break;
+            }}
+#endif
+            default:
                 break;
         }}
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
+    output_mutex->unlock();
     return result;
 }}
 
@@ -211,13 +256,34 @@ EXPORT_FUNCTION VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(
     return util_GetLayerProperties(ARRAY_SIZE(layerProperties), layerProperties, pPropertyCount, pProperties);
 }}
 
+// Enum and bitmask name tables, shared by the back ends
+
+@foreach enum
+static const char* const api_dump_enum_strings_{enumName}[] = {{
+    {enumNameList}
+}};
+static const ApiDumpEnumBlock api_dump_enum_blocks_{enumName}[] = {{ {enumBlockList} }};
+extern const ApiDumpEnumNames api_dump_enum_names_{enumName} = {{ api_dump_enum_strings_{enumName}, api_dump_enum_blocks_{enumName}, {enumBlockCount} }};
+@end enum
+
+@foreach bitmask
+static const char* const api_dump_bit_strings_{bitName}[] = {{
+    {bitNameList}
+}};
+static const uint32_t api_dump_bit_order_{bitName}[] = {{ {bitOrderList} }};
+static const ApiDumpFlagName api_dump_bit_values_{bitName}[] = {{ {bitExactValues}{{0, nullptr, 0}} }};
+extern const ApiDumpBitmaskNames api_dump_bitmask_names_{bitName} = {{ api_dump_bit_strings_{bitName}, api_dump_bit_order_{bitName}, {bitNameCount}, api_dump_bit_values_{bitName} }};
+@end bitmask
+
 // Autogen instance functions
 
 @foreach function where('{funcDispatchType}' == 'instance' and '{funcName}' not in ['vkCreateInstance', 'vkCreateDevice', 'vkGetInstanceProcAddr', 'vkEnumerateDeviceExtensionProperties', 'vkEnumerateDeviceLayerProperties'])
 VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 {{
+    static std::atomic<uint64_t> command_calls{{0}};
+    std::recursive_mutex* output_mutex = ApiDumpInstance::current().beginCall("{funcName}", command_calls, {funcSerialized});
     @if('{funcName}' not in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
+    if (output_mutex) output_mutex->lock();
     dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
     @end if
 
@@ -239,6 +305,7 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     }}
     @end if
 
+    ApiDumpInstance::current().startCallTimer();
     @if('{funcReturn}' != 'void')
     {funcReturn} result = instance_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
@@ -246,7 +313,7 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     instance_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
     @if('{funcName}' in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
+    if (output_mutex) output_mutex->lock();
     dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
     @end if
     {funcStateTrackingCode}
@@ -273,30 +340,56 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
         switch(ApiDumpInstance::current().settings().format())
         {{
             @if('{funcReturn}' != 'void')
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ {funcParamAddresses} }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_{funcName}, &result, args);
                 break;
+            }}
+#endif
             @end if
             @if('{funcReturn}' == 'void')
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ {funcParamAddresses} }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_{funcName}, nullptr, args);
                 break;
+            }}
+#endif
             @end if
+            default:
+                break;
         }}
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
+    if (output_mutex) output_mutex->unlock();
     @if('{funcReturn}' != 'void')
     return result;
     @end if
@@ -308,14 +401,17 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 @foreach function where('{funcDispatchType}' == 'device' and '{funcName}' not in ['vkGetDeviceProcAddr'])
 VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 {{
+    static std::atomic<uint64_t> command_calls{{0}};
+    std::recursive_mutex* output_mutex = ApiDumpInstance::current().beginCall("{funcName}", command_calls, {funcSerialized});
     @if('{funcName}' not in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
+    if (output_mutex) output_mutex->lock();
     @if('{funcName}' in ['vkDebugMarkerSetObjectNameEXT', 'vkSetDebugUtilsObjectNameEXT'])
     ApiDumpInstance::current().update_object_name_map(pNameInfo);
     @end if
     dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
     @end if
 
+    ApiDumpInstance::current().startCallTimer();
     @if('{funcReturn}' != 'void')
     {funcReturn} result = device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
@@ -323,7 +419,7 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
     @if('{funcName}' in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
+    if (output_mutex) output_mutex->lock();
     dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
     @end if
     {funcStateTrackingCode}
@@ -335,33 +431,59 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
         switch(ApiDumpInstance::current().settings().format())
         {{
             @if('{funcReturn}' != 'void')
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ {funcParamAddresses} }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_{funcName}, &result, args);
                 break;
+            }}
+#endif
             @end if
             @if('{funcReturn}' == 'void')
+#if defined(API_DUMP_FORMAT_TEXT)
             case ApiDumpFormat::Text:
                 dump_text_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_FORMAT_HTML)
             case ApiDumpFormat::Html:
                 dump_html_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
                 break;
+#endif
+#if defined(API_DUMP_REFLECTION)
             case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
+            case ApiDumpFormat::Binary:
+            case ApiDumpFormat::Ndjson:
+            case ApiDumpFormat::Csv:
+            {{
+                const void* args[] = {{ {funcParamAddresses} }};
+                dump_reflected_call(ApiDumpInstance::current(), api_dump_function_info_{funcName}, nullptr, args);
                 break;
+            }}
+#endif
             @end if
+            default:
+                break;
         }}
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
     @if('{funcName}' == 'vkQueuePresentKHR')
     ApiDumpInstance::current().nextFrame();
     @end if
+    if (output_mutex) output_mutex->unlock();
     @if('{funcReturn}' != 'void')
     return result;
     @end if
@@ -420,6 +542,57 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkD
 }}
 """
 
+BACKENDS_CODEGEN = """
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file is generated from the Khronos Vulkan XML API Registry.
+ */
+
+// Declarations of the per-function entry points of every back end. Each back end is compiled as a separate translation unit
+// (api_dump_text.cpp, api_dump_html.cpp) so this header is all api_dump.cpp needs to dispatch to them.
+// The json, binary, ndjson and csv formats share the reflection tables of api_dump_reflection_tables.cpp instead.
+
+#pragma once
+
+#include "api_dump.h"
+
+@foreach enum
+extern const ApiDumpEnumNames api_dump_enum_names_{enumName};
+@end enum
+@foreach bitmask
+extern const ApiDumpBitmaskNames api_dump_bitmask_names_{bitName};
+@end bitmask
+
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+@if('{funcReturn}' != 'void')
+void dump_text_{funcName}(ApiDumpInstance& dump_inst, {funcReturn} result, {funcTypedParams});
+void dump_html_{funcName}(ApiDumpInstance& dump_inst, {funcReturn} result, {funcTypedParams});
+@end if
+@if('{funcReturn}' == 'void')
+void dump_text_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams});
+void dump_html_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams});
+@end if
+#if defined(API_DUMP_REFLECTION)
+extern const ApiDumpFunctionInfo api_dump_function_info_{funcName};
+#endif
+@end function
+"""
+
 TEXT_CODEGEN = """
 /* Copyright (c) 2015-2023 Valve Corporation
  * Copyright (c) 2015-2023 LunarG, Inc.
@@ -446,11 +619,15 @@ TEXT_CODEGEN = """
  * This file is generated from the Khronos Vulkan XML API Registry.
  */
 
+@if({isVideoGeneration})
 #pragma once
+@end if
 
 #include "api_dump.h"
-#include "api_dump_video_text.h"
 @if(not {isVideoGeneration})
+#include "api_dump_backends.h"
+#include "api_dump_video_text.h"
+
 void dump_text_pNext_struct_name(const void* object, const ApiDumpSettings& settings, int indents, const char* pnext_type);
 void dump_text_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents);
 @end if
@@ -529,9 +706,9 @@ void dump_text_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
     if(settings.showAddress()) {{
         settings.stream() << object;
 
-        std::unordered_map<uint64_t, std::string>::const_iterator it = ApiDumpInstance::current().object_name_map.find((uint64_t) object);
-        if (it != ApiDumpInstance::current().object_name_map.end()) {{
-            settings.stream() << " [" << it->second << "]";
+        const std::string name = ApiDumpInstance::current().objectName((uint64_t) object);
+        if (!name.empty()) {{
+            settings.stream() << " [" << name << "]";
         }}
     }} else {{
         settings.stream() << "address";
@@ -542,19 +719,17 @@ void dump_text_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
 //=========================== Enum Implementations ==========================//
 
 @foreach enum
+@if({isVideoGeneration})
+static const char* const api_dump_enum_strings_{enumName}[] = {{
+    {enumNameList}
+}};
+static const ApiDumpEnumBlock api_dump_enum_blocks_{enumName}[] = {{ {enumBlockList} }};
+static const ApiDumpEnumNames api_dump_enum_names_{enumName} = {{ api_dump_enum_strings_{enumName}, api_dump_enum_blocks_{enumName}, {enumBlockCount} }};
+@end if
 void dump_text_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
 {{
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "{optName} (";
-        break;
-    @end option
-    default:
-        settings.stream() << "UNKNOWN (";
-    }}
-    settings.stream() << object << ")";
+    const char* name = api_dump_enum_name(api_dump_enum_names_{enumName}, (int64_t) object);
+    settings.stream() << (name != nullptr ? name : "UNKNOWN") << " (" << object << ")";
 }}
 @end enum
 
@@ -563,26 +738,21 @@ void dump_text_{enumName}({enumName} object, const ApiDumpSettings& settings, in
 @foreach bitmask
 @if('{bitWidth}' == '64')
 // 64 bit bitmasks don't have an enum of bit values.
-// NOTE: Because all of the api_dump_*.h files are only included in api_dump.cpp, this typedef
-// only needs to be generated by the first .h file.
+// NOTE: Each backend is compiled as its own translation unit, so every backend repeats this typedef.
 typedef VkFlags64 {bitName};
 @end if
+@if({isVideoGeneration})
+static const char* const api_dump_bit_strings_{bitName}[] = {{
+    {bitNameList}
+}};
+static const uint32_t api_dump_bit_order_{bitName}[] = {{ {bitOrderList} }};
+static const ApiDumpFlagName api_dump_bit_values_{bitName}[] = {{ {bitExactValues}{{0, nullptr, 0}} }};
+static const ApiDumpBitmaskNames api_dump_bitmask_names_{bitName} = {{ api_dump_bit_strings_{bitName}, api_dump_bit_order_{bitName}, {bitNameCount}, api_dump_bit_values_{bitName} }};
+@end if
 void dump_text_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
 {{
-    bool is_first = true;
     settings.stream() << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ")";
+    dump_bitmask_names(api_dump_bitmask_names_{bitName}, object, settings);
 }}
 @end bitmask
 
@@ -806,7 +976,8 @@ void dump_text_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
         @end if
         @end parameter
     }}
-    settings.shouldFlush() ? settings.stream() << std::endl : settings.stream() << "\\n";
+    settings.stream() << "\\n";
+    settings.flushCallOutput();
 }}
 @end function
 
@@ -843,11 +1014,15 @@ HTML_CODEGEN = """
  * This file is generated from the Khronos Vulkan XML API Registry.
  */
 
+@if({isVideoGeneration})
 #pragma once
+@end if
 
 #include "api_dump.h"
-#include "api_dump_video_html.h"
 @if(not {isVideoGeneration})
+#include "api_dump_backends.h"
+#include "api_dump_video_html.h"
+
 void dump_html_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents);
 @end if
 @foreach union
@@ -926,9 +1101,9 @@ void dump_html_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
     if(settings.showAddress()) {{
         settings.stream() << object;
 
-        std::unordered_map<uint64_t, std::string>::const_iterator it = ApiDumpInstance::current().object_name_map.find((uint64_t) object);
-        if (it != ApiDumpInstance::current().object_name_map.end()) {{
-            settings.stream() << "</div><div class='val'>[" << it->second << "]";
+        const std::string name = ApiDumpInstance::current().objectName((uint64_t) object);
+        if (!name.empty()) {{
+            settings.stream() << "</div><div class='val'>[" << name << "]";
         }}
     }} else {{
         settings.stream() << "address";
@@ -940,43 +1115,40 @@ void dump_html_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
 //=========================== Enum Implementations ==========================//
 
 @foreach enum
+@if({isVideoGeneration})
+static const char* const api_dump_enum_strings_{enumName}[] = {{
+    {enumNameList}
+}};
+static const ApiDumpEnumBlock api_dump_enum_blocks_{enumName}[] = {{ {enumBlockList} }};
+static const ApiDumpEnumNames api_dump_enum_names_{enumName} = {{ api_dump_enum_strings_{enumName}, api_dump_enum_blocks_{enumName}, {enumBlockCount} }};
+@end if
 void dump_html_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
 {{
-    settings.stream() << "<div class='val'>";
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "{optName} (";
-        break;
-    @end option
-    default:
-        settings.stream() << "UNKNOWN (";
-    }}
-    settings.stream() << object << ")</div></summary>";
+    const char* name = api_dump_enum_name(api_dump_enum_names_{enumName}, (int64_t) object);
+    settings.stream() << "<div class='val'>" << (name != nullptr ? name : "UNKNOWN") << " (" << object << ")</div></summary>";
 }}
 @end enum
 
 //========================= Bitmask Implementations =========================//
 
 @foreach bitmask
+@if('{bitWidth}' == '64')
+// 64 bit bitmasks don't have an enum of bit values.
+// NOTE: Each backend is compiled as its own translation unit, so every backend repeats this typedef.
+typedef VkFlags64 {bitName};
+@end if
+@if({isVideoGeneration})
+static const char* const api_dump_bit_strings_{bitName}[] = {{
+    {bitNameList}
+}};
+static const uint32_t api_dump_bit_order_{bitName}[] = {{ {bitOrderList} }};
+static const ApiDumpFlagName api_dump_bit_values_{bitName}[] = {{ {bitExactValues}{{0, nullptr, 0}} }};
+static const ApiDumpBitmaskNames api_dump_bitmask_names_{bitName} = {{ api_dump_bit_strings_{bitName}, api_dump_bit_order_{bitName}, {bitNameCount}, api_dump_bit_values_{bitName} }};
+@end if
 void dump_html_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
 {{
-    settings.stream() << "<div class=\'val\'>";
-    bool is_first = true;
-    settings.stream() << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ")";
+    settings.stream() << "<div class=\'val\'>" << object;
+    dump_bitmask_names(api_dump_bitmask_names_{bitName}, object, settings);
     settings.stream() << "</div></summary>";
 }}
 @end bitmask
@@ -1178,19 +1350,17 @@ void dump_html_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
         @end if
         @end parameter
     }}
-    settings.shouldFlush() ? settings.stream() << std::endl : settings.stream() << "\\n";
+    settings.stream() << "\\n";
+    settings.flushCallOutput();
 
     settings.stream() << "</details>";
 }}
 @end function
 """
 
-# This JSON Codegen is essentially copied from the HTML section above.
-
-JSON_CODEGEN = """
-/* Copyright (c) 2015-2023 Valve Corporation
- * Copyright (c) 2015-2023 LunarG, Inc.
- * Copyright (c) 2015-2017, 2019 Google Inc.
+REFLECTION_CODEGEN = """
+/* Copyright (c) 2023 Valve Corporation
+ * Copyright (c) 2023 LunarG, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -1203,356 +1373,90 @@ JSON_CODEGEN = """
  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
  * See the License for the specific language governing permissions and
  * limitations under the License.
- *
- * Author: Lenny Komow <lenny@lunarg.com>
- * Author: Joey Bzdek <joey@lunarg.com>
- * Author: Shannon McPherson <shannon@lunarg.com>
- * Author: David Pinedo <david@lunarg.com>
- * Author: Charles Giessen <charles@lunarg.com>
  */
 
 /*
  * This file is generated from the Khronos Vulkan XML API Registry.
  */
 
-#pragma once
+// Reflection tables walked by dump_reflected_call() in api_dump_reflection.cpp
 
 #include "api_dump.h"
-#include "api_dump_video_json.h"
-@if(not {isVideoGeneration})
-void dump_json_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents);
-@end if
-@foreach union
-void dump_json_{unName}(const {unName}& object, const ApiDumpSettings& settings, int indents);
-@end union
-
-//=========================== Type Implementations ==========================//
-
-@foreach type where('{etyName}' != 'void')
-void dump_json_{etyName}({etyName} object, const ApiDumpSettings& settings, int indents)
-{{
-
-    @if('{etyName}' != 'uint8_t' and '{etyName}' != 'int8_t')
-    settings.stream() << "\\"" << object << "\\"";
-    @end if
-    @if('{etyName}' == 'uint8_t')
-    settings.stream() << "\\"" << (uint32_t) object << "\\"";
-    @end if
-    @if('{etyName}' == 'int8_t')
-    settings.stream() << "\\"" << (int32_t) object << "\\"";
-    @end if
-}}
-@end type
-
-//========================= Basetype Implementations ========================//
-
-@foreach basetype where(not '{baseName}' in ['ANativeWindow', 'AHardwareBuffer', 'CAMetalLayer'])
-void dump_json_{baseName}({baseName} object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << "\\"" << object << "\\"";
-}}
-@end basetype
-@foreach basetype where('{baseName}' in ['ANativeWindow', 'AHardwareBuffer'])
-#if defined(VK_USE_PLATFORM_ANDROID_KHR)
-void dump_json_{baseName}(const {baseName}* object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << "\\"" << object << "\\"";
-}}
-#endif
-@end basetype
-@foreach basetype where('{baseName}' in ['CAMetalLayer'])
-#if defined(VK_USE_PLATFORM_METAL_EXT)
-void dump_json_{baseName}({baseName} object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << "\\"" << object << "\\"";
-}}
-#endif
-@end basetype
-
-//======================= System Type Implementations =======================//
-
-@foreach systype
-void dump_json_{sysName}(const {sysType} object, const ApiDumpSettings& settings, int indents)
-{{
-    @if({sysNeedsPointer} == True)
-    OutputAddressJSON(settings, object);
-    settings.stream() << "\\n";
-    @end if
-    @if({sysNeedsPointer} == False)
-    if (settings.showAddress())
-        settings.stream() << "\\"" << object << "\\"";
-    else
-        settings.stream() << "\\"address\\"";
-    @end if
-}}
-@end systype
-
-//========================== Handle Implementations =========================//
-
-@foreach handle
-void dump_json_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings, int indents)
-{{
-    if(settings.showAddress()) {{
-        settings.stream() << "\\"" << object << "\\"";
-    }} else {{
-        settings.stream() << "\\"address\\"";
-    }}
-}}
-@end handle
+#include "api_dump_backends.h"
+#include "api_dump_reflection.h"
 
-//=========================== Enum Implementations ==========================//
-
-@foreach enum
-void dump_json_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
-{{
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "\\"{optName}\\"";
-        break;
-    @end option
-    default:
-        settings.stream() << "\\"UNKNOWN (" << object << ")\\"";
-    }}
-}}
-@end enum
-
-//========================= Bitmask Implementations =========================//
-
-@foreach bitmask
-void dump_json_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
-{{
-    bool is_first = true;
-    settings.stream() << '"' << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ')';
-    settings.stream() << "\\"";
-}}
-@end bitmask
-
-//=========================== Flag Implementations ==========================//
+#include <cstddef>
 
-@foreach flag where('{flagEnum}' != 'None')
-void dump_json_{flagName}({flagName} object, const ApiDumpSettings& settings, int indents)
-{{
-    dump_json_{flagEnum}(({flagEnum}) object, settings, indents);
-}}
-@end flag
-@foreach flag where('{flagEnum}' == 'None')
-void dump_json_{flagName}({flagName} object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << '"' << object << "\\"";
-}}
-@end flag
-
-//======================= Func Pointer Implementations ======================//
-
-@foreach funcpointer
-void dump_json_{pfnName}({pfnName} object, const ApiDumpSettings& settings, int indents)
-{{
-    if(settings.showAddress())
-       settings.stream() << "\\"" << object << "\\"";
-    else
-        settings.stream() << "\\"address\\"";
-}}
-@end funcpointer
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
-//========================== Struct Implementations =========================//
+//============================ Struct Declarations ==========================//
 
 @foreach struct
-void dump_json_{sctName}(const {sctName}& object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << settings.indentation(indents) << "[\\n";
+extern const ApiDumpStructInfo api_dump_struct_info_{sctName};
+@end struct
+@foreach union
+extern const ApiDumpStructInfo api_dump_struct_info_{unName};
+@end union
 
-    @foreach member
-        @if('{memParameterStorage}' != '' and '{memCondition}' != 'None')
-    if({memCondition})
-        {memParameterStorage}
-        @end if
-        @if('{memParameterStorage}' != '' and '{memCondition}' == 'None')
-    {memParameterStorage}
-        @end if
-    @end member
+//================================= Structs =================================//
 
+@foreach struct
+static const ApiDumpMemberInfo api_dump_members_{sctName}[] = {{
     @foreach member
-        @if({memIndex} != 0)
-    settings.stream() << ",\\n";
-        @end if
-        @if('{memCondition}' != 'None')
-    if({memCondition})
-        @end if
-        @if({memPtrLevel} == 0)
-            @if('{memName}' != 'pNext')
-    dump_json_value<const {memBaseType}>(object.{memName}, NULL, settings, "{memType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID});
-            @end if
-            @if('{memName}' == 'pNext')
-    if(object.pNext != nullptr){{
-        dump_json_pNext_trampoline(object.{memName}, settings, indents + 1);
-    }} else {{
-        dump_json_value<const {memBaseType}>(object.{memName}, object.{memName}, settings, "{memType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID});
-    }}
-            @end if
-        @end if
-        @if({memPtrLevel} == 1 and '{memLength}' == 'None')
-    dump_json_pointer<const {memBaseType}>(object.{memName}, settings, "{memType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID});
-        @end if
-        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not {memLengthIsMember})
-    dump_json_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // IQA
-        @end if
-        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' != 'pCode')
-            @if('{memLength}'[0].isdigit() or '{memLength}'[0].isupper())
-    dump_json_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
-            @end if
-            @if(not ('{memLength}'[0].isdigit() or '{memLength}'[0].isupper()))
-                @if('{memLength}' == 'rasterizationSamples')
-    dump_json_array<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
-                @end if
-                @if('{memLength}' != 'rasterizationSamples')
-    dump_json_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
-                @end if
-            @end if
-        @end if
-        @if('{sctName}' == 'VkShaderModuleCreateInfo')
-            @if('{memName}' == 'pCode')
-    if(settings.showShader())
-        dump_json_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // KQA
-    else
-        dump_json_special("SHADER DATA", settings, "{memType}", "{memName}", indents + 1);
-            @end if
-        @end if
-
-        @if('{memCondition}' != 'None')
-    else
-        dump_json_UNUSED(settings, "{memType}", "{memName}", indents + 1);
-        @end if
+    {memReflInfo},
     @end member
-    settings.stream() << "\\n" << settings.indentation(indents) << "]";
-}}
+}};
+extern const ApiDumpStructInfo api_dump_struct_info_{sctName} = {{
+    "{sctName}", sizeof({sctName}), {sctStructureTypeIndex}, false, api_dump_members_{sctName}, ARRAY_SIZE(api_dump_members_{sctName})}};
 @end struct
 
-//========================== Union Implementations ==========================//
-@foreach union
-void dump_json_{unName}(const {unName}& object, const ApiDumpSettings& settings, int indents)
-{{
-    settings.stream() << settings.indentation(indents) << "[\\n";
+//================================= Unions ==================================//
 
+@foreach union
+static const ApiDumpMemberInfo api_dump_members_{unName}[] = {{
     @foreach choice
-    @if('{chcCondition}' != 'None')
-    if({chcCondition})
-    @end if
-    @if({chcIndex} != 0 and '{chcCondition}' == 'None')
-    settings.stream() << ",\\n"; // Only need commas when more than one field is printed
-    @end if
-    @if({chcPtrLevel} == 0)
-    dump_json_value<const {chcBaseType}>(object.{chcName}, NULL, settings, "{chcType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID});
-    @end if
-    @if({chcPtrLevel} == 1 and '{chcLength}' == 'None')
-    dump_json_pointer<const {chcBaseType}>(object.{chcName}, settings, "{chcType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID});
-    @end if
-    @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
-    dump_json_array<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID}); // OQA
-    @end if
+    {chcReflInfo},
     @end choice
-
-    settings.stream() << "\\n" << settings.indentation(indents) << "]";
-}}
+}};
+extern const ApiDumpStructInfo api_dump_struct_info_{unName} = {{
+    "{unName}", sizeof({unName}), -1, true, api_dump_members_{unName}, ARRAY_SIZE(api_dump_members_{unName})}};
 @end union
 
-//======================== pNext Chain Implementation =======================//
-@if(not {isVideoGeneration})
-void dump_json_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents)
-{{
-    switch((int64_t) (static_cast<const VkBaseInStructure*>(object)->sType)) {{
-    @foreach struct
-        @if({sctStructureTypeIndex} != -1)
-    case {sctStructureTypeIndex}:
-        dump_json_pNext<const {sctName}>(static_cast<const {sctName}*>(object), settings, "{sctName}", indents, dump_json_{sctName});
-        break;
-        @end if
-    @end struct
-
-    case VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO: // 47
-    case VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO: // 48
-        if(static_cast<const VkBaseInStructure*>(object)->pNext != nullptr){{
-            dump_json_pNext_trampoline(static_cast<const void*>(static_cast<const VkBaseInStructure*>(object)->pNext), settings, indents);
-        }} else {{
-            settings.stream() << settings.indentation(indents) << "{{\\n";
-            settings.stream() << settings.indentation(indents + 1) << "\\"type\\" : \\"const void*\\",\\n";
-            settings.stream() << settings.indentation(indents + 1) << "\\"name\\" : \\"pNext\\",\\n";
-            settings.stream() << settings.indentation(indents + 1) << "\\"value\\" : \\"NULL\\"\\n";
-            settings.stream() << settings.indentation(indents) << "}}";
-        }}
-        break;
-    default:
-        settings.stream() << settings.indentation(indents) << "{{\\n";
-        settings.stream() << settings.indentation(indents + 1) << "\\"type\\" : \\"const void*\\",\\n";
-        settings.stream() << settings.indentation(indents + 1) << "\\"name\\" : \\"pNext\\",\\n";
-        settings.stream() << settings.indentation(indents + 1) << "\\"value\\" : \\"UNKNOWN (" << (int64_t) (static_cast<const VkBaseInStructure*>(object)->sType) << ")\\"\\n";
-        settings.stream() << settings.indentation(indents) << "}}";
-    }}
-}}
-@end if
-//========================= Function Implementations ========================//
+//================================ Functions ================================//
 
-@foreach function where(not '{funcName}' in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+static const ApiDumpMemberInfo api_dump_params_{funcName}[] = {{
+    @foreach parameter
+    {prmReflInfo},
+    @end parameter
+}};
 @if('{funcReturn}' != 'void')
-void dump_json_{funcName}(ApiDumpInstance& dump_inst, {funcReturn} result, {funcTypedParams})
+static const ApiDumpMemberInfo api_dump_result_{funcName} = {funcReflResult};
+extern const ApiDumpFunctionInfo api_dump_function_info_{funcName} = {{
+    "{funcName}", &api_dump_result_{funcName}, api_dump_params_{funcName}, ARRAY_SIZE(api_dump_params_{funcName})}};
 @end if
 @if('{funcReturn}' == 'void')
-void dump_json_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
+extern const ApiDumpFunctionInfo api_dump_function_info_{funcName} = {{
+    "{funcName}", nullptr, api_dump_params_{funcName}, ARRAY_SIZE(api_dump_params_{funcName})}};
 @end if
-{{
-    const ApiDumpSettings& settings(dump_inst.settings());
+@end function
 
-    @if('{funcReturn}' != 'void')
-    settings.stream() << settings.indentation(3) << "\\\"returnValue\\\" : ";
-    dump_json_{funcReturn}(result, settings, 0);
-    if(settings.showParams())
-        settings.stream() << ",";
-    settings.stream() << "\\n";
-    @end if
+//============================== sType Lookup ===============================//
 
-    // Display parameter values
-    if(settings.showParams())
+const ApiDumpStructInfo* api_dump_struct_info_from_stype(int32_t s_type)
+{{
+    switch(s_type)
     {{
-        settings.stream() << settings.indentation(3) << "\\\"args\\\" :\\n";
-        settings.stream() << settings.indentation(3) << "[\\n";
-
-        @foreach parameter
-        @if({prmIndex} != 0)
-        settings.stream() << ",\\n";
-        @end if
-        @if('{prmParameterStorage}' != '')
-        {prmParameterStorage}
-        @end if
-        @if({prmPtrLevel} == 0)
-        dump_json_value<const {prmBaseType}>({prmName}, NULL, settings, "{prmType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID});
-        @end if
-        @if({prmPtrLevel} == 1 and '{prmLength}' == 'None')
-        dump_json_pointer<const {prmBaseType}>({prmName}, settings, "{prmType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID});
-        @end if
-        @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
-        dump_json_array<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID}); // PQA
+    @foreach struct
+        @if({sctStructureTypeIndex} != -1)
+    case {sctStructureTypeIndex}:
+        return &api_dump_struct_info_{sctName};
         @end if
-        @end parameter
-
-        settings.stream() << "\\n" << settings.indentation(3) << "]\\n";
+    @end struct
+    default:
+        return nullptr;
     }}
-    settings.stream() << settings.indentation(2) << "}}";
-    if (settings.shouldFlush()) settings.stream().flush();
 }}
-@end function
 """
 
 POINTER_TYPES = ['void', 'xcb_connection_t', 'Display', 'SECURITY_ATTRIBUTES', 'ANativeWindow', 'AHardwareBuffer', 'wl_display', '_screen_context', '_screen_window', '_screen_buffer']
@@ -1666,6 +1570,9 @@ VALIDITY_CHECKS = {
     }
 }
 
+# Largest run of unnamed values allowed inside one block of an enum name table before a new block is started
+ENUM_BLOCK_MAX_GAP = 8
+
 # These types are defined in both video.xml and vk.xml. Because duplicate functions aren't allowed,
 # we have to prevent these from generating twice. This is done by removing the types from the non-video
 # outputs
@@ -1819,33 +1726,14 @@ class ApiDumpOutputGenerator(OutputGenerator):
                             self.sysTypes[sysTypeName] = VulkanSystemType(sysTypeName, extension)
 
 
-        # Fill in the is_struct and is_union member variables of the Variable class so that json output can be correct
-
-        for value in self.functions.values():
-            for variable in value.parameters:
-                if variable.typeID in self.structs:
-                    variable.is_struct = True
-                if variable.typeID in self.unions:
-                    variable.is_union = True
-        for value in self.structs.values():
-            for variable in value.members:
-                if variable.typeID in self.structs:
-                    variable.is_struct = True
-                if variable.typeID in self.unions:
-                    variable.is_union = True
-        for value in self.unions.values():
-            for variable in value.choices:
-                if variable.typeID in self.structs:
-                    variable.is_struct = True
-                if variable.typeID in self.unions:
-                    variable.is_union = True
-
         # Replace any types that are aliases with the non-aliased type
         for struct in self.structs.values():
             for member in struct.members:
                 if member.typeID in self.aliases:
                     member.typeID = self.aliases[member.typeID]
 
+        if not self.isVideoGeneration:
+            self.genReflectionInfo()
 
         # Find every @foreach, @if, and @end
         forIter = re.finditer('(^\\s*\\@foreach\\s+[a-z]+(\\s+where\\(.*\\))?\\s*^)|(\\@foreach [a-z]+(\\s+where\\(.*\\))?\\b)', self.format, flags=re.MULTILINE)
@@ -1927,6 +1815,129 @@ class ApiDumpOutputGenerator(OutputGenerator):
 
         gen.OutputGenerator.endFile(self)
 
+    # Fills in the ApiDumpMemberInfo initializer of every struct member, union choice and function parameter.
+    # See layersvt/api_dump_reflection.h for the meaning of each field.
+    def genReflectionInfo(self):
+        for struct in self.structs.values():
+            for member in struct.members:
+                member.reflInfo = self.reflectionInfo(member, member.name, member.type, struct.name, None)
+        for union in self.unions.values():
+            for choice in union.choices:
+                choice.reflInfo = self.reflectionInfo(choice, choice.name, choice.type, union.name, None)
+        for function in self.functions.values():
+            for param in function.parameters:
+                param.reflInfo = self.reflectionInfo(param, param.name, param.type, None, function)
+            if function.returnType != 'void':
+                function.reflResult = self.reflectionElement(function.returnType, 'result', function.returnType, 0, '0', None, function)
+
+    # Returns (tag, size, struct info, enum names, bitmask names) of a non-pointer type
+    def reflectionType(self, typeID, name):
+        if typeID == 'cstring':
+            return ('CString', '0', 'nullptr', 'nullptr', 'nullptr')
+        if typeID in POINTER_TYPES:
+            return ('PNext' if name == 'pNext' else 'Void', '0', 'nullptr', 'nullptr', 'nullptr')
+        if typeID in self.structs:
+            return ('Struct', '0', '&api_dump_struct_info_' + typeID, 'nullptr', 'nullptr')
+        if typeID in self.unions:
+            return ('Union', '0', '&api_dump_struct_info_' + typeID, 'nullptr', 'nullptr')
+        if typeID in self.enums:
+            return ('Enum', 'sizeof({})'.format(typeID), 'nullptr', '&api_dump_enum_names_' + typeID, 'nullptr')
+        if typeID in self.bitmasks:
+            return ('Flags', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', '&api_dump_bitmask_names_' + typeID)
+        if typeID in self.flags:
+            flagEnum = self.flags[typeID].enum
+            if flagEnum in self.aliases:
+                flagEnum = self.aliases[flagEnum]
+            flagNames = '&api_dump_bitmask_names_' + flagEnum if flagEnum in self.bitmasks else 'nullptr'
+            return ('Flags', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', flagNames)
+        if typeID in self.handles:
+            return ('Handle', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', 'nullptr')
+        if typeID in self.funcPointers:
+            return ('FuncPointer', '0', 'nullptr', 'nullptr', 'nullptr')
+        if typeID == 'VkBool32':
+            return ('Bool32', 'sizeof(VkBool32)', 'nullptr', 'nullptr', 'nullptr')
+
+        scalar = typeID
+        if typeID in self.basetypes and self.basetypes[typeID].type is not None:
+            scalar = self.basetypes[typeID].type
+        if scalar in ['float', 'double']:
+            return ('Float', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', 'nullptr')
+        if scalar.startswith('uint') or scalar == 'size_t':
+            return ('UInt', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', 'nullptr')
+        if scalar.startswith('int') or scalar == 'char':
+            return ('SInt', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', 'nullptr')
+        return ('Opaque', 'sizeof({})'.format(typeID), 'nullptr', 'nullptr', 'nullptr')
+
+    # Wraps code in a captureless lambda that gets its variables from the context pointer of ApiDumpMemberInfo callbacks
+    def reflectionLambda(self, returnType, code, owner, function):
+        if owner is not None:
+            context = '[[maybe_unused]] const auto &object = *static_cast<const {} *>(context); '.format(owner)
+        else:
+            context = '[[maybe_unused]] const void *const *args = static_cast<const void *const *>(context); '
+            for param in function.parameters:
+                if re.search('\\b' + param.name + '\\b', code):
+                    paramType = param.childType + '*' if '[' in param.text else param.type
+                    context += 'const auto &{} = *static_cast<{} const *>(args[{}]); '.format(param.name, paramType, param.index)
+        if returnType == 'void':
+            return '[](const void *context) {{ {}{} }}'.format(context, code)
+        return '[](const void *context) -> {} {{ {}return {}; }}'.format(returnType, context, code)
+
+    def reflectionElement(self, typeID, name, typeName, pointerLevels, offset, owner, function, fixedLength='0', length='nullptr',
+                          condition='nullptr', store='nullptr', isShaderCode=False):
+        tag, size, structInfo, enumName, flagNames = self.reflectionType(typeID, name)
+        # Types that are only known by name can't be read, the last pointer to them is dumped as an address instead
+        if tag == 'Opaque' and pointerLevels > 0:
+            tag, size, pointerLevels = 'Void', '0', pointerLevels - 1
+        return '{{"{}", "{}", ApiDumpTypeTag::{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}}}'.format(
+            name, typeName, tag, size, pointerLevels, 'true' if isShaderCode else 'false', offset, fixedLength, length, condition,
+            store, structInfo, enumName, flagNames)
+
+    def reflectionInfo(self, variable, name, typeName, owner, function):
+        if owner is not None:
+            offset = 'offsetof({}, {})'.format(owner, name)
+            condition = 'nullptr' if variable.condition is None else self.reflectionLambda('bool', '(' + variable.condition + ')', owner, None)
+        else:
+            offset = str(variable.index)
+            condition = 'nullptr'
+        store = 'nullptr'
+        if variable.parameterStorage != '':
+            store = self.reflectionLambda('void', variable.parameterStorage, owner, function)
+
+        pointerLevels = variable.pointerLevels
+        fixedLength = '0'
+        length = 'nullptr'
+        typeID = variable.typeID
+        if variable.text.count('[') > 1:
+            # Multi dimensional arrays, such as VkTransformMatrixKHR::matrix, are dumped as their address
+            return '{{"{}", "{}", ApiDumpTypeTag::Opaque, 0, 0, false, {}, 0, nullptr, {}, {}, nullptr, nullptr, nullptr}}'.format(
+                name, typeName, offset, condition, store)
+        elif owner is not None and '[' in variable.text:
+            # Arrays stored in the struct, some of them are only partially filled
+            fixedLength = 'sizeof({0}::{1}) / sizeof({0}::{1}[0])'.format(owner, name)
+            pointerLevels = 0
+            if typeID == 'cstring':
+                return '{{"{}", "{}", ApiDumpTypeTag::CharArray, 0, 0, false, {}, {}, nullptr, {}, {}, nullptr, nullptr, nullptr}}'.format(
+                    name, typeName, offset, fixedLength, condition, store)
+            if variable.lengthMember:
+                length = self.reflectionLambda('uint64_t', self.reflectionLength(variable.arrayLength), owner, None)
+        elif pointerLevels == 1 and variable.arrayLength is not None and typeID not in POINTER_TYPES:
+            if owner is not None:
+                length = self.reflectionLambda('uint64_t', self.reflectionLength(variable.arrayLength), owner, None)
+            else:
+                length = self.reflectionLambda('uint64_t', variable.arrayLength, None, function)
+
+        isShaderCode = owner == 'VkShaderModuleCreateInfo' and name == 'pCode'
+        return self.reflectionElement(typeID, name, typeName, pointerLevels, offset, owner, function, fixedLength, length, condition,
+                                      store, isShaderCode)
+
+    # Length of a struct member array, written like the text back end does
+    def reflectionLength(self, arrayLength):
+        if arrayLength[0].isdigit() or arrayLength[0].isupper():
+            return arrayLength
+        if arrayLength == 'rasterizationSamples':
+            return '(object.rasterizationSamples + 31) / 32'
+        return 'object.' + arrayLength
+
     def genCmd(self, cmd, name, alias):
         gen.OutputGenerator.genCmd(self, cmd, name, alias)
 
@@ -2172,8 +2183,8 @@ class VulkanVariable:
         if self.typeID in PARAMETER_STATE and parentName in PARAMETER_STATE[self.typeID]:
             self.parameterStorage = PARAMETER_STATE[self.typeID][parentName]
 
-        self.is_struct = False
-        self.is_union = False
+        # ApiDumpMemberInfo initializer used by api_dump_reflection_tables.cpp, filled in by genReflectionInfo()
+        self.reflInfo = ''
 
 class VulkanBasetype:
 
@@ -2211,11 +2222,39 @@ class VulkanBitmask:
                 childName, childValue = ext.enumValues[self.name]
                 self.options.append(VulkanEnum.Option(childName, childValue, None, None))
 
+    # Builds the ApiDumpBitmaskNames tables: the name of each bit indexed by its position, and the values that must match
+    # exactly (those written with a value in the xml, such as 0 or a combination of bits). Each name keeps its position in
+    # the xml, so the names of a value are written in the same order as the options.
+    def nameTables(self):
+        bitNames = {}
+        bitOrder = {}
+        exactValues = []
+        for order, option in enumerate(self.options):
+            if option.multiValue is None:
+                bit = StrToInt(str(option.value)).bit_length() - 1
+                if bit not in bitNames:
+                    bitNames[bit] = option.name
+                    bitOrder[bit] = order
+            else:
+                exactValues.append('{{{}ULL, "{}", {}}}, '.format(option.value, option.name, order))
+        bitCount = max(bitNames) + 1 if len(bitNames) > 0 else 1
+        bitList = ',\n    '.join('"{}"'.format(bitNames[bit]) if bit in bitNames else 'nullptr' for bit in range(bitCount))
+        orderList = ', '.join(str(bitOrder.get(bit, 0)) for bit in range(bitCount))
+        return bitList, orderList, bitCount, ''.join(exactValues)
+
     def values(self):
+        # Computed on first use as values() is called for every option of nested loops
+        if not hasattr(self, 'nameTablesCache'):
+            self.nameTablesCache = self.nameTables()
+        bitList, orderList, bitCount, exactValues = self.nameTablesCache
         return {
             'bitName': self.name,
             'bitType': self.type,
             'bitWidth': self.width,
+            'bitNameList': bitList,
+            'bitOrderList': orderList,
+            'bitNameCount': bitCount,
+            'bitExactValues': exactValues,
         }
 
 def isPow2(num):
@@ -2307,10 +2346,38 @@ class VulkanEnum:
                     continue
                 self.options.append(VulkanEnum.Option(childName, childValue, None, None))
 
+    # Builds the ApiDumpEnumNames tables. Values are split in dense blocks, typically one for the core values and one for each
+    # extension, so a value is named by a search over a few blocks and an array access.
+    def nameTables(self):
+        names = {}
+        for option in self.options:
+            names.setdefault(StrToInt(str(option.value)), option.name)
+        blocks = []
+        for value in sorted(names):
+            if len(blocks) > 0 and value - blocks[-1][1] <= ENUM_BLOCK_MAX_GAP:
+                blocks[-1][1] = value
+            else:
+                blocks.append([value, value])
+        nameList = []
+        blockList = []
+        for first, last in blocks:
+            blockList.append('{{{}, {}, {}}}'.format(first, last - first + 1, len(nameList)))
+            nameList += ['"{}"'.format(names[value]) if value in names else 'nullptr' for value in range(first, last + 1)]
+        if len(blocks) == 0:
+            return 'nullptr', '{0, 0, 0}', 1
+        return ',\n    '.join(nameList), ', '.join(blockList), len(blocks)
+
     def values(self):
+        # Computed on first use as values() is called for every option of nested loops
+        if not hasattr(self, 'nameTablesCache'):
+            self.nameTablesCache = self.nameTables()
+        nameList, blockList, blockCount = self.nameTablesCache
         return {
             'enumName': self.name,
             'enumType': self.type,
+            'enumNameList': nameList,
+            'enumBlockList': blockList,
+            'enumBlockCount': blockCount,
         }
 
 class VulkanExtension:
@@ -2414,8 +2481,7 @@ class VulkanFunction:
                 'prmLength': self.arrayLength,
                 'prmParameterStorage': self.parameterStorage,
                 'prmIndex': self.index,
-                'prmIsStruct': 'true' if self.is_struct else 'false',
-                'prmIsUnion': 'true' if self.is_union else 'false'
+                'prmReflInfo': self.reflInfo,
             }
 
     def __init__(self, rootNode, constants, aliases, extensions):
@@ -2446,6 +2512,9 @@ class VulkanFunction:
         if self.name in TRACKED_STATE:
             self.stateTrackingCode = TRACKED_STATE[self.name]
 
+        # ApiDumpMemberInfo initializer of the return value, filled in by genReflectionInfo()
+        self.reflResult = ''
+
     def values(self):
         return {
             'funcName': self.name,
@@ -2457,6 +2526,9 @@ class VulkanFunction:
             'funcDispatchParam': self.parameters[0].name,
             'funcDispatchType' : self.dispatchType,
             'funcStateTrackingCode': self.stateTrackingCode,
+            'funcSerialized': 'true' if self.name in SERIALIZED_API_CALLS else 'false',
+            'funcParamAddresses': ', '.join('&' + p.name for p in self.parameters),
+            'funcReflResult': self.reflResult,
         }
 
 class VulkanFunctionPointer:
@@ -2510,8 +2582,7 @@ class VulkanStruct:
                 'memCondition': self.condition,
                 'memParameterStorage': self.parameterStorage,
                 'memIndex' : self.index,
-                'memIsStruct': 'true' if self.is_struct else 'false',
-                'memIsUnion': 'true' if self.is_union else 'false',
+                'memReflInfo': self.reflInfo,
             }
 
 
@@ -2610,8 +2681,7 @@ class VulkanUnion:
                 'chcCondition': self.condition,
                 #'chcLengthIsMember': self.lengthMember,
                 'chcIndex': self.index,
-                'chcIsStruct': 'true' if self.is_struct else 'false',
-                'chcIsUnion': 'true' if self.is_union else 'false',
+                'chcReflInfo': self.reflInfo,
             }
 
     def __init__(self, rootNode, constants):
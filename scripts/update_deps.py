@@ -703,7 +703,7 @@ def main():
         '--optional',
         dest='optional',
         type=lambda a: set(a.lower().split(',')),
-        help="Comma-separated list of 'optional' resources that may be skipped. Only 'tests' is currently supported as 'optional'",
+        help="Comma-separated list of 'optional' resources that may be skipped. 'tests' and 'benchmarks' are currently supported as 'optional'",
         default=set())
     parser.add_argument(
         '--cmake_var',
@@ -14,7 +14,7 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-import argparse, cProfile, pdb, string, sys, time, os
+import argparse, cProfile, pdb, pickle, string, sys, time, os
 
 # Simple timer functions
 startTime = None
@@ -153,13 +153,13 @@ def makeGenOpts(args):
             expandEnumerants = False)
         ]
 
-    # API dump generator options for api_dump_text.h
-    genOpts['api_dump_text.h'] = [
+    # API dump generator options for api_dump_backends.h
+    genOpts['api_dump_backends.h'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
-            input             = TEXT_CODEGEN,
-            filename          = 'api_dump_text.h',
+            input             = BACKENDS_CODEGEN,
+            filename          = 'api_dump_backends.h',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -179,16 +179,16 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
-    ]
+            expandEnumerants = False)
+        ]
 
-    # API dump generator options for api_dump_video_text.h
-    genOpts['api_dump_video_text.h'] = [
+    # API dump generator options for api_dump_text.cpp
+    genOpts['api_dump_text.cpp'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
             input             = TEXT_CODEGEN,
-            filename          = 'api_dump_video_text.h',
+            filename          = 'api_dump_text.cpp',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -208,17 +208,16 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False,
-            isVideoGeneration = True)
+            expandEnumerants  = False)
     ]
 
-    # API dump generator options for api_dump_html.h
-    genOpts['api_dump_html.h'] = [
+    # API dump generator options for api_dump_video_text.h
+    genOpts['api_dump_video_text.h'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
-            input             = HTML_CODEGEN,
-            filename          = 'api_dump_html.h',
+            input             = TEXT_CODEGEN,
+            filename          = 'api_dump_video_text.h',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -238,16 +237,17 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
+            expandEnumerants  = False,
+            isVideoGeneration = True)
     ]
 
-     # API dump generator options for api_dump_video_html.h
-    genOpts['api_dump_video_html.h'] = [
+    # API dump generator options for api_dump_html.cpp
+    genOpts['api_dump_html.cpp'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
             input             = HTML_CODEGEN,
-            filename          = 'api_dump_video_html.h',
+            filename          = 'api_dump_html.cpp',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -267,17 +267,16 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False,
-            isVideoGeneration = True)
+            expandEnumerants  = False)
     ]
 
-    # API dump generator options for api_dump_json.h
-    genOpts['api_dump_json.h'] = [
+     # API dump generator options for api_dump_video_html.h
+    genOpts['api_dump_video_html.h'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
-            input             = JSON_CODEGEN,
-            filename          = 'api_dump_json.h',
+            input             = HTML_CODEGEN,
+            filename          = 'api_dump_video_html.h',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -297,16 +296,17 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
+            expandEnumerants  = False,
+            isVideoGeneration = True)
     ]
 
-    # API dump generator options for api_dump_video_json.h
-    genOpts['api_dump_video_json.h'] = [
+    # API dump generator options for api_dump_reflection_tables.cpp
+    genOpts['api_dump_reflection_tables.cpp'] = [
         ApiDumpOutputGenerator,
         ApiDumpGeneratorOptions(
             conventions       = conventions,
-            input             = JSON_CODEGEN,
-            filename          = 'api_dump_video_json.h',
+            input             = REFLECTION_CODEGEN,
+            filename          = 'api_dump_reflection_tables.cpp',
             apiname           = 'vulkan',
             genpath           = None,
             profile           = None,
@@ -326,8 +326,7 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False,
-            isVideoGeneration = True)
+            expandEnumerants  = False)
     ]
 
 
@@ -386,41 +385,92 @@ def makeGenOpts(args):
 # This is encapsulated in a function so it can be profiled and/or timed.
 # The args parameter is an parsed argument object containing the following
 # fields that are used:
-#   target - target to generate
 #   directory - directory to generate it in
 #   protect - True if re-inclusion wrappers should be created
 #   extensions - list of additional extensions to include in generated
 #   interfaces
-def genTarget(args):
+# The target parameter is the name of the target to generate.
+def genTarget(args, target):
     global genOpts
 
     # Create generator options with parameters specified on command line
     makeGenOpts(args)
 
     # Select a generator matching the requested target
-    if (args.target in genOpts.keys()):
-        createGenerator = genOpts[args.target][0]
-        options = genOpts[args.target][1]
-
-        #if not args.quiet:
-           # write('* Building', options.filename, file=sys.stderr)
-           # write('* options.versions          =', options.versions, file=sys.stderr)
-           # write('* options.emitversions      =', options.emitversions, file=sys.stderr)
-           # write('* options.defaultExtensions =', options.defaultExtensions, file=sys.stderr)
-           # write('* options.addExtensions     =', options.addExtensions, file=sys.stderr)
-           # write('* options.removeExtensions  =', options.removeExtensions, file=sys.stderr)
-           # write('* options.emitExtensions    =', options.emitExtensions, file=sys.stderr)
+    if (target in genOpts.keys()):
+        createGenerator = genOpts[target][0]
+        options = genOpts[target][1]
 
         gen = createGenerator(errFile=errWarn,
                               warnFile=errWarn,
                               diagFile=diag)
-        if not args.quiet:
-            write('* Generated', options.filename, file=sys.stderr)
         return (gen, options)
     else:
-        write('No generator options for unknown target:', args.target, file=sys.stderr)
+        write('No generator options for unknown target:', target, file=sys.stderr)
         return None
 
+# The registry file a target is generated from. Targets for the video std headers
+# use -videoRegistry when it is given, so every output can be generated in one run.
+def targetRegistry(args, options):
+    if args.videoRegistry is not None and getattr(options, 'isVideoGeneration', False):
+        return args.videoRegistry
+    return args.registry
+
+# Key identifying a cached registry. The cache is only reused if the registry XML
+# and the registry scripts are unchanged and the same python version is running.
+def registryCacheKey(registryFile, options):
+    key = [sys.version, options.apiname]
+    for path in [registryFile, sys.modules['reg'].__file__]:
+        stat = os.stat(path)
+        key += [os.path.abspath(path), stat.st_mtime_ns, stat.st_size]
+    return key
+
+def registryCachePath(args, registryFile):
+    return os.path.join(args.registryCache, os.path.basename(registryFile) + '.cache')
+
+# Load the registry from the cache written by a previous run, returning None if
+# there is no usable cache.
+def loadCachedRegistry(args, registryFile, gen, options):
+    if args.registryCache is None:
+        return None
+    try:
+        with open(registryCachePath(args, registryFile), 'rb') as cacheFile:
+            (key, state) = pickle.load(cacheFile)
+    except Exception:
+        return None
+    if key != registryCacheKey(registryFile, options):
+        return None
+    reg = Registry(gen, options)
+    reg.__dict__.update(state)
+    attachGenerator(reg, gen, options)
+    return reg
+
+# Save the loaded registry so that the next run can skip parsing the XML. This must
+# happen before apiGen() as generation marks the registry entries as required.
+def saveCachedRegistry(args, registryFile, options, reg):
+    if args.registryCache is None:
+        return
+    state = dict(reg.__dict__)
+    state['gen'] = None
+    state['genOpts'] = None
+    cachePath = registryCachePath(args, registryFile)
+    try:
+        os.makedirs(args.registryCache, exist_ok=True)
+        with open(cachePath + '.tmp', 'wb') as cacheFile:
+            pickle.dump((registryCacheKey(registryFile, options), state), cacheFile, protocol=pickle.HIGHEST_PROTOCOL)
+        os.replace(cachePath + '.tmp', cachePath)
+    except Exception as e:
+        # The cache is only an optimization, generation still succeeds without it
+        if not args.quiet:
+            write('* Could not write registry cache', cachePath, ':', e, file=sys.stderr)
+
+# Point an already loaded registry at the generator for the next target
+def attachGenerator(reg, gen, options):
+    reg.setGenerator(gen)
+    reg.genOpts = options
+    gen.genOpts = options
+    options.registry = reg
+
 # -feature name
 # -extension name
 # For both, "name" may be a single name, or a space-separated list
@@ -469,8 +519,14 @@ if __name__ == '__main__':
     parser.add_argument('-o', action='store', dest='directory',
                         default='.',
                         help='Create target and related files in specified directory')
-    parser.add_argument('target', metavar='target', nargs='?',
-                        help='Specify target')
+    parser.add_argument('-videoRegistry', action='store',
+                        default=None,
+                        help='Use specified registry file for the video std targets')
+    parser.add_argument('-registryCache', action='store',
+                        default=None,
+                        help='Cache the parsed registries in the specified directory between runs')
+    parser.add_argument('target', metavar='target', nargs='+',
+                        help='Specify target(s), all targets are generated in a single run')
     parser.add_argument('-quiet', action='store_true', default=False,
                         help='Suppress script output during normal execution.')
 
@@ -490,7 +546,7 @@ if __name__ == '__main__':
 
     # VulkanTools generator additions
     from tool_helper_file_generator import ToolHelperFileOutputGenerator, ToolHelperFileOutputGeneratorOptions
-    from api_dump_generator import ApiDumpGeneratorOptions, ApiDumpOutputGenerator, COMMON_CODEGEN, TEXT_CODEGEN, HTML_CODEGEN, JSON_CODEGEN
+    from api_dump_generator import ApiDumpGeneratorOptions, ApiDumpOutputGenerator, COMMON_CODEGEN, BACKENDS_CODEGEN, TEXT_CODEGEN, HTML_CODEGEN, REFLECTION_CODEGEN
     from vkconventions import VulkanConventions
 
     # This splits arguments which are space-separated lists
@@ -508,37 +564,58 @@ if __name__ == '__main__':
     else:
         diag = None
 
-    # Create the API generator & generator options
-    (gen, options) = genTarget(args)
-
-    # Create the registry object with the specified generator and generator
-    # options. The options are set before XML loading as they may affect it.
-    reg = Registry(gen, options)
-
-    # Parse the specified registry XML into an ElementTree object
-    startTimer(args.time)
-    tree = etree.parse(args.registry)
-    endTimer(args.time, '* Time to make ElementTree =')
-
-    # Load the XML tree into the registry object
-    startTimer(args.time)
-    reg.loadElementTree(tree)
-    endTimer(args.time, '* Time to parse ElementTree =')
-
-    if (args.validate):
-        reg.validateGroups()
-
-    if (args.dump):
-        write('* Dumping registry to regdump.txt', file=sys.stderr)
-        reg.dumpReg(filehandle = open('regdump.txt', 'w', encoding='utf-8'))
-
-    # Finally, use the output generator to create the requested target
-    if (args.debug):
-        pdb.run('reg.apiGen()')
-    else:
-        startTimer(args.time)
-        reg.apiGen()
-        endTimer(args.time, '* Time to generate ' + options.filename + ' =')
-
-    if not args.quiet:
-        write('* Generated ', options.filename, file=sys.stderr)
+    # Group the targets by registry file, so that each registry is only parsed once
+    # no matter how many targets are generated from it.
+    targetsByRegistry = {}
+    for target in args.target:
+        genTargetResult = genTarget(args, target)
+        if genTargetResult is None:
+            sys.exit(1)
+        targetsByRegistry.setdefault(targetRegistry(args, genTargetResult[1]), []).append(genTargetResult)
+
+    for registryFile, targets in targetsByRegistry.items():
+        reg = None
+        for (gen, options) in targets:
+            if reg is None:
+                startTimer(args.time)
+                reg = loadCachedRegistry(args, registryFile, gen, options)
+                endTimer(args.time, '* Time to load cached registry =')
+
+            if reg is None:
+                # Create the registry object with the specified generator and generator
+                # options. The options are set before XML loading as they may affect it.
+                reg = Registry(gen, options)
+
+                # Parse the specified registry XML into an ElementTree object
+                startTimer(args.time)
+                tree = etree.parse(registryFile)
+                endTimer(args.time, '* Time to make ElementTree =')
+
+                # Load the XML tree into the registry object
+                startTimer(args.time)
+                reg.loadElementTree(tree)
+                endTimer(args.time, '* Time to parse ElementTree =')
+
+                saveCachedRegistry(args, registryFile, options, reg)
+
+                if (args.validate):
+                    reg.validateGroups()
+
+                if (args.dump):
+                    write('* Dumping registry to regdump.txt', file=sys.stderr)
+                    reg.dumpReg(filehandle = open('regdump.txt', 'w', encoding='utf-8'))
+            else:
+                # Reuse the registry loaded for the previous target
+                attachGenerator(reg, gen, options)
+                reg.apiReset()
+
+            # Finally, use the output generator to create the requested target
+            if (args.debug):
+                pdb.run('reg.apiGen()')
+            else:
+                startTimer(args.time)
+                reg.apiGen()
+                endTimer(args.time, '* Time to generate ' + options.filename + ' =')
+
+            if not args.quiet:
+                write('* Generated ', options.filename, file=sys.stderr)